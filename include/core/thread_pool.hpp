@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SFSim {
+namespace Core {
+
+// Persistent worker threads for data-parallel loops. The calling thread
+// works alongside the pool, and calls made from inside a task (or while
+// another parallelFor is running) simply run inline.
+class ThreadPool {
+public:
+    using RangeTask = std::function<void(size_t begin, size_t end)>;
+    
+    static ThreadPool& getInstance();
+    
+    explicit ThreadPool(unsigned int workerCount);
+    ~ThreadPool();
+    
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    
+    unsigned int getThreadCount() const { return static_cast<unsigned int>(_workers.size()) + 1; }
+    
+    void parallelFor(size_t count, size_t grainSize, const RangeTask& task);
+    
+    // For systems with a parallel threshold, where 0 keeps everything on the
+    // calling thread: whether count items are enough to split.
+    static bool exceedsThreshold(size_t count, size_t threshold) { return threshold != 0 && count >= threshold; }
+    // parallelFor on the shared pool when parallel is set; otherwise the
+    // whole range runs inline, without starting the pool.
+    static void parallelForIf(bool parallel, size_t count, size_t grainSize, const RangeTask& task);
+    
+private:
+    std::vector<std::thread> _workers;
+    
+    std::mutex _submitMutex;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _finished;
+    
+    const RangeTask* _task;
+    size_t _count;
+    size_t _grainSize;
+    std::atomic<size_t> _next;
+    unsigned int _activeWorkers;
+    unsigned long long _generation;
+    bool _stopping;
+    
+    void workerLoop();
+    void runChunks();
+};
+
+} // namespace Core
+} // namespace SFSim
\ No newline at end of file
@@ -11,6 +11,9 @@ class Entity;
 enum class ComponentType {
     Transform,
     Render,
+    Light,
+    Rigidbody,
+    Collider,
     Custom
 };
 
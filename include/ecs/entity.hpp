@@ -40,6 +40,7 @@ public:
         
         component->_entity = this;
         _components[type] = std::move(component);
+        touchComponents();
         
         ptr->onAttach();
         return ptr;
@@ -79,17 +80,28 @@ public:
             it->second->onDetach();
             it->second->_entity = nullptr;
             _components.erase(it);
+            touchComponents();
         }
     }
     
     void removeAllComponents();
     
+    // Changes whenever a component is added or removed or the entity is
+    // (de)activated, so systems can keep component pointers across frames
+    // and only look them up again then. No two entities ever share a
+    // version, even one created where a destroyed one used to be.
+    unsigned int getComponentVersion() const { return _componentVersion; }
+    // The newest version of any entity. While it stays the same, no entity
+    // was created, destroyed or changed in any of those ways, and lists of
+    // entities with given components are still valid.
+    static unsigned int getLatestComponentVersion();
+    
     std::vector<Component*> getAllComponents();
     std::vector<const Component*> getAllComponents() const;
     
     void update(float deltaTime);
     
-    void setActive(bool active) { _active = active; }
+    void setActive(bool active) { if (active != _active) { _active = active; touchComponents(); } }
     bool isActive() const { return _active; }
     
     void setName(const std::string& name) { _name = name; }
@@ -120,10 +132,13 @@ public:
     }
     
 private:
+    void touchComponents();
+    
     EntityID _id;
     std::unordered_map<std::type_index, std::unique_ptr<Component>> _components;
     std::vector<std::unique_ptr<Component>> _customComponents;
     bool _active;
+    unsigned int _componentVersion;
     std::string _name;
 };
 
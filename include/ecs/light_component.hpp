@@ -0,0 +1,46 @@
+#pragma once
+
+#include "component.hpp"
+#include "renderer/lighting.hpp"
+
+namespace SFSim {
+namespace ECS {
+
+class LightComponent : public ComponentBase<LightComponent> {
+public:
+    LightComponent();
+    LightComponent(LightType type, const sf::Color& color = sf::Color::White, float intensity = 1.0f);
+    
+    ComponentType getComponentType() const override { return ComponentType::Light; }
+    
+    void setLightType(LightType type) { _light.type = type; }
+    LightType getLightType() const { return _light.type; }
+    
+    void setColor(const sf::Color& color) { _light.color = color; }
+    const sf::Color& getColor() const { return _light.color; }
+    
+    void setIntensity(float intensity) { _light.intensity = intensity; }
+    float getIntensity() const { return _light.intensity; }
+    
+    void setRange(float range) { _light.range = range; }
+    float getRange() const { return _light.range; }
+    
+    void setSpotAngles(float innerConeAngle, float outerConeAngle);
+    float getInnerConeAngle() const { return _light.innerConeAngle; }
+    float getOuterConeAngle() const { return _light.outerConeAngle; }
+    
+    void setDirection(const Vector3f& direction) { _light.direction = direction; }
+    const Vector3f& getDirection() const { return _light.direction; }
+    
+    void setEnabled(bool enabled) { _enabled = enabled; }
+    bool isEnabled() const { return _enabled; }
+    
+    Light getWorldLight() const;
+    
+private:
+    Light _light;
+    bool _enabled;
+};
+
+} // namespace ECS
+} // namespace SFSim
\ No newline at end of file
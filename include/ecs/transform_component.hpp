@@ -2,6 +2,7 @@
 
 #include "component.hpp"
 #include "transform.hpp"
+#include "transform_hierarchy.hpp"
 
 namespace SFSim {
 namespace ECS {
@@ -10,31 +11,58 @@ class TransformComponent : public ComponentBase<TransformComponent> {
 public:
     TransformComponent();
     TransformComponent(const Vector3f& position, const Vector3f& rotation = Vector3f::zero(), const Vector3f& scale = Vector3f::one());
+    ~TransformComponent() override;
+    
+    TransformComponent(const TransformComponent&) = delete;
+    TransformComponent& operator=(const TransformComponent&) = delete;
     
     ComponentType getComponentType() const override { return ComponentType::Transform; }
     
     Transform& getTransform() { return _transform; }
     const Transform& getTransform() const { return _transform; }
     
-    void setPosition(const Vector3f& position) { _transform.setPosition(position); }
-    void setRotation(const Vector3f& rotation) { _transform.setRotation(rotation); }
-    void setScale(const Vector3f& scale) { _transform.setScale(scale); }
-    void setScale(float scale) { _transform.setScale(scale); }
+    void setPosition(const Vector3f& position) { _transform.setPosition(position); syncHierarchy(); }
+    void setRotation(const Vector3f& rotation) { _transform.setRotation(rotation); syncHierarchy(); }
+    void setOrientation(const Quaternion& orientation) { _transform.setOrientation(orientation); syncHierarchy(); }
+    void setScale(const Vector3f& scale) { _transform.setScale(scale); syncHierarchy(); }
+    void setScale(float scale) { _transform.setScale(scale); syncHierarchy(); }
     
     const Vector3f& getPosition() const { return _transform.getPosition(); }
     const Vector3f& getRotation() const { return _transform.getRotation(); }
+    const Quaternion& getOrientation() const { return _transform.getOrientation(); }
     const Vector3f& getScale() const { return _transform.getScale(); }
     
-    void translate(const Vector3f& translation) { _transform.translate(translation); }
-    void rotate(const Vector3f& rotation) { _transform.rotate(rotation); }
-    void scaleBy(const Vector3f& scale) { _transform.scaleBy(scale); }
-    void scaleBy(float scale) { _transform.scaleBy(scale); }
+    void translate(const Vector3f& translation) { _transform.translate(translation); syncHierarchy(); }
+    void rotate(const Vector3f& rotation) { _transform.rotate(rotation); syncHierarchy(); }
+    void rotate(const Quaternion& rotation) { _transform.rotate(rotation); syncHierarchy(); }
+    void scaleBy(const Vector3f& scale) { _transform.scaleBy(scale); syncHierarchy(); }
+    void scaleBy(float scale) { _transform.scaleBy(scale); syncHierarchy(); }
+    
+    // Moves this transform into a flat hierarchy node. While bound, the
+    // world matrix comes from the hierarchy (as of its last update()) and
+    // changes must go through this component's setters, not getTransform().
+    void bindToHierarchy(TransformHierarchy& hierarchy, const TransformComponent* parent = nullptr);
+    void unbindFromHierarchy();
+    bool isInHierarchy() const { return _hierarchy != nullptr; }
+    TransformHierarchy::NodeId getHierarchyNode() const { return _node; }
+    
+    // Both components must be bound to the same hierarchy; fails on cycles.
+    bool setParent(const TransformComponent* parent);
     
     const Matrix4x4& getLocalMatrix() const { return _transform.getLocalMatrix(); }
-    const Matrix4x4& getWorldMatrix() const { return _transform.getWorldMatrix(); }
+    Matrix4x4 getWorldMatrix() const {
+        return _hierarchy ? _hierarchy->getWorldMatrix(_node) : _transform.getWorldMatrix();
+    }
+    Matrix4x4 getInverseWorldMatrix() const {
+        return _hierarchy ? _hierarchy->getWorldMatrix(_node).invertedAffine() : _transform.getInverseWorldMatrix();
+    }
     
 private:
     Transform _transform;
+    TransformHierarchy* _hierarchy;
+    TransformHierarchy::NodeId _node;
+    
+    void syncHierarchy();
 };
 
 } // namespace ECS
@@ -9,6 +9,8 @@ namespace SFSim {
 
 using namespace Math;
 
+class LightEnvironment;
+
 enum class GeometryType {
     Point,
     Line,
@@ -26,6 +28,13 @@ public:
     virtual void draw(sf::RenderWindow& window, const Matrix4x4& transform, const Matrix4x4& viewProjection) = 0;
     virtual std::vector<Vector3f> getVertices() const = 0;
     virtual void setColor(const sf::Color& color) = 0;
+    virtual void setLightEnvironment(const LightEnvironment* lighting) {}
+    
+    // Geometry that shares a material id can be merged into one draw call by
+    // appending its screen-space triangles to a shared buffer. Returns false
+    // when the geometry has to be drawn on its own.
+    virtual unsigned int getMaterialId() const { return 0; }
+    virtual bool appendTriangles(std::vector<sf::Vertex>& batch, sf::RenderWindow& window, const Matrix4x4& transform, const Matrix4x4& viewProjection) { return false; }
     
 protected:
     GeometryType _type;
@@ -2,12 +2,19 @@
 
 #include "geometry.hpp"
 #include "renderer/material.hpp"
+#include "renderer/triangle_setup.hpp"
 #include <vector>
 #include <memory>
 #include <string>
+#include <functional>
 
 namespace SFSim {
 
+namespace Physics {
+class MeshBVH;
+class ConvexHull;
+}
+
 struct Vertex {
     Vector3f position;
     Vector3f normal;
@@ -26,30 +33,63 @@ public:
     
     void setVertices(const std::vector<Vertex>& vertices);
     void setIndices(const std::vector<unsigned int>& indices);
+    // Interned, so meshes given equivalent materials share one instance and
+    // one render batch; null means the default material.
     void setMaterial(std::shared_ptr<Material> material);
     
     const std::vector<Vertex>& getMeshVertices() const { return _vertices; }
     const std::vector<unsigned int>& getIndices() const { return _indices; }
-    std::shared_ptr<Material> getMaterial() const { return _material; }
+    // Materials are interned and may be shared with other meshes, so they
+    // are read-only here; editMaterial() changes a copy and interns that.
+    std::shared_ptr<const Material> getMaterial() const { return _material; }
+    void editMaterial(const std::function<void(Material&)>& edit);
     
     void addVertex(const Vertex& vertex);
     void addTriangle(unsigned int a, unsigned int b, unsigned int c);
     void addQuad(unsigned int a, unsigned int b, unsigned int c, unsigned int d);
     
+    // Rewrites every vertex's position in place as positionOf(index), for
+    // meshes deformed every frame (soft bodies): nothing is reallocated and
+    // the rest of each vertex is left alone.
+    template<typename PositionOf>
+    void updatePositions(PositionOf positionOf);
+    
     void calculateNormals();
+    // Recomputes just the normals of these vertices, each from the
+    // triangles around it, for when only part of a mesh has moved. Which
+    // triangles meet at each vertex is worked out once and kept until the
+    // indices or the number of vertices change.
+    void calculateNormals(const std::vector<unsigned int>& vertices);
     void calculateTangents();
     
+    void setSmoothShading(bool smooth) { _smoothShading = smooth; }
+    bool isSmoothShading() const { return _smoothShading; }
+    
     void clear();
     
     void draw(sf::RenderWindow& window, const Matrix4x4& transform, const Matrix4x4& viewProjection) override;
     std::vector<Vector3f> getVertices() const override;
     void setColor(const sf::Color& color) override;
+    void setLightEnvironment(const LightEnvironment* lighting) override { _lighting = lighting; }
+    
+    unsigned int getMaterialId() const override { return _material->getId(); }
+    bool appendTriangles(std::vector<sf::Vertex>& batch, sf::RenderWindow& window, const Matrix4x4& transform, const Matrix4x4& viewProjection) override;
     
     static std::unique_ptr<MeshGeometry> createCube(float size = 1.0f);
     static std::unique_ptr<MeshGeometry> createSphere(float radius = 1.0f, int segments = 16, int rings = 16);
     static std::unique_ptr<MeshGeometry> createPlane(float width = 1.0f, float height = 1.0f, int widthSegments = 1, int heightSegments = 1);
     static std::unique_ptr<MeshGeometry> createGrid(float size = 10.0f, int divisions = 10);
     
+    const TriangleSetup::Statistics& getSetupStatistics() const { return _setup.getStatistics(); }
+    
+    // Triangle BVH for precise raycasts, built on first use and shared by
+    // every collider that takes it. Rebuilt after the mesh's positions or
+    // indices change.
+    std::shared_ptr<const Physics::MeshBVH> getBVH() const;
+    // Convex hull of the vertex positions, for ConvexHull colliders; built,
+    // shared and rebuilt like the BVH, but only when positions change.
+    std::shared_ptr<const Physics::ConvexHull> getConvexHull() const;
+    
     static std::unique_ptr<MeshGeometry> loadFromOBJ(const std::string& filename);
     bool saveToOBJ(const std::string& filename) const;
     
@@ -58,10 +98,52 @@ private:
     std::vector<unsigned int> _indices;
     std::shared_ptr<Material> _material;
     
+    TriangleSetup _setup;
+    std::vector<sf::Vertex> _drawBuffer;
+    bool _smoothShading;
+    const LightEnvironment* _lighting;
+    
+    struct LightingCache {
+        const Material* material;
+        unsigned int materialVersion;
+        unsigned int meshVersion;
+        const LightEnvironment* lighting;
+        unsigned int lightingVersion;
+        Matrix4x4 transform;
+        bool valid;
+    };
+    
+    unsigned int _meshVersion;
+    LightingCache _lightingCache;
+    mutable std::shared_ptr<const Physics::MeshBVH> _bvh;
+    mutable bool _bvhDirty;
+    mutable std::shared_ptr<const Physics::ConvexHull> _hull;
+    mutable bool _hullDirty;
+    // The triangles around vertex v are _vertexTriangles[_vertexTriangleStart[v]]
+    // up to the next vertex's start.
+    std::vector<unsigned int> _vertexTriangleStart;
+    std::vector<unsigned int> _vertexTriangles;
+    bool _adjacencyDirty;
+    std::vector<Vector3f> _worldPositions;
+    std::vector<Vector3f> _worldNormals;
+    std::vector<sf::Color> _vertexColors;
+    
+    void buildAdjacency();
+    void updateVertexLighting(const Matrix4x4& transform, const LightEnvironment& lighting);
+    void setupTriangles(sf::RenderWindow& window, const Matrix4x4& transform, const Matrix4x4& viewProjection, bool cullBackfaces);
     void drawWireframe(sf::RenderWindow& window, const Matrix4x4& transform, const Matrix4x4& viewProjection);
     void drawFilled(sf::RenderWindow& window, const Matrix4x4& transform, const Matrix4x4& viewProjection);
-    void drawTriangle(sf::RenderWindow& window, const Vertex& a, const Vertex& b, const Vertex& c, 
-                     const Matrix4x4& transform, const Matrix4x4& viewProjection);
+    void buildFilled(sf::RenderWindow& window, const Matrix4x4& transform, const Matrix4x4& viewProjection);
 };
 
+template<typename PositionOf>
+void MeshGeometry::updatePositions(PositionOf positionOf) {
+    for (size_t i = 0; i < _vertices.size(); ++i) {
+        _vertices[i].position = positionOf(i);
+    }
+    ++_meshVersion;
+    _bvhDirty = true;
+    _hullDirty = true;
+}
+
 } // namespace SFSim
\ No newline at end of file
@@ -1,11 +1,33 @@
 #pragma once
 
 #include "vector.hpp"
+#include "quaternion.hpp"
+#include "simd.hpp"
 #include <cmath>
+#include <cstddef>
 
 namespace SFSim {
 namespace Math {
 
+// Top three rows of out[i] = a * b[i] for affine matrices laid out with the
+// given stride (16 for Matrix4x4, 12 for Matrix3x4). a's coefficients are
+// broadcast once for the whole run; out may alias b.
+inline void multiplyAffineRows(const float* a, const float* b, float* out, size_t count, size_t stride) {
+    const Float4 a00(a[0]), a01(a[1]), a02(a[2]), t0(0.0f, 0.0f, 0.0f, a[3]);
+    const Float4 a10(a[4]), a11(a[5]), a12(a[6]), t1(0.0f, 0.0f, 0.0f, a[7]);
+    const Float4 a20(a[8]), a21(a[9]), a22(a[10]), t2(0.0f, 0.0f, 0.0f, a[11]);
+    
+    for (size_t i = 0; i < count; ++i, b += stride, out += stride) {
+        Float4 b0 = Float4::load(b);
+        Float4 b1 = Float4::load(b + 4);
+        Float4 b2 = Float4::load(b + 8);
+        
+        (a00 * b0 + a01 * b1 + a02 * b2 + t0).store(out);
+        (a10 * b0 + a11 * b1 + a12 * b2 + t1).store(out + 4);
+        (a20 * b0 + a21 * b1 + a22 * b2 + t2).store(out + 8);
+    }
+}
+
 class Matrix4x4 {
 public:
     float m[16];
@@ -188,6 +210,76 @@ public:
         *this = inverted();
     }
     
+    // Bottom row 0 0 0 1: every TRS, view and orthographic matrix.
+    bool isAffine() const {
+        return m[12] == 0 && m[13] == 0 && m[14] == 0 && m[15] == 1;
+    }
+    
+    // Product of two affine matrices (3x4 blocks), skipping the bottom row.
+    Matrix4x4 multipliedAffine(const Matrix4x4& other) const {
+        Matrix4x4 result;
+        multiplyAffine(*this, &other, &result, 1);
+        return result;
+    }
+    
+    // out[i] = a * b[i] for a run of affine matrices. out may alias b.
+    static void multiplyAffine(const Matrix4x4& a, const Matrix4x4* b, Matrix4x4* out, size_t count) {
+        multiplyAffineRows(a.m, &b->m[0], &out->m[0], count, 16);
+        for (size_t i = 0; i < count; ++i) {
+            out[i].m[12] = 0.0f;
+            out[i].m[13] = 0.0f;
+            out[i].m[14] = 0.0f;
+            out[i].m[15] = 1.0f;
+        }
+    }
+    
+    // Inverse of an affine matrix: invert the 3x3 block, then -inv(A) * t.
+    Matrix4x4 invertedAffine() const {
+        float c00 = m[5] * m[10] - m[6] * m[9];
+        float c01 = m[6] * m[8] - m[4] * m[10];
+        float c02 = m[4] * m[9] - m[5] * m[8];
+        
+        float det = m[0] * c00 + m[1] * c01 + m[2] * c02;
+        if (std::abs(det) < 1e-12f) {
+            return Matrix4x4();
+        }
+        float invDet = 1.0f / det;
+        
+        Matrix4x4 inv;
+        inv[0] = c00 * invDet;
+        inv[1] = (m[2] * m[9] - m[1] * m[10]) * invDet;
+        inv[2] = (m[1] * m[6] - m[2] * m[5]) * invDet;
+        inv[4] = c01 * invDet;
+        inv[5] = (m[0] * m[10] - m[2] * m[8]) * invDet;
+        inv[6] = (m[2] * m[4] - m[0] * m[6]) * invDet;
+        inv[8] = c02 * invDet;
+        inv[9] = (m[1] * m[8] - m[0] * m[9]) * invDet;
+        inv[10] = (m[0] * m[5] - m[1] * m[4]) * invDet;
+        
+        inv[3] = -(inv[0] * m[3] + inv[1] * m[7] + inv[2] * m[11]);
+        inv[7] = -(inv[4] * m[3] + inv[5] * m[7] + inv[6] * m[11]);
+        inv[11] = -(inv[8] * m[3] + inv[9] * m[7] + inv[10] * m[11]);
+        return inv;
+    }
+    
+    // transformPoint without the projective divide.
+    Vector3f transformPointAffine(const Vector3f& v) const {
+        return Vector3f(
+            m[0] * v.x + m[1] * v.y + m[2] * v.z + m[3],
+            m[4] * v.x + m[5] * v.y + m[6] * v.z + m[7],
+            m[8] * v.x + m[9] * v.y + m[10] * v.z + m[11]
+        );
+    }
+    
+    // Batched transformPointAffine/transformDirection. out may alias the input.
+    void transformPointsAffine(const Vector3f* points, Vector3f* out, size_t count) const {
+        transformRun(points, out, count, m[3], m[7], m[11]);
+    }
+    
+    void transformDirections(const Vector3f* directions, Vector3f* out, size_t count) const {
+        transformRun(directions, out, count, 0.0f, 0.0f, 0.0f);
+    }
+    
     static Matrix4x4 translation(const Vector3f& t) {
         Matrix4x4 result;
         result.identity();
@@ -278,6 +370,25 @@ public:
         return result;
     }
     
+    static Matrix4x4 rotation(const Quaternion& q) {
+        return compose(Vector3f::zero(), q, Vector3f::one());
+    }
+    
+    // translation(t) * rotation(q) * scale(s), written out directly. q must
+    // be a unit quaternion.
+    static Matrix4x4 compose(const Vector3f& t, const Quaternion& q, const Vector3f& s) {
+        float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+        float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+        float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+        
+        return Matrix4x4(
+            (1.0f - 2.0f * (yy + zz)) * s.x, 2.0f * (xy - wz) * s.y, 2.0f * (xz + wy) * s.z, t.x,
+            2.0f * (xy + wz) * s.x, (1.0f - 2.0f * (xx + zz)) * s.y, 2.0f * (yz - wx) * s.z, t.y,
+            2.0f * (xz - wy) * s.x, 2.0f * (yz + wx) * s.y, (1.0f - 2.0f * (xx + yy)) * s.z, t.z,
+            0.0f, 0.0f, 0.0f, 1.0f
+        );
+    }
+    
     static Matrix4x4 lookAt(const Vector3f& eye, const Vector3f& target, const Vector3f& up) {
         Vector3f zAxis = (eye - target).normalized();
         Vector3f xAxis = up.cross(zAxis).normalized();
@@ -325,6 +436,88 @@ public:
         result.identity();
         return result;
     }
+    
+private:
+    void transformRun(const Vector3f* in, Vector3f* out, size_t count, float tx, float ty, float tz) const {
+        const float m0 = m[0], m1 = m[1], m2 = m[2];
+        const float m4 = m[4], m5 = m[5], m6 = m[6];
+        const float m8 = m[8], m9 = m[9], m10 = m[10];
+        
+        for (size_t i = 0; i < count; ++i) {
+            Vector3f v = in[i];
+            out[i] = Vector3f(m0 * v.x + m1 * v.y + m2 * v.z + tx,
+                              m4 * v.x + m5 * v.y + m6 * v.z + ty,
+                              m8 * v.x + m9 * v.y + m10 * v.z + tz);
+        }
+    }
+};
+
+// Affine transform stored as the top three rows of a Matrix4x4; the bottom
+// row is implicitly 0 0 0 1. A quarter smaller than Matrix4x4, for large
+// arrays of transforms where memory traffic dominates.
+class Matrix3x4 {
+public:
+    float m[12];
+    
+    Matrix3x4() {
+        identity();
+    }
+    
+    explicit Matrix3x4(const Matrix4x4& matrix) {
+        for (int i = 0; i < 12; ++i) m[i] = matrix.m[i];
+    }
+    
+    void identity() {
+        m[0] = 1; m[1] = 0; m[2] = 0; m[3] = 0;
+        m[4] = 0; m[5] = 1; m[6] = 0; m[7] = 0;
+        m[8] = 0; m[9] = 0; m[10] = 1; m[11] = 0;
+    }
+    
+    Matrix4x4 toMatrix4x4() const {
+        return Matrix4x4(m[0], m[1], m[2], m[3],
+                         m[4], m[5], m[6], m[7],
+                         m[8], m[9], m[10], m[11],
+                         0.0f, 0.0f, 0.0f, 1.0f);
+    }
+    
+    Matrix3x4 operator*(const Matrix3x4& other) const {
+        Matrix3x4 result;
+        multiplyAffineRows(m, other.m, result.m, 1, 12);
+        return result;
+    }
+    
+    // out[i] = a * b[i] for a run of matrices. out may alias b.
+    static void multiply(const Matrix3x4& a, const Matrix3x4* b, Matrix3x4* out, size_t count) {
+        multiplyAffineRows(a.m, &b->m[0], &out->m[0], count, 12);
+    }
+    
+    Matrix3x4 inverted() const {
+        return Matrix3x4(toMatrix4x4().invertedAffine());
+    }
+    
+    Vector3f transformPoint(const Vector3f& v) const {
+        return Vector3f(
+            m[0] * v.x + m[1] * v.y + m[2] * v.z + m[3],
+            m[4] * v.x + m[5] * v.y + m[6] * v.z + m[7],
+            m[8] * v.x + m[9] * v.y + m[10] * v.z + m[11]
+        );
+    }
+    
+    Vector3f transformDirection(const Vector3f& v) const {
+        return Vector3f(
+            m[0] * v.x + m[1] * v.y + m[2] * v.z,
+            m[4] * v.x + m[5] * v.y + m[6] * v.z,
+            m[8] * v.x + m[9] * v.y + m[10] * v.z
+        );
+    }
+    
+    Vector3f getTranslation() const {
+        return Vector3f(m[3], m[7], m[11]);
+    }
+    
+    static Matrix3x4 compose(const Vector3f& t, const Quaternion& q, const Vector3f& s) {
+        return Matrix3x4(Matrix4x4::compose(t, q, s));
+    }
 };
 
 } // namespace Math
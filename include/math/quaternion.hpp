@@ -0,0 +1,134 @@
+#pragma once
+
+#include "vector.hpp"
+#include <cmath>
+
+namespace SFSim {
+namespace Math {
+
+// Unit quaternion rotation (x, y, z vector part, w scalar part). Euler
+// angles use the same convention as Transform: rotationX * rotationY *
+// rotationZ, radians.
+class Quaternion {
+public:
+    float x, y, z, w;
+
+    Quaternion() : x(0), y(0), z(0), w(1) {}
+    Quaternion(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+
+    static Quaternion identity() { return Quaternion(); }
+
+    static Quaternion fromAxisAngle(const Vector3f& axis, float angleRadians) {
+        Vector3f n = axis.normalized();
+        float s = std::sin(angleRadians * 0.5f);
+        return Quaternion(n.x * s, n.y * s, n.z * s, std::cos(angleRadians * 0.5f));
+    }
+
+    // Closed form of fromAxisAngle(X, e.x) * fromAxisAngle(Y, e.y) * fromAxisAngle(Z, e.z).
+    static Quaternion fromEuler(const Vector3f& euler) {
+        float cx = std::cos(euler.x * 0.5f), sx = std::sin(euler.x * 0.5f);
+        float cy = std::cos(euler.y * 0.5f), sy = std::sin(euler.y * 0.5f);
+        float cz = std::cos(euler.z * 0.5f), sz = std::sin(euler.z * 0.5f);
+        return Quaternion(
+            sx * cy * cz + cx * sy * sz,
+            cx * sy * cz - sx * cy * sz,
+            cx * cy * sz + sx * sy * cz,
+            cx * cy * cz - sx * sy * sz
+        );
+    }
+
+    Vector3f toEuler() const {
+        float r00 = 1.0f - 2.0f * (y * y + z * z);
+        float r01 = 2.0f * (x * y - w * z);
+        float r02 = 2.0f * (x * z + w * y);
+        float cosY = std::sqrt(r00 * r00 + r01 * r01);
+        float ry = std::atan2(r02, cosY);
+
+        // Near gimbal lock rx and rz lose precision as 1/cosY, so below
+        // ~sqrt(float epsilon) only their combination is kept, all in rx.
+        if (cosY < 3e-4f) {
+            float r21 = 2.0f * (y * z + w * x);
+            float r11 = 1.0f - 2.0f * (x * x + z * z);
+            return Vector3f(std::atan2(r21, r11), ry, 0.0f);
+        }
+
+        float r12 = 2.0f * (y * z - w * x);
+        float r22 = 1.0f - 2.0f * (x * x + y * y);
+        return Vector3f(std::atan2(-r12, r22), ry, std::atan2(-r01, r00));
+    }
+
+    Quaternion operator*(const Quaternion& o) const {
+        return Quaternion(
+            w * o.x + x * o.w + y * o.z - z * o.y,
+            w * o.y - x * o.z + y * o.w + z * o.x,
+            w * o.z + x * o.y - y * o.x + z * o.w,
+            w * o.w - x * o.x - y * o.y - z * o.z
+        );
+    }
+
+    Quaternion& operator*=(const Quaternion& o) {
+        *this = *this * o;
+        return *this;
+    }
+
+    // q * v * q^-1 for a unit quaternion, without building a matrix.
+    Vector3f rotate(const Vector3f& v) const {
+        Vector3f u(x, y, z);
+        Vector3f t = u.cross(v) * 2.0f;
+        return v + t * w + u.cross(t);
+    }
+
+    float dot(const Quaternion& o) const {
+        return x * o.x + y * o.y + z * o.z + w * o.w;
+    }
+
+    float lengthSquared() const {
+        return dot(*this);
+    }
+
+    Quaternion conjugate() const {
+        return Quaternion(-x, -y, -z, w);
+    }
+
+    Quaternion inverse() const {
+        float lenSq = lengthSquared();
+        if (lenSq == 0) return Quaternion();
+        float inv = 1.0f / lenSq;
+        return Quaternion(-x * inv, -y * inv, -z * inv, w * inv);
+    }
+
+    Quaternion normalized() const {
+        float lenSq = lengthSquared();
+        if (lenSq == 0) return Quaternion();
+        float inv = 1.0f / std::sqrt(lenSq);
+        return Quaternion(x * inv, y * inv, z * inv, w * inv);
+    }
+
+    void normalize() {
+        *this = normalized();
+    }
+
+    static Quaternion slerp(const Quaternion& a, const Quaternion& b, float t) {
+        Quaternion end = b;
+        float cosTheta = a.dot(b);
+        if (cosTheta < 0) {
+            end = Quaternion(-b.x, -b.y, -b.z, -b.w);
+            cosTheta = -cosTheta;
+        }
+
+        float wa = 1.0f - t;
+        float wb = t;
+        if (cosTheta < 0.9995f) {
+            float theta = std::acos(cosTheta);
+            float invSin = 1.0f / std::sin(theta);
+            wa = std::sin(wa * theta) * invSin;
+            wb = std::sin(wb * theta) * invSin;
+        }
+
+        return Quaternion(a.x * wa + end.x * wb, a.y * wa + end.y * wb,
+                          a.z * wa + end.z * wb, a.w * wa + end.w * wb).normalized();
+    }
+};
+
+} // namespace Math
+} // namespace SFSim
\ No newline at end of file
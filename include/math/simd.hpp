@@ -0,0 +1,228 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define SFSIM_SIMD_SSE 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#define SFSIM_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace SFSim {
+namespace Math {
+
+// Four-lane float vector. Maps to SSE2 on x64 and NEON on arm64, with a
+// scalar fallback elsewhere. Comparisons return lane masks (all bits set or
+// clear) that can be combined with &, | and consumed by select()/movemask().
+// reciprocal() and rsqrt() are hardware estimates refined by one Newton step
+// (about 22 bits), meant for shading math rather than exact results.
+class Float4 {
+public:
+    static constexpr int Width = 4;
+
+#if defined(SFSIM_SIMD_SSE)
+    __m128 v;
+
+    Float4() : v(_mm_setzero_ps()) {}
+    Float4(__m128 value) : v(value) {}
+    Float4(float s) : v(_mm_set1_ps(s)) {}
+    Float4(float a, float b, float c, float d) : v(_mm_setr_ps(a, b, c, d)) {}
+
+    static Float4 load(const float* p) { return Float4(_mm_loadu_ps(p)); }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+
+    Float4 operator+(const Float4& o) const { return Float4(_mm_add_ps(v, o.v)); }
+    Float4 operator-(const Float4& o) const { return Float4(_mm_sub_ps(v, o.v)); }
+    Float4 operator*(const Float4& o) const { return Float4(_mm_mul_ps(v, o.v)); }
+    Float4 operator/(const Float4& o) const { return Float4(_mm_div_ps(v, o.v)); }
+    Float4 operator-() const { return Float4(_mm_sub_ps(_mm_setzero_ps(), v)); }
+
+    Float4 operator<(const Float4& o) const { return Float4(_mm_cmplt_ps(v, o.v)); }
+    Float4 operator<=(const Float4& o) const { return Float4(_mm_cmple_ps(v, o.v)); }
+    Float4 operator>(const Float4& o) const { return Float4(_mm_cmpgt_ps(v, o.v)); }
+    Float4 operator>=(const Float4& o) const { return Float4(_mm_cmpge_ps(v, o.v)); }
+
+    Float4 operator&(const Float4& o) const { return Float4(_mm_and_ps(v, o.v)); }
+    Float4 operator|(const Float4& o) const { return Float4(_mm_or_ps(v, o.v)); }
+
+    static Float4 min(const Float4& a, const Float4& b) { return Float4(_mm_min_ps(a.v, b.v)); }
+    static Float4 max(const Float4& a, const Float4& b) { return Float4(_mm_max_ps(a.v, b.v)); }
+    static Float4 sqrt(const Float4& a) { return Float4(_mm_sqrt_ps(a.v)); }
+    static Float4 abs(const Float4& a) { return Float4(_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)); }
+
+    static Float4 reciprocal(const Float4& a) {
+        __m128 r = _mm_rcp_ps(a.v);
+        return Float4(_mm_mul_ps(r, _mm_sub_ps(_mm_set1_ps(2.0f), _mm_mul_ps(a.v, r))));
+    }
+    static Float4 rsqrt(const Float4& a) {
+        __m128 r = _mm_rsqrt_ps(a.v);
+        __m128 halfA = _mm_mul_ps(_mm_set1_ps(0.5f), a.v);
+        return Float4(_mm_mul_ps(r, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(halfA, _mm_mul_ps(r, r)))));
+    }
+
+    static Float4 select(const Float4& mask, const Float4& a, const Float4& b) {
+        return Float4(_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)));
+    }
+
+    int movemask() const { return _mm_movemask_ps(v); }
+#elif defined(SFSIM_SIMD_NEON)
+    float32x4_t v;
+
+    Float4() : v(vdupq_n_f32(0.0f)) {}
+    Float4(float32x4_t value) : v(value) {}
+    Float4(float s) : v(vdupq_n_f32(s)) {}
+    Float4(float a, float b, float c, float d) {
+        float lanes[4] = {a, b, c, d};
+        v = vld1q_f32(lanes);
+    }
+
+    static Float4 load(const float* p) { return Float4(vld1q_f32(p)); }
+    void store(float* p) const { vst1q_f32(p, v); }
+
+    Float4 operator+(const Float4& o) const { return Float4(vaddq_f32(v, o.v)); }
+    Float4 operator-(const Float4& o) const { return Float4(vsubq_f32(v, o.v)); }
+    Float4 operator*(const Float4& o) const { return Float4(vmulq_f32(v, o.v)); }
+    Float4 operator/(const Float4& o) const { return Float4(vdivq_f32(v, o.v)); }
+    Float4 operator-() const { return Float4(vnegq_f32(v)); }
+
+    Float4 operator<(const Float4& o) const { return fromMask(vcltq_f32(v, o.v)); }
+    Float4 operator<=(const Float4& o) const { return fromMask(vcleq_f32(v, o.v)); }
+    Float4 operator>(const Float4& o) const { return fromMask(vcgtq_f32(v, o.v)); }
+    Float4 operator>=(const Float4& o) const { return fromMask(vcgeq_f32(v, o.v)); }
+
+    Float4 operator&(const Float4& o) const { return fromMask(vandq_u32(toMask(), o.toMask())); }
+    Float4 operator|(const Float4& o) const { return fromMask(vorrq_u32(toMask(), o.toMask())); }
+
+    static Float4 min(const Float4& a, const Float4& b) { return Float4(vminq_f32(a.v, b.v)); }
+    static Float4 max(const Float4& a, const Float4& b) { return Float4(vmaxq_f32(a.v, b.v)); }
+    static Float4 sqrt(const Float4& a) { return Float4(vsqrtq_f32(a.v)); }
+    static Float4 abs(const Float4& a) { return Float4(vabsq_f32(a.v)); }
+
+    static Float4 reciprocal(const Float4& a) {
+        float32x4_t r = vrecpeq_f32(a.v);
+        return Float4(vmulq_f32(r, vrecpsq_f32(a.v, r)));
+    }
+    static Float4 rsqrt(const Float4& a) {
+        float32x4_t r = vrsqrteq_f32(a.v);
+        return Float4(vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(a.v, r), r)));
+    }
+
+    static Float4 select(const Float4& mask, const Float4& a, const Float4& b) {
+        return Float4(vbslq_f32(mask.toMask(), a.v, b.v));
+    }
+
+    int movemask() const {
+        uint32x4_t bits = vshrq_n_u32(toMask(), 31);
+        return static_cast<int>(vgetq_lane_u32(bits, 0) |
+                                (vgetq_lane_u32(bits, 1) << 1) |
+                                (vgetq_lane_u32(bits, 2) << 2) |
+                                (vgetq_lane_u32(bits, 3) << 3));
+    }
+
+private:
+    uint32x4_t toMask() const { return vreinterpretq_u32_f32(v); }
+    static Float4 fromMask(uint32x4_t m) { return Float4(vreinterpretq_f32_u32(m)); }
+public:
+#else
+    float v[4];
+
+    Float4() : v{0.0f, 0.0f, 0.0f, 0.0f} {}
+    Float4(float s) : v{s, s, s, s} {}
+    Float4(float a, float b, float c, float d) : v{a, b, c, d} {}
+
+    static Float4 load(const float* p) { return Float4(p[0], p[1], p[2], p[3]); }
+    void store(float* p) const { std::memcpy(p, v, sizeof(v)); }
+
+    Float4 operator+(const Float4& o) const { return Float4(v[0] + o.v[0], v[1] + o.v[1], v[2] + o.v[2], v[3] + o.v[3]); }
+    Float4 operator-(const Float4& o) const { return Float4(v[0] - o.v[0], v[1] - o.v[1], v[2] - o.v[2], v[3] - o.v[3]); }
+    Float4 operator*(const Float4& o) const { return Float4(v[0] * o.v[0], v[1] * o.v[1], v[2] * o.v[2], v[3] * o.v[3]); }
+    Float4 operator/(const Float4& o) const { return Float4(v[0] / o.v[0], v[1] / o.v[1], v[2] / o.v[2], v[3] / o.v[3]); }
+    Float4 operator-() const { return Float4(-v[0], -v[1], -v[2], -v[3]); }
+
+    Float4 operator<(const Float4& o) const { return compare(o, [](float a, float b) { return a < b; }); }
+    Float4 operator<=(const Float4& o) const { return compare(o, [](float a, float b) { return a <= b; }); }
+    Float4 operator>(const Float4& o) const { return compare(o, [](float a, float b) { return a > b; }); }
+    Float4 operator>=(const Float4& o) const { return compare(o, [](float a, float b) { return a >= b; }); }
+
+    Float4 operator&(const Float4& o) const { return bitwise(o, [](std::uint32_t a, std::uint32_t b) { return a & b; }); }
+    Float4 operator|(const Float4& o) const { return bitwise(o, [](std::uint32_t a, std::uint32_t b) { return a | b; }); }
+
+    static Float4 min(const Float4& a, const Float4& b) {
+        return Float4(std::fmin(a.v[0], b.v[0]), std::fmin(a.v[1], b.v[1]), std::fmin(a.v[2], b.v[2]), std::fmin(a.v[3], b.v[3]));
+    }
+    static Float4 max(const Float4& a, const Float4& b) {
+        return Float4(std::fmax(a.v[0], b.v[0]), std::fmax(a.v[1], b.v[1]), std::fmax(a.v[2], b.v[2]), std::fmax(a.v[3], b.v[3]));
+    }
+    static Float4 sqrt(const Float4& a) {
+        return Float4(std::sqrt(a.v[0]), std::sqrt(a.v[1]), std::sqrt(a.v[2]), std::sqrt(a.v[3]));
+    }
+    static Float4 abs(const Float4& a) {
+        return Float4(std::fabs(a.v[0]), std::fabs(a.v[1]), std::fabs(a.v[2]), std::fabs(a.v[3]));
+    }
+
+    static Float4 reciprocal(const Float4& a) { return Float4(1.0f) / a; }
+    static Float4 rsqrt(const Float4& a) { return Float4(1.0f) / sqrt(a); }
+
+    static Float4 select(const Float4& mask, const Float4& a, const Float4& b) {
+        Float4 result;
+        for (int i = 0; i < 4; ++i) {
+            result.v[i] = (bits(mask.v[i]) & 0x80000000u) ? a.v[i] : b.v[i];
+        }
+        return result;
+    }
+
+    int movemask() const {
+        int mask = 0;
+        for (int i = 0; i < 4; ++i) {
+            if (bits(v[i]) & 0x80000000u) mask |= 1 << i;
+        }
+        return mask;
+    }
+
+private:
+    static std::uint32_t bits(float f) { std::uint32_t u; std::memcpy(&u, &f, sizeof(u)); return u; }
+    static float fromBits(std::uint32_t u) { float f; std::memcpy(&f, &u, sizeof(f)); return f; }
+
+    template<typename Op>
+    Float4 compare(const Float4& o, Op op) const {
+        Float4 result;
+        for (int i = 0; i < 4; ++i) result.v[i] = fromBits(op(v[i], o.v[i]) ? 0xFFFFFFFFu : 0u);
+        return result;
+    }
+
+    template<typename Op>
+    Float4 bitwise(const Float4& o, Op op) const {
+        Float4 result;
+        for (int i = 0; i < 4; ++i) result.v[i] = fromBits(op(bits(v[i]), bits(o.v[i])));
+        return result;
+    }
+public:
+#endif
+
+    float lane(int i) const {
+        float lanes[4];
+        store(lanes);
+        return lanes[i];
+    }
+
+    float horizontalSum() const {
+        float lanes[4];
+        store(lanes);
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+
+    Float4& operator+=(const Float4& o) { *this = *this + o; return *this; }
+    Float4& operator-=(const Float4& o) { *this = *this - o; return *this; }
+    Float4& operator*=(const Float4& o) { *this = *this * o; return *this; }
+
+    static Float4 clamp(const Float4& a, const Float4& lo, const Float4& hi) {
+        return min(max(a, lo), hi);
+    }
+};
+
+} // namespace Math
+} // namespace SFSim
\ No newline at end of file
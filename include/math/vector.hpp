@@ -107,6 +107,15 @@ public:
         return Vector3f(x * scalar, y * scalar, z * scalar);
     }
     
+    // Component-wise product.
+    Vector3f operator*(const Vector3f& other) const {
+        return Vector3f(x * other.x, y * other.y, z * other.z);
+    }
+    
+    Vector3f operator-() const {
+        return Vector3f(-x, -y, -z);
+    }
+    
     Vector3f operator/(float scalar) const {
         return Vector3f(x / scalar, y / scalar, z / scalar);
     }
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "math/vector.hpp"
+#include "math/matrix.hpp"
+#include "math/simd.hpp"
+
+namespace SFSim {
+namespace Physics {
+
+using namespace Math;
+
+struct AABB {
+    Vector3f min;
+    Vector3f max;
+    
+    AABB() : min(Vector3f::zero()), max(Vector3f::zero()) {}
+    AABB(const Vector3f& minPoint, const Vector3f& maxPoint) : min(minPoint), max(maxPoint) {}
+    
+    Vector3f getCenter() const { return (min + max) * 0.5f; }
+    Vector3f getSize() const { return max - min; }
+    Vector3f getExtents() const { return getSize() * 0.5f; }
+    
+    float getSurfaceArea() const {
+        Vector3f size = getSize();
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+    
+    bool contains(const Vector3f& point) const;
+    bool contains(const AABB& other) const;
+    bool intersects(const AABB& other) const;
+    AABB merge(const AABB& other) const;
+    // Bounds of this box after an affine transform.
+    AABB transformed(const Matrix4x4& matrix) const;
+    void expand(const Vector3f& point);
+    void expand(float amount);
+};
+
+struct Sphere {
+    Vector3f center;
+    float radius;
+    
+    Sphere() : center(Vector3f::zero()), radius(1.0f) {}
+    Sphere(const Vector3f& c, float r) : center(c), radius(r) {}
+    
+    bool contains(const Vector3f& point) const;
+    bool intersects(const Sphere& other) const;
+    bool intersects(const AABB& aabb) const;
+};
+
+struct Ray {
+    Vector3f origin;
+    Vector3f direction;
+    
+    Ray() : origin(Vector3f::zero()), direction(Vector3f::forward()) {}
+    Ray(const Vector3f& o, const Vector3f& d) : origin(o), direction(d.normalized()) {}
+    
+    Vector3f getPoint(float t) const { return origin + direction * t; }
+    
+    // Reciprocal direction for repeated slab tests. Zero components map to a
+    // huge finite value instead of infinity so the slabs never produce NaN.
+    Vector3f getInverseDirection() const;
+    
+    // Slab test. distance is where the ray enters the box, or 0 if the
+    // origin is inside it.
+    bool intersects(const AABB& box, float maxDistance, float& distance) const;
+    bool intersects(const AABB& box, const Vector3f& inverseDirection, float maxDistance, float& distance) const;
+};
+
+// Up to Width rays in structure-of-arrays form, traced together so each box
+// is slab-tested against every lane at once.
+struct RayPacket {
+    static constexpr int Width = Float4::Width;
+    
+    float originX[Width], originY[Width], originZ[Width];
+    float inverseX[Width], inverseY[Width], inverseZ[Width];
+    float maxDistance[Width];
+    int count;
+    
+    RayPacket()
+        : originX{}, originY{}, originZ{}
+        , inverseX{}, inverseY{}, inverseZ{}
+        , maxDistance{}, count(0) {}
+    
+    void add(const Ray& ray, float rayMaxDistance);
+    // Bit i is set when lane i is in use.
+    int getLaneMask() const { return (1 << count) - 1; }
+};
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
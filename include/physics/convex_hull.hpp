@@ -0,0 +1,58 @@
+#pragma once
+
+#include "physics/bounds.hpp"
+#include "physics/mesh_bvh.hpp"
+#include <vector>
+
+namespace SFSim {
+namespace Physics {
+
+// Convex hull of a point cloud, built with quickhull, for colliders that
+// need a closer fit than a box or capsule. Its vertices are also kept in
+// structure-of-arrays form, padded to whole Float4 groups, so support() -
+// which GJK calls every iteration - scans them four at a time.
+class ConvexHull {
+public:
+    using Hit = MeshBVH::Hit;
+
+    ConvexHull();
+
+    // Points all on one plane or line enclose no volume to build faces
+    // around; the hull then keeps every point as a vertex and has no faces,
+    // which still gives support() the right answers.
+    void build(const std::vector<Vector3f>& points);
+    void clear();
+
+    // The vertex furthest along direction, which need not be normalised.
+    Vector3f support(const Vector3f& direction) const;
+    // Where the ray enters the hull; the triangle is the face entered,
+    // numbered as in getIndices() - on a flat side split into coplanar
+    // triangles, the one containing the hit point. Rays starting inside hit the face they
+    // leave through, like raycasts against boxes. Hulls without faces are
+    // never hit.
+    bool raycast(const Ray& ray, float maxDistance, Hit& hit) const;
+
+    bool isEmpty() const { return _vertices.empty(); }
+    const AABB& getBounds() const { return _bounds; }
+    const std::vector<Vector3f>& getVertices() const { return _vertices; }
+    // Three per face, counter-clockwise seen from outside.
+    const std::vector<unsigned int>& getIndices() const { return _indices; }
+    size_t getFaceCount() const { return _indices.size() / 3; }
+
+private:
+    std::vector<Vector3f> _vertices;
+    std::vector<float> _x;
+    std::vector<float> _y;
+    std::vector<float> _z;
+    std::vector<unsigned int> _indices;
+    // Each face's outward unit normal and its distance along it from the
+    // origin.
+    std::vector<Vector3f> _normals;
+    std::vector<float> _offsets;
+    AABB _bounds;
+
+    void setVertices(std::vector<Vector3f> vertices);
+};
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
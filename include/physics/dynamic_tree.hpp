@@ -0,0 +1,256 @@
+#pragma once
+
+#include "physics/bounds.hpp"
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+namespace SFSim {
+namespace Physics {
+
+// Layer mask that matches every proxy.
+constexpr uint32_t AllLayers = 0xFFFFFFFFu;
+
+// Incrementally maintained bounding volume hierarchy over "fat" AABBs.
+// Leaves are enlarged by a margin (plus the predicted displacement), so
+// objects that move a little only need a containment check; a leaf is
+// removed and reinserted once its tight bounds escape. Insertion picks the
+// sibling with the lowest surface-area cost and rebalances with rotations,
+// keeping queries logarithmic in the number of proxies. Every node also
+// carries the union of its leaves' layer bits, so queries given a layer
+// mask skip whole subtrees of proxies they don't care about.
+class DynamicAABBTree {
+public:
+    static constexpr int NullNode = -1;
+
+    DynamicAABBTree();
+
+    void setMargin(float margin) { _margin = margin; }
+    float getMargin() const { return _margin; }
+
+    int createProxy(const AABB& bounds, void* userData, uint32_t layers = AllLayers);
+    void destroyProxy(int proxyId);
+    // Returns true if the proxy had to be reinserted.
+    bool moveProxy(int proxyId, const AABB& bounds, const Vector3f& displacement = Vector3f::zero());
+    void setProxyLayers(int proxyId, uint32_t layers);
+    void clear();
+
+    void* getUserData(int proxyId) const { return _nodes[proxyId].userData; }
+    uint32_t getProxyLayers(int proxyId) const { return _nodes[proxyId].layers; }
+    const AABB& getFatBounds(int proxyId) const { return _nodes[proxyId].bounds; }
+
+    size_t getProxyCount() const { return _proxyCount; }
+    int getHeight() const { return _root == NullNode ? 0 : _nodes[_root].height; }
+
+    // Each query also takes an optional layer mask; only proxies sharing a
+    // bit with it are visited.
+    
+    // callback(proxyId) -> false stops the query.
+    template<typename Callback>
+    void query(const AABB& bounds, Callback callback) const { query(bounds, AllLayers, callback); }
+    template<typename Callback>
+    void query(const AABB& bounds, uint32_t layerMask, Callback callback) const;
+
+    // callback(proxyId, maxDistance) -> new maxDistance; 0 stops the query,
+    // a smaller value clips the ray to the closest hit so far.
+    template<typename Callback>
+    void raycast(const Ray& ray, float maxDistance, Callback callback) const { raycast(ray, maxDistance, AllLayers, callback); }
+    template<typename Callback>
+    void raycast(const Ray& ray, float maxDistance, uint32_t layerMask, Callback callback) const;
+    
+    // Box cast: box moves by displacement, and callback(proxyId, maxFraction)
+    // is called for every leaf it may touch along the way, returning a new
+    // maxFraction in [0, 1] as raycast does with distances.
+    template<typename Callback>
+    void sweep(const AABB& box, const Vector3f& displacement, Callback callback) const { sweep(box, displacement, AllLayers, callback); }
+    template<typename Callback>
+    void sweep(const AABB& box, const Vector3f& displacement, uint32_t layerMask, Callback callback) const;
+    
+    // callback(proxyId, laneMask) for every leaf hit by at least one lane;
+    // it may lower packet.maxDistance for lanes to clip them. Uses only
+    // local state, so packets can be traced from several threads at once.
+    template<typename Callback>
+    void raycastPacket(RayPacket& packet, Callback callback) const { raycastPacket(packet, AllLayers, callback); }
+    template<typename Callback>
+    void raycastPacket(RayPacket& packet, uint32_t layerMask, Callback callback) const;
+
+private:
+    struct Node {
+        AABB bounds;
+        void* userData;
+        int parent;
+        int child1;
+        int child2;
+        int height;
+        uint32_t layers;
+
+        bool isLeaf() const { return child1 == NullNode; }
+    };
+
+    std::vector<Node> _nodes;
+    int _root;
+    int _freeList;
+    size_t _proxyCount;
+    float _margin;
+
+    // Traversals keep their stack locally, so queries can run concurrently
+    // or from inside another query's callback. Balancing keeps the height
+    // logarithmic, so a fixed stack is plenty.
+    static constexpr int StackSize = 128;
+
+    int allocateNode();
+    void freeNode(int node);
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+    int balance(int node);
+    void refit(Node& node);
+};
+
+template<typename Callback>
+void DynamicAABBTree::query(const AABB& bounds, uint32_t layerMask, Callback callback) const {
+    if (_root == NullNode) return;
+
+    int stack[StackSize];
+    int top = 0;
+    stack[top++] = _root;
+
+    while (top > 0) {
+        int id = stack[--top];
+
+        const Node& node = _nodes[id];
+        if (!(node.layers & layerMask) || !node.bounds.intersects(bounds)) continue;
+
+        if (node.isLeaf()) {
+            if (!callback(id)) return;
+        } else {
+            stack[top++] = node.child1;
+            stack[top++] = node.child2;
+        }
+    }
+}
+
+template<typename Callback>
+void DynamicAABBTree::raycast(const Ray& ray, float maxDistance, uint32_t layerMask, Callback callback) const {
+    if (_root == NullNode) return;
+
+    Vector3f inverseDirection = ray.getInverseDirection();
+
+    int stack[StackSize];
+    int top = 0;
+    stack[top++] = _root;
+
+    while (top > 0) {
+        int id = stack[--top];
+
+        const Node& node = _nodes[id];
+        float entry;
+        if (!(node.layers & layerMask) || !ray.intersects(node.bounds, inverseDirection, maxDistance, entry)) continue;
+
+        if (node.isLeaf()) {
+            float clipped = callback(id, maxDistance);
+            if (clipped <= 0.0f) return;
+            maxDistance = std::min(maxDistance, clipped);
+        } else {
+            // Nearer child on top, so closer hits clip the search sooner.
+            Vector3f separation = _nodes[node.child2].bounds.getCenter() - _nodes[node.child1].bounds.getCenter();
+            bool firstIsNear = separation.dot(ray.direction) >= 0.0f;
+            stack[top++] = firstIsNear ? node.child2 : node.child1;
+            stack[top++] = firstIsNear ? node.child1 : node.child2;
+        }
+    }
+}
+
+template<typename Callback>
+void DynamicAABBTree::sweep(const AABB& box, const Vector3f& displacement, uint32_t layerMask, Callback callback) const {
+    if (_root == NullNode) return;
+    
+    // A ray from the box's center against nodes grown by its extents.
+    Ray ray;
+    ray.origin = box.getCenter();
+    ray.direction = displacement;
+    Vector3f extents = box.getExtents();
+    Vector3f inverseDirection = ray.getInverseDirection();
+    float maxFraction = 1.0f;
+    
+    int stack[StackSize];
+    int top = 0;
+    stack[top++] = _root;
+    
+    while (top > 0) {
+        int id = stack[--top];
+        
+        const Node& node = _nodes[id];
+        if (!(node.layers & layerMask)) continue;
+        
+        float entry;
+        AABB grown(node.bounds.min - extents, node.bounds.max + extents);
+        if (!ray.intersects(grown, inverseDirection, maxFraction, entry)) continue;
+        
+        if (node.isLeaf()) {
+            float clipped = callback(id, maxFraction);
+            if (clipped <= 0.0f) return;
+            maxFraction = std::min(maxFraction, clipped);
+        } else {
+            stack[top++] = node.child1;
+            stack[top++] = node.child2;
+        }
+    }
+}
+
+template<typename Callback>
+void DynamicAABBTree::raycastPacket(RayPacket& packet, uint32_t layerMask, Callback callback) const {
+    if (_root == NullNode || packet.count == 0) return;
+
+    const Float4 originX = Float4::load(packet.originX);
+    const Float4 originY = Float4::load(packet.originY);
+    const Float4 originZ = Float4::load(packet.originZ);
+    const Float4 inverseX = Float4::load(packet.inverseX);
+    const Float4 inverseY = Float4::load(packet.inverseY);
+    const Float4 inverseZ = Float4::load(packet.inverseZ);
+    const Float4 zero(0.0f);
+    const int lanes = packet.getLaneMask();
+    Float4 maxDistance = Float4::load(packet.maxDistance);
+
+    const float directionX = 1.0f / packet.inverseX[0];
+    const float directionY = 1.0f / packet.inverseY[0];
+    const float directionZ = 1.0f / packet.inverseZ[0];
+
+    int stack[StackSize];
+    int top = 0;
+    stack[top++] = _root;
+
+    while (top > 0) {
+        const Node& node = _nodes[stack[--top]];
+        if (!(node.layers & layerMask)) continue;
+
+        Float4 tx1 = (Float4(node.bounds.min.x) - originX) * inverseX;
+        Float4 tx2 = (Float4(node.bounds.max.x) - originX) * inverseX;
+        Float4 ty1 = (Float4(node.bounds.min.y) - originY) * inverseY;
+        Float4 ty2 = (Float4(node.bounds.max.y) - originY) * inverseY;
+        Float4 tz1 = (Float4(node.bounds.min.z) - originZ) * inverseZ;
+        Float4 tz2 = (Float4(node.bounds.max.z) - originZ) * inverseZ;
+
+        Float4 tNear = Float4::max(Float4::max(Float4::min(tx1, tx2), Float4::min(ty1, ty2)),
+                                   Float4::max(Float4::min(tz1, tz2), zero));
+        Float4 tFar = Float4::min(Float4::min(Float4::max(tx1, tx2), Float4::max(ty1, ty2)),
+                                  Float4::min(Float4::max(tz1, tz2), maxDistance));
+
+        int hitMask = (tNear <= tFar).movemask() & lanes;
+        if (hitMask == 0) continue;
+
+        if (node.isLeaf()) {
+            callback(static_cast<int>(&node - _nodes.data()), hitMask);
+            maxDistance = Float4::load(packet.maxDistance);
+        } else {
+            // Nearer child along the first lane's direction on top, so closer
+            // hits clip the search sooner.
+            Vector3f separation = _nodes[node.child2].bounds.getCenter() - _nodes[node.child1].bounds.getCenter();
+            bool firstIsNear = separation.x * directionX + separation.y * directionY + separation.z * directionZ >= 0.0f;
+            stack[top++] = firstIsNear ? node.child2 : node.child1;
+            stack[top++] = firstIsNear ? node.child1 : node.child2;
+        }
+    }
+}
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "math/vector.hpp"
+#include "physics/bounds.hpp"
+#include "physics/particle_world.hpp"
+#include "physics/spatial_hash_grid.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace SFSim {
+namespace Physics {
+
+using namespace Math;
+
+// Smoothed-particle hydrodynamics over the particles of a ParticleWorld,
+// with the kernels of Muller et al. 2003: each particle's density is
+// summed from its neighbors within the smoothing radius (poly6), pressure
+// follows from how far that is above the rest density, and pressure
+// (spiky gradient, in the symmetric form that keeps momentum) and
+// viscosity (viscosity Laplacian) accelerate it. Gravity and everything
+// else stay with the world, which integrates the particles once the fluid
+// has changed their velocities. The world's container walls act as fluid
+// at rest beyond them, so particles near a wall feel the density,
+// pressure and drag of a full neighborhood rather than piling up on it.
+//
+// Every step the world is put in the grid's sorted order, so the neighbor
+// passes read the world's arrays in sequence; steps after the first find
+// it nearly sorted already. Both passes run on the thread pool for worlds
+// over its parallel threshold.
+class FluidSolver {
+public:
+    FluidSolver();
+
+    // Meters; neighbors further apart than this don't interact.
+    void setSmoothingRadius(float radius) { _smoothingRadius = radius; }
+    float getSmoothingRadius() const { return _smoothingRadius; }
+    // Kilograms per cubic meter.
+    void setRestDensity(float density) { _restDensity = density; }
+    float getRestDensity() const { return _restDensity; }
+    // Kilograms, the same for every particle.
+    void setParticleMass(float mass) { _particleMass = mass; }
+    float getParticleMass() const { return _particleMass; }
+    // Pressure per unit of density above the rest density. Stiffer fluids
+    // compress less and need a shorter time step.
+    void setStiffness(float stiffness) { _stiffness = stiffness; }
+    float getStiffness() const { return _stiffness; }
+    void setViscosity(float viscosity) { _viscosity = viscosity; }
+    float getViscosity() const { return _viscosity; }
+
+    // update() advances in steps of exactly this long.
+    void setTimeStep(float seconds) { _timeStep = seconds; }
+    float getTimeStep() const { return _timeStep; }
+    // Steps per update() at most; time beyond them is dropped, so a slow
+    // frame doesn't make the next one slower still.
+    void setMaxSteps(int steps) { _maxSteps = steps; }
+    int getMaxSteps() const { return _maxSteps; }
+
+    // Distance between particles packed at the rest density.
+    float getParticleSpacing() const;
+
+    // Fills the box with particles at rest, a particle spacing apart, and
+    // returns how many were spawned. Lifetime 0 lives until clear().
+    size_t spawnBlock(ParticleWorld& world, const AABB& box, float lifetime, std::uint32_t color) const;
+
+    // Runs as many whole steps as the time carried over plus deltaTime
+    // holds, and returns how many.
+    int update(ParticleWorld& world, float deltaTime);
+    // One step of getTimeStep().
+    void step(ParticleWorld& world);
+
+    // Per particle, in the world's order as of the last step; valid until
+    // the world next changes size.
+    const float* getDensities() const { return _density.data(); }
+    const float* getPressures() const { return _pressure.data(); }
+    const SpatialHashGrid& getGrid() const { return _grid; }
+
+private:
+    float _smoothingRadius;
+    float _restDensity;
+    float _particleMass;
+    float _stiffness;
+    float _viscosity;
+    float _timeStep;
+    int _maxSteps;
+    float _accumulator;
+
+    SpatialHashGrid _grid;
+    std::vector<float> _density;
+    std::vector<float> _pressure;
+    std::vector<float> _inverseDensity;
+    std::vector<float> _pressureTerm;
+    std::vector<float> _accelerationX;
+    std::vector<float> _accelerationY;
+    std::vector<float> _accelerationZ;
+
+    void computeDensities(const ParticleWorld& world, size_t begin, size_t end);
+    void computeAccelerations(const ParticleWorld& world, size_t begin, size_t end);
+};
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "math/vector.hpp"
+#include "math/matrix.hpp"
+#include "physics/convex_hull.hpp"
+
+namespace SFSim {
+namespace Physics {
+
+using namespace Math;
+
+// A convex shape as GJK sees it: a core given by its support mapping,
+// grown by a radius. Spheres are a point and capsules a segment, grown by
+// their radius, so they stay exactly round instead of becoming polytopes
+// and GJK only has to find the distance between the cores.
+struct ConvexShape {
+    enum Kind { Point, Segment, Box, Triangle, Hull };
+
+    Kind kind;
+    // Point: the point. Segment: its midpoint, with halfAxis to one end.
+    // Box: its center, with halfAxis its world-aligned half extents.
+    Vector3f center;
+    Vector3f halfAxis;
+    float radius;
+    // Triangle: its three corners.
+    Vector3f corners[3];
+    // Hull: the hull and the affine map from its space to the world.
+    const ConvexHull* hull;
+    Matrix4x4 hullToWorld;
+
+    static ConvexShape point(const Vector3f& point, float radius);
+    static ConvexShape segment(const Vector3f& center, const Vector3f& halfAxis, float radius);
+    static ConvexShape box(const Vector3f& center, const Vector3f& halfExtents);
+    static ConvexShape triangle(const Vector3f& a, const Vector3f& b, const Vector3f& c);
+    static ConvexShape convexHull(const ConvexHull& hull, const Matrix4x4& hullToWorld);
+
+    // Point of the core furthest along direction (need not be normalised).
+    Vector3f support(const Vector3f& direction) const;
+};
+
+// Normal from a to b, penetration depth (negative for a gap) and contact
+// point between two convex shapes: GJK finds the distance between their
+// cores, and EPA how deep they go when the cores themselves overlap.
+// Returns false as soon as the shapes are known to be more than maxGap
+// apart.
+//
+// axis warm-starts the search: pass the one the last call for the same
+// pair left behind (zero the first time) and GJK starts next to the
+// answer, usually converging in an iteration or two. It is set to -normal.
+bool convexContact(const ConvexShape& a, const ConvexShape& b, float maxGap, Vector3f& axis,
+                   Vector3f& normal, float& penetration, Vector3f& point);
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
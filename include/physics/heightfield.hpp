@@ -0,0 +1,114 @@
+#pragma once
+
+#include "physics/bounds.hpp"
+#include "physics/mesh_bvh.hpp"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+namespace SFSim {
+namespace Physics {
+
+// Terrain as a regular grid of heights. Sample (column, row) sits at
+// (column * spacing, height, row * spacing) in heightfield space, and each
+// cell between four samples is split into two triangles. Four floats per
+// sample instead of a mesh's nine per triangle, and no BVH to build: a
+// pyramid of per-block lowest and highest heights rejects whole regions of
+// terrain above or below a query at once.
+class Heightfield {
+public:
+    using Hit = MeshBVH::Hit;
+
+    Heightfield();
+
+    // heights holds columns * rows samples, row by row. Both counts must be
+    // at least 2.
+    void build(int columns, int rows, float spacing, const std::vector<float>& heights);
+    void clear();
+
+    // Surface height at (x, z), interpolated across the cell's triangle and
+    // clamped to the grid.
+    float getHeightAt(float x, float z) const;
+    float getHeight(int column, int row) const { return _heights[row * _columns + column]; }
+
+    // Closest triangle hit within maxDistance; as MeshBVH::raycast, with
+    // triangle numbered two per cell, row by row.
+    bool raycast(const Ray& ray, float maxDistance, Hit& hit) const;
+    // Calls callback(a, b, c, triangle) for the triangles of every cell whose
+    // bounds overlap box, with vertices in heightfield space.
+    template<typename Callback>
+    void query(const AABB& box, Callback callback) const;
+
+    bool isEmpty() const { return _levels.empty(); }
+    const AABB& getBounds() const { return _bounds; }
+    int getColumns() const { return _columns; }
+    int getRows() const { return _rows; }
+    float getSpacing() const { return _spacing; }
+    size_t getTriangleCount() const { return isEmpty() ? 0 : static_cast<size_t>(_columns - 1) * (_rows - 1) * 2; }
+
+private:
+    // Level 0 holds each cell's lowest and highest corner; every level above
+    // covers 2x2 blocks of the one below.
+    struct Level {
+        int columns;
+        int rows;
+        std::vector<float> low;
+        std::vector<float> high;
+    };
+
+    struct Block {
+        int level;
+        int column;
+        int row;
+    };
+
+    // Enough for every level to leave three siblings waiting.
+    static constexpr int MaxLevels = 32;
+
+    int _columns;
+    int _rows;
+    float _spacing;
+    std::vector<float> _heights;
+    std::vector<Level> _levels;
+    AABB _bounds;
+
+    // Bounds of a block, with its cells clamped to the grid.
+    AABB blockBounds(const Block& block) const;
+    // The cell's corners, ordered (column, row), (column, row + 1),
+    // (column + 1, row + 1), (column + 1, row); its triangles are 0-1-2 and
+    // 0-2-3, both facing +y.
+    void cellCorners(int column, int row, Vector3f corners[4]) const;
+};
+
+template<typename Callback>
+void Heightfield::query(const AABB& box, Callback callback) const {
+    if (_levels.empty() || !_bounds.intersects(box)) return;
+
+    Block stack[MaxLevels * 3 + 1];
+    int top = 0;
+    stack[top++] = {static_cast<int>(_levels.size()) - 1, 0, 0};
+
+    while (top > 0) {
+        Block block = stack[--top];
+        if (!blockBounds(block).intersects(box)) continue;
+
+        if (block.level == 0) {
+            Vector3f corners[4];
+            cellCorners(block.column, block.row, corners);
+            unsigned int triangle = static_cast<unsigned int>(block.row * (_columns - 1) + block.column) * 2;
+            callback(corners[0], corners[1], corners[2], triangle);
+            callback(corners[0], corners[2], corners[3], triangle + 1);
+            continue;
+        }
+
+        const Level& below = _levels[block.level - 1];
+        for (int row = block.row * 2; row < std::min(block.row * 2 + 2, below.rows); ++row) {
+            for (int column = block.column * 2; column < std::min(block.column * 2 + 2, below.columns); ++column) {
+                stack[top++] = {block.level - 1, column, row};
+            }
+        }
+    }
+}
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "physics/bounds.hpp"
+#include <vector>
+
+namespace SFSim {
+namespace Physics {
+
+// Bounding volume hierarchy over the triangles of one mesh, in mesh space.
+// Built top-down with binned SAH; the upper levels are split serially and
+// the remaining subtrees are built on the thread pool. Nodes live in one
+// flat array with siblings adjacent, and leaves reference a contiguous run
+// of triangles stored in leaf order, so traversal never chases pointers.
+class MeshBVH {
+public:
+    struct Hit {
+        float distance;
+        // Index of the triangle in the source index buffer (indices / 3).
+        unsigned int triangle;
+        // Weights of the triangle's three vertices at the hit point.
+        Vector3f barycentric;
+        // Unnormalised geometric normal, following the triangle's winding.
+        Vector3f normal;
+    };
+
+    MeshBVH();
+
+    void build(const std::vector<Vector3f>& positions, const std::vector<unsigned int>& indices);
+    void clear();
+
+    // Closest triangle hit within maxDistance. The ray direction need not be
+    // normalised; distances are in units of its length.
+    bool raycast(const Ray& ray, float maxDistance, Hit& hit) const;
+    // Calls callback(a, b, c, triangle) for every triangle whose bounds
+    // overlap box, with its vertices in mesh space and its index as in Hit.
+    template<typename Callback>
+    void query(const AABB& box, Callback callback) const;
+
+    bool isEmpty() const { return _nodes.empty(); }
+    const AABB& getBounds() const { return _nodes.front().bounds; }
+    size_t getTriangleCount() const { return _triangles.size(); }
+    size_t getNodeCount() const { return _nodes.size(); }
+
+private:
+    static constexpr unsigned int MaxDepth = 64;
+
+    // Interior nodes keep their first child in firstIndex (the second is
+    // firstIndex + 1); leaves keep their first triangle and a non-zero count.
+    struct Node {
+        AABB bounds;
+        unsigned int firstIndex;
+        unsigned int count;
+
+        bool isLeaf() const { return count != 0; }
+    };
+
+    // Vertex 0 and the two edges from it, precomputed for Moller-Trumbore.
+    struct Triangle {
+        Vector3f vertex;
+        Vector3f edge1;
+        Vector3f edge2;
+    };
+
+    struct BuildTask {
+        unsigned int node;
+        unsigned int first;
+        unsigned int count;
+        unsigned int depth;
+    };
+
+    // Triangles whose centroid falls in bins [0, bin] along axis go left.
+    struct Split {
+        int axis;
+        int bin;
+        float low;
+        float scale;
+        AABB leftBounds;
+        AABB rightBounds;
+        unsigned int leftCount;
+    };
+
+    std::vector<Node> _nodes;
+    std::vector<Triangle> _triangles;
+    std::vector<unsigned int> _triangleIds;
+
+    // Build scratch: one record per triangle, partitioned in place so each
+    // node's triangles stay contiguous in memory.
+    struct BuildRef {
+        // Triangle bounds as (x, y, z, unused) lanes.
+        Float4 min;
+        Float4 max;
+        Vector3f centroid;
+        unsigned int triangle;
+    };
+    std::vector<BuildRef> _refs;
+
+    void buildSubtree(std::vector<Node>& nodes, const BuildTask& root, std::vector<BuildTask>* deferred, size_t deferBelow);
+    bool findSplit(unsigned int first, unsigned int count, const AABB& nodeBounds, Split& split) const;
+    AABB rangeBounds(unsigned int first, unsigned int count) const;
+};
+
+template<typename Callback>
+void MeshBVH::query(const AABB& box, Callback callback) const {
+    if (_nodes.empty() || !_nodes[0].bounds.intersects(box)) return;
+
+    unsigned int stack[MaxDepth + 2];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const Node& node = _nodes[stack[--top]];
+
+        if (node.isLeaf()) {
+            for (unsigned int i = node.firstIndex; i < node.firstIndex + node.count; ++i) {
+                const Triangle& triangle = _triangles[i];
+                Vector3f b = triangle.vertex + triangle.edge1;
+                Vector3f c = triangle.vertex + triangle.edge2;
+                AABB bounds(triangle.vertex, triangle.vertex);
+                bounds.expand(b);
+                bounds.expand(c);
+                if (bounds.intersects(box)) {
+                    callback(triangle.vertex, b, c, _triangleIds[i]);
+                }
+            }
+            continue;
+        }
+
+        for (unsigned int child = node.firstIndex; child < node.firstIndex + 2; ++child) {
+            if (_nodes[child].bounds.intersects(box)) stack[top++] = child;
+        }
+    }
+}
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "math/vector.hpp"
+#include "ecs/system.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace SFSim {
+namespace Physics {
+
+using namespace Math;
+using namespace ECS;
+
+// Mutual gravitation between point masses, for orbital and gravitational
+// scenarios where one uniform gravity vector doesn't apply.
+//
+// BarnesHut sorts the bodies along a Morton curve and builds an octree
+// over them, each cell carrying its mass and center of mass. Bodies are
+// then taken a leaf at a time: one walk of the tree collects what the
+// whole leaf interacts with, opening cells that look larger than the
+// opening angle from the leaf and summarizing the rest by their center of
+// mass, and the list is summed four sources at a time. O(n log n), with
+// an error that shrinks with the opening angle. Direct sums every pair,
+// four at a time: O(n^2) and exact, for checking the tree against.
+//
+// Leaves (or, directly, bodies) are spread over the thread pool.
+class NBodyGravity {
+public:
+    enum class Method { BarnesHut, Direct };
+
+    NBodyGravity();
+
+    void setMethod(Method method) { _method = method; }
+    Method getMethod() const { return _method; }
+
+    void setGravitationalConstant(float constant) { _gravitationalConstant = constant; }
+    float getGravitationalConstant() const { return _gravitationalConstant; }
+
+    // Plummer softening length: the force between two bodies levels off
+    // within about this distance instead of growing without bound, which
+    // keeps close encounters from needing tiny time steps.
+    void setSoftening(float length) { _softening = length; }
+    float getSoftening() const { return _softening; }
+
+    // A cell is summarized once its size over its distance from the leaf
+    // being evaluated falls below this. 0 opens every cell, which is
+    // exact but slower than Direct; 0.5 to 0.7 is usual.
+    void setOpeningAngle(float angle) { _openingAngle = angle; }
+    float getOpeningAngle() const { return _openingAngle; }
+
+    // Sets of at least this many bodies are evaluated in parallel; 0 keeps
+    // evaluation on the calling thread.
+    void setParallelThreshold(size_t bodies) { _parallelThreshold = bodies; }
+    size_t getParallelThreshold() const { return _parallelThreshold; }
+
+    // Acceleration of each body due to all the others. The output arrays
+    // hold count entries and may not alias the inputs.
+    void computeAccelerations(const float* x, const float* y, const float* z, const float* mass, size_t count,
+                              float* accelerationX, float* accelerationY, float* accelerationZ);
+    void computeAccelerations(const std::vector<Vector3f>& positions, const std::vector<float>& masses,
+                              std::vector<Vector3f>& accelerations);
+
+    // Cells in the tree of the last BarnesHut evaluation.
+    size_t getNodeCount() const { return _nodes.size(); }
+
+private:
+    struct Node {
+        // Center of mass and total mass.
+        float x, y, z, mass;
+        // Edge length of the cell.
+        float size;
+        uint32_t firstChild;
+        uint32_t childCount;
+        // The cell's bodies, a contiguous range in Morton order.
+        uint32_t bodyBegin;
+        uint32_t bodyCount;
+    };
+
+    // Sources an evaluation sums over, in structure-of-arrays form padded
+    // to whole Float4 groups with massless entries.
+    struct SourceList {
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+        std::vector<float> mass;
+
+        void clear() { x.clear(); y.clear(); z.clear(); mass.clear(); }
+        void add(float px, float py, float pz, float m) { x.push_back(px); y.push_back(py); z.push_back(pz); mass.push_back(m); }
+        void pad();
+        size_t size() const { return x.size(); }
+    };
+
+    Method _method;
+    float _gravitationalConstant;
+    float _softening;
+    float _openingAngle;
+    size_t _parallelThreshold;
+
+    std::vector<Node> _nodes;
+    std::vector<uint32_t> _leaves;
+    // Morton keys with body indices, and the bodies in that order.
+    std::vector<uint64_t> _keys;
+    std::vector<uint64_t> _keyScratch;
+    std::vector<uint32_t> _order;
+    std::vector<uint32_t> _orderScratch;
+    SourceList _sorted;
+
+    void buildTree(const float* x, const float* y, const float* z, const float* mass, size_t count);
+    // Fills in node's children from its body range, level levels down.
+    void buildNode(uint32_t node, int level);
+    void evaluateLeaf(const Node& leaf, SourceList& sources, float* accelerationX, float* accelerationY, float* accelerationZ) const;
+    // Sums sources' pull on the body at (x, y, z), unscaled by G.
+    Vector3f sumSources(const SourceList& sources, float x, float y, float z) const;
+};
+
+// Applies NBodyGravity to every active entity with a rigidbody and a
+// transform, through RigidbodyComponent::addForce. Add it to the scene
+// before PhysicsSystem, so the forces are there when the step integrates
+// them, and turn PhysicsSystem's own gravity off (or the bodies' gravity
+// scale down to 0). Kinematic bodies attract the others but aren't moved.
+class NBodySystem : public System {
+public:
+    void update(float deltaTime, const std::vector<std::unique_ptr<Entity>>& entities) override;
+
+    NBodyGravity& getGravity() { return _gravity; }
+    const NBodyGravity& getGravity() const { return _gravity; }
+
+private:
+    NBodyGravity _gravity;
+    std::vector<Entity*> _bodies;
+    std::vector<float> _x, _y, _z, _mass;
+    std::vector<float> _accelerationX, _accelerationY, _accelerationZ;
+};
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
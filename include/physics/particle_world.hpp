@@ -0,0 +1,208 @@
+#pragma once
+
+#include "math/vector.hpp"
+#include "physics/bounds.hpp"
+#include "physics/spatial_hash_grid.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace SFSim {
+namespace Physics {
+
+using namespace Math;
+
+// Spawns particles in a cone around direction, from a sphere of jitter
+// radius around position. Colors are packed 0xRRGGBBAA, as sf::Color's
+// toInteger() gives them, so this module stays free of SFML.
+struct ParticleEmitter {
+    Vector3f position;
+    Vector3f direction;
+    // Half-angle of the cone, in radians; pi sprays in every direction.
+    float spread;
+    float jitter;
+    float minSpeed;
+    float maxSpeed;
+    // Particles per second, while enabled.
+    float rate;
+    // Seconds; 0 lives until removed by clear().
+    float minLifetime;
+    float maxLifetime;
+    std::uint32_t color;
+    bool enabled;
+
+    ParticleEmitter();
+};
+
+// Acceleration applied to every particle each step. Gravity is constant;
+// drag slows particles by strength per second, like a rigidbody's drag;
+// a vortex swirls particles around the axis through position, strongest
+// (strength / 2) at radius from it and falling off as 1/r beyond; an
+// attractor pulls toward position as strength / r^2, softened by radius so
+// it stays finite at the center. Negative strengths reverse a vortex or
+// make an attractor repel.
+struct ForceField {
+    enum Type { Gravity, Drag, Vortex, Attractor };
+
+    Type type;
+    Vector3f position;
+    // Gravity: the acceleration. Vortex: its (unit) axis.
+    Vector3f vector;
+    float strength;
+    float radius;
+
+    static ForceField gravity(const Vector3f& acceleration);
+    static ForceField drag(float strength);
+    static ForceField vortex(const Vector3f& position, const Vector3f& axis, float strength, float radius);
+    static ForceField attractor(const Vector3f& position, float strength, float radius);
+};
+
+// Particle state in structure-of-arrays form, one float array per
+// component kept to whole Float4 groups, like RigidbodyWorld. update()
+// runs the force fields as SIMD kernels over parallel chunks, then packs
+// the live particles back to the front of the arrays, so every index below
+// size() is a live particle and renderers can walk the arrays directly.
+class ParticleWorld {
+public:
+    ParticleWorld();
+
+    size_t addEmitter(const ParticleEmitter& emitter);
+    ParticleEmitter& getEmitter(size_t index) { return _emitters[index].emitter; }
+    size_t getEmitterCount() const { return _emitters.size(); }
+    void clearEmitters() { _emitters.clear(); }
+
+    void addForceField(const ForceField& field) { _fields.push_back(field); }
+    std::vector<ForceField>& getForceFields() { return _fields; }
+    void clearForceFields() { _fields.clear(); }
+
+    // Particles bounce off the inside of the box, keeping restitution of
+    // their speed into the wall.
+    void setContainer(const AABB& box, float restitution);
+    void clearContainer() { _hasContainer = false; }
+    bool hasContainer() const { return _hasContainer; }
+    const AABB& getContainer() const { return _container; }
+
+    // Makes particles spheres of radius that collide with each other:
+    // overlapping pairs are pushed apart by stiffness per unit of overlap,
+    // with damping per unit of approach speed, and cohesion pulls pairs
+    // within twice their contact distance back together, fading out with
+    // distance. Neighbors are found through a SpatialHashGrid rebuilt every
+    // step, so this stays linear in the number of particles.
+    void setInteraction(float radius, float stiffness, float damping, float cohesion);
+    void clearInteraction() { _interacting = false; }
+    bool isInteracting() const { return _interacting; }
+    // The grid of the last interacting update(), over positions before it
+    // moved the particles.
+    const SpatialHashGrid& getGrid() const { return _grid; }
+
+    // Spawns beyond the cap are dropped.
+    void setMaxParticles(size_t count) { _maxParticles = count; }
+    size_t getMaxParticles() const { return _maxParticles; }
+
+    // Worlds with at least this many particles are updated in parallel; 0
+    // keeps updates on the calling thread.
+    void setParallelThreshold(size_t particles) { _parallelThreshold = particles; }
+    size_t getParallelThreshold() const { return _parallelThreshold; }
+
+    void setSeed(unsigned int seed) { _random.seed(seed); }
+
+    // Returns the index, or size() if the world is full. Lifetime 0 lives
+    // until clear().
+    size_t spawn(const Vector3f& position, const Vector3f& velocity, float lifetime, std::uint32_t color);
+    // A burst of count particles from the emitter, whether or not it is
+    // enabled.
+    void emit(const ParticleEmitter& emitter, size_t count);
+    void clear();
+
+    // Lets particles interact, then ages, accelerates and moves every
+    // particle, removes the ones that have outlived their lifetime, and
+    // lets the emitters spawn.
+    void update(float deltaTime);
+
+    size_t size() const { return _count; }
+
+    Vector3f getPosition(size_t particle) const { return _position.get(particle); }
+    Vector3f getVelocity(size_t particle) const { return _velocity.get(particle); }
+    void setPosition(size_t particle, const Vector3f& position) { _position.set(particle, position); }
+    void setVelocity(size_t particle, const Vector3f& velocity) { _velocity.set(particle, velocity); }
+    float getAge(size_t particle) const { return _age[particle]; }
+    float getLifetime(size_t particle) const { return _lifetime[particle]; }
+    std::uint32_t getColor(size_t particle) const { return _color[particle]; }
+
+    // Moves particle order[i] to index i, for every i below size(); order
+    // must list each of them once. Particles are free to move around, so
+    // solvers that walk neighbors put them in a SpatialHashGrid's sorted
+    // order, and then read the arrays in sequence.
+    void reorder(const std::vector<uint32_t>& order);
+
+    // The arrays themselves, valid until the next spawn or update; the
+    // first size() entries are live, and they run on to a whole Float4
+    // group.
+    const float* getPositionX() const { return _position.x.data(); }
+    const float* getPositionY() const { return _position.y.data(); }
+    const float* getPositionZ() const { return _position.z.data(); }
+    const float* getVelocityX() const { return _velocity.x.data(); }
+    const float* getVelocityY() const { return _velocity.y.data(); }
+    const float* getVelocityZ() const { return _velocity.z.data(); }
+    const float* getAges() const { return _age.data(); }
+    // Infinite for particles that never expire.
+    const float* getLifetimes() const { return _lifetime.data(); }
+    const std::uint32_t* getColors() const { return _color.data(); }
+
+private:
+    struct Column3 {
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+
+        Vector3f get(size_t i) const { return Vector3f(x[i], y[i], z[i]); }
+        void set(size_t i, const Vector3f& value) { x[i] = value.x; y[i] = value.y; z[i] = value.z; }
+        void resize(size_t count) { x.resize(count, 0.0f); y.resize(count, 0.0f); z.resize(count, 0.0f); }
+    };
+
+    struct EmitterState {
+        ParticleEmitter emitter;
+        // Fraction of a particle carried over between steps, so low rates
+        // still emit at high frame rates.
+        float pending;
+    };
+
+    Column3 _position;
+    Column3 _velocity;
+    std::vector<float> _age;
+    std::vector<float> _lifetime;
+    std::vector<std::uint32_t> _color;
+
+    std::vector<EmitterState> _emitters;
+    std::vector<ForceField> _fields;
+    AABB _container;
+    float _restitution;
+    bool _hasContainer;
+
+    float _radius;
+    float _stiffness;
+    float _damping;
+    float _cohesion;
+    bool _interacting;
+    SpatialHashGrid _grid;
+    // Velocity change from interaction, in the grid's sorted order.
+    Column3 _interaction;
+    // Where reorder() gathers each array before swapping it in.
+    std::vector<float> _scratch;
+    std::vector<std::uint32_t> _colorScratch;
+
+    size_t _count;
+    size_t _maxParticles;
+    size_t _parallelThreshold;
+    std::mt19937 _random;
+
+    void spawnFrom(const ParticleEmitter& emitter);
+    void interact(float deltaTime);
+    // Returns how many particles in [begin, end) died.
+    size_t integrate(size_t begin, size_t end, float deltaTime);
+    void removeDead();
+};
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
@@ -1,79 +1,97 @@
 #pragma once
 
 #include "math/vector.hpp"
+#include "physics/bounds.hpp"
+#include "physics/dynamic_tree.hpp"
+#include "physics/mesh_bvh.hpp"
+#include "physics/heightfield.hpp"
+#include "physics/convex_hull.hpp"
+#include "physics/rigidbody_world.hpp"
 #include "ecs/component.hpp"
 #include "ecs/system.hpp"
 #include <vector>
 #include <memory>
+#include <unordered_map>
+#include <algorithm>
+#include <array>
+#include <cstdint>
 
 namespace SFSim {
+class Transform;
+namespace ECS { class TransformComponent; }
+
 namespace Physics {
 
 using namespace Math;
 using namespace ECS;
 
-struct AABB {
-    Vector3f min;
-    Vector3f max;
-    
-    AABB() : min(Vector3f::zero()), max(Vector3f::zero()) {}
-    AABB(const Vector3f& minPoint, const Vector3f& maxPoint) : min(minPoint), max(maxPoint) {}
-    
-    Vector3f getCenter() const { return (min + max) * 0.5f; }
-    Vector3f getSize() const { return max - min; }
-    Vector3f getExtents() const { return getSize() * 0.5f; }
-    
-    bool contains(const Vector3f& point) const;
-    bool intersects(const AABB& other) const;
-    AABB merge(const AABB& other) const;
-    void expand(const Vector3f& point);
-    void expand(float amount);
-};
-
-struct Sphere {
-    Vector3f center;
-    float radius;
-    
-    Sphere() : center(Vector3f::zero()), radius(1.0f) {}
-    Sphere(const Vector3f& c, float r) : center(c), radius(r) {}
-    
-    bool contains(const Vector3f& point) const;
-    bool intersects(const Sphere& other) const;
-    bool intersects(const AABB& aabb) const;
-};
-
-struct Ray {
-    Vector3f origin;
-    Vector3f direction;
-    
-    Ray() : origin(Vector3f::zero()), direction(Vector3f::forward()) {}
-    Ray(const Vector3f& o, const Vector3f& d) : origin(o), direction(d.normalized()) {}
-    
-    Vector3f getPoint(float t) const { return origin + direction * t; }
-};
-
 struct RaycastHit {
     bool hit;
     Vector3f point;
     Vector3f normal;
     float distance;
     Entity* entity;
+    // Mesh, heightfield and convex hull colliders only: the triangle hit
+    // (for meshes and hulls its first index is at triangleIndex * 3, for
+    // heightfields it is numbered as in Heightfield::raycast) and the
+    // weights of its three vertices. -1 otherwise.
+    int triangleIndex;
+    Vector3f barycentric;
+    
+    RaycastHit()
+        : hit(false), point(Vector3f::zero()), normal(Vector3f::up()), distance(0.0f), entity(nullptr)
+        , triangleIndex(-1), barycentric(Vector3f::zero()) {}
+};
+
+// A sphere's deepest overlap with a collider, from
+// PhysicsSystem::collideSpheres. The normal points out of the collider,
+// the way the sphere has to move by penetration to leave it.
+struct SphereContact {
+    bool hit;
+    Vector3f normal;
+    float penetration;
+    Entity* entity;
     
-    RaycastHit() : hit(false), point(Vector3f::zero()), normal(Vector3f::up()), distance(0.0f), entity(nullptr) {}
+    SphereContact() : hit(false), normal(Vector3f::up()), penetration(0.0f), entity(nullptr) {}
+};
+
+// A contact or trigger overlap that began, stayed or ended during a step.
+// Trigger events have a zero normal; End events keep the last contact's.
+struct CollisionEvent {
+    enum Type : uint8_t { Begin, Stay, End };
+    
+    Entity* a;
+    Entity* b;
+    // From a to b.
+    Vector3f normal;
+    float penetration;
+    Type type;
+    bool trigger;
 };
 
 class RigidbodyComponent : public ComponentBase<RigidbodyComponent> {
 public:
     RigidbodyComponent();
     
-    void setMass(float mass) { _mass = mass; _invMass = (mass > 0) ? 1.0f / mass : 0.0f; }
+    ComponentType getComponentType() const override { return ComponentType::Rigidbody; }
+    
+    void setMass(float mass);
     float getMass() const { return _mass; }
     float getInverseMass() const { return _invMass; }
     
-    void setVelocity(const Vector3f& velocity) { _velocity = velocity; }
+    // Principal moments of inertia, about the body's local axes. Unless set
+    // here they follow the collider's shape and scale and the body's mass;
+    // a zero moment locks rotation about that axis.
+    void setInertiaTensor(const Vector3f& inertia) { _inertiaFromCollider = false; setInertia(inertia); }
+    const Vector3f& getInertiaTensor() const { return _inertia; }
+    const Vector3f& getInverseInertiaTensor() const { return _invInertia; }
+    bool isInertiaFromCollider() const { return _inertiaFromCollider; }
+    
+    void setVelocity(const Vector3f& velocity) { _velocity = velocity; wakeUp(); }
     const Vector3f& getVelocity() const { return _velocity; }
     
-    void setAngularVelocity(const Vector3f& angularVelocity) { _angularVelocity = angularVelocity; }
+    // World space, radians per second about each axis.
+    void setAngularVelocity(const Vector3f& angularVelocity) { _angularVelocity = angularVelocity; wakeUp(); }
     const Vector3f& getAngularVelocity() const { return _angularVelocity; }
     
     void setDrag(float drag) { _drag = drag; }
@@ -88,18 +106,42 @@ public:
     void setKinematic(bool kinematic) { _kinematic = kinematic; }
     bool isKinematic() const { return _kinematic; }
     
-    void addForce(const Vector3f& force) { _force += force; }
-    void addImpulse(const Vector3f& impulse) { _velocity += impulse * _invMass; }
-    void addTorque(const Vector3f& torque) { _torque += torque; }
+    // Continuous bodies are swept along each step's motion and stopped at
+    // the first impact, so they can't tunnel through thin colliders however
+    // fast they move. Meant for the few bodies that need it: projectiles,
+    // fast vehicles.
+    void setContinuous(bool continuous) { _continuous = continuous; }
+    bool isContinuous() const { return _continuous; }
+    
+    void addForce(const Vector3f& force) { _force += force; wakeUp(); }
+    void addImpulse(const Vector3f& impulse) { _velocity += impulse * _invMass; wakeUp(); }
+    // World space; applied through the inertia tensor on the next step.
+    void addTorque(const Vector3f& torque) { _torque += torque; wakeUp(); }
     
     void clearForces() { _force = Vector3f::zero(); _torque = Vector3f::zero(); }
     
     const Vector3f& getForce() const { return _force; }
     const Vector3f& getTorque() const { return _torque; }
     
+    // Sleeping bodies are skipped by the physics step. Forces, impulses and
+    // velocity changes wake a body, as does contact with an awake one; the
+    // rest of its island wakes with it on the next step.
+    void setCanSleep(bool canSleep) { _canSleep = canSleep; if (!canSleep) wakeUp(); }
+    bool canSleep() const { return _canSleep; }
+    bool isSleeping() const { return _sleeping; }
+    void wakeUp() { if (_sleeping) { _sleeping = false; _sleepTime = 0.0f; } }
+    
 private:
+    friend class PhysicsSystem;
+    friend class RigidbodyWorld;
+    
+    void setInertia(const Vector3f& inertia);
+    
     float _mass;
     float _invMass;
+    Vector3f _inertia;
+    Vector3f _invInertia;
+    bool _inertiaFromCollider;
     Vector3f _velocity;
     Vector3f _angularVelocity;
     Vector3f _force;
@@ -108,34 +150,79 @@ private:
     float _angularDrag;
     float _gravityScale;
     bool _kinematic;
+    bool _continuous;
+    
+    bool _canSleep;
+    bool _sleeping;
+    // How long the body has been below the sleep thresholds.
+    float _sleepTime;
+    // Position at the start of the current step.
+    Vector3f _stepStart;
+    // Sleeping island this body belongs to, or -1.
+    int _sleepIsland;
+    // Position in the current step's awake body list, or -1.
+    int _solverIndex;
 };
 
 class ColliderComponent : public ComponentBase<ColliderComponent> {
 public:
-    enum Type { Box, Sphere, Capsule };
+    enum Type { Box, Sphere, Capsule, Mesh, Heightfield, ConvexHull };
     
     ColliderComponent(Type type = Box);
     
-    void setType(Type type) { _type = type; }
-    Type getType() const { return _type; }
+    ComponentType getComponentType() const override { return ComponentType::Collider; }
+    
+    void setColliderType(Type type) { _type = type; ++_version; }
+    Type getColliderType() const { return _type; }
     
-    void setSize(const Vector3f& size) { _size = size; }
+    void setSize(const Vector3f& size) { _size = size; ++_version; }
     const Vector3f& getSize() const { return _size; }
     
-    void setRadius(float radius) { _radius = radius; }
+    void setRadius(float radius) { _radius = radius; ++_version; }
     float getRadius() const { return _radius; }
     
-    void setHeight(float height) { _height = height; }
+    void setHeight(float height) { _height = height; ++_version; }
     float getHeight() const { return _height; }
     
-    void setCenter(const Vector3f& center) { _center = center; }
+    void setCenter(const Vector3f& center) { _center = center; ++_version; }
     const Vector3f& getCenter() const { return _center; }
     
-    void setTrigger(bool trigger) { _isTrigger = trigger; }
+    void setTrigger(bool trigger) { _isTrigger = trigger; ++_version; }
     bool isTrigger() const { return _isTrigger; }
     
+    // The layer (0-31) this collider is on and the layers it collides with.
+    // A pair is only tested if each is in the other's mask and the system's
+    // layer matrix lets their layers collide.
+    void setLayer(int layer) { _layer = std::min(std::max(layer, 0), 31); ++_version; }
+    int getLayer() const { return _layer; }
+    void setCollisionMask(uint32_t mask) { _collisionMask = mask; ++_version; }
+    uint32_t getCollisionMask() const { return _collisionMask; }
+    
+    // Makes this a Mesh collider. The BVH is in the entity's local space,
+    // offset by the center, and is usually shared between all entities using
+    // the same mesh (see MeshGeometry::getBVH).
+    void setMesh(std::shared_ptr<const MeshBVH> mesh) { _mesh = std::move(mesh); _type = Mesh; ++_version; }
+    const std::shared_ptr<const MeshBVH>& getMesh() const { return _mesh; }
+    
+    // Makes this a Heightfield collider: terrain offset by the center and
+    // scaled with the entity, but never rotated. Can be shared like meshes.
+    void setHeightfield(std::shared_ptr<const Physics::Heightfield> heightfield) { _heightfield = std::move(heightfield); _type = Heightfield; ++_version; }
+    const std::shared_ptr<const Physics::Heightfield>& getHeightfield() const { return _heightfield; }
+    
+    // Makes this a ConvexHull collider. Like a mesh it is in the entity's
+    // local space, offset by the center, follows the full transform and can
+    // be shared (see MeshGeometry::getConvexHull).
+    void setConvexHull(std::shared_ptr<const Physics::ConvexHull> hull) { _convexHull = std::move(hull); _type = ConvexHull; ++_version; }
+    const std::shared_ptr<const Physics::ConvexHull>& getConvexHull() const { return _convexHull; }
+    
     AABB getBounds(const Vector3f& position, const Vector3f& scale) const;
-    Sphere getBoundingSphere(const Vector3f& position, const Vector3f& scale) const;
+    Physics::Sphere getBoundingSphere(const Vector3f& position, const Vector3f& scale) const;
+    // Principal moments of a solid shape of this mass about its center.
+    // Meshes, heightfields and convex hulls count as their bounding box.
+    Vector3f getInertiaTensor(float mass, const Vector3f& scale) const;
+    
+    // Changes whenever a setter is called.
+    unsigned int getVersion() const { return _version; }
     
 private:
     Type _type;
@@ -144,6 +231,12 @@ private:
     float _height;
     Vector3f _center;
     bool _isTrigger;
+    int _layer;
+    uint32_t _collisionMask;
+    std::shared_ptr<const MeshBVH> _mesh;
+    std::shared_ptr<const Physics::Heightfield> _heightfield;
+    std::shared_ptr<const Physics::ConvexHull> _convexHull;
+    unsigned int _version;
 };
 
 class PhysicsSystem : public System {
@@ -158,24 +251,250 @@ public:
     void setSimulationSpeed(float speed) { _simulationSpeed = speed; }
     float getSimulationSpeed() const { return _simulationSpeed; }
     
-    RaycastHit raycast(const Ray& ray, float maxDistance = 1000.0f, const std::vector<std::unique_ptr<Entity>>& entities = {});
-    std::vector<Entity*> overlapSphere(const Vector3f& center, float radius, const std::vector<std::unique_ptr<Entity>>& entities);
-    std::vector<Entity*> overlapBox(const Vector3f& center, const Vector3f& size, const std::vector<std::unique_ptr<Entity>>& entities);
+    // Batches of at least this many rays (or spheres) are split across the
+    // thread pool; 0 keeps raycastBatch and collideSpheres on the calling
+    // thread.
+    void setParallelRaycastThreshold(size_t rays) { _parallelRaycastThreshold = rays; }
+    size_t getParallelRaycastThreshold() const { return _parallelRaycastThreshold; }
+    
+    // Which layers collide with which, on top of each collider's own mask.
+    // Symmetric; every pair of layers collides by default. Layers are
+    // clamped to 0-31, as ColliderComponent::setLayer does.
+    void setLayersCollide(int layerA, int layerB, bool collide);
+    bool doLayersCollide(int layerA, int layerB) const { return (_layerMatrix[clampLayer(layerA)] >> clampLayer(layerB)) & 1u; }
+    uint32_t getLayerCollisionMask(int layer) const { return _layerMatrix[clampLayer(layer)]; }
+    
+    // Velocity passes over the contacts per step; stacks need several.
+    void setSolverIterations(int iterations) { _solverIterations = std::max(iterations, 1); }
+    int getSolverIterations() const { return _solverIterations; }
+    
+    // An island (bodies linked by contacts) goes to sleep once every body in
+    // it has stayed below both speeds for sleepTime seconds.
+    void setSleepThresholds(float linear, float angular) { _sleepLinearSpeed = linear; _sleepAngularSpeed = angular; }
+    float getSleepLinearThreshold() const { return _sleepLinearSpeed; }
+    float getSleepAngularThreshold() const { return _sleepAngularSpeed; }
+    void setSleepTime(float seconds) { _timeToSleep = seconds; }
+    float getSleepTime() const { return _timeToSleep; }
+    void setSleepingEnabled(bool enabled);
+    bool isSleepingEnabled() const { return _sleepingEnabled; }
+    
+    // Non-kinematic bodies simulated by the last update().
+    size_t getAwakeBodyCount() const { return _awakeBodyCount; }
+    size_t getSleepingIslandCount() const { return _sleepingIslands.size() - _freeSleepingIslands.size(); }
+    
+    // Everything that began, stayed or ended in the last update(), one event
+    // per pair, valid until the next update(). Pairs where neither side
+    // moved (asleep or static) carry over without Stay events. A pair whose
+    // entity is removed is dropped without an End event.
+    const std::vector<CollisionEvent>& getCollisionEvents() const { return _events; }
+    
+    void onEntityRemoved(Entity* entity) override;
+    
+    // Queries run against a persistent spatial index of collider entities.
+    // update() refreshes it after integrating; call updateSpatialIndex()
+    // directly after moving colliders outside the physics step.
+    //
+    // Colliders without a rigidbody are static. They live in an index of
+    // their own, with no margin, and are only indexed again when their
+    // transform, collider or set of components changes; they never search
+    // for contacts themselves, so static pairs are never tested.
+    void updateSpatialIndex(const std::vector<std::unique_ptr<Entity>>& entities);
+    const DynamicAABBTree& getSpatialIndex() const { return _index; }
+    const DynamicAABBTree& getStaticIndex() const { return _staticIndex; }
+    
+    // Queries only see colliders on layers in layerMask (bit n for layer n).
+    RaycastHit raycast(const Ray& ray, float maxDistance = 1000.0f, uint32_t layerMask = AllLayers);
+    // Writes one hit per ray. Rays are traced in SIMD packets of
+    // RayPacket::Width, so batches of nearby, similarly aimed rays (sensor
+    // sweeps) share most of their traversal.
+    void raycastBatch(const Ray* rays, size_t count, RaycastHit* hits, float maxDistance = 1000.0f, uint32_t layerMask = AllLayers);
+    std::vector<Entity*> overlapSphere(const Vector3f& center, float radius, uint32_t layerMask = AllLayers);
+    // Writes each sphere's deepest contact with the solid colliders on
+    // layerMask, for things the solver doesn't move itself (soft body
+    // particles) to push themselves out with. The colliders around the
+    // whole batch are found once, then each sphere is tested against them.
+    void collideSpheres(const Vector3f* centers, size_t count, float radius, SphereContact* contacts, uint32_t layerMask = AllLayers);
+    std::vector<Entity*> overlapBox(const Vector3f& center, const Vector3f& size, uint32_t layerMask = AllLayers);
     
 private:
+    struct IndexedCollider {
+        Entity* entity;
+        RigidbodyComponent* body;
+        ColliderComponent* collider;
+        TransformComponent* transform;
+        ColliderComponent::Type type;
+        bool isStatic;
+        int proxy;
+        // Unique across both trees: the proxy id, then whether it is static.
+        uint32_t pairId;
+        // What the entry was built from; static entries are reused until
+        // one of these changes.
+        unsigned int componentVersion;
+        unsigned int colliderVersion;
+        unsigned int transformVersion;
+        AABB bounds;
+        Physics::Sphere sphere;
+        bool trigger;
+        int layer;
+        uint32_t mask;
+        unsigned int stamp;
+        // Last step this collider searched for contacts, i.e. could move.
+        unsigned int searched;
+        // Mesh and heightfield colliders trace and collide with their
+        // triangles in their own space, and convex hulls with their faces.
+        std::shared_ptr<const MeshBVH> mesh;
+        std::shared_ptr<const Physics::Heightfield> heightfield;
+        std::shared_ptr<const Physics::ConvexHull> hull;
+        Matrix4x4 worldToMesh;
+        Matrix4x4 meshToWorld;
+        
+        bool hasTriangles() const { return mesh || heightfield; }
+    };
+    
+    // Normal points from a to b. The arms run from each sphere's center to
+    // the contact point, and are zero for shapes that don't turn on contact.
+    struct Contact {
+        IndexedCollider* a;
+        IndexedCollider* b;
+        Vector3f normal;
+        float penetration;
+        Vector3f armA;
+        Vector3f armB;
+    };
+    
+    // A static collider's components and their versions when it was
+    // indexed, kept apart from the index so checking them runs down one
+    // dense array.
+    struct StaticWatch {
+        const ColliderComponent* collider;
+        const Transform* transform;
+        unsigned int colliderVersion;
+        unsigned int transformVersion;
+        IndexedCollider* indexed;
+    };
+    
+    // An entity list as it was when last scanned. While it is the same list
+    // and no entity anywhere has changed, the scan's results still stand.
+    struct EntityScan {
+        const std::unique_ptr<Entity>* entities = nullptr;
+        size_t count = 0;
+        unsigned int version = 0;
+        bool stale = true;
+        
+        bool isCurrent(const std::vector<std::unique_ptr<Entity>>& list) const {
+            return !stale && entities == list.data() && count == list.size() && version == Entity::getLatestComponentVersion();
+        }
+        void record(const std::vector<std::unique_ptr<Entity>>& list) {
+            entities = list.data();
+            count = list.size();
+            version = Entity::getLatestComponentVersion();
+            stale = false;
+        }
+    };
+    
+    // A touching pair, keyed by its pair ids (lower first) so a step's
+    // pairs can be diffed against the last step's as sorted lists.
+    struct TrackedPair {
+        uint64_t key;
+        IndexedCollider* a;
+        IndexedCollider* b;
+        Vector3f normal;
+        float penetration;
+        bool trigger;
+        
+        bool operator<(const TrackedPair& other) const { return key < other.key; }
+    };
+    
+    // The separating axis GJK last found for each pair that went through
+    // it, keyed like TrackedPair, so the next step's search starts where
+    // this one ended. Entries not used for a step are dropped.
+    struct CachedAxis {
+        Vector3f axis;
+        unsigned int step;
+    };
+    
     Vector3f _gravity;
     float _simulationSpeed;
     
-    void integrateVelocity(RigidbodyComponent* rigidbody, float deltaTime);
-    void integratePosition(Entity* entity, RigidbodyComponent* rigidbody, float deltaTime);
-    void checkCollisions(const std::vector<std::unique_ptr<Entity>>& entities);
-    
-    bool checkCollision(Entity* entityA, Entity* entityB);
-    bool checkAABBCollision(const AABB& a, const AABB& b);
-    bool checkSphereCollision(const Sphere& a, const Sphere& b);
-    bool checkSpherAABBCollision(const Sphere& sphere, const AABB& aabb);
-    
-    void resolveCollision(Entity* entityA, Entity* entityB, const Vector3f& normal, float penetration);
+    DynamicAABBTree _index;
+    DynamicAABBTree _staticIndex;
+    std::unordered_map<Entity*, IndexedCollider> _indexed;
+    std::array<uint32_t, 32> _layerMatrix;
+    unsigned int _indexStamp;
+    
+    // Entities with rigidbodies, and indexed colliders in entity order, as
+    // of the last scan that found anything added, removed or (de)activated.
+    EntityScan _bodyScan;
+    EntityScan _colliderScan;
+    std::vector<Entity*> _bodyEntities;
+    std::vector<IndexedCollider*> _dynamicColliders;
+    std::vector<StaticWatch> _staticColliders;
+    size_t _parallelRaycastThreshold;
+    
+    // Awake bodies are integrated in _world, whose slots line up with the
+    // first _world.size() entries of _awakeBodies and _bodyTransforms.
+    RigidbodyWorld _world;
+    std::vector<TransformComponent*> _bodyTransforms;
+    
+    std::vector<Contact> _contacts;
+    std::vector<RigidbodyComponent*> _awakeBodies;
+    std::vector<RigidbodyComponent*> _kinematicBodies;
+    unsigned int _step;
+    
+    // Pairs found this step, pairs touching as of the last one, and the
+    // events built from the two: filled in _pendingEvents, then swapped out.
+    std::vector<TrackedPair> _pairs;
+    std::vector<TrackedPair> _activePairs;
+    std::unordered_map<uint64_t, CachedAxis> _separatingAxes;
+    std::vector<TrackedPair> _mergedPairs;
+    std::vector<CollisionEvent> _events;
+    std::vector<CollisionEvent> _pendingEvents;
+    std::vector<int> _islandParent;
+    std::vector<float> _islandSleepTime;
+    std::vector<int> _islandSlot;
+    std::vector<std::vector<RigidbodyComponent*>> _sleepingIslands;
+    std::vector<int> _freeSleepingIslands;
+    size_t _awakeBodyCount;
+    
+    float _sleepLinearSpeed;
+    float _sleepAngularSpeed;
+    float _timeToSleep;
+    bool _sleepingEnabled;
+    int _solverIterations;
+    
+    DynamicAABBTree& treeOf(const IndexedCollider& collider) { return collider.isStatic ? _staticIndex : _index; }
+    IndexedCollider& indexCollider(Entity* entity, ColliderComponent* collider, TransformComponent* transform, RigidbodyComponent* body);
+    void integrateBlock(size_t begin, size_t end, float deltaTime);
+    void findContacts();
+    void addPair(IndexedCollider* a, IndexedCollider* b, const Vector3f& normal, float penetration, bool trigger);
+    void solveContacts();
+    void updateEvents();
+    void watchStatic(IndexedCollider& indexed);
+    void releaseCollider(std::unordered_map<Entity*, IndexedCollider>::iterator it);
+    static int clampLayer(int layer) { return std::min(std::max(layer, 0), 31); }
+    void updateSleeping(float deltaTime);
+    void wakeIsland(int island);
+    void dropRemovedBodies(const std::vector<std::unique_ptr<Entity>>& entities);
+    void wakeTouching(const AABB& bounds, uint32_t layerMask);
+    int findIsland(int body);
+    
+    // Normal from a to b, penetration (negative for a gap within the
+    // contact margin) and contact point. Shapes meet triangle colliders
+    // triangle by triangle, sphere pairs as spheres and box pairs as their
+    // bounds; every other pair goes through GJK and EPA, warm-started from
+    // axis when one is given (see convexContact).
+    static bool collide(const IndexedCollider& a, const IndexedCollider& b, Vector3f& normal, float& penetration, Vector3f& point, Vector3f* axis = nullptr);
+    static bool isConvexPair(const IndexedCollider& a, const IndexedCollider& b);
+    // collide(), keeping the pair's GJK axis in _separatingAxes.
+    bool collidePair(const IndexedCollider& a, const IndexedCollider& b, Vector3f& normal, float& penetration, Vector3f& point);
+    static bool triangleContact(const IndexedCollider& shape, const IndexedCollider& surface, Vector3f& normal, float& penetration, Vector3f& point);
+    // Penetration (positive only) and normal out of the collider.
+    static bool sphereContact(const IndexedCollider& collider, const Physics::Sphere& sphere, Vector3f& normal, float& penetration);
+    static bool raycastCollider(const IndexedCollider& collider, const Ray& ray, const Vector3f& invDir, float maxDistance, RaycastHit& hit);
+    
+    Vector3f sweepDisplacement(Entity* entity, const Vector3f& position, const Vector3f& scale, const Vector3f& displacement);
+    
+    void resolveCollision(const Contact& contact, float penetration);
 };
 
 } // namespace Physics
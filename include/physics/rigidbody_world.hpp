@@ -0,0 +1,99 @@
+#pragma once
+
+#include "math/vector.hpp"
+#include "math/quaternion.hpp"
+#include <cstddef>
+#include <vector>
+
+namespace SFSim {
+namespace Physics {
+
+using namespace Math;
+
+class RigidbodyComponent;
+
+// Rigidbody state in structure-of-arrays form: one contiguous float array
+// per component, kept to whole Float4 groups, so integration runs as SIMD
+// kernels over every body instead of through each component's getters.
+// PhysicsSystem loads its awake bodies into a world each step and stores
+// the results back; headless simulations can also use one directly.
+class RigidbodyWorld {
+public:
+    RigidbodyWorld();
+
+    // Copies the body's velocities, pending force and torque, and parameters.
+    size_t add(const RigidbodyComponent& body, const Vector3f& position, const Quaternion& orientation);
+    // Keeps the allocations for the next round of add().
+    void clear();
+    size_t size() const { return _count; }
+
+    Vector3f getPosition(size_t body) const { return _position.get(body); }
+    Quaternion getOrientation(size_t body) const { return _orientation.get(body); }
+    Vector3f getVelocity(size_t body) const { return _velocity.get(body); }
+    Vector3f getAngularVelocity(size_t body) const { return _angularVelocity.get(body); }
+
+    void setPosition(size_t body, const Vector3f& position) { _position.set(body, position); }
+    void setVelocity(size_t body, const Vector3f& velocity) { _velocity.set(body, velocity); }
+    void addForce(size_t body, const Vector3f& force) { _force.set(body, _force.get(body) + force); }
+    void addTorque(size_t body, const Vector3f& torque) { _torque.set(body, _torque.get(body) + torque); }
+
+    // Writes velocities back to the component.
+    void store(size_t body, RigidbodyComponent& component) const;
+
+    // Gravity, forces, torques and drag, then positions and orientations,
+    // for every body; pending forces and torques are consumed. Torque is
+    // applied through the world-space inverse inertia at the start of the
+    // step; the gyroscopic term is left out, which keeps the step stable
+    // for long, thin bodies.
+    void integrate(float deltaTime, const Vector3f& gravity);
+    // Just bodies [begin, end); begin must be a multiple of Float4::Width.
+    // Lets callers mirror a block back to components while it is still in
+    // cache.
+    void integrate(size_t begin, size_t end, float deltaTime, const Vector3f& gravity);
+
+    // Worlds with at least this many bodies are integrated in parallel; 0
+    // keeps integration on the calling thread.
+    void setParallelThreshold(size_t bodies) { _parallelThreshold = bodies; }
+    size_t getParallelThreshold() const { return _parallelThreshold; }
+
+private:
+    struct Column3 {
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+
+        Vector3f get(size_t i) const { return Vector3f(x[i], y[i], z[i]); }
+        void set(size_t i, const Vector3f& value) { x[i] = value.x; y[i] = value.y; z[i] = value.z; }
+        void resize(size_t count) { x.resize(count, 0.0f); y.resize(count, 0.0f); z.resize(count, 0.0f); }
+    };
+
+    struct Column4 {
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+        std::vector<float> w;
+
+        Quaternion get(size_t i) const { return Quaternion(x[i], y[i], z[i], w[i]); }
+        void set(size_t i, const Quaternion& value) { x[i] = value.x; y[i] = value.y; z[i] = value.z; w[i] = value.w; }
+        void resize(size_t count) { x.resize(count, 0.0f); y.resize(count, 0.0f); z.resize(count, 0.0f); w.resize(count, 1.0f); }
+    };
+
+    Column3 _position;
+    Column4 _orientation;
+    Column3 _velocity;
+    Column3 _angularVelocity;
+    Column3 _force;
+    Column3 _torque;
+    // Principal moments, in body space.
+    Column3 _inverseInertia;
+    std::vector<float> _inverseMass;
+    std::vector<float> _drag;
+    std::vector<float> _angularDrag;
+    std::vector<float> _gravityScale;
+
+    size_t _count;
+    size_t _parallelThreshold;
+};
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
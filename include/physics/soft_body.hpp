@@ -0,0 +1,167 @@
+#pragma once
+
+#include "math/vector.hpp"
+#include "physics/physics.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace SFSim {
+
+class MeshGeometry;
+
+namespace Physics {
+
+using namespace Math;
+
+// Cloth and soft bodies made of a mesh's own vertices, simulated with
+// extended position-based dynamics (XPBD) in small steps: every substep
+// predicts where the particles are going, moves them back onto their
+// constraints once, pushes them out of colliders and takes their velocity
+// from how far they actually moved.
+//
+// Each edge of the mesh keeps its length (stretch) and each pair of
+// triangles sharing an edge keeps the distance between their far corners
+// (bending); closed meshes can also keep their enclosed volume, like a
+// balloon. Compliances are inverse stiffnesses, so 0 is as stiff as the
+// substeps allow. Edge and bending constraints are colored up front so no
+// two in a batch share a particle, and each batch is solved in parallel.
+//
+// update() writes the particles straight into the mesh's vertices and
+// refreshes the normals of the ones that moved. The mesh is simulated in
+// world space, so the entity drawing it should have an identity transform.
+class SoftBody {
+public:
+    SoftBody();
+
+    // Takes the mesh's vertices as particles, with mass spread evenly over
+    // them. Vertices at the same position (the seams of createSphere, the
+    // corners of createCube) become one particle, so the surface holds
+    // together. The mesh has to outlive the soft body, or its next build().
+    void build(MeshGeometry& mesh, float mass);
+
+    // Meters per newton.
+    void setStretchCompliance(float compliance) { _stretchCompliance = compliance; }
+    float getStretchCompliance() const { return _stretchCompliance; }
+    void setBendCompliance(float compliance) { _bendCompliance = compliance; }
+    float getBendCompliance() const { return _bendCompliance; }
+
+    // Closed meshes only: keeps the enclosed volume at pressure times what
+    // it was at build(), with this compliance (cubic meters per newton).
+    void setVolumeConstrained(bool constrained) { _volumeConstrained = constrained; }
+    bool isVolumeConstrained() const { return _volumeConstrained; }
+    void setVolumeCompliance(float compliance) { _volumeCompliance = compliance; }
+    float getVolumeCompliance() const { return _volumeCompliance; }
+    void setPressure(float pressure) { _pressure = pressure; }
+    float getPressure() const { return _pressure; }
+
+    // More substeps make every constraint stiffer and contacts firmer.
+    void setSubsteps(int substeps) { _substeps = substeps < 1 ? 1 : substeps; }
+    int getSubsteps() const { return _substeps; }
+
+    void setGravity(const Vector3f& gravity) { _gravity = gravity; }
+    const Vector3f& getGravity() const { return _gravity; }
+    // Fraction of its velocity a particle loses per second.
+    void setDamping(float damping) { _damping = damping; }
+    float getDamping() const { return _damping; }
+
+    // Particles collide as spheres of this radius, keeping the surface this
+    // far off colliders, and slide along them against Coulomb friction.
+    void setThickness(float thickness) { _thickness = thickness; }
+    float getThickness() const { return _thickness; }
+    void setFriction(float friction) { _friction = friction; }
+    float getFriction() const { return _friction; }
+    void setCollisionMask(uint32_t mask) { _collisionMask = mask; }
+    uint32_t getCollisionMask() const { return _collisionMask; }
+
+    // Batches of at least this many constraints, and passes over at least
+    // this many particles, run on the thread pool; 0 keeps the solver on
+    // the calling thread.
+    void setParallelThreshold(size_t count) { _parallelThreshold = count; }
+    size_t getParallelThreshold() const { return _parallelThreshold; }
+
+    size_t getParticleCount() const { return _positions.size(); }
+    // The particle a vertex of the mesh follows.
+    size_t getParticle(size_t vertex) const { return _vertexParticle[vertex]; }
+    const Vector3f& getPosition(size_t particle) const { return _positions[particle]; }
+    void setPosition(size_t particle, const Vector3f& position) { _positions[particle] = position; }
+    const Vector3f& getVelocity(size_t particle) const { return _velocities[particle]; }
+    void setVelocity(size_t particle, const Vector3f& velocity) { _velocities[particle] = velocity; }
+    // 0 pins the particle where it is.
+    void setInverseMass(size_t particle, float inverseMass) { _inverseMass[particle] = inverseMass; }
+    float getInverseMass(size_t particle) const { return _inverseMass[particle]; }
+    void pin(size_t particle) { setInverseMass(particle, 0.0f); }
+
+    // Stretch and bending constraints, and the parallel batches they are
+    // solved in.
+    size_t getConstraintCount() const { return _constraints.size(); }
+    size_t getBatchCount() const { return _batches.empty() ? 0 : _batches.size() - 1; }
+    float getVolume() const;
+    float getRestVolume() const { return _restVolume; }
+
+    // Advances deltaTime (at most MaxDeltaTime, so a long frame doesn't
+    // blow the cloth apart) in getSubsteps() steps, colliding with
+    // physics' colliders when given one, then updates the mesh.
+    void update(float deltaTime, PhysicsSystem* physics = nullptr);
+
+    static constexpr float MaxDeltaTime = 1.0f / 30.0f;
+
+private:
+    struct DistanceConstraint {
+        uint32_t a;
+        uint32_t b;
+        float restLength;
+        bool bending;
+    };
+
+    MeshGeometry* _mesh;
+
+    float _stretchCompliance;
+    float _bendCompliance;
+    bool _volumeConstrained;
+    float _volumeCompliance;
+    float _pressure;
+    int _substeps;
+    Vector3f _gravity;
+    float _damping;
+    float _thickness;
+    float _friction;
+    uint32_t _collisionMask;
+    size_t _parallelThreshold;
+
+    std::vector<Vector3f> _positions;
+    std::vector<Vector3f> _previous;
+    std::vector<Vector3f> _velocities;
+    std::vector<float> _inverseMass;
+    std::vector<uint32_t> _vertexParticle;
+    // Particles where the mesh's vertices were last written.
+    std::vector<Vector3f> _written;
+    std::vector<uint8_t> _moved;
+    std::vector<unsigned int> _movedVertices;
+
+    // In batch order; batch i is [_batches[i], _batches[i + 1]). Whatever
+    // the coloring couldn't place follows the last batch and is solved
+    // serially.
+    std::vector<DistanceConstraint> _constraints;
+    std::vector<uint32_t> _batches;
+
+    // Triangles as particle indices, and for each particle the corners it
+    // is (triangle * 3 + corner), from _cornerStart[p] to _cornerStart[p + 1].
+    std::vector<uint32_t> _triangles;
+    std::vector<uint32_t> _cornerStart;
+    std::vector<uint32_t> _corners;
+    std::vector<Vector3f> _volumeGradient;
+    float _restVolume;
+
+    std::vector<SphereContact> _contacts;
+
+    void color();
+    void substep(float dt, PhysicsSystem* physics);
+    void solveConstraints(size_t begin, size_t end, float stretchAlpha, float bendAlpha);
+    void solveVolume(float dt);
+    void collide(PhysicsSystem& physics);
+    void writeMesh();
+};
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
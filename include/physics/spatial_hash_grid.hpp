@@ -0,0 +1,222 @@
+#pragma once
+
+#include "math/vector.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace SFSim {
+namespace Physics {
+
+using namespace Math;
+
+// Uniform grid over a set of points, hashed into a table of buckets so it
+// needs no bounds, and rebuilt from scratch whenever the points move.
+// build() counting-sorts the points by bucket: getSortedIndices() lists
+// them bucket by bucket, and their positions are copied into the same
+// order, so walking the points in sorted order and visiting each one's
+// neighbors reads memory mostly in sequence. Within a bucket points keep
+// their original order, parallel build or not, so results built on the
+// grid don't change from run to run.
+//
+// Neighbor searches only ever look at the cells the search radius
+// touches, so with a cell size near the interaction radius, finding every
+// point's neighbors is linear in the number of points.
+class SpatialHashGrid {
+public:
+    SpatialHashGrid();
+
+    // Takes effect at the next build().
+    void setCellSize(float size) { _cellSize = size; }
+    float getCellSize() const { return _cellSize; }
+
+    // Grids over at least this many points are built in parallel; 0 keeps
+    // builds on the calling thread.
+    void setParallelThreshold(size_t points) { _parallelThreshold = points; }
+    size_t getParallelThreshold() const { return _parallelThreshold; }
+
+    void build(const float* x, const float* y, const float* z, size_t count);
+    void build(const std::vector<Vector3f>& points);
+    void clear();
+
+    size_t size() const { return _sortedIndices.size(); }
+
+    // callback(index, distanceSquared) for every point within radius of
+    // position, with index as passed to build() -> false stops the query.
+    template<typename Callback>
+    void query(const Vector3f& position, float radius, Callback callback) const;
+
+    // callback(sorted, distanceSquared) for every other point within radius
+    // of the point at sorted position sorted, itself included only if
+    // includeSelf. Reads nothing but the grid, so any number of threads can
+    // run it at once, each over its own slice of sorted positions.
+    template<typename Callback>
+    void forEachNeighbor(size_t sorted, float radius, bool includeSelf, Callback callback) const;
+
+    // callback(first, second, distanceSquared) once for each pair of points
+    // within radius of each other, with indices as passed to build().
+    template<typename Callback>
+    void forEachPair(float radius, Callback callback) const;
+
+    // Point indices, as passed to build(), bucket by bucket.
+    const std::vector<uint32_t>& getSortedIndices() const { return _sortedIndices; }
+    // Positions in sorted order.
+    const float* getSortedX() const { return _sortedX.data(); }
+    const float* getSortedY() const { return _sortedY.data(); }
+    const float* getSortedZ() const { return _sortedZ.data(); }
+    Vector3f getSortedPosition(size_t sorted) const { return Vector3f(_sortedX[sorted], _sortedY[sorted], _sortedZ[sorted]); }
+
+private:
+    float _cellSize;
+    // Of the last build, which searches go by.
+    float _inverseCellSize;
+    size_t _parallelThreshold;
+    // The table has a power of two buckets, at least twice the number of
+    // points.
+    uint32_t _bucketMask;
+
+    // Where each bucket's points start in sorted order, one past the end
+    // for the last.
+    std::vector<uint32_t> _bucketStart;
+    std::vector<uint32_t> _sortedIndices;
+    std::vector<float> _sortedX;
+    std::vector<float> _sortedY;
+    std::vector<float> _sortedZ;
+    // Each sorted point's cell, packed, so points that only share a bucket
+    // with a cell being searched are passed over without a distance test.
+    std::vector<uint64_t> _sortedCells;
+
+    // Build scratch: each point's cell and bucket, and its rank among the
+    // points in that bucket.
+    std::vector<uint64_t> _cells;
+    std::vector<uint32_t> _buckets;
+    std::vector<uint32_t> _ranks;
+    std::vector<std::atomic<uint32_t>> _counts;
+    std::vector<uint32_t> _blockSums;
+
+    // floor() without the library call it costs below SSE4.1.
+    int cellCoordinate(float value) const {
+        float scaled = value * _inverseCellSize;
+        int truncated = static_cast<int>(scaled);
+        return truncated - (scaled < static_cast<float>(truncated));
+    }
+    // 21 bits per axis, offset so the cells around the origin don't wrap;
+    // cells a whole wrap apart share a key, and the distance test tells
+    // their points apart. x is the low field, so a row's keys are one
+    // contiguous range.
+    static constexpr int CellBits = 21;
+    static constexpr int CellOffset = 1 << (CellBits - 1);
+    static constexpr uint32_t CellMask = (1u << CellBits) - 1;
+    static uint64_t packCell(int x, int y, int z) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(z + CellOffset) & CellMask) << (2 * CellBits)) |
+               (static_cast<uint64_t>(static_cast<uint32_t>(y + CellOffset) & CellMask) << CellBits) |
+               static_cast<uint64_t>(static_cast<uint32_t>(x + CellOffset) & CellMask);
+    }
+    // Rows of cells along x are hashed as a whole and laid out in
+    // consecutive buckets, so a search reads one run of the table and of
+    // the sorted points per row it touches, rather than one per cell.
+    static uint32_t hashRow(int y, int z) {
+        return (static_cast<uint32_t>(y) * 0x9E3779B1u) ^ (static_cast<uint32_t>(z) * 0x85EBCA77u);
+    }
+    uint32_t bucketOf(int x, int y, int z) const {
+        return (hashRow(y, z) + static_cast<uint32_t>(x)) & _bucketMask;
+    }
+
+    // Visits each row of cells overlapping the box around position, with
+    // the range of sorted points hashed to its buckets (two, where it
+    // wraps around the table) and the range of keys its cells have.
+    // callback(firstCell, lastCell, begin, end) -> false stops.
+    template<typename Callback>
+    bool forEachRow(const Vector3f& position, float radius, Callback callback) const;
+};
+
+template<typename Callback>
+bool SpatialHashGrid::forEachRow(const Vector3f& position, float radius, Callback callback) const {
+    if (_sortedIndices.empty()) return true;
+
+    int minX = cellCoordinate(position.x - radius), maxX = cellCoordinate(position.x + radius);
+    int minY = cellCoordinate(position.y - radius), maxY = cellCoordinate(position.y + radius);
+    int minZ = cellCoordinate(position.z - radius), maxZ = cellCoordinate(position.z + radius);
+
+    // Rows so long (or so far out) that their keys wrap are walked a cell
+    // at a time instead.
+    uint32_t cells = static_cast<uint32_t>(maxX - minX) + 1;
+    bool wholeRows = static_cast<int64_t>(minX) + CellOffset >= 0 &&
+                     static_cast<int64_t>(maxX) + CellOffset <= static_cast<int64_t>(CellMask) &&
+                     cells <= _bucketMask;
+
+    for (int z = minZ; z <= maxZ; ++z) {
+        for (int y = minY; y <= maxY; ++y) {
+            uint32_t row = hashRow(y, z);
+            if (!wholeRows) {
+                for (int x = minX; x <= maxX; ++x) {
+                    uint32_t bucket = (row + static_cast<uint32_t>(x)) & _bucketMask;
+                    uint64_t cell = packCell(x, y, z);
+                    if (!callback(cell, cell, _bucketStart[bucket], _bucketStart[bucket + 1])) return false;
+                }
+                continue;
+            }
+
+            uint64_t firstCell = packCell(minX, y, z);
+            uint64_t lastCell = packCell(maxX, y, z);
+            uint32_t first = (row + static_cast<uint32_t>(minX)) & _bucketMask;
+            uint32_t last = first + cells;
+            if (last <= _bucketMask + 1) {
+                if (!callback(firstCell, lastCell, _bucketStart[first], _bucketStart[last])) return false;
+            } else {
+                if (!callback(firstCell, lastCell, _bucketStart[first], _bucketStart[_bucketMask + 1])) return false;
+                if (!callback(firstCell, lastCell, _bucketStart[0], _bucketStart[last - _bucketMask - 1])) return false;
+            }
+        }
+    }
+    return true;
+}
+
+template<typename Callback>
+void SpatialHashGrid::query(const Vector3f& position, float radius, Callback callback) const {
+    float radiusSquared = radius * radius;
+    forEachRow(position, radius, [&](uint64_t firstCell, uint64_t lastCell, uint32_t begin, uint32_t end) {
+        for (uint32_t s = begin; s < end; ++s) {
+            // Whether a point is in range is a coin toss, so the tests are
+            // combined into one branch instead of mispredicting twice.
+            float dx = _sortedX[s] - position.x;
+            float dy = _sortedY[s] - position.y;
+            float dz = _sortedZ[s] - position.z;
+            float distanceSquared = dx * dx + dy * dy + dz * dz;
+            bool inRange = (_sortedCells[s] >= firstCell) & (_sortedCells[s] <= lastCell) & (distanceSquared <= radiusSquared);
+            if (inRange && !callback(_sortedIndices[s], distanceSquared)) return false;
+        }
+        return true;
+    });
+}
+
+template<typename Callback>
+void SpatialHashGrid::forEachNeighbor(size_t sorted, float radius, bool includeSelf, Callback callback) const {
+    Vector3f position = getSortedPosition(sorted);
+    float radiusSquared = radius * radius;
+    forEachRow(position, radius, [&](uint64_t firstCell, uint64_t lastCell, uint32_t begin, uint32_t end) {
+        for (uint32_t s = begin; s < end; ++s) {
+            float dx = _sortedX[s] - position.x;
+            float dy = _sortedY[s] - position.y;
+            float dz = _sortedZ[s] - position.z;
+            float distanceSquared = dx * dx + dy * dy + dz * dz;
+            bool inRange = (_sortedCells[s] >= firstCell) & (_sortedCells[s] <= lastCell) &
+                           (distanceSquared <= radiusSquared) & (s != sorted || includeSelf);
+            if (inRange) callback(static_cast<size_t>(s), distanceSquared);
+        }
+        return true;
+    });
+}
+
+template<typename Callback>
+void SpatialHashGrid::forEachPair(float radius, Callback callback) const {
+    for (size_t sorted = 0; sorted < _sortedIndices.size(); ++sorted) {
+        forEachNeighbor(sorted, radius, false, [&](size_t other, float distanceSquared) {
+            if (other > sorted) callback(_sortedIndices[sorted], _sortedIndices[other], distanceSquared);
+        });
+    }
+}
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "math/vector.hpp"
+#include "math/matrix.hpp"
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <cstddef>
+
+namespace SFSim {
+
+using namespace Math;
+
+enum class LightType {
+    Directional,
+    Point,
+    Spot
+};
+
+struct Light {
+    LightType type;
+    Vector3f position;
+    Vector3f direction;
+    sf::Color color;
+    float intensity;
+    float range;
+    float innerConeAngle;
+    float outerConeAngle;
+
+    Light()
+        : type(LightType::Directional)
+        , position(Vector3f::zero())
+        , direction(Vector3f(0, 0, -1))
+        , color(sf::Color::White)
+        , intensity(1.0f)
+        , range(10.0f)
+        , innerConeAngle(0.35f)
+        , outerConeAngle(0.5f)
+    {}
+
+    bool operator==(const Light& other) const;
+    bool operator!=(const Light& other) const { return !(*this == other); }
+};
+
+// Lights for one frame, bucketed into view-space clusters (screen tiles x
+// exponential depth slices). Directional lights affect everything; point
+// and spot lights are only listed in the clusters their range touches, so
+// per-vertex cost depends on local light density rather than total count.
+class LightEnvironment {
+public:
+    LightEnvironment();
+
+    void setView(const Matrix4x4& view, const Matrix4x4& projection, const Vector3f& eye);
+    void clearView();
+    bool hasView() const { return _hasView; }
+    const Vector3f& getEyePosition() const { return _eye; }
+
+    void setClusterDimensions(int tilesX, int tilesY, int slices);
+
+    void clearLights() { _lights.clear(); }
+    void addLight(const Light& light) { _lights.push_back(light); }
+    const std::vector<Light>& getLights() const { return _builtLights; }
+    
+    void setAmbientLight(const sf::Color& color, float intensity = 1.0f);
+    const Vector3f& getAmbientRadiance() const { return _ambient; }
+
+    void build();
+    unsigned int getVersion() const { return _version; }
+
+    const std::vector<unsigned int>& getDirectionalLights() const { return _directional; }
+    size_t getLightsAt(const Vector3f& worldPosition, const unsigned int*& lights) const;
+    bool evaluateLight(unsigned int index, const Vector3f& worldPosition, Vector3f& toLight, Vector3f& radiance) const;
+
+    Vector3f getPrimaryLightDirection() const;
+
+    static const LightEnvironment& getDefault();
+
+private:
+    struct ClusterRange {
+        int x0, x1, y0, y1, z0, z1;
+    };
+
+    std::vector<Light> _lights;
+    std::vector<Light> _builtLights;
+    std::vector<unsigned int> _directional;
+    Vector3f _ambient;
+
+    bool _hasView;
+    Matrix4x4 _view;
+    Matrix4x4 _projection;
+    Vector3f _eye;
+    bool _perspective;
+    float _near;
+    float _far;
+    float _sliceScale;
+
+    int _tilesX;
+    int _tilesY;
+    int _slices;
+    std::vector<unsigned int> _clusterOffsets;
+    std::vector<unsigned int> _clusterLights;
+
+    unsigned int _version;
+    bool _viewChanged;
+
+    int clusterIndex(int x, int y, int z) const { return (z * _tilesY + y) * _tilesX + x; }
+    int depthSlice(float depth) const;
+    bool computeClusterRange(const Light& light, ClusterRange& range) const;
+};
+
+} // namespace SFSim
\ No newline at end of file
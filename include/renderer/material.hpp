@@ -1,36 +1,60 @@
 #pragma once
 
 #include "math/vector.hpp"
+#include "math/simd.hpp"
 #include <SFML/Graphics.hpp>
 #include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
 
 namespace SFSim {
 
 using namespace Math;
 
+class LightEnvironment;
+
 enum class MaterialType {
     Basic,
     Phong,
     PBR
 };
 
+// Fast trades a little accuracy for throughput in the batched shade() path:
+// a precomputed specular power table for Phong. PBR's punctual terms are
+// already pow-free, and approximating them saved nothing measurable while
+// costing visible error at grazing angles, so PBR shades the same either way.
+enum class ShadingQuality {
+    Accurate,
+    Fast
+};
+
+// Four surface samples lit by four (possibly different) lights: the unit
+// normal, direction to the viewer and direction to the light for each lane.
+struct LightingBatch {
+    Float4 nx, ny, nz;
+    Float4 vx, vy, vz;
+    Float4 lx, ly, lz;
+};
+
 class Material {
 public:
     Material(MaterialType type = MaterialType::Basic);
     virtual ~Material() = default;
     
     MaterialType getType() const { return _type; }
+    unsigned int getId() const { return _id; }
     
     void setName(const std::string& name) { _name = name; }
     const std::string& getName() const { return _name; }
     
-    void setDiffuseColor(const sf::Color& color) { _diffuseColor = color; }
+    void setDiffuseColor(const sf::Color& color) { _diffuseColor = color; markChanged(); }
     const sf::Color& getDiffuseColor() const { return _diffuseColor; }
     
-    void setEmissiveColor(const sf::Color& color) { _emissiveColor = color; }
+    void setEmissiveColor(const sf::Color& color) { _emissiveColor = color; markChanged(); }
     const sf::Color& getEmissiveColor() const { return _emissiveColor; }
     
-    void setOpacity(float opacity) { _opacity = std::max(0.0f, std::min(1.0f, opacity)); }
+    void setOpacity(float opacity) { _opacity = std::max(0.0f, std::min(1.0f, opacity)); markChanged(); }
     float getOpacity() const { return _opacity; }
     
     void setWireframe(bool wireframe) { _wireframe = wireframe; }
@@ -39,59 +63,116 @@ public:
     void setDoubleSided(bool doubleSided) { _doubleSided = doubleSided; }
     bool isDoubleSided() const { return _doubleSided; }
     
+    void setShadingQuality(ShadingQuality quality) { _shadingQuality = quality; markChanged(); }
+    ShadingQuality getShadingQuality() const { return _shadingQuality; }
+    
+    unsigned int getVersion() const { return _version; }
+    
+    // Copies get a fresh id. Every subclass must override clone(), which
+    // meshes use to edit shared materials, and subclasses with extra state
+    // the other two as well, so the registry never merges materials that
+    // shade differently.
+    virtual std::shared_ptr<Material> clone() const;
+    virtual bool isEquivalent(const Material& other) const;
+    virtual size_t hashProperties() const;
+    
     virtual sf::Color calculateColor(const Vector3f& position, const Vector3f& normal, const Vector3f& lightDir) const;
+    virtual void shade(const Vector3f* normals, const Vector3f* positions, sf::Color* out, size_t n, const LightEnvironment& lighting) const;
     
 protected:
     MaterialType _type;
+    unsigned int _id;
     std::string _name;
     sf::Color _diffuseColor;
     sf::Color _emissiveColor;
     float _opacity;
     bool _wireframe;
     bool _doubleSided;
+    ShadingQuality _shadingQuality;
+    unsigned int _version;
+    
+    static unsigned int nextId();
+    
+    void markChanged();
+    virtual void updateShadingConstants() {}
+    
+    // shade() runs the hooks below for every light when this is true, and
+    // otherwise calls calculateColor for the primary light. Only the built-in
+    // materials say true for their own type: subclasses keep shading through
+    // calculateColor unless they override this to opt in.
+    virtual bool supportsBatchedShading() const;
+    virtual Vector3f getAmbientTerm() const;
+    virtual void evaluateAmbient(const Vector3f* normals, const Vector3f* viewDirs, size_t n, const Vector3f& radiance, float* r, float* g, float* b) const;
+    virtual void evaluateLighting(const LightingBatch& batch, Float4& r, Float4& g, Float4& b) const;
 };
 
 class PhongMaterial : public Material {
 public:
     PhongMaterial();
     
-    void setSpecularColor(const sf::Color& color) { _specularColor = color; }
+    void setSpecularColor(const sf::Color& color) { _specularColor = color; markChanged(); }
     const sf::Color& getSpecularColor() const { return _specularColor; }
     
-    void setShininess(float shininess) { _shininess = std::max(1.0f, shininess); }
+    void setShininess(float shininess);
     float getShininess() const { return _shininess; }
     
-    void setAmbientColor(const sf::Color& color) { _ambientColor = color; }
+    void setAmbientColor(const sf::Color& color) { _ambientColor = color; markChanged(); }
     const sf::Color& getAmbientColor() const { return _ambientColor; }
     
+    std::shared_ptr<Material> clone() const override;
+    bool isEquivalent(const Material& other) const override;
+    size_t hashProperties() const override;
+    
     sf::Color calculateColor(const Vector3f& position, const Vector3f& normal, const Vector3f& lightDir) const override;
     
+protected:
+    bool supportsBatchedShading() const override;
+    Vector3f getAmbientTerm() const override;
+    void evaluateLighting(const LightingBatch& batch, Float4& r, Float4& g, Float4& b) const override;
+    
 private:
+    static constexpr int SpecularTableSize = 256;
+    
     sf::Color _specularColor;
     sf::Color _ambientColor;
     float _shininess;
+    std::vector<float> _specularTable;
 };
 
 class PBRMaterial : public Material {
 public:
     PBRMaterial();
     
-    void setMetallic(float metallic) { _metallic = std::max(0.0f, std::min(1.0f, metallic)); }
+    void setMetallic(float metallic) { _metallic = std::max(0.0f, std::min(1.0f, metallic)); markChanged(); }
     float getMetallic() const { return _metallic; }
     
-    void setRoughness(float roughness) { _roughness = std::max(0.0f, std::min(1.0f, roughness)); }
+    void setRoughness(float roughness) { _roughness = std::max(0.0f, std::min(1.0f, roughness)); markChanged(); }
     float getRoughness() const { return _roughness; }
     
-    void setSpecularF0(const Vector3f& f0) { _specularF0 = f0; }
+    void setSpecularF0(const Vector3f& f0) { _specularF0 = f0; markChanged(); }
     const Vector3f& getSpecularF0() const { return _specularF0; }
     
+    std::shared_ptr<Material> clone() const override;
+    bool isEquivalent(const Material& other) const override;
+    size_t hashProperties() const override;
+    
     sf::Color calculateColor(const Vector3f& position, const Vector3f& normal, const Vector3f& lightDir) const override;
     
+protected:
+    bool supportsBatchedShading() const override;
+    void updateShadingConstants() override;
+    void evaluateAmbient(const Vector3f* normals, const Vector3f* viewDirs, size_t n, const Vector3f& radiance, float* r, float* g, float* b) const override;
+    void evaluateLighting(const LightingBatch& batch, Float4& r, Float4& g, Float4& b) const override;
+    
 private:
     float _metallic;
     float _roughness;
     Vector3f _specularF0;
     
+    Vector3f _albedo;
+    Vector3f _F0;
+    float _alpha2;
+    float _k;
     Vector3f fresnelSchlick(float cosTheta, const Vector3f& F0) const;
     float distributionGGX(const Vector3f& N, const Vector3f& H, float roughness) const;
     float geometrySchlickGGX(float NdotV, float roughness) const;
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "renderer/material.hpp"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace SFSim {
+
+// Shares one Material instance between everything that would otherwise
+// create an identical copy. Interned materials are shared, so clone() one
+// before modifying it. The registry only holds weak references; materials
+// die with their last user.
+class MaterialRegistry {
+public:
+    static MaterialRegistry& getInstance();
+    
+    std::shared_ptr<Material> intern(const std::shared_ptr<Material>& material);
+    std::shared_ptr<Material> getDefault();
+    
+    size_t getMaterialCount() const;
+    void collectGarbage();
+    
+private:
+    MaterialRegistry() = default;
+    
+    std::unordered_map<size_t, std::vector<std::weak_ptr<Material>>> _buckets;
+    std::shared_ptr<Material> _default;
+};
+
+} // namespace SFSim
\ No newline at end of file
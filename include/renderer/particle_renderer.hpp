@@ -0,0 +1,54 @@
+#pragma once
+
+#include "math/matrix.hpp"
+#include "physics/particle_world.hpp"
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <vector>
+
+namespace SFSim {
+
+using namespace Math;
+
+// Draws a whole ParticleWorld in one draw call. Particles are projected
+// four at a time, in parallel chunks, straight from the world's arrays into
+// one vertex buffer; off-screen ones are dropped before they reach it.
+class ParticleRenderer {
+public:
+    enum class Style { Points, Squares };
+
+    ParticleRenderer();
+
+    // Points are a single pixel each; squares are size pixels across and
+    // take six vertices.
+    void setStyle(Style style) { _style = style; }
+    Style getStyle() const { return _style; }
+    void setSize(float pixels) { _size = pixels; }
+    float getSize() const { return _size; }
+
+    // Fades each particle out over its lifetime; ones that never expire
+    // keep their color.
+    void setFadeOut(bool enabled) { _fadeOut = enabled; }
+    bool isFadeOutEnabled() const { return _fadeOut; }
+
+    void draw(sf::RenderTarget& target, const Physics::ParticleWorld& world, const Matrix4x4& viewProjection);
+
+    // Particles that made it on screen in the last draw().
+    size_t getDrawnCount() const { return _drawn; }
+
+private:
+    Style _style;
+    float _size;
+    bool _fadeOut;
+    size_t _drawn;
+
+    std::vector<sf::Vertex> _vertices;
+    std::vector<size_t> _chunkCounts;
+
+    // Writes the visible particles of [begin, end) from out onwards and
+    // returns how many vertices that took.
+    size_t project(const Physics::ParticleWorld& world, size_t begin, size_t end, const Matrix4x4& viewProjection,
+                   float width, float height, sf::Vertex* out) const;
+};
+
+} // namespace SFSim
\ No newline at end of file
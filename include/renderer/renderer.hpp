@@ -4,6 +4,7 @@
 #include "math/matrix.hpp"
 #include "geometry/geometry.hpp"
 #include "camera.hpp"
+#include "renderer/lighting.hpp"
 #include <SFML/Graphics.hpp>
 #include <vector>
 #include <memory>
@@ -17,12 +18,16 @@ struct RenderCommand {
     Matrix4x4 transform;
     int priority;
     float depth;
+    unsigned int materialId;
     
     bool operator<(const RenderCommand& other) const {
         if (priority != other.priority) {
             return priority > other.priority;
         }
-        return depth > other.depth;
+        if (depth != other.depth) {
+            return depth > other.depth;
+        }
+        return materialId < other.materialId;
     }
 };
 
@@ -40,6 +45,9 @@ public:
     void setCamera(Camera* camera);
     Camera* getCamera() const { return _camera; }
     
+    void setLightEnvironment(const LightEnvironment* lighting) { _lighting = lighting; }
+    const LightEnvironment* getLightEnvironment() const { return _lighting; }
+    
     void submit(Geometry* geometry, const Matrix4x4& transform, int priority = 0);
     void submitImmediate(Geometry* geometry, const Matrix4x4& transform);
     
@@ -52,6 +60,9 @@ public:
     void setBackfaceCulling(bool enabled) { _backfaceCulling = enabled; }
     bool isBackfaceCullingEnabled() const { return _backfaceCulling; }
     
+    // There is no depth buffer, so depth testing means drawing back to front.
+    // With it disabled the queue is sorted by material instead, which lets
+    // more geometry share a draw call.
     void setDepthTesting(bool enabled) { _depthTesting = enabled; }
     bool isDepthTestingEnabled() const { return _depthTesting; }
     
@@ -68,13 +79,14 @@ public:
     
     struct Statistics {
         int drawCalls;
+        int batches;
         int triangles;
         int lines;
         int points;
         float frameTime;
         
         void reset() {
-            drawCalls = triangles = lines = points = 0;
+            drawCalls = batches = triangles = lines = points = 0;
             frameTime = 0.0f;
         }
     };
@@ -84,8 +96,10 @@ public:
 private:
     sf::RenderWindow* _window;
     Camera* _camera;
+    const LightEnvironment* _lighting;
     
     std::vector<RenderCommand> _renderQueue;
+    std::vector<sf::Vertex> _batchVertices;
     std::vector<std::unique_ptr<Geometry>> _debugGeometry;
     
     bool _wireframeMode;
@@ -97,7 +111,10 @@ private:
     
     void sortRenderQueue();
     void executeRenderQueue();
+    void executeBatch(size_t begin, size_t end, const Matrix4x4& viewProjection);
+    void flushBatch();
     void renderDebugGeometry();
+    void recordGeometry(Geometry* geometry);
     
     float calculateDepth(Geometry* geometry, const Matrix4x4& transform) const;
     bool shouldCullBackface(Geometry* geometry, const Matrix4x4& transform) const;
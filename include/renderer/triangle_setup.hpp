@@ -0,0 +1,75 @@
+#pragma once
+
+#include "math/vector.hpp"
+#include "math/matrix.hpp"
+#include <vector>
+#include <cstddef>
+
+namespace SFSim {
+
+using namespace Math;
+
+struct Vertex;
+
+// Per-mesh triangle setup: transforms vertices to clip space once, rejects
+// triangles that are back-facing or entirely behind the near plane, and clips
+// the ones that straddle it. Output vertices reference the source mesh
+// vertices (from, to, t) so callers can interpolate any per-vertex attribute.
+class TriangleSetup {
+public:
+    struct SetupVertex {
+        Vector2f screen;
+        unsigned int from;
+        unsigned int to;
+        float t;
+    };
+
+    struct Statistics {
+        size_t triangles;
+        size_t backfaceCulled;
+        size_t nearCulled;
+        size_t clipped;
+        size_t emitted;
+
+        void reset() {
+            triangles = backfaceCulled = nearCulled = clipped = emitted = 0;
+        }
+    };
+
+    TriangleSetup();
+
+    void setBackfaceCulling(bool enabled) { _backfaceCulling = enabled; }
+    bool isBackfaceCullingEnabled() const { return _backfaceCulling; }
+
+    void transformVertices(const Vertex* vertices, size_t count, const Matrix4x4& mvp, float screenWidth, float screenHeight);
+    void assemble(const unsigned int* indices, size_t indexCount);
+
+    const std::vector<SetupVertex>& getVertices() const { return _output; }
+    const std::vector<unsigned int>& getSourceTriangles() const { return _sourceTriangles; }
+    const Statistics& getStatistics() const { return _stats; }
+
+    bool isVertexVisible(unsigned int index) const { return _nearDistance[index] >= 0.0f; }
+    Vector2f getScreenPosition(unsigned int index) const { return Vector2f(_screenX[index], _screenY[index]); }
+
+private:
+    bool _backfaceCulling;
+    float _screenWidth;
+    float _screenHeight;
+
+    std::vector<float> _clipX;
+    std::vector<float> _clipY;
+    std::vector<float> _clipW;
+    std::vector<float> _screenX;
+    std::vector<float> _screenY;
+    std::vector<float> _nearDistance;
+
+    std::vector<SetupVertex> _output;
+    std::vector<unsigned int> _sourceTriangles;
+    Statistics _stats;
+
+    void emitTriangle(unsigned int i0, unsigned int i1, unsigned int i2, unsigned int source);
+    void clipTriangle(unsigned int i0, unsigned int i1, unsigned int i2, unsigned int source);
+    Vector2f toScreen(float x, float y, float w) const;
+};
+
+} // namespace SFSim
\ No newline at end of file
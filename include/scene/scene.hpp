@@ -3,6 +3,8 @@
 #include "ecs/entity.hpp"
 #include "ecs/system.hpp"
 #include "camera.hpp"
+#include "renderer/lighting.hpp"
+#include "transform_hierarchy.hpp"
 #include <vector>
 #include <memory>
 #include <unordered_map>
@@ -47,7 +49,7 @@ public:
             if (entity->isActive() && 
                 entity->hasComponent<T>() && 
                 entity->hasComponent<U>() &&
-                hasAllComponents<Rest...>(entity.get())) {
+                (entity->hasComponent<Rest>() && ...)) {
                 result.push_back(entity.get());
             }
         }
@@ -72,6 +74,12 @@ public:
     void setActiveCamera(Camera* camera) { _activeCamera = camera; }
     Camera* getActiveCamera() const { return _activeCamera; }
     
+    LightEnvironment& getLightEnvironment() { return _lighting; }
+    const LightEnvironment& getLightEnvironment() const { return _lighting; }
+    
+    TransformHierarchy& getTransformHierarchy() { return _transformHierarchy; }
+    const TransformHierarchy& getTransformHierarchy() const { return _transformHierarchy; }
+    
     void update(float deltaTime);
     void render(sf::RenderWindow& window);
     
@@ -87,6 +95,8 @@ private:
     
     Camera* _activeCamera;
     EntityID _nextEntityId;
+    LightEnvironment _lighting;
+    TransformHierarchy _transformHierarchy;
     
     template<typename T>
     bool hasAllComponents(Entity* entity) {
@@ -99,6 +109,7 @@ private:
     }
     
     void updateEntityIndexMap();
+    void updateLighting();
 };
 
 } // namespace SFSim
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "math/vector.hpp"
 #include "math/matrix.hpp"
+#include "math/quaternion.hpp"
 #include <vector>
 #include <memory>
 
@@ -16,15 +17,20 @@ public:
     
     void setPosition(const Vector3f& position);
     void setRotation(const Vector3f& rotation);
+    void setOrientation(const Quaternion& orientation);
     void setScale(const Vector3f& scale);
     void setScale(float scale);
     
     const Vector3f& getPosition() const { return _position; }
+    // Euler angles (rotationX * rotationY * rotationZ), kept in sync with
+    // the quaternion that actually drives the matrices.
     const Vector3f& getRotation() const { return _rotation; }
+    const Quaternion& getOrientation() const { return _orientation; }
     const Vector3f& getScale() const { return _scale; }
     
     void translate(const Vector3f& translation);
     void rotate(const Vector3f& rotation);
+    void rotate(const Quaternion& rotation);
     void scaleBy(const Vector3f& scale);
     void scaleBy(float scale);
     
@@ -34,6 +40,7 @@ public:
     
     const Matrix4x4& getLocalMatrix() const;
     const Matrix4x4& getWorldMatrix() const;
+    const Matrix4x4& getInverseWorldMatrix() const;
     
     void setParent(Transform* parent);
     Transform* getParent() const { return _parent; }
@@ -44,6 +51,7 @@ public:
     
     Vector3f getWorldPosition() const;
     Vector3f getWorldRotation() const;
+    Quaternion getWorldOrientation() const;
     Vector3f getWorldScale() const;
     
     Vector3f transformPoint(const Vector3f& point) const;
@@ -51,17 +59,29 @@ public:
     Vector3f inverseTransformPoint(const Vector3f& point) const;
     Vector3f inverseTransformDirection(const Vector3f& direction) const;
     
+    // Batched forms for large point sets; out may alias the input.
+    void transformPoints(const Vector3f* points, Vector3f* out, size_t count) const;
+    void transformDirections(const Vector3f* directions, Vector3f* out, size_t count) const;
+    void inverseTransformPoints(const Vector3f* points, Vector3f* out, size_t count) const;
+    void inverseTransformDirections(const Vector3f* directions, Vector3f* out, size_t count) const;
+    
     void markDirty();
+    // Changes whenever the local or world transform does.
+    unsigned int getVersion() const { return _version; }
     
 private:
     Vector3f _position;
     Vector3f _rotation;
+    Quaternion _orientation;
     Vector3f _scale;
     
     mutable Matrix4x4 _localMatrix;
     mutable Matrix4x4 _worldMatrix;
+    mutable Matrix4x4 _inverseWorldMatrix;
     mutable bool _localMatrixDirty;
     mutable bool _worldMatrixDirty;
+    mutable bool _inverseWorldMatrixDirty;
+    unsigned int _version;
     
     Transform* _parent;
     std::vector<Transform*> _children;
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "math/vector.hpp"
+#include "math/matrix.hpp"
+#include "math/quaternion.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace SFSim {
+
+using namespace Math;
+
+// Flat alternative to linking Transform objects together. Nodes are stored
+// in arrays sorted parent-before-child (breadth first, so each depth level
+// and each node's children are contiguous) and setters only flip a bit in a
+// dirty bitset. update() recomputes every affected world matrix in one
+// forward sweep over the bitset, splitting wide levels across the core
+// thread pool. World matrices reflect the last update().
+class TransformHierarchy {
+public:
+    using NodeId = std::uint32_t;
+    static constexpr NodeId InvalidNode = 0xFFFFFFFFu;
+    
+    TransformHierarchy();
+    
+    NodeId create(NodeId parent = InvalidNode);
+    // Children of a destroyed node are reattached to its parent and keep
+    // their local transforms.
+    void destroy(NodeId node);
+    void clear();
+    
+    bool isValid(NodeId node) const { return node < _indexOfNode.size() && _indexOfNode[node] != InvalidNode; }
+    size_t size() const { return _nodeOfIndex.size(); }
+    
+    bool setParent(NodeId node, NodeId parent);
+    NodeId getParent(NodeId node) const { return _parentNode[_indexOfNode[node]]; }
+    
+    void setLocalTransform(NodeId node, const Vector3f& position, const Quaternion& orientation, const Vector3f& scale);
+    void setLocalTransform(NodeId node, const Vector3f& position, const Vector3f& rotation, const Vector3f& scale);
+    void setPosition(NodeId node, const Vector3f& position);
+    void setRotation(NodeId node, const Vector3f& rotation);
+    void setOrientation(NodeId node, const Quaternion& orientation);
+    void setScale(NodeId node, const Vector3f& scale);
+    
+    const Vector3f& getPosition(NodeId node) const { return _position[_indexOfNode[node]]; }
+    Vector3f getRotation(NodeId node) const { return _orientation[_indexOfNode[node]].toEuler(); }
+    const Quaternion& getOrientation(NodeId node) const { return _orientation[_indexOfNode[node]]; }
+    const Vector3f& getScale(NodeId node) const { return _scale[_indexOfNode[node]]; }
+    
+    // Matrices are stored as 3x4 affine blocks; the Matrix4x4 getters expand them.
+    const Matrix3x4& getLocalAffine(NodeId node) const { return _localMatrix[_indexOfNode[node]]; }
+    const Matrix3x4& getWorldAffine(NodeId node) const { return _worldMatrix[_indexOfNode[node]]; }
+    Matrix4x4 getLocalMatrix(NodeId node) const { return getLocalAffine(node).toMatrix4x4(); }
+    Matrix4x4 getWorldMatrix(NodeId node) const { return getWorldAffine(node).toMatrix4x4(); }
+    Vector3f getWorldPosition(NodeId node) const { return getWorldAffine(node).getTranslation(); }
+    
+    // True if the node's world matrix was recomputed by the last update().
+    bool wasUpdated(NodeId node) const;
+    
+    // Levels with at least this many nodes are updated in parallel; 0 keeps
+    // the update on the calling thread.
+    void setParallelThreshold(size_t nodes) { _parallelThreshold = nodes; }
+    size_t getParallelThreshold() const { return _parallelThreshold; }
+    
+    void update();
+    
+    size_t getLevelCount() const { return _levelOffsets.empty() ? 0 : _levelOffsets.size() - 1; }
+    
+private:
+    // Indexed by dense position in update order.
+    std::vector<NodeId> _nodeOfIndex;
+    std::vector<NodeId> _parentNode;
+    std::vector<std::uint32_t> _parentIndex;
+    std::vector<std::uint32_t> _firstChild;
+    std::vector<std::uint32_t> _childCount;
+    std::vector<Vector3f> _position;
+    std::vector<Quaternion> _orientation;
+    std::vector<Vector3f> _scale;
+    std::vector<Matrix3x4> _localMatrix;
+    std::vector<Matrix3x4> _worldMatrix;
+    std::vector<std::uint64_t> _localDirty;
+    std::vector<std::uint64_t> _worldUpdated;
+    std::vector<size_t> _levelOffsets;
+    
+    // Indexed by NodeId.
+    std::vector<std::uint32_t> _indexOfNode;
+    std::vector<NodeId> _freeNodes;
+    
+    size_t _parallelThreshold;
+    bool _structureDirty;
+    bool _anyDirty;
+    bool _anyUpdated;
+    
+    void markDirty(std::uint32_t index);
+    void rebuildOrder();
+    void updateLocalMatrices(size_t begin, size_t end);
+    void updateWorldMatrices(std::uint32_t index);
+    void propagate(size_t begin, size_t end);
+};
+
+} // namespace SFSim
\ No newline at end of file
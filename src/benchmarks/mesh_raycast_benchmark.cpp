@@ -0,0 +1,125 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include "physics/mesh_bvh.hpp"
+#include "core/thread_pool.hpp"
+
+using namespace SFSim;
+using namespace SFSim::Physics;
+
+using Clock = std::chrono::high_resolution_clock;
+
+double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Lumpy UV sphere, so triangles vary in size and orientation like a scan.
+void buildSphere(int rings, int segments, std::vector<Vector3f>& positions, std::vector<unsigned int>& indices) {
+    for (int r = 0; r <= rings; ++r) {
+        float phi = 3.14159265f * r / rings;
+        for (int s = 0; s <= segments; ++s) {
+            float theta = 6.2831853f * s / segments;
+            float radius = 1.0f + 0.05f * std::sin(phi * 17.0f) * std::cos(theta * 13.0f);
+            positions.push_back(Vector3f(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta)) * radius);
+        }
+    }
+
+    for (int r = 0; r < rings; ++r) {
+        for (int s = 0; s < segments; ++s) {
+            unsigned int a = r * (segments + 1) + s;
+            unsigned int b = a + segments + 1;
+            indices.insert(indices.end(), {a, b, a + 1, a + 1, b, b + 1});
+        }
+    }
+}
+
+// Every triangle, for checking the tree against.
+bool bruteForce(const Ray& ray, const std::vector<Vector3f>& positions, const std::vector<unsigned int>& indices, float& closest, unsigned int& triangle) {
+    bool found = false;
+    for (size_t t = 0; t < indices.size() / 3; ++t) {
+        Vector3f a = positions[indices[t * 3]];
+        Vector3f e1 = positions[indices[t * 3 + 1]] - a;
+        Vector3f e2 = positions[indices[t * 3 + 2]] - a;
+
+        Vector3f p = ray.direction.cross(e2);
+        float det = e1.dot(p);
+        if (std::abs(det) < 1e-20f) continue;
+        float invDet = 1.0f / det;
+        Vector3f s = ray.origin - a;
+        float u = s.dot(p) * invDet;
+        if (u < 0.0f || u > 1.0f) continue;
+        Vector3f q = s.cross(e1);
+        float v = ray.direction.dot(q) * invDet;
+        if (v < 0.0f || u + v > 1.0f) continue;
+        float distance = e2.dot(q) * invDet;
+        if (distance <= 0.0f || distance >= closest) continue;
+
+        closest = distance;
+        triangle = static_cast<unsigned int>(t);
+        found = true;
+    }
+    return found;
+}
+
+int main(int argc, char* argv[]) {
+    int rings = argc > 1 ? std::atoi(argv[1]) : 708;
+    int rayCount = argc > 2 ? std::atoi(argv[2]) : 200000;
+
+    std::vector<Vector3f> positions;
+    std::vector<unsigned int> indices;
+    buildSphere(rings, rings, positions, indices);
+    size_t triangleCount = indices.size() / 3;
+
+    std::cout << "Mesh raycast benchmark: " << triangleCount << " triangles, "
+              << Core::ThreadPool::getInstance().getThreadCount() << " threads" << std::endl;
+
+    MeshBVH bvh;
+    double buildMs = 1e30;
+    for (int i = 0; i < 3; ++i) {
+        auto start = Clock::now();
+        bvh.build(positions, indices);
+        buildMs = std::min(buildMs, elapsedMs(start));
+    }
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<Ray> rays(rayCount);
+    for (Ray& ray : rays) {
+        Vector3f origin = Vector3f(unit(rng), unit(rng), unit(rng)).normalized() * 3.0f;
+        Vector3f target(unit(rng) * 0.8f, unit(rng) * 0.8f, unit(rng) * 0.8f);
+        ray = Ray(origin, target - origin);
+    }
+
+    size_t hits = 0;
+    auto start = Clock::now();
+    for (const Ray& ray : rays) {
+        MeshBVH::Hit hit;
+        hits += bvh.raycast(ray, 10.0f, hit);
+    }
+    double rayMs = elapsedMs(start);
+
+    int mismatches = 0;
+    for (int i = 0; i < 50; ++i) {
+        MeshBVH::Hit hit;
+        bool treeHit = bvh.raycast(rays[i], 10.0f, hit);
+        float closest = 10.0f;
+        unsigned int triangle = 0;
+        bool bruteHit = bruteForce(rays[i], positions, indices, closest, triangle);
+        if (treeHit != bruteHit || (treeHit && (hit.triangle != triangle || std::abs(hit.distance - closest) > 1e-5f))) {
+            mismatches++;
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "  build:              " << buildMs << " ms (" << bvh.getNodeCount() << " nodes)" << std::endl
+              << "  raycast:            " << rayCount / rayMs * 1000.0 << " rays/s ("
+              << hits << " hits)" << std::endl
+              << "  brute-force checks: " << 50 - mismatches << "/50 agree" << std::endl;
+
+    return mismatches == 0 ? 0 : 1;
+}
\ No newline at end of file
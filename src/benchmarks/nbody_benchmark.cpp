@@ -0,0 +1,122 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "physics/nbody.hpp"
+#include "core/thread_pool.hpp"
+
+using namespace SFSim;
+using namespace SFSim::Physics;
+
+using Clock = std::chrono::high_resolution_clock;
+
+// A Plummer sphere of unit mass and scale radius: dense in the middle and
+// thinning out without bound, like a star cluster, so the tree has to go
+// deep in the core and stays shallow in the halo.
+struct Bodies {
+    std::vector<float> x, y, z, mass;
+};
+
+Bodies plummerSphere(size_t count, unsigned int seed) {
+    Bodies bodies;
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (size_t i = 0; i < count; ++i) {
+        // Cut off at the radius enclosing 99.9% of the mass.
+        float enclosed = 0.999f * unit(random) + 1e-6f;
+        float radius = 1.0f / std::sqrt(std::pow(enclosed, -2.0f / 3.0f) - 1.0f);
+        float cosTheta = 2.0f * unit(random) - 1.0f;
+        float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+        float phi = 6.2831853f * unit(random);
+        bodies.x.push_back(radius * sinTheta * std::cos(phi));
+        bodies.y.push_back(radius * sinTheta * std::sin(phi));
+        bodies.z.push_back(radius * cosTheta);
+        bodies.mass.push_back(1.0f / count);
+    }
+    return bodies;
+}
+
+double timeEvaluation(NBodyGravity& gravity, const Bodies& bodies, std::vector<float>& ax, std::vector<float>& ay, std::vector<float>& az) {
+    size_t count = bodies.x.size();
+    ax.resize(count);
+    ay.resize(count);
+    az.resize(count);
+    auto start = Clock::now();
+    gravity.computeAccelerations(bodies.x.data(), bodies.y.data(), bodies.z.data(), bodies.mass.data(), count,
+                                 ax.data(), ay.data(), az.data());
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Mean error of the tree against exact sums in double precision, over a
+// sample of bodies, relative to the RMS acceleration of the sample.
+double sampleError(const NBodyGravity& gravity, const Bodies& bodies, const std::vector<float>& ax, const std::vector<float>& ay, const std::vector<float>& az) {
+    size_t count = bodies.x.size();
+    size_t samples = std::min<size_t>(count, 256);
+    double softeningSquared = double(gravity.getSoftening()) * gravity.getSoftening();
+    double errorSum = 0.0;
+    double magnitudeSum = 0.0;
+    for (size_t s = 0; s < samples; ++s) {
+        size_t i = s * count / samples;
+        double exact[3] = {0.0, 0.0, 0.0};
+        for (size_t j = 0; j < count; ++j) {
+            double dx = double(bodies.x[j]) - bodies.x[i];
+            double dy = double(bodies.y[j]) - bodies.y[i];
+            double dz = double(bodies.z[j]) - bodies.z[i];
+            double distanceSquared = dx * dx + dy * dy + dz * dz;
+            if (distanceSquared == 0.0) continue;
+            double weight = bodies.mass[j] / std::pow(distanceSquared + softeningSquared, 1.5);
+            exact[0] += dx * weight;
+            exact[1] += dy * weight;
+            exact[2] += dz * weight;
+        }
+        double g = gravity.getGravitationalConstant();
+        double ex = ax[i] - g * exact[0];
+        double ey = ay[i] - g * exact[1];
+        double ez = az[i] - g * exact[2];
+        errorSum += std::sqrt(ex * ex + ey * ey + ez * ez);
+        magnitudeSum += g * g * (exact[0] * exact[0] + exact[1] * exact[1] + exact[2] * exact[2]);
+    }
+    return (errorSum / samples) / std::sqrt(magnitudeSum / samples);
+}
+
+int main(int argc, char* argv[]) {
+    size_t maxCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    float openingAngle = argc > 2 ? static_cast<float>(std::atof(argv[2])) : 0.5f;
+    // Direct summation is quadratic; past this it takes minutes.
+    const size_t maxDirect = 20000;
+
+    std::cout << "N-body benchmark: Plummer sphere, opening angle " << openingAngle << ", "
+              << Core::ThreadPool::getInstance().getThreadCount() << " threads" << std::endl;
+
+    NBodyGravity gravity;
+    gravity.setGravitationalConstant(1.0f);
+    gravity.setSoftening(0.01f);
+    gravity.setOpeningAngle(openingAngle);
+
+    std::vector<float> ax, ay, az;
+    for (size_t count = 1000; count <= maxCount; count *= 10) {
+        Bodies bodies = plummerSphere(count, 7);
+
+        gravity.setMethod(NBodyGravity::Method::BarnesHut);
+        timeEvaluation(gravity, bodies, ax, ay, az);
+        double tree = timeEvaluation(gravity, bodies, ax, ay, az);
+        double error = sampleError(gravity, bodies, ax, ay, az);
+
+        std::cout << "  " << std::setw(8) << count << " bodies: tree " << std::fixed << std::setprecision(2)
+                  << tree * 1000.0 << " ms (" << std::setprecision(2) << count / tree / 1e6 << "M bodies/s, "
+                  << gravity.getNodeCount() << " cells, error " << std::scientific << std::setprecision(1) << error << ")";
+
+        if (count <= maxDirect) {
+            gravity.setMethod(NBodyGravity::Method::Direct);
+            double direct = timeEvaluation(gravity, bodies, ax, ay, az);
+            std::cout << ", direct " << std::fixed << std::setprecision(2) << direct * 1000.0 << " ms";
+        }
+        std::cout << std::defaultfloat << std::endl;
+    }
+
+    return 0;
+}
\ No newline at end of file
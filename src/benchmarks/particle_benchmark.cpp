@@ -0,0 +1,118 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include "physics/particle_world.hpp"
+#include "core/thread_pool.hpp"
+
+using namespace SFSim;
+using namespace SFSim::Physics;
+
+using Clock = std::chrono::high_resolution_clock;
+
+constexpr float TimeStep = 1.0f / 60.0f;
+constexpr float Boundary = 5.0f;
+constexpr float Bounce = 0.8f;
+
+// How the particle example stored and stepped its particles before the
+// world: one struct per particle, gravity and a box bounce.
+struct Particle {
+    Vector3f position;
+    Vector3f velocity;
+};
+
+void updateStructs(std::vector<Particle>& particles) {
+    for (auto& particle : particles) {
+        particle.velocity.y -= 9.8f * TimeStep;
+        particle.position += particle.velocity * TimeStep;
+
+        if (particle.position.x > Boundary || particle.position.x < -Boundary) {
+            particle.velocity.x *= -Bounce;
+            particle.position.x = std::clamp(particle.position.x, -Boundary, Boundary);
+        }
+        if (particle.position.y > Boundary || particle.position.y < -Boundary) {
+            particle.velocity.y *= -Bounce;
+            particle.position.y = std::clamp(particle.position.y, -Boundary, Boundary);
+        }
+        if (particle.position.z > Boundary || particle.position.z < -Boundary) {
+            particle.velocity.z *= -Bounce;
+            particle.position.z = std::clamp(particle.position.z, -Boundary, Boundary);
+        }
+    }
+}
+
+template<typename Fn>
+double bestStepMs(int steps, Fn fn) {
+    double best = 1e30;
+    for (int i = 0; i < steps; ++i) {
+        auto start = Clock::now();
+        fn();
+        best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    int steps = argc > 2 ? std::atoi(argv[2]) : 10;
+
+    std::cout << "Particle benchmark: " << count << " particles, "
+              << Core::ThreadPool::getInstance().getThreadCount() << " threads" << std::endl;
+
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    std::vector<Particle> structs(count);
+    ParticleWorld world;
+    world.setMaxParticles(count);
+    world.setContainer(AABB(Vector3f(-Boundary, -Boundary, -Boundary), Vector3f(Boundary, Boundary, Boundary)), Bounce);
+    for (size_t i = 0; i < count; ++i) {
+        Vector3f position = Vector3f(unit(rng), unit(rng), unit(rng)) * Boundary;
+        Vector3f velocity = Vector3f(unit(rng), unit(rng), unit(rng)) * 3.0f;
+        structs[i] = {position, velocity};
+        world.spawn(position, velocity, 0.0f, 0xFFFFFFFFu);
+    }
+
+    // The same motion first, then every kind of field at once.
+    world.addForceField(ForceField::gravity(Vector3f(0, -9.8f, 0)));
+    double structMs = bestStepMs(steps, [&]() { updateStructs(structs); });
+    world.setParallelThreshold(0);
+    double gravityMs = bestStepMs(steps, [&]() { world.update(TimeStep); });
+    world.setParallelThreshold(65536);
+    double gravityParallelMs = bestStepMs(steps, [&]() { world.update(TimeStep); });
+
+    world.addForceField(ForceField::drag(0.1f));
+    world.addForceField(ForceField::vortex(Vector3f::zero(), Vector3f(0, 1, 0), 10.0f, 1.0f));
+    world.addForceField(ForceField::attractor(Vector3f(2, 0, 0), 20.0f, 0.5f));
+    world.addForceField(ForceField::attractor(Vector3f(-2, 0, 0), -20.0f, 0.5f));
+    world.setParallelThreshold(0);
+    double fieldsMs = bestStepMs(steps, [&]() { world.update(TimeStep); });
+    world.setParallelThreshold(65536);
+    double fieldsParallelMs = bestStepMs(steps, [&]() { world.update(TimeStep); });
+
+    // Steady state with emitters replacing the particles that expire: about
+    // a sixtieth of them die and are compacted away every step.
+    world.clear();
+    ParticleEmitter emitter;
+    emitter.spread = 3.14159f;
+    emitter.jitter = 1.0f;
+    emitter.minLifetime = 0.5f;
+    emitter.maxLifetime = 1.5f;
+    emitter.rate = static_cast<float>(count);
+    world.addEmitter(emitter);
+    for (int i = 0; i < 120; ++i) world.update(TimeStep);
+    double churnMs = bestStepMs(steps, [&]() { world.update(TimeStep); });
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "  structs, gravity:            " << structMs << " ms/step" << std::endl
+              << "  world, gravity:              " << gravityMs << " ms/step" << std::endl
+              << "  world, gravity, pool:        " << gravityParallelMs << " ms/step" << std::endl
+              << "  world, all fields:           " << fieldsMs << " ms/step" << std::endl
+              << "  world, all fields, pool:     " << fieldsParallelMs << " ms/step" << std::endl
+              << "  world, emitting (" << world.size() << " live): " << churnMs << " ms/step" << std::endl;
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,212 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <cstdlib>
+#include <cmath>
+#include "ecs/entity.hpp"
+#include "ecs/transform_component.hpp"
+#include "physics/physics.hpp"
+
+using namespace SFSim;
+using namespace SFSim::ECS;
+using namespace SFSim::Physics;
+
+using Clock = std::chrono::high_resolution_clock;
+
+constexpr float TimeStep = 1.0f / 60.0f;
+
+// A floor with columns of boxes stacked on it, dropped from just above
+// their resting height.
+std::vector<std::unique_ptr<Entity>> buildPile(int columns, int height) {
+    std::vector<std::unique_ptr<Entity>> entities;
+    float extent = columns * 1.5f;
+    
+    auto floor = std::make_unique<Entity>(1);
+    floor->addComponent<TransformComponent>()->setPosition(Vector3f(0, -0.5f, 0));
+    floor->addComponent<ColliderComponent>(ColliderComponent::Box)->setSize(Vector3f(extent * 2.0f, 1.0f, extent * 2.0f));
+    entities.push_back(std::move(floor));
+    
+    for (int x = 0; x < columns; ++x) {
+        for (int z = 0; z < columns; ++z) {
+            for (int y = 0; y < height; ++y) {
+                auto entity = std::make_unique<Entity>(entities.size() + 1);
+                Vector3f position(x * 1.5f - extent * 0.5f, 0.5f + y * 1.05f, z * 1.5f - extent * 0.5f);
+                entity->addComponent<TransformComponent>()->setPosition(position);
+                entity->addComponent<ColliderComponent>(ColliderComponent::Box);
+                entity->addComponent<RigidbodyComponent>();
+                entities.push_back(std::move(entity));
+            }
+        }
+    }
+    
+    return entities;
+}
+
+double averageStepMs(PhysicsSystem& physics, const std::vector<std::unique_ptr<Entity>>& entities, int steps) {
+    auto start = Clock::now();
+    for (int i = 0; i < steps; ++i) {
+        physics.update(TimeStep, entities);
+    }
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / steps;
+}
+
+void measure(int columns, int height, bool sleeping) {
+    auto entities = buildPile(columns, height);
+    size_t bodies = entities.size() - 1;
+    
+    PhysicsSystem physics;
+    physics.setSleepingEnabled(sleeping);
+    
+    double settling = averageStepMs(physics, entities, 60);
+    averageStepMs(physics, entities, 240);
+    size_t awake = physics.getAwakeBodyCount();
+    double resting = averageStepMs(physics, entities, 120);
+    
+    std::cout << std::fixed << std::setprecision(3)
+              << "  " << bodies << " bodies, sleeping " << (sleeping ? "on " : "off")
+              << ": settling " << settling << " ms/step, resting " << resting << " ms/step ("
+              << awake << " awake)" << std::endl;
+    
+    if (sleeping) {
+        // Knock one box sideways; only its own column should wake.
+        entities[bodies / 2]->getComponent<RigidbodyComponent>()->addImpulse(Vector3f(0.5f, 0, 0));
+        physics.update(TimeStep, entities);
+        physics.update(TimeStep, entities);
+        std::cout << "    after a nudge: " << physics.getAwakeBodyCount() << " awake" << std::endl;
+    }
+}
+
+// Bullets fired at a thin wall, stepped at the given rate for one second.
+void measureTunnelling(const char* label, float stepsPerSecond, bool continuous) {
+    std::vector<std::unique_ptr<Entity>> entities;
+    
+    auto wall = std::make_unique<Entity>(1);
+    wall->addComponent<TransformComponent>()->setPosition(Vector3f(10.0f, 0, 0));
+    wall->addComponent<ColliderComponent>(ColliderComponent::Box)->setSize(Vector3f(0.1f, 10.0f, 10.0f));
+    entities.push_back(std::move(wall));
+    
+    for (int y = 0; y < 10; ++y) {
+        for (int z = 0; z < 10; ++z) {
+            auto bullet = std::make_unique<Entity>(entities.size() + 1);
+            bullet->addComponent<TransformComponent>()->setPosition(Vector3f(0.5f, y * 0.8f - 3.6f, z * 0.8f - 3.6f));
+            bullet->addComponent<ColliderComponent>(ColliderComponent::Sphere)->setRadius(0.05f);
+            auto* rigidbody = bullet->addComponent<RigidbodyComponent>();
+            rigidbody->setGravityScale(0.0f);
+            rigidbody->setVelocity(Vector3f(200.0f, 0, 0));
+            rigidbody->setContinuous(continuous);
+            entities.push_back(std::move(bullet));
+        }
+    }
+    
+    PhysicsSystem physics;
+    int steps = static_cast<int>(stepsPerSecond);
+    auto start = Clock::now();
+    for (int i = 0; i < steps; ++i) {
+        physics.update(1.0f / stepsPerSecond, entities);
+    }
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    
+    int tunnelled = 0;
+    for (size_t i = 1; i < entities.size(); ++i) {
+        if (entities[i]->getComponent<TransformComponent>()->getPosition().x > 10.0f) tunnelled++;
+    }
+    
+    std::cout << std::fixed << std::setprecision(3)
+              << "  " << label << ": " << ms << " ms per simulated second, "
+              << tunnelled << "/100 bullets tunnelled" << std::endl;
+}
+
+// A dense cloud of debris falling onto a floor. With the debris layer told
+// not to collide with itself, only debris vs floor pairs are ever tested.
+void measureDebris(int count, bool filtered) {
+    constexpr int Debris = 1;
+    std::vector<std::unique_ptr<Entity>> entities;
+    
+    auto floor = std::make_unique<Entity>(1);
+    floor->addComponent<TransformComponent>()->setPosition(Vector3f(0, -0.5f, 0));
+    floor->addComponent<ColliderComponent>(ColliderComponent::Box)->setSize(Vector3f(100.0f, 1.0f, 100.0f));
+    entities.push_back(std::move(floor));
+    
+    int side = static_cast<int>(std::cbrt(static_cast<float>(count))) + 1;
+    for (int i = 0; i < count; ++i) {
+        auto piece = std::make_unique<Entity>(entities.size() + 1);
+        Vector3f position((i % side) * 0.3f, 1.0f + (i / (side * side)) * 0.3f, ((i / side) % side) * 0.3f);
+        piece->addComponent<TransformComponent>()->setPosition(position);
+        auto* collider = piece->addComponent<ColliderComponent>(ColliderComponent::Box);
+        collider->setSize(Vector3f(0.4f, 0.4f, 0.4f));
+        collider->setLayer(Debris);
+        piece->addComponent<RigidbodyComponent>()->setCanSleep(false);
+        entities.push_back(std::move(piece));
+    }
+    
+    PhysicsSystem physics;
+    physics.setLayersCollide(Debris, Debris, !filtered);
+    double ms = averageStepMs(physics, entities, 120);
+    
+    std::cout << std::fixed << std::setprecision(3)
+              << "  " << count << " pieces, debris vs debris " << (filtered ? "off" : "on ")
+              << ": " << ms << " ms/step" << std::endl;
+}
+
+// A level of static boxes with a handful of bodies bouncing around on it:
+// the level should cost next to nothing once it is indexed.
+void measureStaticLevel(int count, int bodies) {
+    std::vector<std::unique_ptr<Entity>> entities;
+    
+    int side = static_cast<int>(std::sqrt(static_cast<float>(count)));
+    for (int i = 0; i < count; ++i) {
+        auto tile = std::make_unique<Entity>(entities.size() + 1);
+        float height = ((i * 7919) % 13) * 0.05f;
+        tile->addComponent<TransformComponent>()->setPosition(Vector3f((i % side) * 1.0f, height - 0.5f, (i / side) * 1.0f));
+        tile->addComponent<ColliderComponent>(ColliderComponent::Box);
+        entities.push_back(std::move(tile));
+    }
+    
+    for (int i = 0; i < bodies; ++i) {
+        auto body = std::make_unique<Entity>(entities.size() + 1);
+        body->addComponent<TransformComponent>()->setPosition(Vector3f((i % 20) * 2.0f + 5.0f, 2.0f + (i / 20) * 1.5f, (i / 20) * 2.0f + 5.0f));
+        body->addComponent<ColliderComponent>(ColliderComponent::Sphere);
+        body->addComponent<RigidbodyComponent>()->setCanSleep(false);
+        entities.push_back(std::move(body));
+    }
+    
+    PhysicsSystem physics;
+    auto start = Clock::now();
+    physics.update(TimeStep, entities);
+    double firstMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    double ms = averageStepMs(physics, entities, 120);
+    
+    std::cout << std::fixed << std::setprecision(3)
+              << "  " << count << " static boxes, " << bodies << " bodies: first step " << firstMs
+              << " ms, then " << ms << " ms/step" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    int height = argc > 1 ? std::atoi(argv[1]) : 4;
+    
+    std::cout << "Physics step benchmark: columns of " << height << " stacked boxes" << std::endl;
+    
+    for (int columns : {10, 30}) {
+        measure(columns, height, false);
+        measure(columns, height, true);
+    }
+    
+    // 200 m/s bullets, 0.1 wide, against a 0.1 thick wall: discrete steps
+    // need to be under 1 ms to catch every one.
+    std::cout << "Bullets vs thin wall" << std::endl;
+    measureTunnelling("discrete, 60 Hz        ", 60.0f, false);
+    measureTunnelling("discrete, 1000 Hz      ", 1000.0f, false);
+    measureTunnelling("continuous, 60 Hz      ", 60.0f, true);
+    
+    std::cout << "Overlapping debris" << std::endl;
+    measureDebris(2000, false);
+    measureDebris(2000, true);
+    
+    std::cout << "Static level" << std::endl;
+    measureStaticLevel(100000, 0);
+    measureStaticLevel(100000, 200);
+    
+    return 0;
+}
\ No newline at end of file
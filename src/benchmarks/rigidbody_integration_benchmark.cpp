@@ -0,0 +1,162 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <memory>
+#include <cstdlib>
+#include <algorithm>
+#include "ecs/entity.hpp"
+#include "ecs/transform_component.hpp"
+#include "physics/physics.hpp"
+#include "physics/rigidbody_world.hpp"
+#include "core/thread_pool.hpp"
+
+using namespace SFSim;
+using namespace SFSim::ECS;
+using namespace SFSim::Physics;
+
+using Clock = std::chrono::high_resolution_clock;
+
+constexpr float TimeStep = 1.0f / 60.0f;
+const Vector3f Gravity(0, -9.81f, 0);
+
+// What every step cost before the world: each body integrated through its
+// component's getters and setters, angular velocity as Euler angle rates.
+void integrateComponents(const std::vector<Entity*>& bodies) {
+    for (Entity* entity : bodies) {
+        auto* rigidbody = entity->getComponent<RigidbodyComponent>();
+        auto* transform = entity->getComponent<TransformComponent>();
+
+        Vector3f acceleration = rigidbody->getForce() * rigidbody->getInverseMass();
+        acceleration += Gravity * rigidbody->getGravityScale();
+        rigidbody->setVelocity(rigidbody->getVelocity() + acceleration * TimeStep);
+
+        Vector3f velocity = rigidbody->getVelocity();
+        velocity = velocity * (1.0f - rigidbody->getDrag() * TimeStep);
+        rigidbody->setVelocity(velocity);
+
+        Vector3f angularVelocity = rigidbody->getAngularVelocity();
+        angularVelocity = angularVelocity * (1.0f - rigidbody->getAngularDrag() * TimeStep);
+        rigidbody->setAngularVelocity(angularVelocity);
+
+        transform->setPosition(transform->getPosition() + rigidbody->getVelocity() * TimeStep);
+        transform->setRotation(transform->getRotation() + rigidbody->getAngularVelocity() * TimeStep);
+
+        rigidbody->clearForces();
+    }
+}
+
+// Load, integrate and store back in blocks, as PhysicsSystem::update does.
+void integrateThroughWorld(RigidbodyWorld& world, const std::vector<Entity*>& bodies,
+                           std::vector<RigidbodyComponent*>& rigidbodies, std::vector<TransformComponent*>& transforms) {
+    constexpr size_t Block = 64;
+
+    auto mirror = [&](size_t begin, size_t end) {
+        world.integrate(begin, end, TimeStep, Gravity);
+        for (size_t i = begin; i < end; ++i) {
+            world.store(i, *rigidbodies[i]);
+            transforms[i]->setPosition(world.getPosition(i));
+            transforms[i]->setOrientation(world.getOrientation(i));
+        }
+    };
+
+    world.clear();
+    rigidbodies.clear();
+    transforms.clear();
+    size_t mirrored = 0;
+    for (Entity* entity : bodies) {
+        auto* rigidbody = entity->getComponent<RigidbodyComponent>();
+        auto* transform = entity->getComponent<TransformComponent>();
+        world.add(*rigidbody, transform->getPosition(), transform->getOrientation());
+        rigidbodies.push_back(rigidbody);
+        transforms.push_back(transform);
+        rigidbody->clearForces();
+
+        if (world.size() - mirrored == Block) {
+            mirror(mirrored, world.size());
+            mirrored = world.size();
+        }
+    }
+    mirror(mirrored, world.size());
+}
+
+std::vector<std::unique_ptr<Entity>> buildBodies(size_t count) {
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    std::vector<std::unique_ptr<Entity>> entities;
+    entities.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        auto entity = std::make_unique<Entity>(static_cast<EntityID>(i + 1));
+        entity->addComponent<TransformComponent>()->setPosition(Vector3f(unit(rng), unit(rng), unit(rng)) * 100.0f);
+        auto* rigidbody = entity->addComponent<RigidbodyComponent>();
+        rigidbody->setMass(1.0f + unit(rng) * 0.5f);
+        rigidbody->setVelocity(Vector3f(unit(rng), unit(rng), unit(rng)) * 5.0f);
+        rigidbody->setAngularVelocity(Vector3f(unit(rng), unit(rng), unit(rng)));
+        entities.push_back(std::move(entity));
+    }
+    return entities;
+}
+
+template<typename Fn>
+double bestStepMs(int steps, Fn fn) {
+    double best = 1e30;
+    for (int i = 0; i < steps; ++i) {
+        auto start = Clock::now();
+        fn();
+        best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    int steps = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    std::cout << "Rigidbody integration benchmark: " << count << " bodies, "
+              << Core::ThreadPool::getInstance().getThreadCount() << " threads" << std::endl;
+
+    auto componentEntities = buildBodies(count);
+    auto worldEntities = buildBodies(count);
+    std::vector<Entity*> componentBodies;
+    std::vector<Entity*> worldBodies;
+    for (size_t i = 0; i < count; ++i) {
+        componentBodies.push_back(componentEntities[i].get());
+        worldBodies.push_back(worldEntities[i].get());
+    }
+
+    // Kernel alone, on state that already lives in the world.
+    RigidbodyWorld resident;
+    for (Entity* entity : worldBodies) {
+        auto* transform = entity->getComponent<TransformComponent>();
+        resident.add(*entity->getComponent<RigidbodyComponent>(), transform->getPosition(), transform->getOrientation());
+    }
+    resident.setParallelThreshold(0);
+    double kernelMs = bestStepMs(steps, [&]() { resident.integrate(TimeStep, Gravity); });
+    resident.setParallelThreshold(65536);
+    double parallelKernelMs = bestStepMs(steps, [&]() { resident.integrate(TimeStep, Gravity); });
+
+    RigidbodyWorld world;
+    std::vector<RigidbodyComponent*> rigidbodies;
+    std::vector<TransformComponent*> transforms;
+    double componentMs = bestStepMs(steps, [&]() { integrateComponents(componentBodies); });
+    double roundTripMs = bestStepMs(steps, [&]() { integrateThroughWorld(world, worldBodies, rigidbodies, transforms); });
+
+    // Both paths started from the same bodies and ran the same steps.
+    int mismatches = 0;
+    for (size_t i = 0; i < count; ++i) {
+        Vector3f a = componentEntities[i]->getComponent<TransformComponent>()->getPosition();
+        Vector3f b = worldEntities[i]->getComponent<TransformComponent>()->getPosition();
+        if (a.x != b.x || a.y != b.y || a.z != b.z) mismatches++;
+    }
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "  components:           " << componentMs << " ms/step" << std::endl
+              << "  world, with mirroring: " << roundTripMs << " ms/step" << std::endl
+              << "  world kernel:          " << kernelMs << " ms/step" << std::endl
+              << "  world kernel, pool:    " << parallelKernelMs << " ms/step" << std::endl
+              << "  positions differing:   " << mismatches << std::endl;
+
+    return mismatches == 0 ? 0 : 1;
+}
\ No newline at end of file
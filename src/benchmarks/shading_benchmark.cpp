@@ -0,0 +1,163 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <cstdlib>
+#include "renderer/material.hpp"
+#include "renderer/lighting.hpp"
+#include "renderer/brdf_lut.hpp"
+
+using namespace SFSim;
+
+struct ShadingInput {
+    std::vector<Vector3f> normals;
+    std::vector<Vector3f> positions;
+};
+
+ShadingInput makeInput(size_t count) {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    
+    ShadingInput input;
+    input.normals.reserve(count);
+    input.positions.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        Vector3f normal(unit(rng), unit(rng), unit(rng));
+        if (normal.lengthSquared() < 1e-4f) normal = Vector3f::up();
+        input.normals.push_back(normal.normalized());
+        input.positions.push_back(Vector3f(unit(rng), unit(rng), unit(rng)) * 5.0f);
+    }
+    return input;
+}
+
+LightEnvironment makeLighting(int pointLights) {
+    LightEnvironment lighting;
+    lighting.setView(Matrix4x4::lookAt(Vector3f(0, 0, 15), Vector3f::zero(), Vector3f::up()),
+                     Matrix4x4::perspective(1.0f, 16.0f / 9.0f, 0.1f, 100.0f),
+                     Vector3f(0, 0, 15));
+    lighting.setAmbientLight(sf::Color(40, 40, 48));
+    
+    Light sun;
+    sun.direction = Vector3f(-0.3f, -1.0f, -0.5f).normalized();
+    lighting.addLight(sun);
+    
+    std::mt19937 rng(99);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    for (int i = 0; i < pointLights; ++i) {
+        Light light;
+        light.type = LightType::Point;
+        light.position = Vector3f(unit(rng), unit(rng), unit(rng)) * 6.0f;
+        light.range = 4.0f;
+        light.color = sf::Color(255, 200, 150);
+        lighting.addLight(light);
+    }
+    
+    lighting.build();
+    return lighting;
+}
+
+double measure(const Material& material, const ShadingInput& input, const LightEnvironment& lighting, std::vector<sf::Color>& out, int iterations) {
+    out.resize(input.normals.size());
+    material.shade(input.normals.data(), input.positions.data(), out.data(), out.size(), lighting);
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        material.shade(input.normals.data(), input.positions.data(), out.data(), out.size(), lighting);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    
+    double seconds = std::chrono::duration<double>(end - start).count();
+    return static_cast<double>(out.size()) * iterations / seconds / 1e6;
+}
+
+void compare(const char* name, Material& material, const ShadingInput& input, const LightEnvironment& lighting, int iterations) {
+    std::vector<sf::Color> accurate, fast;
+    
+    material.setShadingQuality(ShadingQuality::Accurate);
+    double accurateRate = measure(material, input, lighting, accurate, iterations);
+    
+    material.setShadingQuality(ShadingQuality::Fast);
+    double fastRate = measure(material, input, lighting, fast, iterations);
+    
+    int maxError = 0;
+    double totalError = 0.0;
+    for (size_t i = 0; i < accurate.size(); ++i) {
+        int errors[3] = {std::abs(accurate[i].r - fast[i].r), std::abs(accurate[i].g - fast[i].g), std::abs(accurate[i].b - fast[i].b)};
+        for (int error : errors) {
+            maxError = std::max(maxError, error);
+            totalError += error;
+        }
+    }
+    
+    std::cout << std::left << std::setw(8) << name << std::right << std::fixed << std::setprecision(2)
+              << " accurate " << std::setw(8) << accurateRate << " Mverts/s"
+              << "  fast " << std::setw(8) << fastRate << " Mverts/s"
+              << "  speedup " << fastRate / accurateRate << "x"
+              << "  error max " << maxError << " mean " << std::setprecision(3) << totalError / (accurate.size() * 3.0)
+              << std::endl;
+}
+
+void measureLookupTable() {
+    const BRDFLookupTable& lut = BRDFLookupTable::getInstance();
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    
+    // Errors peak at grazing angles on near-mirror surfaces, so report the
+    // rest of the table separately.
+    const int samples = 2000;
+    float maxError = 0.0f;
+    float maxErrorAboveGrazing = 0.0f;
+    for (int i = 0; i < samples; ++i) {
+        float NdotV = std::max(unit(rng), 1e-3f);
+        float roughness = unit(rng);
+        Vector2f reference = lut.integrate(NdotV, roughness);
+        Vector2f table = lut.sample(NdotV, roughness);
+        float error = std::max(std::abs(reference.x - table.x), std::abs(reference.y - table.y));
+        maxError = std::max(maxError, error);
+        if (NdotV >= 0.05f) maxErrorAboveGrazing = std::max(maxErrorAboveGrazing, error);
+    }
+    
+    volatile float sink = 0.0f;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < 1000000; ++i) {
+        Vector2f value = lut.sample((i % 1000) / 1000.0f, (i % 997) / 997.0f);
+        sink = sink + value.x;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    
+    std::cout << "BRDF LUT " << BRDFLookupTable::Size << "x" << BRDFLookupTable::Size
+              << "  max error vs integration " << std::setprecision(4) << maxError
+              << " (" << maxErrorAboveGrazing << " for NdotV >= 0.05)"
+              << "  lookups " << std::setprecision(1) << 1.0 / seconds << " M/s" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    size_t vertexCount = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 65536;
+    int pointLights = argc > 2 ? std::atoi(argv[2]) : 32;
+    int iterations = argc > 3 ? std::atoi(argv[3]) : 20;
+    
+    std::cout << "Shading benchmark: " << vertexCount << " vertices, " << pointLights
+              << " point lights, " << iterations << " iterations" << std::endl;
+    
+    ShadingInput input = makeInput(vertexCount);
+    LightEnvironment lighting = makeLighting(pointLights);
+    
+    PhongMaterial phong;
+    phong.setDiffuseColor(sf::Color(180, 60, 60));
+    phong.setShininess(48.0f);
+    compare("Phong", phong, input, lighting, iterations);
+    
+    PBRMaterial pbr;
+    pbr.setDiffuseColor(sf::Color(200, 160, 90));
+    pbr.setMetallic(0.6f);
+    pbr.setRoughness(0.35f);
+    compare("PBR", pbr, input, lighting, iterations);
+    
+    measureLookupTable();
+    
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include "ecs/entity.hpp"
+#include "ecs/transform_component.hpp"
+#include "physics/physics.hpp"
+
+using namespace SFSim;
+using namespace SFSim::ECS;
+using namespace SFSim::Physics;
+
+using Clock = std::chrono::high_resolution_clock;
+
+double elapsedSeconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// What every query cost before the index: a pass over all collider entities.
+struct BruteForce {
+    std::vector<AABB> bounds;
+    std::vector<Physics::Sphere> spheres;
+
+    size_t overlapSphere(const Vector3f& center, float radius) const {
+        Physics::Sphere query(center, radius);
+        size_t count = 0;
+        for (const Physics::Sphere& sphere : spheres) {
+            if (query.intersects(sphere)) count++;
+        }
+        return count;
+    }
+
+    size_t overlapBox(const Vector3f& center, const Vector3f& size) const {
+        AABB query(center - size * 0.5f, center + size * 0.5f);
+        size_t count = 0;
+        for (const AABB& box : bounds) {
+            if (query.intersects(box)) count++;
+        }
+        return count;
+    }
+
+    float raycast(const Ray& ray, float maxDistance) const {
+        float closest = maxDistance;
+        for (const AABB& box : bounds) {
+            float distance;
+            if (ray.intersects(box, closest, distance)) {
+                closest = std::max(distance, 1e-6f);
+            }
+        }
+        return closest;
+    }
+};
+
+template<typename Fn>
+double queriesPerSecond(int queries, Fn fn) {
+    auto start = Clock::now();
+    for (int i = 0; i < queries; ++i) {
+        fn(i);
+    }
+    return queries / elapsedSeconds(start);
+}
+
+void measure(size_t entityCount, int queries) {
+    std::mt19937 rng(42);
+    // Keep density constant so each query touches a similar number of hits.
+    float extent = 10.0f * std::cbrt(static_cast<float>(entityCount));
+    std::uniform_real_distribution<float> position(-extent, extent);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> size(0.5f, 2.0f);
+
+    std::vector<std::unique_ptr<Entity>> entities;
+    BruteForce brute;
+
+    for (size_t i = 0; i < entityCount; ++i) {
+        auto entity = std::make_unique<Entity>(static_cast<EntityID>(i + 1));
+        auto* transform = entity->addComponent<TransformComponent>();
+        transform->setPosition(Vector3f(position(rng), position(rng), position(rng)));
+
+        auto* collider = entity->addComponent<ColliderComponent>(i % 2 ? ColliderComponent::Box : ColliderComponent::Sphere);
+        collider->setSize(Vector3f(size(rng), size(rng), size(rng)));
+        collider->setRadius(size(rng) * 0.5f);
+
+        brute.bounds.push_back(collider->getBounds(transform->getPosition(), transform->getScale()));
+        brute.spheres.push_back(collider->getBoundingSphere(transform->getPosition(), transform->getScale()));
+        entities.push_back(std::move(entity));
+    }
+
+    PhysicsSystem physics;
+
+    auto start = Clock::now();
+    physics.updateSpatialIndex(entities);
+    double buildMs = elapsedSeconds(start) * 1000.0;
+
+    // Nudge 10% of the colliders, as a physics step would.
+    for (size_t i = 0; i < entityCount; i += 10) {
+        auto* transform = entities[i]->getComponent<TransformComponent>();
+        transform->setPosition(transform->getPosition() + Vector3f(unit(rng), unit(rng), unit(rng)) * 0.05f);
+    }
+    start = Clock::now();
+    physics.updateSpatialIndex(entities);
+    double refitMs = elapsedSeconds(start) * 1000.0;
+
+    std::vector<Vector3f> centers(queries);
+    std::vector<Ray> rays(queries);
+    for (int i = 0; i < queries; ++i) {
+        centers[i] = Vector3f(position(rng), position(rng), position(rng));
+        rays[i] = Ray(centers[i], Vector3f(unit(rng), unit(rng), unit(rng)));
+    }
+
+    size_t sink = 0;
+    double sphereBrute = queriesPerSecond(queries, [&](int i) { sink += brute.overlapSphere(centers[i], 5.0f); });
+    double sphereTree = queriesPerSecond(queries, [&](int i) { sink += physics.overlapSphere(centers[i], 5.0f).size(); });
+    double boxBrute = queriesPerSecond(queries, [&](int i) { sink += brute.overlapBox(centers[i], Vector3f(8, 8, 8)); });
+    double boxTree = queriesPerSecond(queries, [&](int i) { sink += physics.overlapBox(centers[i], Vector3f(8, 8, 8)).size(); });
+    double rayBrute = queriesPerSecond(queries, [&](int i) { sink += brute.raycast(rays[i], 50.0f) < 50.0f; });
+    double rayTree = queriesPerSecond(queries, [&](int i) { sink += physics.raycast(rays[i], 50.0f).hit; });
+
+    // Batched rays: the random ones above, and a sensor sweep fanning out
+    // from a single origin, which is what packets are meant for.
+    std::vector<RaycastHit> hits(queries);
+    double rayBatch = queriesPerSecond(1, [&](int) { physics.raycastBatch(rays.data(), rays.size(), hits.data(), 50.0f); }) * queries;
+
+    std::vector<Ray> sweep(queries);
+    int columns = static_cast<int>(std::sqrt(static_cast<float>(queries)));
+    for (int i = 0; i < queries; ++i) {
+        float yaw = (i % columns) * 6.2832f / columns;
+        float pitch = (i / columns) * 1.5f / columns - 0.75f;
+        sweep[i] = Ray(Vector3f::zero(), Vector3f(std::cos(yaw) * std::cos(pitch), std::sin(pitch), std::sin(yaw) * std::cos(pitch)));
+    }
+    double sweepSingle = queriesPerSecond(queries, [&](int i) { sink += physics.raycast(sweep[i], 50.0f).hit; });
+    double sweepBatch = queriesPerSecond(1, [&](int) { physics.raycastBatch(sweep.data(), sweep.size(), hits.data(), 50.0f); }) * queries;
+    for (const RaycastHit& hit : hits) sink += hit.hit;
+
+    std::cout << entityCount << " colliders (tree height: static " << physics.getStaticIndex().getHeight()
+              << ", dynamic " << physics.getSpatialIndex().getHeight() << ")" << std::endl;
+    std::cout << std::fixed << std::setprecision(2)
+              << "  build:                     " << buildMs << " ms" << std::endl
+              << "  refit after 10% moved:     " << refitMs << " ms" << std::endl
+              << std::setprecision(0)
+              << "  overlapSphere brute/tree:  " << sphereBrute << " / " << sphereTree << " queries/s" << std::endl
+              << "  overlapBox brute/tree:     " << boxBrute << " / " << boxTree << " queries/s" << std::endl
+              << "  raycast brute/tree:        " << rayBrute << " / " << rayTree << " queries/s" << std::endl
+              << "  raycastBatch random:       " << rayBatch << " rays/s" << std::endl
+              << "  sensor sweep single/batch: " << sweepSingle << " / " << sweepBatch << " rays/s" << std::endl
+              << "  (checksum " << sink << ")" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    int queries = argc > 1 ? std::atoi(argv[1]) : 2000;
+
+    std::cout << "Spatial query benchmark: " << queries << " queries per measurement" << std::endl;
+
+    for (size_t count : {1000, 10000, 100000}) {
+        measure(count, queries);
+    }
+
+    return 0;
+}
\ No newline at end of file
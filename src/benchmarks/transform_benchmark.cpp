@@ -0,0 +1,127 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include "transform.hpp"
+#include "transform_hierarchy.hpp"
+#include "core/thread_pool.hpp"
+
+using namespace SFSim;
+
+using Clock = std::chrono::high_resolution_clock;
+
+double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Parent of node i for the two shapes measured: a single deep chain, and a
+// wide tree with a fan-out of 8.
+size_t parentOf(size_t i, bool chain) {
+    return chain ? i - 1 : (i - 1) / 8;
+}
+
+template<typename Fn>
+double bestOf(int iterations, Fn fn) {
+    double best = 1e30;
+    for (int i = 0; i < iterations; ++i) {
+        best = std::min(best, fn(i));
+    }
+    return best;
+}
+
+void measureShape(const char* name, size_t count, bool chain, int iterations) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    std::vector<std::unique_ptr<Transform>> transforms;
+    TransformHierarchy hierarchy;
+    std::vector<TransformHierarchy::NodeId> nodes;
+
+    for (size_t i = 0; i < count; ++i) {
+        Vector3f position(unit(rng), unit(rng), unit(rng));
+        Vector3f rotation(unit(rng) * 0.1f, unit(rng) * 0.1f, unit(rng) * 0.1f);
+        Vector3f scale = Vector3f::one();
+
+        transforms.push_back(std::make_unique<Transform>(position, rotation, scale));
+        TransformHierarchy::NodeId parent = TransformHierarchy::InvalidNode;
+        if (i > 0) {
+            transforms[i]->setParent(transforms[parentOf(i, chain)].get());
+            parent = nodes[parentOf(i, chain)];
+        }
+        nodes.push_back(hierarchy.create(parent));
+        hierarchy.setLocalTransform(nodes[i], position, rotation, scale);
+    }
+
+    auto start = Clock::now();
+    hierarchy.update();
+    double firstUpdate = elapsedMs(start);
+
+    // Transform recomputes lazily per object; walking every world matrix is
+    // what a renderer visiting every node would pay.
+    float maxError = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        const Matrix4x4& expected = transforms[i]->getWorldMatrix();
+        const Matrix4x4& actual = hierarchy.getWorldMatrix(nodes[i]);
+        for (int k = 0; k < 16; ++k) {
+            maxError = std::max(maxError, std::abs(expected.m[k] - actual.m[k]));
+        }
+    }
+
+    double linkedRoot = bestOf(iterations, [&](int r) {
+        transforms[0]->setPosition(Vector3f(static_cast<float>(r), 0, 0));
+        auto t = Clock::now();
+        for (size_t i = 0; i < count; ++i) transforms[i]->getWorldMatrix();
+        return elapsedMs(t);
+    });
+
+    double flatRoot = bestOf(iterations, [&](int r) {
+        hierarchy.setPosition(nodes[0], Vector3f(static_cast<float>(r), 0, 0));
+        auto t = Clock::now();
+        hierarchy.update();
+        return elapsedMs(t);
+    });
+
+    double flatSparse = bestOf(iterations, [&](int r) {
+        for (size_t i = 1; i < count; i += 100) {
+            hierarchy.setRotation(nodes[i], Vector3f(0, static_cast<float>(r) * 0.01f, 0));
+        }
+        auto t = Clock::now();
+        hierarchy.update();
+        return elapsedMs(t);
+    });
+
+    double flatLeaf = bestOf(iterations, [&](int r) {
+        hierarchy.setPosition(nodes[count - 1], Vector3f(static_cast<float>(r), 0, 0));
+        auto t = Clock::now();
+        hierarchy.update();
+        return elapsedMs(t);
+    });
+
+    std::cout << name << " (" << hierarchy.getLevelCount() << " levels)" << std::endl;
+    std::cout << std::fixed << std::setprecision(3)
+              << "  first update:              " << firstUpdate << " ms" << std::endl
+              << "  root moved, linked:        " << linkedRoot << " ms" << std::endl
+              << "  root moved, flat:          " << flatRoot << " ms" << std::endl
+              << "  1% rotated, flat:          " << flatSparse << " ms" << std::endl
+              << "  one leaf moved, flat:      " << flatLeaf << " ms" << std::endl
+              << std::scientific << std::setprecision(2)
+              << "  max error vs Transform:    " << maxError << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    size_t nodeCount = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 100000;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 20;
+
+    std::cout << "Transform benchmark: " << nodeCount << " nodes, " << iterations << " iterations, "
+              << Core::ThreadPool::getInstance().getThreadCount() << " threads" << std::endl;
+
+    measureShape("Chain", nodeCount, true, iterations);
+    measureShape("Wide tree", nodeCount, false, iterations);
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "core/thread_pool.hpp"
+#include <algorithm>
+
+namespace SFSim {
+namespace Core {
+
+namespace {
+
+thread_local bool insideParallelTask = false;
+
+} // namespace
+
+ThreadPool& ThreadPool::getInstance() {
+    static ThreadPool instance(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return instance;
+}
+
+ThreadPool::ThreadPool(unsigned int workerCount)
+    : _task(nullptr)
+    , _count(0)
+    , _grainSize(1)
+    , _next(0)
+    , _activeWorkers(0)
+    , _generation(0)
+    , _stopping(false)
+{
+    _workers.reserve(workerCount);
+    for (unsigned int i = 0; i < workerCount; ++i) {
+        _workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    
+    for (std::thread& worker : _workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grainSize, const RangeTask& task) {
+    if (count == 0) return;
+    grainSize = std::max<size_t>(1, grainSize);
+    
+    std::unique_lock<std::mutex> submitLock(_submitMutex, std::try_to_lock);
+    if (_workers.empty() || count <= grainSize || insideParallelTask || !submitLock.owns_lock()) {
+        task(0, count);
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _task = &task;
+        _count = count;
+        _grainSize = grainSize;
+        _next.store(0, std::memory_order_relaxed);
+        _activeWorkers = static_cast<unsigned int>(_workers.size());
+        ++_generation;
+    }
+    _wake.notify_all();
+    
+    runChunks();
+    
+    std::unique_lock<std::mutex> lock(_mutex);
+    _finished.wait(lock, [this] { return _activeWorkers == 0; });
+    _task = nullptr;
+}
+
+void ThreadPool::parallelForIf(bool parallel, size_t count, size_t grainSize, const RangeTask& task) {
+    if (parallel) {
+        getInstance().parallelFor(count, grainSize, task);
+    } else {
+        task(0, count);
+    }
+}
+
+void ThreadPool::workerLoop() {
+    unsigned long long seenGeneration = 0;
+    
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [&] { return _stopping || _generation != seenGeneration; });
+            if (_stopping) return;
+            seenGeneration = _generation;
+        }
+        
+        runChunks();
+        
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            --_activeWorkers;
+        }
+        _finished.notify_one();
+    }
+}
+
+void ThreadPool::runChunks() {
+    bool wasInside = insideParallelTask;
+    insideParallelTask = true;
+    
+    for (;;) {
+        size_t begin = _next.fetch_add(_grainSize, std::memory_order_relaxed);
+        if (begin >= _count) break;
+        (*_task)(begin, std::min(begin + _grainSize, _count));
+    }
+    
+    insideParallelTask = wasInside;
+}
+
+} // namespace Core
+} // namespace SFSim
\ No newline at end of file
@@ -1,11 +1,19 @@
 #include "ecs/entity.hpp"
+#include <atomic>
 
 namespace SFSim {
 namespace ECS {
 
+namespace {
+
+std::atomic<unsigned int> nextComponentVersion(0);
+
+} // namespace
+
 Entity::Entity(EntityID id) 
     : _id(id)
     , _active(true)
+    , _componentVersion(++nextComponentVersion)
     , _name("Entity_" + std::to_string(id))
 {
 }
@@ -20,6 +28,15 @@ void Entity::removeAllComponents() {
         pair.second->_entity = nullptr;
     }
     _components.clear();
+    touchComponents();
+}
+
+unsigned int Entity::getLatestComponentVersion() {
+    return nextComponentVersion.load();
+}
+
+void Entity::touchComponents() {
+    _componentVersion = ++nextComponentVersion;
 }
 
 std::vector<Component*> Entity::getAllComponents() {
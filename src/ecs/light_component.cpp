@@ -0,0 +1,42 @@
+#include "ecs/light_component.hpp"
+#include "ecs/entity.hpp"
+#include "ecs/transform_component.hpp"
+#include <algorithm>
+
+namespace SFSim {
+namespace ECS {
+
+LightComponent::LightComponent()
+    : _enabled(true)
+{
+}
+
+LightComponent::LightComponent(LightType type, const sf::Color& color, float intensity)
+    : _enabled(true)
+{
+    _light.type = type;
+    _light.color = color;
+    _light.intensity = intensity;
+}
+
+void LightComponent::setSpotAngles(float innerConeAngle, float outerConeAngle) {
+    _light.outerConeAngle = std::max(outerConeAngle, 0.0f);
+    _light.innerConeAngle = std::clamp(innerConeAngle, 0.0f, _light.outerConeAngle);
+}
+
+Light LightComponent::getWorldLight() const {
+    Light light = _light;
+    
+    const Entity* entity = getEntity();
+    const TransformComponent* transform = entity ? entity->getComponent<TransformComponent>() : nullptr;
+    if (transform) {
+        const Matrix4x4& world = transform->getWorldMatrix();
+        light.position = world.transformPoint(Vector3f::zero());
+        light.direction = world.transformDirection(_light.direction).normalized();
+    }
+    
+    return light;
+}
+
+} // namespace ECS
+} // namespace SFSim
\ No newline at end of file
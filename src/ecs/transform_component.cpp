@@ -5,13 +5,58 @@ namespace ECS {
 
 TransformComponent::TransformComponent() 
     : _transform()
+    , _hierarchy(nullptr)
+    , _node(TransformHierarchy::InvalidNode)
 {
 }
 
 TransformComponent::TransformComponent(const Vector3f& position, const Vector3f& rotation, const Vector3f& scale)
     : _transform(position, rotation, scale)
+    , _hierarchy(nullptr)
+    , _node(TransformHierarchy::InvalidNode)
 {
 }
 
+TransformComponent::~TransformComponent() {
+    unbindFromHierarchy();
+}
+
+void TransformComponent::bindToHierarchy(TransformHierarchy& hierarchy, const TransformComponent* parent) {
+    unbindFromHierarchy();
+    
+    TransformHierarchy::NodeId parentNode = TransformHierarchy::InvalidNode;
+    if (parent && parent->_hierarchy == &hierarchy) {
+        parentNode = parent->_node;
+    }
+    
+    _hierarchy = &hierarchy;
+    _node = hierarchy.create(parentNode);
+    syncHierarchy();
+}
+
+void TransformComponent::unbindFromHierarchy() {
+    if (_hierarchy) {
+        _hierarchy->destroy(_node);
+        _hierarchy = nullptr;
+        _node = TransformHierarchy::InvalidNode;
+    }
+}
+
+bool TransformComponent::setParent(const TransformComponent* parent) {
+    if (!_hierarchy) return false;
+    
+    if (!parent) {
+        return _hierarchy->setParent(_node, TransformHierarchy::InvalidNode);
+    }
+    if (parent->_hierarchy != _hierarchy) return false;
+    return _hierarchy->setParent(_node, parent->_node);
+}
+
+void TransformComponent::syncHierarchy() {
+    if (_hierarchy) {
+        _hierarchy->setLocalTransform(_node, _transform.getPosition(), _transform.getOrientation(), _transform.getScale());
+    }
+}
+
 } // namespace ECS
 } // namespace SFSim
\ No newline at end of file
@@ -1,39 +1,64 @@
 #include "geometry/mesh.hpp"
+#include "renderer/lighting.hpp"
+#include "renderer/material_registry.hpp"
+#include "physics/mesh_bvh.hpp"
+#include "physics/convex_hull.hpp"
 #include <fstream>
 #include <sstream>
 #include <cmath>
 #include <algorithm>
+#include <cstdint>
 
 namespace SFSim {
 
 MeshGeometry::MeshGeometry()
     : Geometry(GeometryType::Mesh)
-    , _material(std::make_shared<Material>())
+    , _material(MaterialRegistry::getInstance().getDefault())
+    , _smoothShading(true)
+    , _lighting(nullptr)
+    , _meshVersion(0)
+    , _bvhDirty(true)
+    , _hullDirty(true)
+    , _adjacencyDirty(true)
 {
+    _lightingCache.valid = false;
 }
 
 MeshGeometry::~MeshGeometry() = default;
 
 void MeshGeometry::setVertices(const std::vector<Vertex>& vertices) {
     _vertices = vertices;
+    ++_meshVersion;
+    _bvhDirty = true;
+    _hullDirty = true;
+    _adjacencyDirty = true;
 }
 
 void MeshGeometry::setIndices(const std::vector<unsigned int>& indices) {
     _indices = indices;
+    _bvhDirty = true;
+    _adjacencyDirty = true;
 }
 
 void MeshGeometry::setMaterial(std::shared_ptr<Material> material) {
-    _material = material ? material : std::make_shared<Material>();
+    _material = MaterialRegistry::getInstance().intern(material);
+    ++_meshVersion;
 }
 
 void MeshGeometry::addVertex(const Vertex& vertex) {
     _vertices.push_back(vertex);
+    ++_meshVersion;
+    _bvhDirty = true;
+    _hullDirty = true;
+    _adjacencyDirty = true;
 }
 
 void MeshGeometry::addTriangle(unsigned int a, unsigned int b, unsigned int c) {
     _indices.push_back(a);
     _indices.push_back(b);
     _indices.push_back(c);
+    _bvhDirty = true;
+    _adjacencyDirty = true;
 }
 
 void MeshGeometry::addQuad(unsigned int a, unsigned int b, unsigned int c, unsigned int d) {
@@ -69,6 +94,56 @@ void MeshGeometry::calculateNormals() {
     for (auto& vertex : _vertices) {
         vertex.normal.normalize();
     }
+    
+    ++_meshVersion;
+}
+
+void MeshGeometry::calculateNormals(const std::vector<unsigned int>& vertices) {
+    if (_adjacencyDirty) buildAdjacency();
+    
+    for (unsigned int v : vertices) {
+        if (v >= _vertices.size()) continue;
+        
+        Vector3f sum = Vector3f::zero();
+        for (unsigned int k = _vertexTriangleStart[v]; k < _vertexTriangleStart[v + 1]; ++k) {
+            size_t i = static_cast<size_t>(_vertexTriangles[k]) * 3;
+            Vector3f v0 = _vertices[_indices[i]].position;
+            Vector3f v1 = _vertices[_indices[i + 1]].position;
+            Vector3f v2 = _vertices[_indices[i + 2]].position;
+            sum += (v1 - v0).cross(v2 - v0).normalized();
+        }
+        _vertices[v].normal = sum.normalized();
+    }
+    
+    ++_meshVersion;
+}
+
+void MeshGeometry::buildAdjacency() {
+    // Counted, then filled in, skipping the triangles calculateNormals()
+    // would.
+    size_t triangleCount = _indices.size() / 3;
+    auto valid = [&](size_t t) {
+        return _indices[t * 3] < _vertices.size() && _indices[t * 3 + 1] < _vertices.size() && _indices[t * 3 + 2] < _vertices.size();
+    };
+    
+    _vertexTriangleStart.assign(_vertices.size() + 1, 0);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        if (!valid(t)) continue;
+        for (size_t corner = 0; corner < 3; ++corner) ++_vertexTriangleStart[_indices[t * 3 + corner] + 1];
+    }
+    for (size_t v = 0; v < _vertices.size(); ++v) {
+        _vertexTriangleStart[v + 1] += _vertexTriangleStart[v];
+    }
+    
+    _vertexTriangles.resize(_vertexTriangleStart.back());
+    std::vector<unsigned int> next(_vertexTriangleStart.begin(), _vertexTriangleStart.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        if (!valid(t)) continue;
+        for (size_t corner = 0; corner < 3; ++corner) {
+            _vertexTriangles[next[_indices[t * 3 + corner]]++] = static_cast<unsigned int>(t);
+        }
+    }
+    _adjacencyDirty = false;
 }
 
 void MeshGeometry::calculateTangents() {
@@ -117,6 +192,10 @@ void MeshGeometry::calculateTangents() {
 void MeshGeometry::clear() {
     _vertices.clear();
     _indices.clear();
+    ++_meshVersion;
+    _bvhDirty = true;
+    _hullDirty = true;
+    _adjacencyDirty = true;
 }
 
 void MeshGeometry::draw(sf::RenderWindow& window, const Matrix4x4& transform, const Matrix4x4& viewProjection) {
@@ -138,81 +217,161 @@ std::vector<Vector3f> MeshGeometry::getVertices() const {
     return positions;
 }
 
-void MeshGeometry::setColor(const sf::Color& color) {
-    if (_material) {
-        _material->setDiffuseColor(color);
+std::shared_ptr<const Physics::MeshBVH> MeshGeometry::getBVH() const {
+    if (_bvhDirty || !_bvh) {
+        // Build into a fresh object so colliders holding the previous tree
+        // keep a consistent one.
+        auto bvh = std::make_shared<Physics::MeshBVH>();
+        bvh->build(getVertices(), _indices);
+        _bvh = bvh;
+        _bvhDirty = false;
     }
+    return _bvh;
 }
 
-void MeshGeometry::drawWireframe(sf::RenderWindow& window, const Matrix4x4& transform, const Matrix4x4& viewProjection) {
+std::shared_ptr<const Physics::ConvexHull> MeshGeometry::getConvexHull() const {
+    if (_hullDirty || !_hull) {
+        auto hull = std::make_shared<Physics::ConvexHull>();
+        hull->build(getVertices());
+        _hull = hull;
+        _hullDirty = false;
+    }
+    return _hull;
+}
+
+void MeshGeometry::editMaterial(const std::function<void(Material&)>& edit) {
+    std::shared_ptr<Material> material = _material->clone();
+    edit(*material);
+    _material = MaterialRegistry::getInstance().intern(material);
+}
+
+void MeshGeometry::setColor(const sf::Color& color) {
+    if (_material->getDiffuseColor() == color) return;
+    
+    editMaterial([&color](Material& material) { material.setDiffuseColor(color); });
+}
+
+bool MeshGeometry::appendTriangles(std::vector<sf::Vertex>& batch, sf::RenderWindow& window, const Matrix4x4& transform, const Matrix4x4& viewProjection) {
+    if (_material->isWireframe()) return false;
+    
+    buildFilled(window, transform, viewProjection);
+    batch.insert(batch.end(), _drawBuffer.begin(), _drawBuffer.end());
+    return true;
+}
+
+void MeshGeometry::setupTriangles(sf::RenderWindow& window, const Matrix4x4& transform, const Matrix4x4& viewProjection, bool cullBackfaces) {
     Matrix4x4 mvp = viewProjection * transform;
+    
+    _setup.setBackfaceCulling(cullBackfaces);
+    _setup.transformVertices(_vertices.data(), _vertices.size(), mvp,
+                             static_cast<float>(window.getSize().x), static_cast<float>(window.getSize().y));
+    _setup.assemble(_indices.data(), _indices.size());
+}
+
+void MeshGeometry::drawWireframe(sf::RenderWindow& window, const Matrix4x4& transform, const Matrix4x4& viewProjection) {
+    setupTriangles(window, transform, viewProjection, false);
+    
     sf::Color color = _material ? _material->getDiffuseColor() : sf::Color::White;
+    const auto& setupVertices = _setup.getVertices();
     
-    for (size_t i = 0; i < _indices.size(); i += 3) {
-        if (i + 2 >= _indices.size()) break;
-        
-        unsigned int i0 = _indices[i];
-        unsigned int i1 = _indices[i + 1];
-        unsigned int i2 = _indices[i + 2];
-        
-        if (i0 >= _vertices.size() || i1 >= _vertices.size() || i2 >= _vertices.size()) continue;
-        
-        Vector3f worldPos0 = transform.transformPoint(_vertices[i0].position);
-        Vector3f worldPos1 = transform.transformPoint(_vertices[i1].position);
-        Vector3f worldPos2 = transform.transformPoint(_vertices[i2].position);
-        
-        Vector2f screen0 = projectPoint(worldPos0, mvp, window.getSize().x, window.getSize().y);
-        Vector2f screen1 = projectPoint(worldPos1, mvp, window.getSize().x, window.getSize().y);
-        Vector2f screen2 = projectPoint(worldPos2, mvp, window.getSize().x, window.getSize().y);
-        
-        drawLine(window, screen0, screen1, color);
-        drawLine(window, screen1, screen2, color);
-        drawLine(window, screen2, screen0, color);
+    _drawBuffer.resize(setupVertices.size() * 2);
+    
+    for (size_t i = 0; i < setupVertices.size(); i += 3) {
+        for (size_t edge = 0; edge < 3; ++edge) {
+            const Vector2f& start = setupVertices[i + edge].screen;
+            const Vector2f& end = setupVertices[i + (edge + 1) % 3].screen;
+            
+            sf::Vertex* line = &_drawBuffer[(i + edge) * 2];
+            line[0].position = sf::Vector2f(start.x, start.y);
+            line[0].color = color;
+            line[1].position = sf::Vector2f(end.x, end.y);
+            line[1].color = color;
+        }
+    }
+    
+    if (!_drawBuffer.empty()) {
+        window.draw(_drawBuffer.data(), _drawBuffer.size(), sf::PrimitiveType::Lines);
     }
 }
 
 void MeshGeometry::drawFilled(sf::RenderWindow& window, const Matrix4x4& transform, const Matrix4x4& viewProjection) {
-    for (size_t i = 0; i < _indices.size(); i += 3) {
-        if (i + 2 >= _indices.size()) break;
-        
-        unsigned int i0 = _indices[i];
-        unsigned int i1 = _indices[i + 1];
-        unsigned int i2 = _indices[i + 2];
-        
-        if (i0 >= _vertices.size() || i1 >= _vertices.size() || i2 >= _vertices.size()) continue;
-        
-        drawTriangle(window, _vertices[i0], _vertices[i1], _vertices[i2], transform, viewProjection);
+    buildFilled(window, transform, viewProjection);
+    
+    if (!_drawBuffer.empty()) {
+        window.draw(_drawBuffer.data(), _drawBuffer.size(), sf::PrimitiveType::Triangles);
     }
 }
 
-void MeshGeometry::drawTriangle(sf::RenderWindow& window, const Vertex& a, const Vertex& b, const Vertex& c,
-                               const Matrix4x4& transform, const Matrix4x4& viewProjection) {
-    Matrix4x4 mvp = viewProjection * transform;
+void MeshGeometry::buildFilled(sf::RenderWindow& window, const Matrix4x4& transform, const Matrix4x4& viewProjection) {
+    bool doubleSided = _material->isDoubleSided();
+    setupTriangles(window, transform, viewProjection, !doubleSided);
     
-    Vector3f worldPosA = transform.transformPoint(a.position);
-    Vector3f worldPosB = transform.transformPoint(b.position);
-    Vector3f worldPosC = transform.transformPoint(c.position);
+    const auto& setupVertices = _setup.getVertices();
+    const auto& sourceTriangles = _setup.getSourceTriangles();
     
-    Vector2f screenA = projectPoint(worldPosA, mvp, window.getSize().x, window.getSize().y);
-    Vector2f screenB = projectPoint(worldPosB, mvp, window.getSize().x, window.getSize().y);
-    Vector2f screenC = projectPoint(worldPosC, mvp, window.getSize().x, window.getSize().y);
+    _drawBuffer.resize(setupVertices.size());
+    if (_drawBuffer.empty()) return;
     
-    sf::Color color = _material ? _material->getDiffuseColor() : sf::Color::White;
+    updateVertexLighting(transform, _lighting ? *_lighting : LightEnvironment::getDefault());
     
-    if (_material) {
-        Vector3f lightDir = Vector3f(0.5f, 0.5f, 1.0f).normalized();
-        Vector3f worldNormal = transform.transformDirection(a.normal).normalized();
-        color = _material->calculateColor(worldPosA, worldNormal, lightDir);
+    for (size_t tri = 0; tri < sourceTriangles.size(); ++tri) {
+        sf::Color flatColor = _vertexColors[_indices[sourceTriangles[tri] * 3]];
+        
+        for (size_t corner = 0; corner < 3; ++corner) {
+            const TriangleSetup::SetupVertex& setupVertex = setupVertices[tri * 3 + corner];
+            sf::Vertex& vertex = _drawBuffer[tri * 3 + corner];
+            vertex.position = sf::Vector2f(setupVertex.screen.x, setupVertex.screen.y);
+            
+            if (!_smoothShading) {
+                vertex.color = flatColor;
+            } else if (setupVertex.from == setupVertex.to) {
+                vertex.color = _vertexColors[setupVertex.from];
+            } else {
+                const sf::Color& c0 = _vertexColors[setupVertex.from];
+                const sf::Color& c1 = _vertexColors[setupVertex.to];
+                float t = setupVertex.t;
+                vertex.color = sf::Color(
+                    static_cast<std::uint8_t>(c0.r + (c1.r - c0.r) * t),
+                    static_cast<std::uint8_t>(c0.g + (c1.g - c0.g) * t),
+                    static_cast<std::uint8_t>(c0.b + (c1.b - c0.b) * t),
+                    static_cast<std::uint8_t>(c0.a + (c1.a - c0.a) * t));
+            }
+        }
     }
+}
+
+void MeshGeometry::updateVertexLighting(const Matrix4x4& transform, const LightEnvironment& lighting) {
+    const Material* material = _material.get();
+    
+    bool cacheHit = _lightingCache.valid &&
+                    _lightingCache.material == material &&
+                    _lightingCache.materialVersion == material->getVersion() &&
+                    _lightingCache.meshVersion == _meshVersion &&
+                    _lightingCache.lighting == &lighting &&
+                    _lightingCache.lightingVersion == lighting.getVersion() &&
+                    std::equal(transform.m, transform.m + 16, _lightingCache.transform.m);
+    
+    if (cacheHit) return;
+    
+    size_t count = _vertices.size();
+    _worldPositions.resize(count);
+    _worldNormals.resize(count);
+    _vertexColors.resize(count);
+    
+    for (size_t i = 0; i < count; ++i) {
+        _worldPositions[i] = transform.transformPoint(_vertices[i].position);
+        _worldNormals[i] = transform.transformDirection(_vertices[i].normal).normalized();
+    }
+    
+    material->shade(_worldNormals.data(), _worldPositions.data(), _vertexColors.data(), count, lighting);
     
-    sf::Vertex triangle[3];
-    triangle[0].position = sf::Vector2f(screenA.x, screenA.y);
-    triangle[0].color = color;
-    triangle[1].position = sf::Vector2f(screenB.x, screenB.y);
-    triangle[1].color = color;
-    triangle[2].position = sf::Vector2f(screenC.x, screenC.y);
-    triangle[2].color = color;
-    window.draw(triangle, 3, sf::PrimitiveType::Triangles);
+    _lightingCache.material = material;
+    _lightingCache.materialVersion = material->getVersion();
+    _lightingCache.meshVersion = _meshVersion;
+    _lightingCache.lighting = &lighting;
+    _lightingCache.lightingVersion = lighting.getVersion();
+    _lightingCache.transform = transform;
+    _lightingCache.valid = true;
 }
 
 std::unique_ptr<MeshGeometry> MeshGeometry::createCube(float size) {
@@ -302,12 +461,12 @@ std::unique_ptr<MeshGeometry> MeshGeometry::createSphere(float radius, int segme
             int next = current + segments + 1;
             
             indices.push_back(current);
-            indices.push_back(next);
             indices.push_back(current + 1);
+            indices.push_back(next);
             
             indices.push_back(current + 1);
-            indices.push_back(next);
             indices.push_back(next + 1);
+            indices.push_back(next);
         }
     }
     
@@ -449,9 +608,9 @@ std::unique_ptr<MeshGeometry> MeshGeometry::loadFromOBJ(const std::string& filen
                 int ti = texIndex.empty() ? -1 : std::stoi(texIndex) - 1;
                 int ni = normIndex.empty() ? -1 : std::stoi(normIndex) - 1;
                 
-                Vector3f pos = (pi >= 0 && pi < positions.size()) ? positions[pi] : Vector3f::zero();
-                Vector2f tex = (ti >= 0 && ti < texCoords.size()) ? texCoords[ti] : Vector2f(0, 0);
-                Vector3f norm = (ni >= 0 && ni < normals.size()) ? normals[ni] : Vector3f::up();
+                Vector3f pos = (pi >= 0 && static_cast<size_t>(pi) < positions.size()) ? positions[pi] : Vector3f::zero();
+                Vector2f tex = (ti >= 0 && static_cast<size_t>(ti) < texCoords.size()) ? texCoords[ti] : Vector2f(0, 0);
+                Vector3f norm = (ni >= 0 && static_cast<size_t>(ni) < normals.size()) ? normals[ni] : Vector3f::up();
                 
                 vertices.emplace_back(pos, norm, tex);
                 return static_cast<unsigned int>(vertices.size() - 1);
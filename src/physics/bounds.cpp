@@ -0,0 +1,119 @@
+#include "physics/bounds.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace SFSim {
+namespace Physics {
+
+bool AABB::contains(const Vector3f& point) const {
+    return point.x >= min.x && point.x <= max.x &&
+           point.y >= min.y && point.y <= max.y &&
+           point.z >= min.z && point.z <= max.z;
+}
+
+bool AABB::contains(const AABB& other) const {
+    return other.min.x >= min.x && other.max.x <= max.x &&
+           other.min.y >= min.y && other.max.y <= max.y &&
+           other.min.z >= min.z && other.max.z <= max.z;
+}
+
+bool AABB::intersects(const AABB& other) const {
+    return !(other.min.x > max.x || other.max.x < min.x ||
+             other.min.y > max.y || other.max.y < min.y ||
+             other.min.z > max.z || other.max.z < min.z);
+}
+
+AABB AABB::merge(const AABB& other) const {
+    return AABB(
+        Vector3f(std::min(min.x, other.min.x), std::min(min.y, other.min.y), std::min(min.z, other.min.z)),
+        Vector3f(std::max(max.x, other.max.x), std::max(max.y, other.max.y), std::max(max.z, other.max.z))
+    );
+}
+
+AABB AABB::transformed(const Matrix4x4& matrix) const {
+    Vector3f center = matrix.transformPointAffine(getCenter());
+    Vector3f e = getExtents();
+    Vector3f extents(
+        std::abs(matrix(0, 0)) * e.x + std::abs(matrix(0, 1)) * e.y + std::abs(matrix(0, 2)) * e.z,
+        std::abs(matrix(1, 0)) * e.x + std::abs(matrix(1, 1)) * e.y + std::abs(matrix(1, 2)) * e.z,
+        std::abs(matrix(2, 0)) * e.x + std::abs(matrix(2, 1)) * e.y + std::abs(matrix(2, 2)) * e.z
+    );
+    return AABB(center - extents, center + extents);
+}
+
+void AABB::expand(const Vector3f& point) {
+    min.x = std::min(min.x, point.x);
+    min.y = std::min(min.y, point.y);
+    min.z = std::min(min.z, point.z);
+    max.x = std::max(max.x, point.x);
+    max.y = std::max(max.y, point.y);
+    max.z = std::max(max.z, point.z);
+}
+
+void AABB::expand(float amount) {
+    Vector3f expansion(amount, amount, amount);
+    min -= expansion;
+    max += expansion;
+}
+
+bool Sphere::contains(const Vector3f& point) const {
+    return (point - center).lengthSquared() <= radius * radius;
+}
+
+bool Sphere::intersects(const Sphere& other) const {
+    float distanceSquared = (center - other.center).lengthSquared();
+    float radiusSum = radius + other.radius;
+    return distanceSquared <= radiusSum * radiusSum;
+}
+
+bool Sphere::intersects(const AABB& aabb) const {
+    Vector3f closest = Vector3f(
+        std::max(aabb.min.x, std::min(center.x, aabb.max.x)),
+        std::max(aabb.min.y, std::min(center.y, aabb.max.y)),
+        std::max(aabb.min.z, std::min(center.z, aabb.max.z))
+    );
+    
+    return (closest - center).lengthSquared() <= radius * radius;
+}
+
+Vector3f Ray::getInverseDirection() const {
+    auto inverse = [](float d) {
+        return std::abs(d) < 1e-20f ? std::copysign(1e20f, d) : 1.0f / d;
+    };
+    return Vector3f(inverse(direction.x), inverse(direction.y), inverse(direction.z));
+}
+
+bool Ray::intersects(const AABB& box, float maxDistance, float& distance) const {
+    return intersects(box, getInverseDirection(), maxDistance, distance);
+}
+
+bool Ray::intersects(const AABB& box, const Vector3f& inverseDirection, float maxDistance, float& distance) const {
+    float tx1 = (box.min.x - origin.x) * inverseDirection.x;
+    float tx2 = (box.max.x - origin.x) * inverseDirection.x;
+    float ty1 = (box.min.y - origin.y) * inverseDirection.y;
+    float ty2 = (box.max.y - origin.y) * inverseDirection.y;
+    float tz1 = (box.min.z - origin.z) * inverseDirection.z;
+    float tz2 = (box.max.z - origin.z) * inverseDirection.z;
+    
+    float tNear = std::max({std::min(tx1, tx2), std::min(ty1, ty2), std::min(tz1, tz2), 0.0f});
+    float tFar = std::min({std::max(tx1, tx2), std::max(ty1, ty2), std::max(tz1, tz2), maxDistance});
+    if (tNear > tFar) return false;
+    
+    distance = tNear;
+    return true;
+}
+
+void RayPacket::add(const Ray& ray, float rayMaxDistance) {
+    Vector3f inverse = ray.getInverseDirection();
+    originX[count] = ray.origin.x;
+    originY[count] = ray.origin.y;
+    originZ[count] = ray.origin.z;
+    inverseX[count] = inverse.x;
+    inverseY[count] = inverse.y;
+    inverseZ[count] = inverse.z;
+    maxDistance[count] = rayMaxDistance;
+    count++;
+}
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
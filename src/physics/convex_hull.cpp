@@ -0,0 +1,381 @@
+#include "physics/convex_hull.hpp"
+#include "math/simd.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+
+namespace SFSim {
+namespace Physics {
+
+namespace {
+
+// A face under construction, with the points still outside it.
+struct Face {
+    unsigned int vertex[3];
+    Vector3f normal;
+    float offset;
+    std::vector<unsigned int> outside;
+    bool live;
+};
+
+uint64_t edgeKey(unsigned int from, unsigned int to) {
+    return (static_cast<uint64_t>(from) << 32) | to;
+}
+
+Face makeFace(const std::vector<Vector3f>& points, unsigned int a, unsigned int b, unsigned int c) {
+    Face face;
+    face.vertex[0] = a;
+    face.vertex[1] = b;
+    face.vertex[2] = c;
+    face.normal = (points[b] - points[a]).cross(points[c] - points[a]).normalized();
+    face.offset = face.normal.dot(points[a]);
+    face.live = true;
+    return face;
+}
+
+float distanceAbove(const Face& face, const Vector3f& point) {
+    return face.normal.dot(point) - face.offset;
+}
+
+} // namespace
+
+ConvexHull::ConvexHull() = default;
+
+void ConvexHull::clear() {
+    _vertices.clear();
+    _x.clear();
+    _y.clear();
+    _z.clear();
+    _indices.clear();
+    _normals.clear();
+    _offsets.clear();
+    _bounds = AABB();
+}
+
+void ConvexHull::setVertices(std::vector<Vector3f> vertices) {
+    _vertices = std::move(vertices);
+    size_t padded = (_vertices.size() + Float4::Width - 1) / Float4::Width * Float4::Width;
+    _x.assign(padded, _vertices[0].x);
+    _y.assign(padded, _vertices[0].y);
+    _z.assign(padded, _vertices[0].z);
+    _bounds = AABB(_vertices[0], _vertices[0]);
+    for (size_t i = 0; i < _vertices.size(); ++i) {
+        _x[i] = _vertices[i].x;
+        _y[i] = _vertices[i].y;
+        _z[i] = _vertices[i].z;
+        _bounds.expand(_vertices[i]);
+    }
+}
+
+void ConvexHull::build(const std::vector<Vector3f>& points) {
+    clear();
+    if (points.empty()) return;
+
+    // Tolerance scaled to the coordinates, so points within rounding of a
+    // face never count as outside it.
+    Vector3f largest = Vector3f::zero();
+    unsigned int extremes[6] = {0, 0, 0, 0, 0, 0};
+    for (unsigned int i = 0; i < points.size(); ++i) {
+        const Vector3f& p = points[i];
+        largest = Vector3f(std::max(largest.x, std::abs(p.x)), std::max(largest.y, std::abs(p.y)), std::max(largest.z, std::abs(p.z)));
+        if (p.x < points[extremes[0]].x) extremes[0] = i;
+        if (p.x > points[extremes[1]].x) extremes[1] = i;
+        if (p.y < points[extremes[2]].y) extremes[2] = i;
+        if (p.y > points[extremes[3]].y) extremes[3] = i;
+        if (p.z < points[extremes[4]].z) extremes[4] = i;
+        if (p.z > points[extremes[5]].z) extremes[5] = i;
+    }
+    const float epsilon = 3.0f * (largest.x + largest.y + largest.z) * std::numeric_limits<float>::epsilon();
+
+    // Starting tetrahedron: the farthest pair of extremes, the point
+    // farthest from their line, then the point farthest from that plane.
+    unsigned int first = extremes[0];
+    unsigned int second = extremes[1];
+    float spread = -1.0f;
+    for (int axis = 0; axis < 3; ++axis) {
+        float length = (points[extremes[axis * 2 + 1]] - points[extremes[axis * 2]]).lengthSquared();
+        if (length > spread) {
+            spread = length;
+            first = extremes[axis * 2];
+            second = extremes[axis * 2 + 1];
+        }
+    }
+
+    unsigned int third = first;
+    unsigned int fourth = first;
+    float farthest = 0.0f;
+    if (std::sqrt(spread) > epsilon) {
+        Vector3f line = points[second] - points[first];
+        for (unsigned int i = 0; i < points.size(); ++i) {
+            float distance = line.cross(points[i] - points[first]).lengthSquared();
+            if (distance > farthest) {
+                farthest = distance;
+                third = i;
+            }
+        }
+        farthest = std::sqrt(farthest) / line.length();
+    }
+    if (farthest > epsilon) {
+        Vector3f normal = (points[second] - points[first]).cross(points[third] - points[first]).normalized();
+        farthest = 0.0f;
+        for (unsigned int i = 0; i < points.size(); ++i) {
+            float distance = std::abs(normal.dot(points[i] - points[first]));
+            if (distance > farthest) {
+                farthest = distance;
+                fourth = i;
+            }
+        }
+    }
+    if (farthest <= epsilon) {
+        setVertices(points);
+        return;
+    }
+
+    std::vector<Face> faces;
+    Vector3f centroid = (points[first] + points[second] + points[third] + points[fourth]) * 0.25f;
+    unsigned int corners[4] = {first, second, third, fourth};
+    for (int i = 0; i < 4; ++i) {
+        unsigned int a = corners[i];
+        unsigned int b = corners[(i + 1) % 4];
+        unsigned int c = corners[(i + 2) % 4];
+        Face face = makeFace(points, a, b, c);
+        if (distanceAbove(face, centroid) > 0.0f) face = makeFace(points, a, c, b);
+        faces.push_back(std::move(face));
+    }
+
+    std::unordered_map<uint64_t, unsigned int> edgeFace;
+    for (unsigned int f = 0; f < faces.size(); ++f) {
+        for (int e = 0; e < 3; ++e) {
+            edgeFace[edgeKey(faces[f].vertex[e], faces[f].vertex[(e + 1) % 3])] = f;
+        }
+    }
+
+    // Each point goes to the face it is farthest above; points inside
+    // every face are done with.
+    auto assign = [&](unsigned int point, size_t firstFace) {
+        float best = epsilon;
+        size_t chosen = faces.size();
+        for (size_t f = firstFace; f < faces.size(); ++f) {
+            float distance = distanceAbove(faces[f], points[point]);
+            if (faces[f].live && distance > best) {
+                best = distance;
+                chosen = f;
+            }
+        }
+        if (chosen < faces.size()) faces[chosen].outside.push_back(point);
+    };
+    for (unsigned int i = 0; i < points.size(); ++i) {
+        if (i != first && i != second && i != third && i != fourth) assign(i, 0);
+    }
+
+    // Faces are only ever appended, and a face's points only go to faces
+    // made after it, so one pass in order handles every face.
+    std::vector<int> visited;
+    std::vector<unsigned int> visible;
+    std::vector<std::pair<unsigned int, unsigned int>> horizon;
+    std::vector<unsigned int> orphans;
+    for (size_t current = 0; current < faces.size(); ++current) {
+        if (!faces[current].live || faces[current].outside.empty()) continue;
+
+        unsigned int eye = faces[current].outside[0];
+        float height = -1.0f;
+        for (unsigned int point : faces[current].outside) {
+            float distance = distanceAbove(faces[current], points[point]);
+            if (distance > height) {
+                height = distance;
+                eye = point;
+            }
+        }
+
+        // Flood out from this face over every face the eye can see; edges
+        // onto faces it can't see make up the horizon. visited holds pass
+        // for visible faces and -pass for ones tested and found hidden.
+        const int pass = static_cast<int>(current) + 1;
+        visited.resize(faces.size(), 0);
+        visible.assign(1, static_cast<unsigned int>(current));
+        horizon.clear();
+        visited[current] = pass;
+        for (size_t i = 0; i < visible.size(); ++i) {
+            const Face& face = faces[visible[i]];
+            for (int e = 0; e < 3; ++e) {
+                unsigned int from = face.vertex[e];
+                unsigned int to = face.vertex[(e + 1) % 3];
+                auto neighbour = edgeFace.find(edgeKey(to, from));
+                if (neighbour == edgeFace.end()) {
+                    horizon.emplace_back(from, to);
+                    continue;
+                }
+                unsigned int other = neighbour->second;
+                if (visited[other] == pass) continue;
+                if (visited[other] != -pass && distanceAbove(faces[other], points[eye]) > epsilon) {
+                    visited[other] = pass;
+                    visible.push_back(other);
+                } else {
+                    visited[other] = -pass;
+                    horizon.emplace_back(from, to);
+                }
+            }
+        }
+
+        orphans.clear();
+        for (unsigned int f : visible) {
+            Face& face = faces[f];
+            face.live = false;
+            for (unsigned int point : face.outside) {
+                if (point != eye) orphans.push_back(point);
+            }
+            face.outside.clear();
+            face.outside.shrink_to_fit();
+            for (int e = 0; e < 3; ++e) {
+                auto edge = edgeFace.find(edgeKey(face.vertex[e], face.vertex[(e + 1) % 3]));
+                if (edge != edgeFace.end() && edge->second == f) edgeFace.erase(edge);
+            }
+        }
+
+        // Each horizon edge keeps its winding, so the new faces face out.
+        size_t firstNew = faces.size();
+        for (const auto& edge : horizon) {
+            unsigned int f = static_cast<unsigned int>(faces.size());
+            faces.push_back(makeFace(points, edge.first, edge.second, eye));
+            edgeFace[edgeKey(edge.first, edge.second)] = f;
+            edgeFace[edgeKey(edge.second, eye)] = f;
+            edgeFace[edgeKey(eye, edge.first)] = f;
+        }
+        for (unsigned int point : orphans) {
+            assign(point, firstNew);
+        }
+    }
+
+    // Keep only the points the live faces use, renumbered in order.
+    std::vector<unsigned int> remap(points.size(), std::numeric_limits<unsigned int>::max());
+    std::vector<Vector3f> vertices;
+    for (const Face& face : faces) {
+        if (!face.live) continue;
+        for (unsigned int vertex : face.vertex) {
+            if (remap[vertex] == std::numeric_limits<unsigned int>::max()) {
+                remap[vertex] = static_cast<unsigned int>(vertices.size());
+                vertices.push_back(points[vertex]);
+            }
+            _indices.push_back(remap[vertex]);
+        }
+        _normals.push_back(face.normal);
+        _offsets.push_back(face.offset);
+    }
+    setVertices(std::move(vertices));
+}
+
+Vector3f ConvexHull::support(const Vector3f& direction) const {
+    if (_vertices.empty()) return Vector3f::zero();
+
+    // Find the largest dot product first, with two running maxima so the
+    // loop isn't bound by one dependency chain, then stop at the first
+    // group holding it: max is far cheaper to chain than tracking indices.
+    const Float4 dx(direction.x);
+    const Float4 dy(direction.y);
+    const Float4 dz(direction.z);
+    auto dots = [&](size_t i) {
+        return Float4::load(&_x[i]) * dx + Float4::load(&_y[i]) * dy + Float4::load(&_z[i]) * dz;
+    };
+
+    Float4 best0(-std::numeric_limits<float>::max());
+    Float4 best1 = best0;
+    size_t i = 0;
+    for (; i + Float4::Width * 2 <= _x.size(); i += Float4::Width * 2) {
+        best0 = Float4::max(best0, dots(i));
+        best1 = Float4::max(best1, dots(i + Float4::Width));
+    }
+    if (i < _x.size()) best0 = Float4::max(best0, dots(i));
+
+    float lanes[Float4::Width];
+    Float4::max(best0, best1).store(lanes);
+    float best = lanes[0];
+    for (int lane = 1; lane < Float4::Width; ++lane) best = std::max(best, lanes[lane]);
+
+    const Float4 target(best);
+    for (i = 0; i < _x.size(); i += Float4::Width) {
+        int mask = (dots(i) >= target).movemask();
+        if (mask) {
+            int lane = 0;
+            while (!(mask & (1 << lane))) ++lane;
+            return _vertices[std::min(i + lane, _vertices.size() - 1)];
+        }
+    }
+    return _vertices[0];
+}
+
+bool ConvexHull::raycast(const Ray& ray, float maxDistance, Hit& hit) const {
+    // Clip the ray against every face's half-space; the last plane it
+    // enters through is where it meets the hull, and the first it leaves
+    // through is where a ray starting inside does.
+    float enter = -std::numeric_limits<float>::max();
+    float exit = std::numeric_limits<float>::max();
+    int entered = -1;
+    int exited = -1;
+    for (size_t f = 0; f < _normals.size(); ++f) {
+        float above = _normals[f].dot(ray.origin) - _offsets[f];
+        float approach = _normals[f].dot(ray.direction);
+        if (std::abs(approach) < 1e-20f) {
+            if (above > 0.0f) return false;
+            continue;
+        }
+        float t = -above / approach;
+        if (approach < 0.0f) {
+            if (t > enter) {
+                enter = t;
+                entered = static_cast<int>(f);
+            }
+        } else if (t < exit) {
+            exit = t;
+            exited = static_cast<int>(f);
+        }
+        if (enter > exit) return false;
+    }
+    int face = enter >= 0.0f ? entered : exited;
+    float distance = enter >= 0.0f ? enter : exit;
+    if (face < 0 || exit <= 0.0f || distance >= maxDistance) return false;
+
+    // Flat sides of the hull are split into several coplanar triangles,
+    // and the clip only tells us the plane, so report whichever triangle
+    // on that plane actually contains the hit point - or, if rounding
+    // leaves it just outside all of them, the one it is closest to being
+    // inside.
+    Vector3f p = ray.getPoint(distance);
+    float bestInside = -std::numeric_limits<float>::max();
+    int bestFace = face;
+    Vector3f bestBarycentric(1.0f, 0.0f, 0.0f);
+    float planeTolerance = 1e-4f * (1.0f + std::abs(_offsets[face]));
+    for (size_t f = 0; f < _normals.size(); ++f) {
+        if (_normals[f].dot(_normals[face]) < 1.0f - 1e-4f ||
+            std::abs(_offsets[f] - _offsets[face]) > planeTolerance) continue;
+        const Vector3f& a = _vertices[_indices[f * 3]];
+        const Vector3f& b = _vertices[_indices[f * 3 + 1]];
+        const Vector3f& c = _vertices[_indices[f * 3 + 2]];
+        Vector3f normal = (b - a).cross(c - a);
+        float area = normal.lengthSquared();
+        if (area <= 0.0f) continue;
+        float u = normal.dot((c - b).cross(p - b)) / area;
+        float v = normal.dot((a - c).cross(p - c)) / area;
+        float inside = std::min(std::min(u, v), 1.0f - u - v);
+        if (inside > bestInside) {
+            bestInside = inside;
+            bestFace = static_cast<int>(f);
+            bestBarycentric = Vector3f(u, v, 1.0f - u - v);
+            if (inside >= 0.0f) break;
+        }
+    }
+
+    const Vector3f& a = _vertices[_indices[bestFace * 3]];
+    const Vector3f& b = _vertices[_indices[bestFace * 3 + 1]];
+    const Vector3f& c = _vertices[_indices[bestFace * 3 + 2]];
+
+    hit.distance = distance;
+    hit.triangle = static_cast<unsigned int>(bestFace);
+    hit.barycentric = bestBarycentric;
+    hit.normal = (b - a).cross(c - a);
+    return true;
+}
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
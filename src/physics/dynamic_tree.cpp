@@ -0,0 +1,264 @@
+#include "physics/dynamic_tree.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace SFSim {
+namespace Physics {
+
+DynamicAABBTree::DynamicAABBTree()
+    : _root(NullNode)
+    , _freeList(NullNode)
+    , _proxyCount(0)
+    , _margin(0.1f)
+{
+}
+
+int DynamicAABBTree::createProxy(const AABB& bounds, void* userData, uint32_t layers) {
+    int leaf = allocateNode();
+    Node& node = _nodes[leaf];
+    node.bounds = bounds;
+    node.bounds.expand(_margin);
+    node.userData = userData;
+    node.height = 0;
+    node.layers = layers;
+
+    insertLeaf(leaf);
+    _proxyCount++;
+    return leaf;
+}
+
+void DynamicAABBTree::destroyProxy(int proxyId) {
+    removeLeaf(proxyId);
+    freeNode(proxyId);
+    _proxyCount--;
+}
+
+bool DynamicAABBTree::moveProxy(int proxyId, const AABB& bounds, const Vector3f& displacement) {
+    if (_nodes[proxyId].bounds.contains(bounds)) {
+        return false;
+    }
+
+    removeLeaf(proxyId);
+
+    // Stretch the new fat box in the direction of travel so steadily moving
+    // objects stay inside it for a few more steps.
+    AABB fat = bounds;
+    fat.expand(_margin);
+    Vector3f predicted = displacement * 2.0f;
+    if (predicted.x < 0) fat.min.x += predicted.x; else fat.max.x += predicted.x;
+    if (predicted.y < 0) fat.min.y += predicted.y; else fat.max.y += predicted.y;
+    if (predicted.z < 0) fat.min.z += predicted.z; else fat.max.z += predicted.z;
+    _nodes[proxyId].bounds = fat;
+
+    insertLeaf(proxyId);
+    return true;
+}
+
+void DynamicAABBTree::setProxyLayers(int proxyId, uint32_t layers) {
+    if (_nodes[proxyId].layers == layers) return;
+    
+    _nodes[proxyId].layers = layers;
+    for (int index = _nodes[proxyId].parent; index != NullNode; index = _nodes[index].parent) {
+        Node& node = _nodes[index];
+        node.layers = _nodes[node.child1].layers | _nodes[node.child2].layers;
+    }
+}
+
+void DynamicAABBTree::clear() {
+    _nodes.clear();
+    _root = NullNode;
+    _freeList = NullNode;
+    _proxyCount = 0;
+}
+
+int DynamicAABBTree::allocateNode() {
+    int id;
+    if (_freeList != NullNode) {
+        id = _freeList;
+        _freeList = _nodes[id].parent;
+    } else {
+        id = static_cast<int>(_nodes.size());
+        _nodes.emplace_back();
+    }
+
+    Node& node = _nodes[id];
+    node.userData = nullptr;
+    node.parent = NullNode;
+    node.child1 = NullNode;
+    node.child2 = NullNode;
+    node.height = 0;
+    return id;
+}
+
+void DynamicAABBTree::freeNode(int node) {
+    _nodes[node].parent = _freeList;
+    _nodes[node].height = -1;
+    _freeList = node;
+}
+
+void DynamicAABBTree::insertLeaf(int leaf) {
+    if (_root == NullNode) {
+        _root = leaf;
+        _nodes[leaf].parent = NullNode;
+        return;
+    }
+
+    // Walk down towards the sibling that minimises the added surface area.
+    AABB leafBounds = _nodes[leaf].bounds;
+    int index = _root;
+    while (!_nodes[index].isLeaf()) {
+        const Node& node = _nodes[index];
+
+        float area = node.bounds.getSurfaceArea();
+        float combinedArea = node.bounds.merge(leafBounds).getSurfaceArea();
+
+        // Cost of pairing with this node, and the cost every descendant
+        // pays for enlarging it.
+        float cost = 2.0f * combinedArea;
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        auto descendCost = [&](int child) {
+            const Node& c = _nodes[child];
+            float enlarged = c.bounds.merge(leafBounds).getSurfaceArea();
+            return c.isLeaf() ? enlarged + inheritanceCost
+                              : (enlarged - c.bounds.getSurfaceArea()) + inheritanceCost;
+        };
+
+        float cost1 = descendCost(node.child1);
+        float cost2 = descendCost(node.child2);
+
+        if (cost < cost1 && cost < cost2) break;
+        index = cost1 < cost2 ? node.child1 : node.child2;
+    }
+
+    int sibling = index;
+    int oldParent = _nodes[sibling].parent;
+    int newParent = allocateNode();
+    _nodes[newParent].parent = oldParent;
+    _nodes[newParent].bounds = leafBounds.merge(_nodes[sibling].bounds);
+    _nodes[newParent].layers = _nodes[leaf].layers | _nodes[sibling].layers;
+    _nodes[newParent].height = _nodes[sibling].height + 1;
+    _nodes[newParent].child1 = sibling;
+    _nodes[newParent].child2 = leaf;
+    _nodes[sibling].parent = newParent;
+    _nodes[leaf].parent = newParent;
+
+    if (oldParent != NullNode) {
+        if (_nodes[oldParent].child1 == sibling) {
+            _nodes[oldParent].child1 = newParent;
+        } else {
+            _nodes[oldParent].child2 = newParent;
+        }
+    } else {
+        _root = newParent;
+    }
+
+    // Refit ancestors, rotating where the subtrees got out of balance.
+    index = _nodes[leaf].parent;
+    while (index != NullNode) {
+        index = balance(index);
+
+        Node& node = _nodes[index];
+        refit(node);
+        index = node.parent;
+    }
+}
+
+void DynamicAABBTree::removeLeaf(int leaf) {
+    if (leaf == _root) {
+        _root = NullNode;
+        return;
+    }
+
+    int parent = _nodes[leaf].parent;
+    int grandParent = _nodes[parent].parent;
+    int sibling = _nodes[parent].child1 == leaf ? _nodes[parent].child2 : _nodes[parent].child1;
+
+    if (grandParent == NullNode) {
+        _root = sibling;
+        _nodes[sibling].parent = NullNode;
+        freeNode(parent);
+        return;
+    }
+
+    if (_nodes[grandParent].child1 == parent) {
+        _nodes[grandParent].child1 = sibling;
+    } else {
+        _nodes[grandParent].child2 = sibling;
+    }
+    _nodes[sibling].parent = grandParent;
+    freeNode(parent);
+
+    int index = grandParent;
+    while (index != NullNode) {
+        index = balance(index);
+
+        Node& node = _nodes[index];
+        refit(node);
+        index = node.parent;
+    }
+}
+
+// Promotes the taller grandchild when the children's heights differ by more
+// than one. Returns the index now at this node's position.
+int DynamicAABBTree::balance(int iA) {
+    Node& A = _nodes[iA];
+    if (A.isLeaf() || A.height < 2) {
+        return iA;
+    }
+
+    int iB = A.child1;
+    int iC = A.child2;
+    int difference = _nodes[iC].height - _nodes[iB].height;
+
+    if (difference == 0 || std::abs(difference) == 1) {
+        return iA;
+    }
+
+    // Rotate the taller child (up) into A's place; A takes one of its children.
+    int iUp = difference > 0 ? iC : iB;
+    Node& up = _nodes[iUp];
+    int iF = up.child1;
+    int iG = up.child2;
+
+    up.child1 = iA;
+    up.parent = A.parent;
+    A.parent = iUp;
+
+    if (up.parent != NullNode) {
+        if (_nodes[up.parent].child1 == iA) {
+            _nodes[up.parent].child1 = iUp;
+        } else {
+            _nodes[up.parent].child2 = iUp;
+        }
+    } else {
+        _root = iUp;
+    }
+
+    int iKeep = _nodes[iF].height > _nodes[iG].height ? iF : iG;
+    int iGive = iKeep == iF ? iG : iF;
+
+    up.child2 = iKeep;
+    if (difference > 0) {
+        A.child2 = iGive;
+    } else {
+        A.child1 = iGive;
+    }
+    _nodes[iGive].parent = iA;
+
+    refit(A);
+    refit(up);
+
+    return iUp;
+}
+
+void DynamicAABBTree::refit(Node& node) {
+    const Node& child1 = _nodes[node.child1];
+    const Node& child2 = _nodes[node.child2];
+    node.bounds = child1.bounds.merge(child2.bounds);
+    node.height = 1 + std::max(child1.height, child2.height);
+    node.layers = child1.layers | child2.layers;
+}
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
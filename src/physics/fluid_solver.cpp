@@ -0,0 +1,223 @@
+#include "physics/fluid_solver.hpp"
+#include "core/thread_pool.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace SFSim {
+namespace Physics {
+
+namespace {
+
+constexpr size_t StepGrain = 4096;
+constexpr float Pi = 3.14159265358979f;
+
+// A container wall acts as fluid at rest density filling the half-space
+// beyond it. Integrated over that half-space, the kernels come out as
+// polynomials in u, the distance to the wall in smoothing radii: the share
+// of the poly6 kernel's weight beyond the wall, how fast that share falls
+// away from it (times h), and the viscosity kernel's integral (times h^2).
+float wallDensity(float u) {
+    float u3 = u * u * u;
+    float beyond = 16.0f / 315.0f - (u3 / 3.0f - 3.0f * u3 * u * u / 5.0f + 3.0f * u3 * u3 * u / 7.0f - u3 * u3 * u3 / 9.0f);
+    float falloff = 1.0f - u * u;
+    return 315.0f / 32.0f * (beyond - u * falloff * falloff * falloff * falloff / 8.0f);
+}
+
+float wallDensityGradient(float u) {
+    float falloff = 1.0f - u * u;
+    return 315.0f / 256.0f * falloff * falloff * falloff * falloff;
+}
+
+float wallViscosity(float u) {
+    float falloff = 1.0f - u;
+    return 7.5f * falloff * falloff * falloff * (1.0f + u);
+}
+
+// Calls wall(normal, distance) for every side of the box within range of
+// position, with the normal pointing into the box.
+template<typename Callback>
+void forEachWall(const AABB& box, const Vector3f& position, float range, Callback wall) {
+    if (position.x - box.min.x < range) wall(Vector3f(1, 0, 0), std::max(0.0f, position.x - box.min.x));
+    if (box.max.x - position.x < range) wall(Vector3f(-1, 0, 0), std::max(0.0f, box.max.x - position.x));
+    if (position.y - box.min.y < range) wall(Vector3f(0, 1, 0), std::max(0.0f, position.y - box.min.y));
+    if (box.max.y - position.y < range) wall(Vector3f(0, -1, 0), std::max(0.0f, box.max.y - position.y));
+    if (position.z - box.min.z < range) wall(Vector3f(0, 0, 1), std::max(0.0f, position.z - box.min.z));
+    if (box.max.z - position.z < range) wall(Vector3f(0, 0, -1), std::max(0.0f, box.max.z - position.z));
+}
+
+} // namespace
+
+FluidSolver::FluidSolver()
+    : _smoothingRadius(0.1f)
+    , _restDensity(1000.0f)
+    , _particleMass(0.125f)
+    , _stiffness(200.0f)
+    , _viscosity(5.0f)
+    , _timeStep(1.0f / 480.0f)
+    , _maxSteps(8)
+    , _accumulator(0.0f)
+{
+}
+
+float FluidSolver::getParticleSpacing() const {
+    return std::cbrt(_particleMass / _restDensity);
+}
+
+size_t FluidSolver::spawnBlock(ParticleWorld& world, const AABB& box, float lifetime, std::uint32_t color) const {
+    float spacing = getParticleSpacing();
+    Vector3f size = box.getSize();
+    int countX = std::max(1, static_cast<int>(size.x / spacing));
+    int countY = std::max(1, static_cast<int>(size.y / spacing));
+    int countZ = std::max(1, static_cast<int>(size.z / spacing));
+
+    // Centered in the box, so the margin left over is even on both sides.
+    Vector3f start = box.getCenter() - Vector3f(static_cast<float>(countX - 1), static_cast<float>(countY - 1), static_cast<float>(countZ - 1)) * (spacing * 0.5f);
+    size_t spawned = 0;
+    for (int y = 0; y < countY; ++y) {
+        for (int z = 0; z < countZ; ++z) {
+            for (int x = 0; x < countX; ++x) {
+                Vector3f position = start + Vector3f(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)) * spacing;
+                if (world.spawn(position, Vector3f::zero(), lifetime, color) == world.size()) return spawned;
+                ++spawned;
+            }
+        }
+    }
+    return spawned;
+}
+
+int FluidSolver::update(ParticleWorld& world, float deltaTime) {
+    _accumulator += deltaTime;
+    int steps = 0;
+    while (_accumulator >= _timeStep && steps < _maxSteps) {
+        _accumulator -= _timeStep;
+        step(world);
+        ++steps;
+    }
+    if (steps == _maxSteps) {
+        _accumulator = std::min(_accumulator, _timeStep);
+    }
+    return steps;
+}
+
+void FluidSolver::step(ParticleWorld& world) {
+    size_t count = world.size();
+    if (count == 0) {
+        world.update(_timeStep);
+        return;
+    }
+
+    _grid.setCellSize(_smoothingRadius);
+    _grid.setParallelThreshold(world.getParallelThreshold());
+    _grid.build(world.getPositionX(), world.getPositionY(), world.getPositionZ(), count);
+    world.reorder(_grid.getSortedIndices());
+
+    _density.resize(count);
+    _pressure.resize(count);
+    _inverseDensity.resize(count);
+    _pressureTerm.resize(count);
+    _accelerationX.resize(count);
+    _accelerationY.resize(count);
+    _accelerationZ.resize(count);
+
+    size_t threshold = world.getParallelThreshold();
+    bool parallel = Core::ThreadPool::exceedsThreshold(count, threshold);
+
+    // Densities have to be complete before any pressure force is.
+    Core::ThreadPool::parallelForIf(parallel, count, StepGrain, [&](size_t begin, size_t end) { computeDensities(world, begin, end); });
+    Core::ThreadPool::parallelForIf(parallel, count, StepGrain, [&](size_t begin, size_t end) { computeAccelerations(world, begin, end); });
+
+    float dt = _timeStep;
+    Core::ThreadPool::parallelForIf(parallel, count, StepGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            Vector3f acceleration(_accelerationX[i], _accelerationY[i], _accelerationZ[i]);
+            world.setVelocity(i, world.getVelocity(i) + acceleration * dt);
+        }
+    });
+
+    world.update(dt);
+}
+
+void FluidSolver::computeDensities(const ParticleWorld& world, size_t begin, size_t end) {
+    float h = _smoothingRadius;
+    float hSquared = h * h;
+    float poly6 = 315.0f / (64.0f * Pi * std::pow(h, 9.0f));
+
+    for (size_t i = begin; i < end; ++i) {
+        float sum = 0.0f;
+        _grid.forEachNeighbor(i, h, true, [&](size_t, float distanceSquared) {
+            float falloff = hSquared - distanceSquared;
+            sum += falloff * falloff * falloff;
+        });
+        float density = _particleMass * poly6 * sum;
+        if (world.hasContainer()) {
+            forEachWall(world.getContainer(), _grid.getSortedPosition(i), h, [&](const Vector3f&, float distance) {
+                density += _restDensity * wallDensity(distance / h);
+            });
+        }
+        _density[i] = density;
+        // Below the rest density (at the surface, mostly) the fluid would
+        // pull itself into clumps; it just doesn't push instead.
+        float pressure = _stiffness * std::max(0.0f, density - _restDensity);
+        _pressure[i] = pressure;
+        // What the force pass needs of every neighbor, worked out once.
+        _inverseDensity[i] = 1.0f / density;
+        _pressureTerm[i] = pressure / (density * density);
+    }
+}
+
+void FluidSolver::computeAccelerations(const ParticleWorld& world, size_t begin, size_t end) {
+    float h = _smoothingRadius;
+    // Both the spiky gradient and the viscosity Laplacian share this.
+    float scale = 45.0f / (Pi * std::pow(h, 6.0f));
+    const float* velocityX = world.getVelocityX();
+    const float* velocityY = world.getVelocityY();
+    const float* velocityZ = world.getVelocityZ();
+    const float* positionX = _grid.getSortedX();
+    const float* positionY = _grid.getSortedY();
+    const float* positionZ = _grid.getSortedZ();
+    const float* inverseDensity = _inverseDensity.data();
+    // Pressure over density squared, which the symmetric form of the
+    // pressure force sums over each pair.
+    const float* pressureTerm = _pressureTerm.data();
+
+    // The world is in grid order, so sorted positions and particle indices
+    // are one and the same.
+    for (size_t i = begin; i < end; ++i) {
+        Vector3f position(positionX[i], positionY[i], positionZ[i]);
+        Vector3f velocity(velocityX[i], velocityY[i], velocityZ[i]);
+        float ownTerm = pressureTerm[i];
+        Vector3f pressureSum = Vector3f::zero();
+        Vector3f viscositySum = Vector3f::zero();
+
+        _grid.forEachNeighbor(i, h, false, [&](size_t j, float distanceSquared) {
+            float distance = std::sqrt(distanceSquared);
+            float falloff = h - distance;
+
+            // Particles on top of each other get pushed apart along x, each
+            // the opposite way.
+            Vector3f offset(position.x - positionX[j], position.y - positionY[j], position.z - positionZ[j]);
+            Vector3f direction = distance > 1e-6f ? offset * (1.0f / distance) : Vector3f(i < j ? 1.0f : -1.0f, 0.0f, 0.0f);
+            pressureSum += direction * ((ownTerm + pressureTerm[j]) * falloff * falloff);
+            Vector3f relative(velocityX[j] - velocity.x, velocityY[j] - velocity.y, velocityZ[j] - velocity.z);
+            viscositySum += relative * (inverseDensity[j] * falloff);
+        });
+
+        Vector3f acceleration = pressureSum * (_particleMass * scale) + viscositySum * (_viscosity * _particleMass * scale * inverseDensity[i]);
+        // Pressure from the fluid beyond a wall is the gradient of what it
+        // adds to the density, and its viscosity holds particles to the
+        // wall's rest.
+        if (world.hasContainer()) {
+            forEachWall(world.getContainer(), position, h, [&](const Vector3f& normal, float distance) {
+                float u = distance / h;
+                acceleration += normal * (ownTerm * _restDensity / h * wallDensityGradient(u));
+                acceleration -= velocity * (_viscosity * inverseDensity[i] / (h * h) * wallViscosity(u));
+            });
+        }
+        _accelerationX[i] = acceleration.x;
+        _accelerationY[i] = acceleration.y;
+        _accelerationZ[i] = acceleration.z;
+    }
+}
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
@@ -0,0 +1,514 @@
+#include "physics/gjk.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace SFSim {
+namespace Physics {
+
+namespace {
+
+constexpr int MaxIterations = 32;
+// GJK stops once an iteration gets no closer than this fraction of the
+// squared distance.
+constexpr float RelativeTolerance = 1e-5f;
+// Cores closer than this overlap as far as GJK is concerned; EPA takes over.
+constexpr float CoreContact = 1e-5f;
+
+constexpr int MaxPolytopeVertices = 64;
+constexpr int MaxPolytopeFaces = 128;
+constexpr float PolytopeTolerance = 1e-4f;
+
+// A point of the Minkowski difference a - b and the points of a and b it
+// came from, which give the closest points back.
+struct SupportPoint {
+    Vector3f w;
+    Vector3f a;
+    Vector3f b;
+};
+
+SupportPoint supportOf(const ConvexShape& a, const ConvexShape& b, const Vector3f& direction) {
+    SupportPoint point;
+    point.a = a.support(direction);
+    point.b = b.support(-direction);
+    point.w = point.a - point.b;
+    return point;
+}
+
+// Up to four support points and the weights of the closest point to the
+// origin on their hull.
+struct Simplex {
+    SupportPoint points[4];
+    float weights[4];
+    int count;
+
+    void keep(std::initializer_list<std::pair<int, float>> kept) {
+        SupportPoint chosen[4];
+        float chosenWeights[4];
+        int n = 0;
+        for (const auto& k : kept) {
+            chosen[n] = points[k.first];
+            chosenWeights[n++] = k.second;
+        }
+        for (int i = 0; i < n; ++i) {
+            points[i] = chosen[i];
+            weights[i] = chosenWeights[i];
+        }
+        count = n;
+    }
+
+    Vector3f closest() const {
+        Vector3f v = Vector3f::zero();
+        for (int i = 0; i < count; ++i) v += points[i].w * weights[i];
+        return v;
+    }
+};
+
+void reduceSegment(Simplex& s, int i, int j) {
+    Vector3f a = s.points[i].w;
+    Vector3f ab = s.points[j].w - a;
+    float length = ab.lengthSquared();
+    float t = length > 0.0f ? -a.dot(ab) / length : 0.0f;
+    if (t <= 0.0f) {
+        s.keep({{i, 1.0f}});
+    } else if (t >= 1.0f) {
+        s.keep({{j, 1.0f}});
+    } else {
+        s.keep({{i, 1.0f - t}, {j, t}});
+    }
+}
+
+// Closest point to the origin on triangle ijk, by Voronoi regions (Ericson,
+// Real-Time Collision Detection 5.1.5).
+void reduceTriangle(Simplex& s, int i, int j, int k) {
+    Vector3f a = s.points[i].w;
+    Vector3f b = s.points[j].w;
+    Vector3f c = s.points[k].w;
+    Vector3f ab = b - a;
+    Vector3f ac = c - a;
+
+    float d1 = -ab.dot(a);
+    float d2 = -ac.dot(a);
+    if (d1 <= 0.0f && d2 <= 0.0f) { s.keep({{i, 1.0f}}); return; }
+
+    float d3 = -ab.dot(b);
+    float d4 = -ac.dot(b);
+    if (d3 >= 0.0f && d4 <= d3) { s.keep({{j, 1.0f}}); return; }
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+        float t = d1 / (d1 - d3);
+        s.keep({{i, 1.0f - t}, {j, t}});
+        return;
+    }
+
+    float d5 = -ab.dot(c);
+    float d6 = -ac.dot(c);
+    if (d6 >= 0.0f && d5 <= d6) { s.keep({{k, 1.0f}}); return; }
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+        float t = d2 / (d2 - d6);
+        s.keep({{i, 1.0f - t}, {k, t}});
+        return;
+    }
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+        float t = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        s.keep({{j, 1.0f - t}, {k, t}});
+        return;
+    }
+
+    float denominator = 1.0f / (va + vb + vc);
+    float v = vb * denominator;
+    float w = vc * denominator;
+    s.keep({{i, 1.0f - v - w}, {j, v}, {k, w}});
+}
+
+// False when the tetrahedron contains the origin.
+bool reduceTetrahedron(Simplex& s) {
+    static const int faces[4][4] = {{0, 1, 2, 3}, {0, 2, 3, 1}, {0, 3, 1, 2}, {1, 3, 2, 0}};
+
+    Simplex best = s;
+    float bestDistance = std::numeric_limits<float>::max();
+    bool outside = false;
+    for (const auto& face : faces) {
+        Vector3f a = s.points[face[0]].w;
+        Vector3f normal = (s.points[face[1]].w - a).cross(s.points[face[2]].w - a);
+        float opposite = normal.dot(s.points[face[3]].w - a);
+        float origin = -normal.dot(a);
+        // The origin is outside this face if it lies across the face's
+        // plane from the fourth point.
+        if (origin * opposite >= 0.0f && opposite != 0.0f) continue;
+
+        Simplex candidate = s;
+        reduceTriangle(candidate, face[0], face[1], face[2]);
+        float distance = candidate.closest().lengthSquared();
+        if (distance < bestDistance) {
+            bestDistance = distance;
+            best = candidate;
+        }
+        outside = true;
+    }
+    if (outside) s = best;
+    return outside;
+}
+
+// Reduces the simplex to the smallest one whose hull holds the point
+// closest to the origin. False when the origin is inside.
+bool reduce(Simplex& s) {
+    switch (s.count) {
+        case 1:
+            s.weights[0] = 1.0f;
+            return true;
+        case 2:
+            reduceSegment(s, 0, 1);
+            return true;
+        case 3:
+            reduceTriangle(s, 0, 1, 2);
+            return true;
+        default:
+            return reduceTetrahedron(s);
+    }
+}
+
+void surfacePoints(const Simplex& s, Vector3f& pointA, Vector3f& pointB) {
+    pointA = Vector3f::zero();
+    pointB = Vector3f::zero();
+    for (int i = 0; i < s.count; ++i) {
+        pointA += s.points[i].a * s.weights[i];
+        pointB += s.points[i].b * s.weights[i];
+    }
+}
+
+// Grows the simplex GJK stopped with into a tetrahedron with the origin
+// on or inside it. False when the Minkowski difference is flat (a point
+// core on a segment core, say) and there is no volume to grow into.
+bool growTetrahedron(const ConvexShape& a, const ConvexShape& b, Simplex& s) {
+    const Vector3f axes[3] = {Vector3f(1, 0, 0), Vector3f(0, 1, 0), Vector3f(0, 0, 1)};
+    const float tolerance = 1e-6f;
+
+    if (s.count == 1) {
+        for (int i = 0; i < 6 && s.count == 1; ++i) {
+            SupportPoint p = supportOf(a, b, i < 3 ? axes[i] : -axes[i - 3]);
+            if ((p.w - s.points[0].w).lengthSquared() > tolerance * tolerance) s.points[s.count++] = p;
+        }
+        if (s.count == 1) return false;
+    }
+
+    if (s.count == 2) {
+        Vector3f line = s.points[1].w - s.points[0].w;
+        Vector3f least = std::abs(line.x) < std::abs(line.y) ? (std::abs(line.x) < std::abs(line.z) ? axes[0] : axes[2])
+                                                             : (std::abs(line.y) < std::abs(line.z) ? axes[1] : axes[2]);
+        Vector3f side = line.cross(least);
+        Vector3f other = line.cross(side);
+        const Vector3f directions[4] = {side, -side, other, -other};
+        for (int i = 0; i < 4 && s.count == 2; ++i) {
+            SupportPoint p = supportOf(a, b, directions[i]);
+            if (line.cross(p.w - s.points[0].w).lengthSquared() > tolerance * tolerance * line.lengthSquared()) s.points[s.count++] = p;
+        }
+        if (s.count == 2) return false;
+    }
+
+    if (s.count == 3) {
+        Vector3f normal = (s.points[1].w - s.points[0].w).cross(s.points[2].w - s.points[0].w);
+        float length = normal.length();
+        if (length <= 0.0f) return false;
+        for (float sign : {1.0f, -1.0f}) {
+            SupportPoint p = supportOf(a, b, normal * sign);
+            if (std::abs(normal.dot(p.w - s.points[0].w)) > tolerance * length) {
+                s.points[s.count++] = p;
+                break;
+            }
+        }
+        if (s.count == 3) return false;
+    }
+    return true;
+}
+
+struct PolytopeFace {
+    int vertex[3];
+    Vector3f normal;
+    float distance;
+    bool live;
+};
+
+// Expands the tetrahedron over the Minkowski difference until the face
+// nearest the origin is on its boundary: that face's normal and distance
+// are the penetration. Returns the face's normal, depth, and the points of
+// a and b behind the origin's projection onto it.
+void expandPolytope(const ConvexShape& a, const ConvexShape& b, const Simplex& s,
+                    Vector3f& normal, float& depth, Vector3f& pointA, Vector3f& pointB) {
+    SupportPoint vertices[MaxPolytopeVertices];
+    PolytopeFace faces[MaxPolytopeFaces];
+    int vertexCount = 4;
+    int faceCount = 0;
+    for (int i = 0; i < 4; ++i) vertices[i] = s.points[i];
+
+    auto addFace = [&](int i, int j, int k) {
+        if (faceCount == MaxPolytopeFaces) return false;
+        PolytopeFace& face = faces[faceCount++];
+        face.vertex[0] = i;
+        face.vertex[1] = j;
+        face.vertex[2] = k;
+        Vector3f n = (vertices[j].w - vertices[i].w).cross(vertices[k].w - vertices[i].w);
+        float length = n.length();
+        face.live = length > 1e-12f;
+        face.normal = face.live ? n / length : Vector3f::up();
+        face.distance = face.normal.dot(vertices[i].w);
+        return true;
+    };
+
+    // Wind the tetrahedron's faces away from the opposite corner.
+    static const int tetrahedron[4][4] = {{0, 1, 2, 3}, {0, 3, 1, 2}, {0, 2, 3, 1}, {1, 3, 2, 0}};
+    for (const auto& f : tetrahedron) {
+        Vector3f n = (vertices[f[1]].w - vertices[f[0]].w).cross(vertices[f[2]].w - vertices[f[0]].w);
+        if (n.dot(vertices[f[3]].w - vertices[f[0]].w) > 0.0f) {
+            addFace(f[0], f[2], f[1]);
+        } else {
+            addFace(f[0], f[1], f[2]);
+        }
+    }
+
+    int closest = 0;
+    std::pair<int, int> edges[MaxPolytopeFaces * 3];
+    while (true) {
+        closest = -1;
+        for (int i = 0; i < faceCount; ++i) {
+            if (faces[i].live && (closest < 0 || faces[i].distance < faces[closest].distance)) closest = i;
+        }
+        if (closest < 0) break;
+
+        const PolytopeFace& nearest = faces[closest];
+        SupportPoint p = supportOf(a, b, nearest.normal);
+        float reach = p.w.dot(nearest.normal);
+        if (reach - nearest.distance <= PolytopeTolerance * std::max(1.0f, nearest.distance) ||
+            vertexCount == MaxPolytopeVertices) break;
+
+        // Every face the new point sees goes; the edges they don't share
+        // with each other form the horizon to close up with new faces.
+        bool sees[MaxPolytopeFaces];
+        int liveCount = 0;
+        int seenCount = 0;
+        int edgeCount = 0;
+        for (int i = 0; i < faceCount; ++i) {
+            const PolytopeFace& face = faces[i];
+            sees[i] = face.live && face.normal.dot(p.w - vertices[face.vertex[0]].w) > 0.0f;
+            if (face.live) ++liveCount;
+            if (!sees[i]) continue;
+            ++seenCount;
+            for (int e = 0; e < 3; ++e) {
+                int from = face.vertex[e];
+                int to = face.vertex[(e + 1) % 3];
+                int shared = -1;
+                for (int k = 0; k < edgeCount; ++k) {
+                    if (edges[k].first == to && edges[k].second == from) {
+                        shared = k;
+                        break;
+                    }
+                }
+                if (shared >= 0) {
+                    edges[shared] = edges[--edgeCount];
+                } else {
+                    edges[edgeCount++] = {from, to};
+                }
+            }
+        }
+
+        // Stop with the polytope intact, and closest still valid, when the
+        // new faces wouldn't fit.
+        if (liveCount - seenCount + edgeCount > MaxPolytopeFaces) break;
+
+        int added = vertexCount;
+        vertices[vertexCount++] = p;
+        int write = 0;
+        for (int i = 0; i < faceCount; ++i) {
+            if (faces[i].live && !sees[i]) faces[write++] = faces[i];
+        }
+        faceCount = write;
+        for (int k = 0; k < edgeCount; ++k) {
+            addFace(edges[k].first, edges[k].second, added);
+        }
+    }
+
+    if (closest < 0) {
+        normal = Vector3f::up();
+        depth = 0.0f;
+        pointA = s.points[0].a;
+        pointB = s.points[0].b;
+        return;
+    }
+
+    // Barycentric weights of the origin's projection onto the face.
+    const PolytopeFace& face = faces[closest];
+    const SupportPoint& p0 = vertices[face.vertex[0]];
+    const SupportPoint& p1 = vertices[face.vertex[1]];
+    const SupportPoint& p2 = vertices[face.vertex[2]];
+    Vector3f projection = face.normal * face.distance;
+    Vector3f n = (p1.w - p0.w).cross(p2.w - p0.w);
+    float area = n.lengthSquared();
+    float u = n.dot((p2.w - p1.w).cross(projection - p1.w)) / area;
+    float v = n.dot((p0.w - p2.w).cross(projection - p2.w)) / area;
+    float w = 1.0f - u - v;
+
+    normal = face.normal;
+    depth = face.distance;
+    pointA = p0.a * u + p1.a * v + p2.a * w;
+    pointB = p0.b * u + p1.b * v + p2.b * w;
+}
+
+} // namespace
+
+ConvexShape ConvexShape::point(const Vector3f& point, float radius) {
+    ConvexShape shape;
+    shape.kind = Point;
+    shape.center = point;
+    shape.halfAxis = Vector3f::zero();
+    shape.radius = radius;
+    shape.hull = nullptr;
+    return shape;
+}
+
+ConvexShape ConvexShape::segment(const Vector3f& center, const Vector3f& halfAxis, float radius) {
+    ConvexShape shape = point(center, radius);
+    shape.kind = Segment;
+    shape.halfAxis = halfAxis;
+    return shape;
+}
+
+ConvexShape ConvexShape::box(const Vector3f& center, const Vector3f& halfExtents) {
+    ConvexShape shape = point(center, 0.0f);
+    shape.kind = Box;
+    shape.halfAxis = halfExtents;
+    return shape;
+}
+
+ConvexShape ConvexShape::triangle(const Vector3f& a, const Vector3f& b, const Vector3f& c) {
+    ConvexShape shape = point((a + b + c) * (1.0f / 3.0f), 0.0f);
+    shape.kind = Triangle;
+    shape.corners[0] = a;
+    shape.corners[1] = b;
+    shape.corners[2] = c;
+    return shape;
+}
+
+ConvexShape ConvexShape::convexHull(const ConvexHull& hull, const Matrix4x4& hullToWorld) {
+    ConvexShape shape = point(hullToWorld.transformPointAffine(hull.getBounds().getCenter()), 0.0f);
+    shape.kind = Hull;
+    shape.hull = &hull;
+    shape.hullToWorld = hullToWorld;
+    return shape;
+}
+
+Vector3f ConvexShape::support(const Vector3f& direction) const {
+    switch (kind) {
+        case Point:
+            return center;
+        case Segment:
+            return direction.dot(halfAxis) >= 0.0f ? center + halfAxis : center - halfAxis;
+        case Box:
+            return Vector3f(center.x + (direction.x >= 0.0f ? halfAxis.x : -halfAxis.x),
+                            center.y + (direction.y >= 0.0f ? halfAxis.y : -halfAxis.y),
+                            center.z + (direction.z >= 0.0f ? halfAxis.z : -halfAxis.z));
+        case Triangle: {
+            float da = direction.dot(corners[0]);
+            float db = direction.dot(corners[1]);
+            float dc = direction.dot(corners[2]);
+            if (da >= db && da >= dc) return corners[0];
+            return db >= dc ? corners[1] : corners[2];
+        }
+        case Hull: {
+            // Support of an affine image: map the direction back through the
+            // transpose, then the vertex forward.
+            const Matrix4x4& m = hullToWorld;
+            Vector3f local(m(0, 0) * direction.x + m(1, 0) * direction.y + m(2, 0) * direction.z,
+                           m(0, 1) * direction.x + m(1, 1) * direction.y + m(2, 1) * direction.z,
+                           m(0, 2) * direction.x + m(1, 2) * direction.y + m(2, 2) * direction.z);
+            return m.transformPointAffine(hull->support(local));
+        }
+    }
+    return center;
+}
+
+bool convexContact(const ConvexShape& a, const ConvexShape& b, float maxGap, Vector3f& axis,
+                   Vector3f& normal, float& penetration, Vector3f& point) {
+    const float radii = a.radius + b.radius;
+    const float reach = maxGap + radii;
+
+    // The axis holds the direction from b's core to a's, so the support
+    // point against it lands on the features that were closest last time.
+    Vector3f seed = axis.lengthSquared() > 1e-12f ? axis : a.center - b.center;
+    if (seed.lengthSquared() <= 1e-12f) seed = Vector3f::up();
+
+    Simplex simplex;
+    simplex.points[0] = supportOf(a, b, -seed);
+    simplex.weights[0] = 1.0f;
+    simplex.count = 1;
+    Vector3f v = simplex.points[0].w;
+
+    bool overlapping = false;
+    for (int iteration = 0; iteration < MaxIterations; ++iteration) {
+        float distanceSquared = v.lengthSquared();
+        if (distanceSquared <= CoreContact * CoreContact) {
+            overlapping = true;
+            break;
+        }
+
+        SupportPoint w = supportOf(a, b, -v);
+        float progress = v.dot(w.w);
+        // progress / |v| bounds the distance from below.
+        if (progress > 0.0f && progress * progress > distanceSquared * reach * reach) {
+            axis = v / std::sqrt(distanceSquared);
+            return false;
+        }
+        if (distanceSquared - progress <= RelativeTolerance * distanceSquared) break;
+
+        bool repeated = false;
+        for (int i = 0; i < simplex.count; ++i) {
+            repeated = repeated || (simplex.points[i].w - w.w).lengthSquared() <= 1e-12f;
+        }
+        if (repeated) break;
+
+        simplex.points[simplex.count++] = w;
+        if (!reduce(simplex)) {
+            overlapping = true;
+            break;
+        }
+        v = simplex.closest();
+    }
+
+    Vector3f pointA, pointB;
+    float depth;
+    if (!overlapping) {
+        float distance = v.length();
+        if (distance > reach) {
+            axis = v / distance;
+            return false;
+        }
+        surfacePoints(simplex, pointA, pointB);
+        normal = -v / distance;
+        depth = -distance;
+    } else {
+        surfacePoints(simplex, pointA, pointB);
+        if (growTetrahedron(a, b, simplex)) {
+            expandPolytope(a, b, simplex, normal, depth, pointA, pointB);
+        } else {
+            // Flat difference: the cores touch along a point or segment
+            // with no preferred side, so separate along the line between
+            // centers.
+            Vector3f offset = b.center - a.center;
+            normal = offset.lengthSquared() > 1e-12f ? offset.normalized() : Vector3f::up();
+            depth = 0.0f;
+        }
+    }
+
+    penetration = depth + radii;
+    point = (pointA + normal * a.radius + pointB - normal * b.radius) * 0.5f;
+    axis = -normal;
+    return penetration >= -maxGap;
+}
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include "physics/heightfield.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace SFSim {
+namespace Physics {
+
+Heightfield::Heightfield()
+    : _columns(0)
+    , _rows(0)
+    , _spacing(1.0f)
+{
+}
+
+void Heightfield::clear() {
+    _columns = 0;
+    _rows = 0;
+    _heights.clear();
+    _levels.clear();
+    _bounds = AABB();
+}
+
+void Heightfield::build(int columns, int rows, float spacing, const std::vector<float>& heights) {
+    clear();
+    if (columns < 2 || rows < 2 || heights.size() < static_cast<size_t>(columns) * rows) return;
+
+    _columns = columns;
+    _rows = rows;
+    _spacing = spacing;
+    _heights.assign(heights.begin(), heights.begin() + static_cast<size_t>(columns) * rows);
+
+    Level cells;
+    cells.columns = columns - 1;
+    cells.rows = rows - 1;
+    cells.low.resize(static_cast<size_t>(cells.columns) * cells.rows);
+    cells.high.resize(cells.low.size());
+    for (int row = 0; row < cells.rows; ++row) {
+        for (int column = 0; column < cells.columns; ++column) {
+            float a = getHeight(column, row);
+            float b = getHeight(column + 1, row);
+            float c = getHeight(column, row + 1);
+            float d = getHeight(column + 1, row + 1);
+            size_t cell = static_cast<size_t>(row) * cells.columns + column;
+            cells.low[cell] = std::min({a, b, c, d});
+            cells.high[cell] = std::max({a, b, c, d});
+        }
+    }
+    _levels.push_back(std::move(cells));
+
+    while (_levels.back().columns > 1 || _levels.back().rows > 1) {
+        const Level& below = _levels.back();
+        Level level;
+        level.columns = (below.columns + 1) / 2;
+        level.rows = (below.rows + 1) / 2;
+        level.low.assign(static_cast<size_t>(level.columns) * level.rows, std::numeric_limits<float>::max());
+        level.high.assign(level.low.size(), -std::numeric_limits<float>::max());
+        for (int row = 0; row < below.rows; ++row) {
+            for (int column = 0; column < below.columns; ++column) {
+                size_t from = static_cast<size_t>(row) * below.columns + column;
+                size_t to = static_cast<size_t>(row / 2) * level.columns + column / 2;
+                level.low[to] = std::min(level.low[to], below.low[from]);
+                level.high[to] = std::max(level.high[to], below.high[from]);
+            }
+        }
+        _levels.push_back(std::move(level));
+    }
+
+    const Level& top = _levels.back();
+    _bounds = AABB(Vector3f(0.0f, top.low[0], 0.0f), Vector3f((columns - 1) * spacing, top.high[0], (rows - 1) * spacing));
+}
+
+AABB Heightfield::blockBounds(const Block& block) const {
+    const Level& level = _levels[block.level];
+    size_t index = static_cast<size_t>(block.row) * level.columns + block.column;
+    int size = 1 << block.level;
+    float right = static_cast<float>(std::min((block.column + 1) * size, _columns - 1));
+    float far = static_cast<float>(std::min((block.row + 1) * size, _rows - 1));
+    return AABB(Vector3f(block.column * size * _spacing, level.low[index], block.row * size * _spacing),
+                Vector3f(right * _spacing, level.high[index], far * _spacing));
+}
+
+void Heightfield::cellCorners(int column, int row, Vector3f corners[4]) const {
+    float x0 = column * _spacing;
+    float x1 = (column + 1) * _spacing;
+    float z0 = row * _spacing;
+    float z1 = (row + 1) * _spacing;
+    corners[0] = Vector3f(x0, getHeight(column, row), z0);
+    corners[1] = Vector3f(x0, getHeight(column, row + 1), z1);
+    corners[2] = Vector3f(x1, getHeight(column + 1, row + 1), z1);
+    corners[3] = Vector3f(x1, getHeight(column + 1, row), z0);
+}
+
+float Heightfield::getHeightAt(float x, float z) const {
+    if (_levels.empty()) return 0.0f;
+
+    float u = std::min(std::max(x / _spacing, 0.0f), static_cast<float>(_columns - 1));
+    float v = std::min(std::max(z / _spacing, 0.0f), static_cast<float>(_rows - 1));
+    int column = std::min(static_cast<int>(u), _columns - 2);
+    int row = std::min(static_cast<int>(v), _rows - 2);
+    float s = u - column;
+    float t = v - row;
+
+    // Split along the cell's diagonal from (0, 0) to (1, 1).
+    float h00 = getHeight(column, row);
+    float h11 = getHeight(column + 1, row + 1);
+    if (t >= s) {
+        float h01 = getHeight(column, row + 1);
+        return h00 + (h01 - h00) * t + (h11 - h01) * s;
+    }
+    float h10 = getHeight(column + 1, row);
+    return h00 + (h10 - h00) * s + (h11 - h10) * t;
+}
+
+bool Heightfield::raycast(const Ray& ray, float maxDistance, Hit& hit) const {
+    if (_levels.empty()) return false;
+
+    Vector3f inverseDirection = ray.getInverseDirection();
+    float closest = maxDistance;
+    float entry;
+    if (!ray.intersects(_bounds, inverseDirection, closest, entry)) return false;
+
+    bool found = false;
+    auto test = [&](const Vector3f& a, const Vector3f& b, const Vector3f& c, unsigned int triangle) {
+        // Moller-Trumbore.
+        Vector3f edge1 = b - a;
+        Vector3f edge2 = c - a;
+        Vector3f p = ray.direction.cross(edge2);
+        float det = edge1.dot(p);
+        if (std::abs(det) < 1e-20f) return;
+
+        float invDet = 1.0f / det;
+        Vector3f s = ray.origin - a;
+        float u = s.dot(p) * invDet;
+        if (u < 0.0f || u > 1.0f) return;
+
+        Vector3f q = s.cross(edge1);
+        float v = ray.direction.dot(q) * invDet;
+        if (v < 0.0f || u + v > 1.0f) return;
+
+        float t = edge2.dot(q) * invDet;
+        if (t <= 0.0f || t >= closest) return;
+
+        closest = t;
+        hit.distance = t;
+        hit.triangle = triangle;
+        hit.barycentric = Vector3f(1.0f - u - v, u, v);
+        hit.normal = edge1.cross(edge2);
+        found = true;
+    };
+
+    Block stack[MaxLevels * 3 + 1];
+    int top = 0;
+    stack[top++] = {static_cast<int>(_levels.size()) - 1, 0, 0};
+
+    while (top > 0) {
+        Block block = stack[--top];
+        if (!ray.intersects(blockBounds(block), inverseDirection, closest, entry)) continue;
+
+        if (block.level == 0) {
+            Vector3f corners[4];
+            cellCorners(block.column, block.row, corners);
+            unsigned int triangle = static_cast<unsigned int>(block.row * (_columns - 1) + block.column) * 2;
+            test(corners[0], corners[1], corners[2], triangle);
+            test(corners[0], corners[2], corners[3], triangle + 1);
+            continue;
+        }
+
+        // The child nearest the ray's origin goes on top, so its hits clip
+        // the others sooner.
+        const Level& below = _levels[block.level - 1];
+        int count = 0;
+        Block children[4];
+        for (int row = block.row * 2; row < std::min(block.row * 2 + 2, below.rows); ++row) {
+            for (int column = block.column * 2; column < std::min(block.column * 2 + 2, below.columns); ++column) {
+                children[count++] = {block.level - 1, column, row};
+            }
+        }
+        float distances[4];
+        for (int i = 0; i < count; ++i) {
+            distances[i] = (blockBounds(children[i]).getCenter() - ray.origin).lengthSquared();
+        }
+        for (int i = 0; i < count; ++i) {
+            int farthest = i;
+            for (int j = i + 1; j < count; ++j) {
+                if (distances[j] > distances[farthest]) farthest = j;
+            }
+            std::swap(children[i], children[farthest]);
+            std::swap(distances[i], distances[farthest]);
+            stack[top++] = children[i];
+        }
+    }
+
+    return found;
+}
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
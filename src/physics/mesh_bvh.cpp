@@ -0,0 +1,416 @@
+#include "physics/mesh_bvh.hpp"
+#include "core/thread_pool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace SFSim {
+namespace Physics {
+
+namespace {
+
+constexpr int BinCount = 16;
+constexpr unsigned int MaxLeafSize = 8;
+// Cost of one box test relative to one triangle test, for the SAH.
+constexpr float TraversalCost = 1.0f;
+
+constexpr size_t PrepareGrain = 16384;
+constexpr size_t BinGrain = 16384;
+// Nodes at least this large bin their triangles across the pool.
+constexpr unsigned int ParallelBinThreshold = 65536;
+// Subtrees are handed to the pool once they drop below
+// max(this, triangles / (threads * 8)).
+constexpr size_t MinParallelSubtree = 4096;
+
+AABB emptyBounds() {
+    const float inf = std::numeric_limits<float>::infinity();
+    return AABB(Vector3f(inf, inf, inf), Vector3f(-inf, -inf, -inf));
+}
+
+float axisOf(const Vector3f& v, int axis) {
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+void grow(AABB& bounds, const AABB& other) {
+    bounds.min.x = std::min(bounds.min.x, other.min.x);
+    bounds.min.y = std::min(bounds.min.y, other.min.y);
+    bounds.min.z = std::min(bounds.min.z, other.min.z);
+    bounds.max.x = std::max(bounds.max.x, other.max.x);
+    bounds.max.y = std::max(bounds.max.y, other.max.y);
+    bounds.max.z = std::max(bounds.max.z, other.max.z);
+}
+
+void grow(AABB& bounds, const Vector3f& point) {
+    bounds.min.x = std::min(bounds.min.x, point.x);
+    bounds.min.y = std::min(bounds.min.y, point.y);
+    bounds.min.z = std::min(bounds.min.z, point.z);
+    bounds.max.x = std::max(bounds.max.x, point.x);
+    bounds.max.y = std::max(bounds.max.y, point.y);
+    bounds.max.z = std::max(bounds.max.z, point.z);
+}
+
+// Box with x, y, z in Float4 lanes, so growing it is two instructions. The
+// binning loops grow one of these for every triangle at every level.
+struct Box {
+    Float4 lo;
+    Float4 hi;
+
+    void reset() {
+        lo = Float4(std::numeric_limits<float>::infinity());
+        hi = Float4(-std::numeric_limits<float>::infinity());
+    }
+
+    void grow(const Float4& otherLo, const Float4& otherHi) {
+        lo = Float4::min(lo, otherLo);
+        hi = Float4::max(hi, otherHi);
+    }
+
+    void grow(const Box& other) {
+        grow(other.lo, other.hi);
+    }
+
+    float area() const {
+        float size[4];
+        (hi - lo).store(size);
+        return 2.0f * (size[0] * size[1] + size[1] * size[2] + size[2] * size[0]);
+    }
+
+    AABB toAABB() const {
+        float l[4], h[4];
+        lo.store(l);
+        hi.store(h);
+        return AABB(Vector3f(l[0], l[1], l[2]), Vector3f(h[0], h[1], h[2]));
+    }
+};
+
+struct BinSet {
+    Box bounds[BinCount];
+    unsigned int count[BinCount];
+
+    void reset(int binCount) {
+        for (int b = 0; b < binCount; ++b) {
+            bounds[b].reset();
+            count[b] = 0;
+        }
+    }
+
+    void merge(const BinSet& other, int binCount) {
+        for (int b = 0; b < binCount; ++b) {
+            bounds[b].grow(other.bounds[b]);
+            count[b] += other.count[b];
+        }
+    }
+};
+
+int binOf(float centroid, float low, float scale) {
+    return std::min(BinCount - 1, std::max(0, static_cast<int>((centroid - low) * scale)));
+}
+
+} // namespace
+
+MeshBVH::MeshBVH() {
+}
+
+void MeshBVH::clear() {
+    _nodes.clear();
+    _triangles.clear();
+    _triangleIds.clear();
+}
+
+void MeshBVH::build(const std::vector<Vector3f>& positions, const std::vector<unsigned int>& indices) {
+    clear();
+
+    unsigned int triangleCount = static_cast<unsigned int>(indices.size() / 3);
+    if (triangleCount == 0) return;
+
+    Core::ThreadPool& pool = Core::ThreadPool::getInstance();
+
+    _refs.resize(triangleCount);
+
+    pool.parallelFor(triangleCount, PrepareGrain, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            const Vector3f& a = positions[indices[t * 3]];
+            const Vector3f& b = positions[indices[t * 3 + 1]];
+            const Vector3f& c = positions[indices[t * 3 + 2]];
+
+            Float4 lo = Float4::min(Float4(a.x, a.y, a.z, 0.0f), Float4::min(Float4(b.x, b.y, b.z, 0.0f), Float4(c.x, c.y, c.z, 0.0f)));
+            Float4 hi = Float4::max(Float4(a.x, a.y, a.z, 0.0f), Float4::max(Float4(b.x, b.y, b.z, 0.0f), Float4(c.x, c.y, c.z, 0.0f)));
+            _refs[t] = BuildRef{lo, hi, (a + b + c) * (1.0f / 3.0f), static_cast<unsigned int>(t)};
+        }
+    });
+
+    _nodes.reserve(static_cast<size_t>(triangleCount) * 2);
+    _nodes.push_back(Node{rangeBounds(0, triangleCount), 0, 0});
+
+    // Split the top of the tree here, then build what is left as independent
+    // subtrees on the pool and splice them in.
+    unsigned int threads = pool.getThreadCount();
+    size_t deferBelow = threads > 1 ? std::max(MinParallelSubtree, static_cast<size_t>(triangleCount) / (threads * 8)) : 0;
+    std::vector<BuildTask> deferred;
+    buildSubtree(_nodes, BuildTask{0, 0, triangleCount, 0}, threads > 1 ? &deferred : nullptr, deferBelow);
+
+    if (!deferred.empty()) {
+        std::vector<std::vector<Node>> subtrees(deferred.size());
+        pool.parallelFor(deferred.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                BuildTask task = deferred[i];
+                subtrees[i].push_back(_nodes[task.node]);
+                task.node = 0;
+                buildSubtree(subtrees[i], task, nullptr, 0);
+            }
+        });
+
+        for (size_t i = 0; i < deferred.size(); ++i) {
+            const std::vector<Node>& local = subtrees[i];
+            unsigned int offset = static_cast<unsigned int>(_nodes.size()) - 1;
+            auto relocate = [offset](Node node) {
+                if (!node.isLeaf()) node.firstIndex += offset;
+                return node;
+            };
+
+            _nodes[deferred[i].node] = relocate(local[0]);
+            for (size_t k = 1; k < local.size(); ++k) {
+                _nodes.push_back(relocate(local[k]));
+            }
+        }
+    }
+
+    _triangles.resize(triangleCount);
+    _triangleIds.resize(triangleCount);
+    pool.parallelFor(triangleCount, PrepareGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            unsigned int t = _refs[i].triangle;
+            _triangleIds[i] = t;
+            const Vector3f& a = positions[indices[t * 3]];
+            _triangles[i] = Triangle{a, positions[indices[t * 3 + 1]] - a, positions[indices[t * 3 + 2]] - a};
+        }
+    });
+
+    _refs.clear();
+    _refs.shrink_to_fit();
+}
+
+void MeshBVH::buildSubtree(std::vector<Node>& nodes, const BuildTask& root, std::vector<BuildTask>* deferred, size_t deferBelow) {
+    std::vector<BuildTask> stack;
+    stack.push_back(root);
+
+    while (!stack.empty()) {
+        BuildTask task = stack.back();
+        stack.pop_back();
+
+        if (deferred && task.count <= deferBelow) {
+            deferred->push_back(task);
+            continue;
+        }
+
+        Split split;
+        if (task.count <= 2 || task.depth >= MaxDepth || !findSplit(task.first, task.count, nodes[task.node].bounds, split)) {
+            nodes[task.node].firstIndex = task.first;
+            nodes[task.node].count = task.count;
+            continue;
+        }
+
+        auto begin = _refs.begin() + task.first;
+        std::partition(begin, begin + task.count, [&](const BuildRef& ref) {
+            return binOf(axisOf(ref.centroid, split.axis), split.low, split.scale) <= split.bin;
+        });
+
+        unsigned int left = static_cast<unsigned int>(nodes.size());
+        nodes.push_back(Node{split.leftBounds, 0, 0});
+        nodes.push_back(Node{split.rightBounds, 0, 0});
+        nodes[task.node].firstIndex = left;
+        nodes[task.node].count = 0;
+
+        stack.push_back(BuildTask{left, task.first, split.leftCount, task.depth + 1});
+        stack.push_back(BuildTask{left + 1, task.first + split.leftCount, task.count - split.leftCount, task.depth + 1});
+    }
+}
+
+bool MeshBVH::findSplit(unsigned int first, unsigned int count, const AABB& nodeBounds, Split& split) const {
+    Core::ThreadPool& pool = Core::ThreadPool::getInstance();
+    bool parallel = count >= ParallelBinThreshold && pool.getThreadCount() > 1;
+
+    // Centroid bounds set the bin ranges, so they need their own pass.
+    AABB centroids = emptyBounds();
+    if (parallel) {
+        std::vector<AABB> partial((count + BinGrain - 1) / BinGrain, emptyBounds());
+        pool.parallelFor(count, BinGrain, [&](size_t begin, size_t end) {
+            AABB& bounds = partial[begin / BinGrain];
+            for (size_t i = begin; i < end; ++i) grow(bounds, _refs[first + i].centroid);
+        });
+        for (const AABB& bounds : partial) grow(centroids, bounds);
+    } else {
+        for (unsigned int i = first; i < first + count; ++i) grow(centroids, _refs[i].centroid);
+    }
+
+    // Bin along the longest axis of the centroids only: a third of the
+    // binning work for a tree that traces about as fast. Small nodes get
+    // fewer bins, since most would be empty.
+    Vector3f extent = centroids.max - centroids.min;
+    int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+    float low = axisOf(centroids.min, axis);
+    float axisExtent = axisOf(extent, axis);
+    if (!(axisExtent > 0.0f)) {
+        return false;
+    }
+
+    int binCount = static_cast<int>(std::min<unsigned int>(BinCount, count));
+    float scale = binCount / axisExtent;
+
+    auto binTriangles = [&](BinSet& bins, size_t begin, size_t end) {
+        bins.reset(binCount);
+        for (size_t i = begin; i < end; ++i) {
+            const BuildRef& ref = _refs[first + i];
+            int b = std::min(binCount - 1, binOf(axisOf(ref.centroid, axis), low, scale));
+            bins.count[b]++;
+            bins.bounds[b].grow(ref.min, ref.max);
+        }
+    };
+
+    BinSet bins;
+    if (parallel) {
+        std::vector<BinSet> partial((count + BinGrain - 1) / BinGrain);
+        pool.parallelFor(count, BinGrain, [&](size_t begin, size_t end) {
+            binTriangles(partial[begin / BinGrain], begin, end);
+        });
+        bins = partial[0];
+        for (size_t c = 1; c < partial.size(); ++c) bins.merge(partial[c], binCount);
+    } else {
+        binTriangles(bins, 0, count);
+    }
+
+    // Sweep from the right first so each left-side candidate can be priced
+    // in the second pass.
+    Box rightBounds[BinCount];
+    unsigned int rightCount[BinCount];
+    Box accumulated;
+    accumulated.reset();
+    unsigned int total = 0;
+    for (int b = binCount - 1; b > 0; --b) {
+        accumulated.grow(bins.bounds[b]);
+        total += bins.count[b];
+        rightBounds[b] = accumulated;
+        rightCount[b] = total;
+    }
+
+    float bestCost = std::numeric_limits<float>::infinity();
+    Box bestLeft;
+    bestLeft.reset();
+    accumulated.reset();
+    total = 0;
+    for (int b = 0; b < binCount - 1; ++b) {
+        accumulated.grow(bins.bounds[b]);
+        total += bins.count[b];
+        if (total == 0 || rightCount[b + 1] == 0) continue;
+
+        float cost = total * accumulated.area() + rightCount[b + 1] * rightBounds[b + 1].area();
+        if (cost < bestCost) {
+            bestCost = cost;
+            bestLeft = accumulated;
+            split.bin = b;
+            split.leftCount = total;
+        }
+    }
+
+    if (bestCost == std::numeric_limits<float>::infinity()) {
+        return false;
+    }
+    split.axis = axis;
+    split.low = low;
+    split.scale = scale;
+    split.leftBounds = bestLeft.toAABB();
+    split.rightBounds = rightBounds[split.bin + 1].toAABB();
+
+    // Splitting only pays if it beats testing every triangle here, counting
+    // the extra box test a split adds.
+    float area = nodeBounds.getSurfaceArea();
+    float leafCost = count * area;
+    return !(count <= MaxLeafSize && bestCost + TraversalCost * area >= leafCost);
+}
+
+AABB MeshBVH::rangeBounds(unsigned int first, unsigned int count) const {
+    Box bounds;
+    bounds.reset();
+    for (unsigned int i = first; i < first + count; ++i) {
+        bounds.grow(_refs[i].min, _refs[i].max);
+    }
+    return bounds.toAABB();
+}
+
+bool MeshBVH::raycast(const Ray& ray, float maxDistance, Hit& hit) const {
+    if (_nodes.empty()) return false;
+
+    Vector3f inverseDirection = ray.getInverseDirection();
+    float closest = maxDistance;
+    unsigned int closestTriangle = 0;
+    float closestU = 0.0f, closestV = 0.0f;
+    bool found = false;
+
+    float entry;
+    if (!ray.intersects(_nodes[0].bounds, inverseDirection, closest, entry)) return false;
+
+    // The build caps the depth, and each level leaves at most one sibling
+    // waiting on the stack.
+    unsigned int stack[MaxDepth + 2];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const Node& node = _nodes[stack[--top]];
+
+        if (node.isLeaf()) {
+            for (unsigned int i = node.firstIndex; i < node.firstIndex + node.count; ++i) {
+                const Triangle& triangle = _triangles[i];
+
+                // Moller-Trumbore.
+                Vector3f p = ray.direction.cross(triangle.edge2);
+                float det = triangle.edge1.dot(p);
+                if (std::abs(det) < 1e-20f) continue;
+
+                float invDet = 1.0f / det;
+                Vector3f s = ray.origin - triangle.vertex;
+                float u = s.dot(p) * invDet;
+                if (u < 0.0f || u > 1.0f) continue;
+
+                Vector3f q = s.cross(triangle.edge1);
+                float v = ray.direction.dot(q) * invDet;
+                if (v < 0.0f || u + v > 1.0f) continue;
+
+                float t = triangle.edge2.dot(q) * invDet;
+                if (t <= 0.0f || t >= closest) continue;
+
+                closest = t;
+                closestTriangle = i;
+                closestU = u;
+                closestV = v;
+                found = true;
+            }
+            continue;
+        }
+
+        unsigned int near = node.firstIndex;
+        unsigned int far = node.firstIndex + 1;
+        float nearEntry, farEntry;
+        bool nearHit = ray.intersects(_nodes[near].bounds, inverseDirection, closest, nearEntry);
+        bool farHit = ray.intersects(_nodes[far].bounds, inverseDirection, closest, farEntry);
+
+        if (nearHit && farHit && farEntry < nearEntry) {
+            std::swap(near, far);
+        }
+        if (farHit && nearHit) stack[top++] = far;
+        if (nearHit) stack[top++] = near;
+        else if (farHit) stack[top++] = far;
+    }
+
+    if (!found) return false;
+
+    const Triangle& triangle = _triangles[closestTriangle];
+    hit.distance = closest;
+    hit.triangle = _triangleIds[closestTriangle];
+    hit.barycentric = Vector3f(1.0f - closestU - closestV, closestU, closestV);
+    hit.normal = triangle.edge1.cross(triangle.edge2);
+    return true;
+}
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
@@ -0,0 +1,341 @@
+#include "physics/nbody.hpp"
+#include "physics/physics.hpp"
+#include "ecs/transform_component.hpp"
+#include "core/thread_pool.hpp"
+#include "math/simd.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace SFSim {
+namespace Physics {
+
+namespace {
+
+// Bodies per leaf at most, unless they are closer together than the
+// deepest level can split.
+constexpr uint32_t LeafSize = 32;
+// Bits of each coordinate in a Morton key, so levels of the tree.
+constexpr int MortonBits = 21;
+constexpr int RadixBits = 11;
+constexpr size_t LeafGrain = 8;
+constexpr size_t DirectGrain = 64;
+constexpr size_t KeyGrain = 16384;
+
+// Spaces out the low 21 bits of v two zero bits apart.
+uint64_t spreadBits(uint64_t v) {
+    v &= 0x1FFFFF;
+    v = (v | v << 32) & 0x1F00000000FFFFull;
+    v = (v | v << 16) & 0x1F0000FF0000FFull;
+    v = (v | v << 8) & 0x100F00F00F00F00Full;
+    v = (v | v << 4) & 0x10C30C30C30C30C3ull;
+    v = (v | v << 2) & 0x1249249249249249ull;
+    return v;
+}
+
+} // namespace
+
+void NBodyGravity::SourceList::pad() {
+    while (x.size() % Float4::Width != 0) add(0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+NBodyGravity::NBodyGravity()
+    : _method(Method::BarnesHut)
+    , _gravitationalConstant(6.674e-11f)
+    , _softening(0.0f)
+    , _openingAngle(0.5f)
+    , _parallelThreshold(4096)
+{
+}
+
+void NBodyGravity::computeAccelerations(const std::vector<Vector3f>& positions, const std::vector<float>& masses,
+                                        std::vector<Vector3f>& accelerations) {
+    size_t count = positions.size();
+    std::vector<float> x(count), y(count), z(count);
+    std::vector<float> ax(count), ay(count), az(count);
+    for (size_t i = 0; i < count; ++i) {
+        x[i] = positions[i].x;
+        y[i] = positions[i].y;
+        z[i] = positions[i].z;
+    }
+    computeAccelerations(x.data(), y.data(), z.data(), masses.data(), count, ax.data(), ay.data(), az.data());
+    accelerations.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        accelerations[i] = Vector3f(ax[i], ay[i], az[i]);
+    }
+}
+
+void NBodyGravity::computeAccelerations(const float* x, const float* y, const float* z, const float* mass, size_t count,
+                                        float* accelerationX, float* accelerationY, float* accelerationZ) {
+    if (count == 0) {
+        _nodes.clear();
+        return;
+    }
+    bool parallel = Core::ThreadPool::exceedsThreshold(count, _parallelThreshold);
+    float g = _gravitationalConstant;
+
+    if (_method == Method::Direct) {
+        _sorted.clear();
+        for (size_t i = 0; i < count; ++i) _sorted.add(x[i], y[i], z[i], mass[i]);
+        _sorted.pad();
+        Core::ThreadPool::parallelForIf(parallel, count, DirectGrain, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                Vector3f acceleration = sumSources(_sorted, x[i], y[i], z[i]) * g;
+                accelerationX[i] = acceleration.x;
+                accelerationY[i] = acceleration.y;
+                accelerationZ[i] = acceleration.z;
+            }
+        });
+        return;
+    }
+
+    buildTree(x, y, z, mass, count);
+    Core::ThreadPool::parallelForIf(parallel, _leaves.size(), LeafGrain, [&](size_t begin, size_t end) {
+        SourceList sources;
+        for (size_t i = begin; i < end; ++i) {
+            evaluateLeaf(_nodes[_leaves[i]], sources, accelerationX, accelerationY, accelerationZ);
+        }
+    });
+}
+
+void NBodyGravity::buildTree(const float* x, const float* y, const float* z, const float* mass, size_t count) {
+    bool parallel = Core::ThreadPool::exceedsThreshold(count, _parallelThreshold);
+
+    Vector3f low(x[0], y[0], z[0]);
+    Vector3f high = low;
+    for (size_t i = 1; i < count; ++i) {
+        low = Vector3f(std::min(low.x, x[i]), std::min(low.y, y[i]), std::min(low.z, z[i]));
+        high = Vector3f(std::max(high.x, x[i]), std::max(high.y, y[i]), std::max(high.z, z[i]));
+    }
+    // The root is a cube, so every cell below it is one too.
+    float extent = std::max(std::max(high.x - low.x, high.y - low.y), std::max(high.z - low.z, 1e-6f));
+    const float cells = static_cast<float>(1u << MortonBits);
+    float scale = cells / extent;
+    const uint64_t maxCell = (1u << MortonBits) - 1;
+
+    _keys.resize(count);
+    _keyScratch.resize(count);
+    _order.resize(count);
+    _orderScratch.resize(count);
+    Core::ThreadPool::parallelForIf(parallel, count, KeyGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            uint64_t cellX = std::min(maxCell, static_cast<uint64_t>((x[i] - low.x) * scale));
+            uint64_t cellY = std::min(maxCell, static_cast<uint64_t>((y[i] - low.y) * scale));
+            uint64_t cellZ = std::min(maxCell, static_cast<uint64_t>((z[i] - low.z) * scale));
+            _keys[i] = spreadBits(cellX) << 2 | spreadBits(cellY) << 1 | spreadBits(cellZ);
+            _order[i] = static_cast<uint32_t>(i);
+        }
+    });
+
+    // Least significant digit first, skipping digits every key shares
+    // (the high ones, when the bodies don't fill the cube).
+    const size_t radix = size_t(1) << RadixBits;
+    std::vector<uint32_t> counts(radix);
+    for (int shift = 0; shift < 3 * MortonBits; shift += RadixBits) {
+        std::fill(counts.begin(), counts.end(), 0u);
+        for (size_t i = 0; i < count; ++i) ++counts[(_keys[i] >> shift) & (radix - 1)];
+        if (counts[(_keys[0] >> shift) & (radix - 1)] == count) continue;
+        uint32_t offset = 0;
+        for (size_t d = 0; d < radix; ++d) {
+            uint32_t digitCount = counts[d];
+            counts[d] = offset;
+            offset += digitCount;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t slot = counts[(_keys[i] >> shift) & (radix - 1)]++;
+            _keyScratch[slot] = _keys[i];
+            _orderScratch[slot] = _order[i];
+        }
+        _keys.swap(_keyScratch);
+        _order.swap(_orderScratch);
+    }
+
+    _sorted.clear();
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t body = _order[i];
+        _sorted.add(x[body], y[body], z[body], mass[body]);
+    }
+
+    _nodes.clear();
+    _leaves.clear();
+    Node root;
+    root.size = extent;
+    root.firstChild = 0;
+    root.childCount = 0;
+    root.bodyBegin = 0;
+    root.bodyCount = static_cast<uint32_t>(count);
+    _nodes.push_back(root);
+    buildNode(0, 0);
+    _sorted.pad();
+}
+
+void NBodyGravity::buildNode(uint32_t node, int level) {
+    uint32_t begin = _nodes[node].bodyBegin;
+    uint32_t end = begin + _nodes[node].bodyCount;
+
+    if (end - begin <= LeafSize || level == MortonBits) {
+        float mass = 0.0f;
+        Vector3f moment = Vector3f::zero();
+        for (uint32_t i = begin; i < end; ++i) {
+            mass += _sorted.mass[i];
+            moment += Vector3f(_sorted.x[i], _sorted.y[i], _sorted.z[i]) * _sorted.mass[i];
+        }
+        // Massless cells pull on nothing, wherever their center is.
+        Vector3f center = mass > 0.0f ? moment * (1.0f / mass) : Vector3f(_sorted.x[begin], _sorted.y[begin], _sorted.z[begin]);
+        Node& leaf = _nodes[node];
+        leaf.x = center.x;
+        leaf.y = center.y;
+        leaf.z = center.z;
+        leaf.mass = mass;
+        _leaves.push_back(node);
+        return;
+    }
+
+    // Keys in the range agree above this level, so each octant's bodies are
+    // a run of the range.
+    int shift = 3 * (MortonBits - 1 - level);
+    float childSize = _nodes[node].size * 0.5f;
+    uint32_t firstChild = static_cast<uint32_t>(_nodes.size());
+    uint32_t childBegin = begin;
+    while (childBegin < end) {
+        uint64_t octant = (_keys[childBegin] >> shift) & 7;
+        uint32_t childEnd = static_cast<uint32_t>(std::partition_point(_keys.begin() + childBegin, _keys.begin() + end,
+            [&](uint64_t key) { return ((key >> shift) & 7) == octant; }) - _keys.begin());
+        Node child;
+        child.size = childSize;
+        child.firstChild = 0;
+        child.childCount = 0;
+        child.bodyBegin = childBegin;
+        child.bodyCount = childEnd - childBegin;
+        _nodes.push_back(child);
+        childBegin = childEnd;
+    }
+    uint32_t childCount = static_cast<uint32_t>(_nodes.size()) - firstChild;
+    _nodes[node].firstChild = firstChild;
+    _nodes[node].childCount = childCount;
+
+    float mass = 0.0f;
+    Vector3f moment = Vector3f::zero();
+    for (uint32_t c = firstChild; c < firstChild + childCount; ++c) {
+        buildNode(c, level + 1);
+        const Node& child = _nodes[c];
+        mass += child.mass;
+        moment += Vector3f(child.x, child.y, child.z) * child.mass;
+    }
+    const Node& first = _nodes[firstChild];
+    Vector3f center = mass > 0.0f ? moment * (1.0f / mass) : Vector3f(first.x, first.y, first.z);
+    Node& cell = _nodes[node];
+    cell.x = center.x;
+    cell.y = center.y;
+    cell.z = center.z;
+    cell.mass = mass;
+}
+
+void NBodyGravity::evaluateLeaf(const Node& leaf, SourceList& sources, float* accelerationX, float* accelerationY, float* accelerationZ) const {
+    uint32_t begin = leaf.bodyBegin;
+    uint32_t end = begin + leaf.bodyCount;
+
+    Vector3f low(_sorted.x[begin], _sorted.y[begin], _sorted.z[begin]);
+    Vector3f high = low;
+    for (uint32_t i = begin + 1; i < end; ++i) {
+        low = Vector3f(std::min(low.x, _sorted.x[i]), std::min(low.y, _sorted.y[i]), std::min(low.z, _sorted.z[i]));
+        high = Vector3f(std::max(high.x, _sorted.x[i]), std::max(high.y, _sorted.y[i]), std::max(high.z, _sorted.z[i]));
+    }
+
+    // Judged against the nearest point of the leaf's bounds, a cell that is
+    // far enough from it is far enough from every body in it.
+    float angleSquared = _openingAngle * _openingAngle;
+    sources.clear();
+    // Up to 7 siblings wait at each level, plus the node being opened.
+    uint32_t stack[8 * (MortonBits + 1)];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& node = _nodes[stack[--top]];
+        if (node.mass == 0.0f) continue;
+
+        // Cells holding the leaf itself are always opened, so its bodies
+        // never see themselves in a center of mass.
+        bool holdsLeaf = begin >= node.bodyBegin && begin < node.bodyBegin + node.bodyCount;
+        if (!holdsLeaf) {
+            float dx = std::max(std::max(low.x - node.x, node.x - high.x), 0.0f);
+            float dy = std::max(std::max(low.y - node.y, node.y - high.y), 0.0f);
+            float dz = std::max(std::max(low.z - node.z, node.z - high.z), 0.0f);
+            if (node.size * node.size < angleSquared * (dx * dx + dy * dy + dz * dz)) {
+                sources.add(node.x, node.y, node.z, node.mass);
+                continue;
+            }
+        }
+
+        if (node.childCount == 0) {
+            uint32_t from = node.bodyBegin;
+            uint32_t to = from + node.bodyCount;
+            sources.x.insert(sources.x.end(), _sorted.x.begin() + from, _sorted.x.begin() + to);
+            sources.y.insert(sources.y.end(), _sorted.y.begin() + from, _sorted.y.begin() + to);
+            sources.z.insert(sources.z.end(), _sorted.z.begin() + from, _sorted.z.begin() + to);
+            sources.mass.insert(sources.mass.end(), _sorted.mass.begin() + from, _sorted.mass.begin() + to);
+        } else {
+            for (uint32_t c = 0; c < node.childCount; ++c) stack[top++] = node.firstChild + c;
+        }
+    }
+    sources.pad();
+
+    float g = _gravitationalConstant;
+    for (uint32_t i = begin; i < end; ++i) {
+        Vector3f acceleration = sumSources(sources, _sorted.x[i], _sorted.y[i], _sorted.z[i]) * g;
+        uint32_t body = _order[i];
+        accelerationX[body] = acceleration.x;
+        accelerationY[body] = acceleration.y;
+        accelerationZ[body] = acceleration.z;
+    }
+}
+
+Vector3f NBodyGravity::sumSources(const SourceList& sources, float x, float y, float z) const {
+    Float4 px(x), py(y), pz(z);
+    Float4 softening(_softening * _softening);
+    Float4 zero(0.0f);
+    Float4 sumX, sumY, sumZ;
+    for (size_t i = 0; i < sources.size(); i += Float4::Width) {
+        Float4 dx = Float4::load(&sources.x[i]) - px;
+        Float4 dy = Float4::load(&sources.y[i]) - py;
+        Float4 dz = Float4::load(&sources.z[i]) - pz;
+        Float4 distanceSquared = dx * dx + dy * dy + dz * dz;
+        Float4 inverse = Float4::rsqrt(distanceSquared + softening);
+        // A body (or one on top of it) doesn't pull on itself.
+        Float4 weight = Float4::select(distanceSquared > zero, Float4::load(&sources.mass[i]) * inverse * inverse * inverse, zero);
+        sumX += dx * weight;
+        sumY += dy * weight;
+        sumZ += dz * weight;
+    }
+    return Vector3f(sumX.horizontalSum(), sumY.horizontalSum(), sumZ.horizontalSum());
+}
+
+void NBodySystem::update(float, const std::vector<std::unique_ptr<Entity>>& entities) {
+    _bodies = getEntitiesWith<RigidbodyComponent, TransformComponent>(entities);
+    size_t count = _bodies.size();
+    _x.resize(count);
+    _y.resize(count);
+    _z.resize(count);
+    _mass.resize(count);
+    _accelerationX.resize(count);
+    _accelerationY.resize(count);
+    _accelerationZ.resize(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        Vector3f position = _bodies[i]->getComponent<TransformComponent>()->getPosition();
+        _x[i] = position.x;
+        _y[i] = position.y;
+        _z[i] = position.z;
+        _mass[i] = _bodies[i]->getComponent<RigidbodyComponent>()->getMass();
+    }
+    _gravity.computeAccelerations(_x.data(), _y.data(), _z.data(), _mass.data(), count,
+                                  _accelerationX.data(), _accelerationY.data(), _accelerationZ.data());
+
+    for (size_t i = 0; i < count; ++i) {
+        RigidbodyComponent* rigidbody = _bodies[i]->getComponent<RigidbodyComponent>();
+        if (rigidbody->isKinematic()) continue;
+        rigidbody->addForce(Vector3f(_accelerationX[i], _accelerationY[i], _accelerationZ[i]) * _mass[i]);
+    }
+}
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
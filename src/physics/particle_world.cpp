@@ -0,0 +1,375 @@
+#include "physics/particle_world.hpp"
+#include "core/thread_pool.hpp"
+#include "math/simd.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+namespace SFSim {
+namespace Physics {
+
+namespace {
+
+// Multiple of Float4::Width, so every chunk starts on a whole group.
+constexpr size_t UpdateGrain = 16384;
+
+struct Float4x3 {
+    Float4 x, y, z;
+};
+
+Float4 dot(const Float4x3& a, const Float4x3& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// Any unit vector perpendicular to v.
+Vector3f perpendicular(const Vector3f& v) {
+    Vector3f other = std::abs(v.x) < 0.9f ? Vector3f(1, 0, 0) : Vector3f(0, 1, 0);
+    return v.cross(other).normalized();
+}
+
+} // namespace
+
+ParticleEmitter::ParticleEmitter()
+    : position(Vector3f::zero())
+    , direction(Vector3f::up())
+    , spread(0.5f)
+    , jitter(0.0f)
+    , minSpeed(1.0f)
+    , maxSpeed(2.0f)
+    , rate(100.0f)
+    , minLifetime(2.0f)
+    , maxLifetime(3.0f)
+    , color(0xFFFFFFFFu)
+    , enabled(true)
+{
+}
+
+ForceField ForceField::gravity(const Vector3f& acceleration) {
+    return {Gravity, Vector3f::zero(), acceleration, 0.0f, 0.0f};
+}
+
+ForceField ForceField::drag(float strength) {
+    return {Drag, Vector3f::zero(), Vector3f::zero(), strength, 0.0f};
+}
+
+ForceField ForceField::vortex(const Vector3f& position, const Vector3f& axis, float strength, float radius) {
+    return {Vortex, position, axis.normalized(), strength, radius};
+}
+
+ForceField ForceField::attractor(const Vector3f& position, float strength, float radius) {
+    return {Attractor, position, Vector3f::zero(), strength, radius};
+}
+
+ParticleWorld::ParticleWorld()
+    : _restitution(0.0f)
+    , _hasContainer(false)
+    , _radius(0.0f)
+    , _stiffness(0.0f)
+    , _damping(0.0f)
+    , _cohesion(0.0f)
+    , _interacting(false)
+    , _count(0)
+    , _maxParticles(1 << 20)
+    , _parallelThreshold(65536)
+    , _random(std::random_device{}())
+{
+}
+
+size_t ParticleWorld::addEmitter(const ParticleEmitter& emitter) {
+    _emitters.push_back({emitter, 0.0f});
+    return _emitters.size() - 1;
+}
+
+void ParticleWorld::setContainer(const AABB& box, float restitution) {
+    _container = box;
+    _restitution = restitution;
+    _hasContainer = true;
+}
+
+void ParticleWorld::setInteraction(float radius, float stiffness, float damping, float cohesion) {
+    _radius = radius;
+    _stiffness = stiffness;
+    _damping = damping;
+    _cohesion = cohesion;
+    _interacting = radius > 0.0f;
+}
+
+size_t ParticleWorld::spawn(const Vector3f& position, const Vector3f& velocity, float lifetime, std::uint32_t color) {
+    if (_count >= _maxParticles) return _count;
+
+    // Arrays only ever grow, by whole groups, so the lanes past the last
+    // particle always exist; whatever they hold is integrated and ignored.
+    if (_count == _age.size()) {
+        size_t capacity = std::max<size_t>(Float4::Width, _count * 2);
+        _position.resize(capacity);
+        _velocity.resize(capacity);
+        _age.resize(capacity, 0.0f);
+        _lifetime.resize(capacity, 0.0f);
+        _color.resize(capacity, 0u);
+    }
+
+    size_t index = _count++;
+    _position.set(index, position);
+    _velocity.set(index, velocity);
+    _age[index] = 0.0f;
+    _lifetime[index] = lifetime > 0.0f ? lifetime : std::numeric_limits<float>::infinity();
+    _color[index] = color;
+    return index;
+}
+
+void ParticleWorld::emit(const ParticleEmitter& emitter, size_t count) {
+    for (size_t i = 0; i < count && _count < _maxParticles; ++i) {
+        spawnFrom(emitter);
+    }
+}
+
+void ParticleWorld::clear() {
+    _count = 0;
+}
+
+void ParticleWorld::spawnFrom(const ParticleEmitter& emitter) {
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    // Uniform over the spherical cap the cone cuts out.
+    Vector3f axis = emitter.direction.normalized();
+    Vector3f tangent = perpendicular(axis);
+    Vector3f bitangent = axis.cross(tangent);
+    float cosTheta = 1.0f - unit(_random) * (1.0f - std::cos(emitter.spread));
+    float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+    float phi = unit(_random) * 2.0f * static_cast<float>(M_PI);
+    Vector3f direction = axis * cosTheta + (tangent * std::cos(phi) + bitangent * std::sin(phi)) * sinTheta;
+
+    Vector3f position = emitter.position;
+    if (emitter.jitter > 0.0f) {
+        Vector3f offset;
+        do {
+            offset = Vector3f(unit(_random), unit(_random), unit(_random)) * 2.0f - Vector3f(1, 1, 1);
+        } while (offset.lengthSquared() > 1.0f);
+        position += offset * emitter.jitter;
+    }
+
+    float speed = emitter.minSpeed + unit(_random) * (emitter.maxSpeed - emitter.minSpeed);
+    float lifetime = emitter.minLifetime + unit(_random) * (emitter.maxLifetime - emitter.minLifetime);
+    spawn(position, direction * speed, lifetime, emitter.color);
+}
+
+void ParticleWorld::update(float deltaTime) {
+    if (_interacting && _count > 1) {
+        interact(deltaTime);
+    }
+
+    size_t padded = (_count + Float4::Width - 1) / Float4::Width * Float4::Width;
+
+    size_t dead = 0;
+    if (padded == 0) {
+        // Nothing to move yet; the emitters below still run.
+    } else if (!Core::ThreadPool::exceedsThreshold(_count, _parallelThreshold)) {
+        dead = integrate(0, padded, deltaTime);
+    } else {
+        std::atomic<size_t> died(0);
+        Core::ThreadPool::getInstance().parallelFor(padded, UpdateGrain, [&](size_t begin, size_t end) {
+            died.fetch_add(integrate(begin, end, deltaTime), std::memory_order_relaxed);
+        });
+        dead = died.load();
+    }
+
+    if (dead > 0) {
+        removeDead();
+    }
+
+    for (EmitterState& state : _emitters) {
+        if (!state.emitter.enabled) continue;
+
+        state.pending += state.emitter.rate * deltaTime;
+        float whole = std::floor(state.pending);
+        state.pending -= whole;
+        emit(state.emitter, static_cast<size_t>(whole));
+    }
+}
+
+void ParticleWorld::interact(float deltaTime) {
+    float contact = 2.0f * _radius;
+    float range = _cohesion > 0.0f ? 2.0f * contact : contact;
+
+    _grid.setCellSize(range);
+    _grid.setParallelThreshold(_parallelThreshold);
+    _grid.build(_position.x.data(), _position.y.data(), _position.z.data(), _count);
+    _interaction.resize(_count);
+
+    const std::vector<uint32_t>& order = _grid.getSortedIndices();
+    bool parallel = Core::ThreadPool::exceedsThreshold(_count, _parallelThreshold);
+
+    // Every particle sums what its neighbors do to it, walking in grid
+    // order; a pair works out the same force from both ends, so momentum
+    // is kept without two threads ever writing to one particle.
+    Core::ThreadPool::parallelForIf(parallel, _count, UpdateGrain, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; ++s) {
+            Vector3f position = _grid.getSortedPosition(s);
+            Vector3f velocity = _velocity.get(order[s]);
+            Vector3f change = Vector3f::zero();
+
+            _grid.forEachNeighbor(s, range, false, [&](size_t other, float distanceSquared) {
+                // Particles on top of each other (the container's clamp can
+                // put two in one corner) still need pushing apart, each
+                // the opposite way.
+                float distance = std::sqrt(distanceSquared);
+                Vector3f normal = distance > 1e-6f ? (position - _grid.getSortedPosition(other)) / distance
+                                                   : Vector3f(s < other ? 1.0f : -1.0f, 0.0f, 0.0f);
+                float push;
+                if (distance < contact) {
+                    float separating = (velocity - _velocity.get(order[other])).dot(normal);
+                    push = std::max(0.0f, _stiffness * (contact - distance) - _damping * separating);
+                } else if (distance < range) {
+                    push = -_cohesion * (1.0f - (distance - contact) / (range - contact));
+                } else {
+                    return;
+                }
+                change += normal * (push * deltaTime);
+            });
+
+            _interaction.set(s, change);
+        }
+    });
+
+    Core::ThreadPool::parallelForIf(parallel, _count, UpdateGrain, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; ++s) {
+            size_t i = order[s];
+            _velocity.set(i, _velocity.get(i) + _interaction.get(s));
+        }
+    });
+}
+
+void ParticleWorld::reorder(const std::vector<uint32_t>& order) {
+    bool parallel = Core::ThreadPool::exceedsThreshold(_count, _parallelThreshold);
+
+    // One array at a time through the scratch array, which then holds the
+    // old one and takes the next; the lanes past the last particle keep
+    // whatever was there.
+    auto gather = [&](auto& column, auto& scratch) {
+        scratch.resize(column.size());
+        Core::ThreadPool::parallelForIf(parallel, _count, UpdateGrain, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) scratch[i] = column[order[i]];
+        });
+        column.swap(scratch);
+    };
+    gather(_position.x, _scratch);
+    gather(_position.y, _scratch);
+    gather(_position.z, _scratch);
+    gather(_velocity.x, _scratch);
+    gather(_velocity.y, _scratch);
+    gather(_velocity.z, _scratch);
+    gather(_age, _scratch);
+    gather(_lifetime, _scratch);
+    gather(_color, _colorScratch);
+}
+
+size_t ParticleWorld::integrate(size_t begin, size_t end, float deltaTime) {
+    end = std::min(end, _age.size());
+
+    // Gravity and drag don't depend on where a particle is, so they fold
+    // into one acceleration and one damping factor for the whole step.
+    Vector3f gravity = Vector3f::zero();
+    float drag = 0.0f;
+    for (const ForceField& field : _fields) {
+        if (field.type == ForceField::Gravity) gravity += field.vector;
+        else if (field.type == ForceField::Drag) drag += field.strength;
+    }
+
+    const Float4 dt(deltaTime);
+    const Float4 zero(0.0f);
+    const Float4 gravityX(gravity.x);
+    const Float4 gravityY(gravity.y);
+    const Float4 gravityZ(gravity.z);
+    const Float4 damping(std::max(0.0f, 1.0f - drag * deltaTime));
+    const Float4 restitution(-_restitution);
+    const Float4 minX(_container.min.x), minY(_container.min.y), minZ(_container.min.z);
+    const Float4 maxX(_container.max.x), maxY(_container.max.y), maxZ(_container.max.z);
+
+    size_t dead = 0;
+    for (size_t i = begin; i < end; i += Float4::Width) {
+        Float4 age = Float4::load(&_age[i]) + dt;
+        age.store(&_age[i]);
+
+        Float4x3 p = {Float4::load(&_position.x[i]), Float4::load(&_position.y[i]), Float4::load(&_position.z[i])};
+        Float4x3 a = {gravityX, gravityY, gravityZ};
+
+        for (const ForceField& field : _fields) {
+            if (field.type == ForceField::Attractor) {
+                Float4x3 d = {Float4(field.position.x) - p.x, Float4(field.position.y) - p.y, Float4(field.position.z) - p.z};
+                Float4 inverse = Float4::rsqrt(dot(d, d) + Float4(field.radius * field.radius));
+                Float4 scale = Float4(field.strength) * inverse * inverse * inverse;
+                a = {a.x + d.x * scale, a.y + d.y * scale, a.z + d.z * scale};
+            } else if (field.type == ForceField::Vortex) {
+                Float4x3 axis = {Float4(field.vector.x), Float4(field.vector.y), Float4(field.vector.z)};
+                Float4x3 d = {p.x - Float4(field.position.x), p.y - Float4(field.position.y), p.z - Float4(field.position.z)};
+                Float4 along = dot(d, axis);
+                Float4x3 radial = {d.x - axis.x * along, d.y - axis.y * along, d.z - axis.z * along};
+                Float4 scale = Float4(field.strength * field.radius) /
+                               (dot(radial, radial) + Float4(field.radius * field.radius));
+                a = {a.x + (axis.y * radial.z - axis.z * radial.y) * scale,
+                     a.y + (axis.z * radial.x - axis.x * radial.z) * scale,
+                     a.z + (axis.x * radial.y - axis.y * radial.x) * scale};
+            }
+        }
+
+        Float4x3 v = {(Float4::load(&_velocity.x[i]) + a.x * dt) * damping,
+                      (Float4::load(&_velocity.y[i]) + a.y * dt) * damping,
+                      (Float4::load(&_velocity.z[i]) + a.z * dt) * damping};
+        p = {p.x + v.x * dt, p.y + v.y * dt, p.z + v.z * dt};
+
+        if (_hasContainer) {
+            // Only velocity into a wall is reflected, so a particle pushed
+            // out past one isn't turned back and forth every step.
+            Float4 hitX = ((p.x < minX) & (v.x < zero)) | ((p.x > maxX) & (v.x > zero));
+            Float4 hitY = ((p.y < minY) & (v.y < zero)) | ((p.y > maxY) & (v.y > zero));
+            Float4 hitZ = ((p.z < minZ) & (v.z < zero)) | ((p.z > maxZ) & (v.z > zero));
+            v = {Float4::select(hitX, v.x * restitution, v.x),
+                 Float4::select(hitY, v.y * restitution, v.y),
+                 Float4::select(hitZ, v.z * restitution, v.z)};
+            p = {Float4::clamp(p.x, minX, maxX), Float4::clamp(p.y, minY, maxY), Float4::clamp(p.z, minZ, maxZ)};
+        }
+
+        v.x.store(&_velocity.x[i]);
+        v.y.store(&_velocity.y[i]);
+        v.z.store(&_velocity.z[i]);
+        p.x.store(&_position.x[i]);
+        p.y.store(&_position.y[i]);
+        p.z.store(&_position.z[i]);
+
+        int expired = (age >= Float4::load(&_lifetime[i])).movemask();
+        if (i + Float4::Width > _count) {
+            expired &= _count > i ? (1 << (_count - i)) - 1 : 0;
+        }
+        for (; expired; expired &= expired - 1) ++dead;
+    }
+    return dead;
+}
+
+void ParticleWorld::removeDead() {
+    // Each dead particle takes the last live one's place; order doesn't
+    // matter to anything drawing or simulating particles. Whole groups that
+    // are all alive are skipped four at a time.
+    size_t i = 0;
+    while (i < _count) {
+        if (i % Float4::Width == 0 && i + Float4::Width <= _count &&
+            !(Float4::load(&_age[i]) >= Float4::load(&_lifetime[i])).movemask()) {
+            i += Float4::Width;
+            continue;
+        }
+        if (_age[i] < _lifetime[i]) {
+            ++i;
+            continue;
+        }
+
+        size_t last = --_count;
+        _position.set(i, _position.get(last));
+        _velocity.set(i, _velocity.get(last));
+        _age[i] = _age[last];
+        _lifetime[i] = _lifetime[last];
+        _color[i] = _color[last];
+    }
+}
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
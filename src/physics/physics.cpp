@@ -1,68 +1,29 @@
 #include "physics/physics.hpp"
+#include "physics/gjk.hpp"
 #include "ecs/transform_component.hpp"
+#include "core/thread_pool.hpp"
 #include <algorithm>
 #include <cmath>
+#include <limits>
+#include <unordered_set>
 
 namespace SFSim {
 namespace Physics {
 
-bool AABB::contains(const Vector3f& point) const {
-    return point.x >= min.x && point.x <= max.x &&
-           point.y >= min.y && point.y <= max.y &&
-           point.z >= min.z && point.z <= max.z;
-}
-
-bool AABB::intersects(const AABB& other) const {
-    return !(other.min.x > max.x || other.max.x < min.x ||
-             other.min.y > max.y || other.max.y < min.y ||
-             other.min.z > max.z || other.max.z < min.z);
-}
-
-AABB AABB::merge(const AABB& other) const {
-    return AABB(
-        Vector3f(std::min(min.x, other.min.x), std::min(min.y, other.min.y), std::min(min.z, other.min.z)),
-        Vector3f(std::max(max.x, other.max.x), std::max(max.y, other.max.y), std::max(max.z, other.max.z))
-    );
-}
-
-void AABB::expand(const Vector3f& point) {
-    min.x = std::min(min.x, point.x);
-    min.y = std::min(min.y, point.y);
-    min.z = std::min(min.z, point.z);
-    max.x = std::max(max.x, point.x);
-    max.y = std::max(max.y, point.y);
-    max.z = std::max(max.z, point.z);
-}
-
-void AABB::expand(float amount) {
-    Vector3f expansion(amount, amount, amount);
-    min -= expansion;
-    max += expansion;
-}
-
-bool Sphere::contains(const Vector3f& point) const {
-    return (point - center).lengthSquared() <= radius * radius;
-}
+namespace {
 
-bool Sphere::intersects(const Sphere& other) const {
-    float distanceSquared = (center - other.center).lengthSquared();
-    float radiusSum = radius + other.radius;
-    return distanceSquared <= radiusSum * radiusSum;
-}
+// Bodies are integrated and mirrored back to their components in blocks
+// this size, while the components are still in cache from loading them.
+constexpr size_t IntegrateBlock = 64;
 
-bool Sphere::intersects(const AABB& aabb) const {
-    Vector3f closest = Vector3f(
-        std::max(aabb.min.x, std::min(center.x, aabb.max.x)),
-        std::max(aabb.min.y, std::min(center.y, aabb.max.y)),
-        std::max(aabb.min.z, std::min(center.z, aabb.max.z))
-    );
-    
-    return (closest - center).lengthSquared() <= radius * radius;
-}
+} // namespace
 
 RigidbodyComponent::RigidbodyComponent()
     : _mass(1.0f)
     , _invMass(1.0f)
+    , _inertia(Vector3f::zero())
+    , _invInertia(Vector3f::zero())
+    , _inertiaFromCollider(true)
     , _velocity(Vector3f::zero())
     , _angularVelocity(Vector3f::zero())
     , _force(Vector3f::zero())
@@ -71,7 +32,33 @@ RigidbodyComponent::RigidbodyComponent()
     , _angularDrag(0.05f)
     , _gravityScale(1.0f)
     , _kinematic(false)
+    , _continuous(false)
+    , _canSleep(true)
+    , _sleeping(false)
+    , _sleepTime(0.0f)
+    , _stepStart(Vector3f::zero())
+    , _sleepIsland(-1)
+    , _solverIndex(-1)
 {
+    // A unit box, until a collider says otherwise.
+    setInertia(Vector3f(1.0f, 1.0f, 1.0f) * (1.0f / 6.0f));
+}
+
+void RigidbodyComponent::setMass(float mass) {
+    if (_inertiaFromCollider && _mass > 0) {
+        setInertia(_inertia * (mass / _mass));
+    }
+    _mass = mass;
+    _invMass = (mass > 0) ? 1.0f / mass : 0.0f;
+}
+
+void RigidbodyComponent::setInertia(const Vector3f& inertia) {
+    _inertia = inertia;
+    _invInertia = Vector3f(
+        inertia.x > 0 ? 1.0f / inertia.x : 0.0f,
+        inertia.y > 0 ? 1.0f / inertia.y : 0.0f,
+        inertia.z > 0 ? 1.0f / inertia.z : 0.0f
+    );
 }
 
 ColliderComponent::ColliderComponent(Type type)
@@ -81,6 +68,9 @@ ColliderComponent::ColliderComponent(Type type)
     , _height(1.0f)
     , _center(Vector3f::zero())
     , _isTrigger(false)
+    , _layer(0)
+    , _collisionMask(AllLayers)
+    , _version(0)
 {
 }
 
@@ -104,279 +94,1623 @@ AABB ColliderComponent::getBounds(const Vector3f& position, const Vector3f& scal
             Vector3f extent(scaledRadius, halfHeight + scaledRadius, scaledRadius);
             return AABB(worldCenter - extent, worldCenter + extent);
         }
+        case Mesh: {
+            if (!_mesh || _mesh->isEmpty()) return AABB(worldCenter, worldCenter);
+            Vector3f a = position + (_center + _mesh->getBounds().min) * scale;
+            Vector3f b = position + (_center + _mesh->getBounds().max) * scale;
+            AABB bounds(a, a);
+            bounds.expand(b);
+            return bounds;
+        }
+        case Heightfield: {
+            if (!_heightfield || _heightfield->isEmpty()) return AABB(worldCenter, worldCenter);
+            Vector3f a = position + (_center + _heightfield->getBounds().min) * scale;
+            Vector3f b = position + (_center + _heightfield->getBounds().max) * scale;
+            AABB bounds(a, a);
+            bounds.expand(b);
+            return bounds;
+        }
+        case ConvexHull: {
+            if (!_convexHull || _convexHull->isEmpty()) return AABB(worldCenter, worldCenter);
+            Vector3f a = position + (_center + _convexHull->getBounds().min) * scale;
+            Vector3f b = position + (_center + _convexHull->getBounds().max) * scale;
+            AABB bounds(a, a);
+            bounds.expand(b);
+            return bounds;
+        }
     }
     return AABB();
 }
 
-Sphere ColliderComponent::getBoundingSphere(const Vector3f& position, const Vector3f& scale) const {
+Physics::Sphere ColliderComponent::getBoundingSphere(const Vector3f& position, const Vector3f& scale) const {
     Vector3f worldCenter = position + _center;
     
     switch (_type) {
         case Box: {
             float scaledRadius = (_size * scale).length() * 0.5f;
-            return Sphere(worldCenter, scaledRadius);
+            return Physics::Sphere(worldCenter, scaledRadius);
         }
         case Sphere: {
             float scaledRadius = _radius * std::max({scale.x, scale.y, scale.z});
-            return Sphere(worldCenter, scaledRadius);
+            return Physics::Sphere(worldCenter, scaledRadius);
         }
         case Capsule: {
             float scaledRadius = _radius * std::max(scale.x, scale.z);
             float scaledHeight = _height * scale.y;
             float totalRadius = scaledRadius + scaledHeight * 0.5f;
-            return Sphere(worldCenter, totalRadius);
+            return Physics::Sphere(worldCenter, totalRadius);
+        }
+        case Mesh:
+        case Heightfield:
+        case ConvexHull: {
+            AABB bounds = getBounds(position, scale);
+            return Physics::Sphere(bounds.getCenter(), bounds.getExtents().length());
         }
     }
-    return Sphere();
+    return Physics::Sphere();
+}
+
+Vector3f ColliderComponent::getInertiaTensor(float mass, const Vector3f& scale) const {
+    auto box = [mass](const Vector3f& size) {
+        Vector3f sq(size.x * size.x, size.y * size.y, size.z * size.z);
+        return Vector3f(sq.y + sq.z, sq.x + sq.z, sq.x + sq.y) * (mass / 12.0f);
+    };
+    
+    switch (_type) {
+        case Box:
+            return box(_size * scale);
+        case Sphere: {
+            float radius = _radius * std::max({scale.x, scale.y, scale.z});
+            float moment = 0.4f * mass * radius * radius;
+            return Vector3f(moment, moment, moment);
+        }
+        case Capsule: {
+            // A cylinder along y plus the two hemispheres, mass split by volume.
+            float r = _radius * std::max(scale.x, scale.z);
+            float h = _height * scale.y;
+            float cylinder = r * r * h;
+            float caps = r * r * r * (4.0f / 3.0f);
+            float cylinderMass = mass * cylinder / (cylinder + caps);
+            float capsMass = mass - cylinderMass;
+            float axial = cylinderMass * r * r * 0.5f + capsMass * r * r * 0.4f;
+            float transverse = cylinderMass * (h * h / 12.0f + r * r * 0.25f) +
+                               capsMass * (r * r * 0.4f + h * h * 0.25f + h * r * 0.375f);
+            return Vector3f(transverse, axial, transverse);
+        }
+        case Mesh:
+            if (!_mesh || _mesh->isEmpty()) return box(Vector3f::zero());
+            return box(_mesh->getBounds().getSize() * scale);
+        case Heightfield:
+            if (!_heightfield || _heightfield->isEmpty()) return box(Vector3f::zero());
+            return box(_heightfield->getBounds().getSize() * scale);
+        case ConvexHull:
+            if (!_convexHull || _convexHull->isEmpty()) return box(Vector3f::zero());
+            return box(_convexHull->getBounds().getSize() * scale);
+    }
+    return Vector3f::zero();
 }
 
 PhysicsSystem::PhysicsSystem()
     : _gravity(0, -9.81f, 0)
     , _simulationSpeed(1.0f)
+    , _indexStamp(0)
+    , _parallelRaycastThreshold(4096)
+    , _step(0)
+    , _awakeBodyCount(0)
+    , _sleepLinearSpeed(0.05f)
+    , _sleepAngularSpeed(0.05f)
+    , _timeToSleep(0.5f)
+    , _sleepingEnabled(true)
+    , _solverIterations(8)
 {
+    _layerMatrix.fill(AllLayers);
+    _staticIndex.setMargin(0.0f);
+}
+
+void PhysicsSystem::setLayersCollide(int layerA, int layerB, bool collide) {
+    layerA = clampLayer(layerA);
+    layerB = clampLayer(layerB);
+    if (collide) {
+        _layerMatrix[layerA] |= 1u << layerB;
+        _layerMatrix[layerB] |= 1u << layerA;
+    } else {
+        _layerMatrix[layerA] &= ~(1u << layerB);
+        _layerMatrix[layerB] &= ~(1u << layerA);
+    }
 }
 
 void PhysicsSystem::update(float deltaTime, const std::vector<std::unique_ptr<Entity>>& entities) {
     float scaledDeltaTime = deltaTime * _simulationSpeed;
     
-    auto rigidbodies = getEntitiesWith<RigidbodyComponent, TransformComponent>(entities);
+    if (!_bodyScan.isCurrent(entities)) {
+        _bodyScan.record(entities);
+        _bodyEntities = getEntitiesWith<RigidbodyComponent, TransformComponent>(entities);
+        dropRemovedBodies(entities);
+    }
     
-    for (Entity* entity : rigidbodies) {
+    ++_step;
+    _awakeBodies.clear();
+    _kinematicBodies.clear();
+    _bodyTransforms.clear();
+    _world.clear();
+    size_t mirrored = 0;
+    for (Entity* entity : _bodyEntities) {
         auto* rigidbody = entity->getComponent<RigidbodyComponent>();
         
+        // Woken since the last step: the rest of its island wakes too.
+        if (rigidbody->_sleepIsland >= 0 && !rigidbody->_sleeping) {
+            wakeIsland(rigidbody->_sleepIsland);
+        }
+        if (rigidbody->_sleeping) continue;
+        
         if (!rigidbody->isKinematic()) {
-            integrateVelocity(rigidbody, scaledDeltaTime);
-            integratePosition(entity, rigidbody, scaledDeltaTime);
+            auto* transform = entity->getComponent<TransformComponent>();
+            rigidbody->_stepStart = transform->getPosition();
+            rigidbody->_solverIndex = static_cast<int>(_awakeBodies.size());
+            _awakeBodies.push_back(rigidbody);
+            _bodyTransforms.push_back(transform);
+            _world.add(*rigidbody, transform->getPosition(), transform->getOrientation());
+            
+            if (_world.size() - mirrored == IntegrateBlock) {
+                integrateBlock(mirrored, _world.size(), scaledDeltaTime);
+                mirrored = _world.size();
+            }
+        } else {
+            _kinematicBodies.push_back(rigidbody);
         }
         
         rigidbody->clearForces();
     }
+    integrateBlock(mirrored, _world.size(), scaledDeltaTime);
     
-    checkCollisions(entities);
+    updateSpatialIndex(entities);
+    findContacts();
+    solveContacts();
+    updateEvents();
+    
+    if (_sleepingEnabled) {
+        updateSleeping(scaledDeltaTime);
+    }
+    
+    _awakeBodyCount = _awakeBodies.size();
+    for (RigidbodyComponent* rigidbody : _awakeBodies) {
+        rigidbody->_solverIndex = -1;
+    }
 }
 
-RaycastHit PhysicsSystem::raycast(const Ray& ray, float maxDistance, const std::vector<std::unique_ptr<Entity>>& entities) {
-    RaycastHit closestHit;
-    closestHit.distance = maxDistance;
+void PhysicsSystem::integrateBlock(size_t begin, size_t end, float deltaTime) {
+    _world.integrate(begin, end, deltaTime, _gravity);
     
-    auto colliders = getEntitiesWith<ColliderComponent, TransformComponent>(entities);
-    
-    for (Entity* entity : colliders) {
-        auto* collider = entity->getComponent<ColliderComponent>();
-        auto* transform = entity->getComponent<TransformComponent>();
+    for (size_t i = begin; i < end; ++i) {
+        RigidbodyComponent* rigidbody = _awakeBodies[i];
+        TransformComponent* transform = _bodyTransforms[i];
+        _world.store(i, *rigidbody);
         
-        if (collider->isTrigger()) continue;
+        Vector3f position = _world.getPosition(i);
+        if (rigidbody->isContinuous()) {
+            const Vector3f& start = rigidbody->_stepStart;
+            position = start + sweepDisplacement(rigidbody->getEntity(), start, transform->getScale(), position - start);
+        }
+        transform->setPosition(position);
         
-        AABB bounds = collider->getBounds(transform->getPosition(), transform->getScale());
+        // Skips the Euler angle update for bodies that aren't turning.
+        const Vector3f& angularVelocity = rigidbody->getAngularVelocity();
+        if (angularVelocity.x != 0 || angularVelocity.y != 0 || angularVelocity.z != 0) {
+            transform->setOrientation(_world.getOrientation(i));
+        }
+    }
+}
+
+void PhysicsSystem::setSleepingEnabled(bool enabled) {
+    _sleepingEnabled = enabled;
+    if (enabled) return;
+    
+    for (size_t i = 0; i < _sleepingIslands.size(); ++i) {
+        if (!_sleepingIslands[i].empty()) {
+            wakeIsland(static_cast<int>(i));
+        }
+    }
+}
+
+void PhysicsSystem::onEntityRemoved(Entity* entity) {
+    auto it = _indexed.find(entity);
+    if (it != _indexed.end()) {
+        releaseCollider(it);
+        _colliderScan.stale = true;
+    }
+    _bodyScan.stale = true;
+    
+    _events.erase(std::remove_if(_events.begin(), _events.end(), [entity](const CollisionEvent& event) {
+        return event.a == entity || event.b == entity;
+    }), _events.end());
+    
+    // Whatever rested on it has to be simulated again.
+    auto* rigidbody = entity->getComponent<RigidbodyComponent>();
+    if (rigidbody && rigidbody->_sleepIsland >= 0) {
+        wakeIsland(rigidbody->_sleepIsland);
+    }
+}
+
+namespace {
+
+// Shapes closer than this count as touching, so resting stacks stay linked
+// into one island even when resolution leaves a hairline gap between them.
+constexpr float ContactMargin = 0.01f;
+
+// Slower impacts don't bounce; otherwise resting contacts jitter forever
+// and never fall asleep.
+constexpr float RestitutionThreshold = 1.0f;
+
+// Coulomb friction between every pair of colliders.
+constexpr float Friction = 0.5f;
+
+bool sameBounds(const AABB& a, const AABB& b) {
+    return a.min.x == b.min.x && a.min.y == b.min.y && a.min.z == b.min.z &&
+           a.max.x == b.max.x && a.max.y == b.max.y && a.max.z == b.max.z;
+}
+
+// Normal from a to b, penetration depth (negative for a gap within the
+// margin) and contact point. Sphere pairs use their spheres, everything
+// else its bounds, touching at the middle of where they overlap.
+bool shapeContact(bool spheres, const AABB& boundsA, const Physics::Sphere& sphereA,
+                  const AABB& boundsB, const Physics::Sphere& sphereB, Vector3f& normal, float& penetration, Vector3f& point) {
+    if (spheres) {
+        Vector3f offset = sphereB.center - sphereA.center;
+        float distance = offset.length();
+        penetration = sphereA.radius + sphereB.radius - distance;
+        if (penetration < -ContactMargin) return false;
+        normal = distance > 1e-6f ? offset / distance : Vector3f::up();
+        point = sphereA.center + normal * (sphereA.radius - penetration * 0.5f);
+        return true;
+    }
+    
+    Vector3f overlap(
+        std::min(boundsA.max.x, boundsB.max.x) - std::max(boundsA.min.x, boundsB.min.x),
+        std::min(boundsA.max.y, boundsB.max.y) - std::max(boundsA.min.y, boundsB.min.y),
+        std::min(boundsA.max.z, boundsB.max.z) - std::max(boundsA.min.z, boundsB.min.z)
+    );
+    if (overlap.x < -ContactMargin || overlap.y < -ContactMargin || overlap.z < -ContactMargin) return false;
+    
+    point = (Vector3f(std::max(boundsA.min.x, boundsB.min.x), std::max(boundsA.min.y, boundsB.min.y), std::max(boundsA.min.z, boundsB.min.z)) +
+             Vector3f(std::min(boundsA.max.x, boundsB.max.x), std::min(boundsA.max.y, boundsB.max.y), std::min(boundsA.max.z, boundsB.max.z))) * 0.5f;
+    Vector3f offset = boundsB.getCenter() - boundsA.getCenter();
+    if (overlap.x <= overlap.y && overlap.x <= overlap.z) {
+        normal = Vector3f(offset.x >= 0 ? 1.0f : -1.0f, 0, 0);
+        penetration = overlap.x;
+    } else if (overlap.y <= overlap.z) {
+        normal = Vector3f(0, offset.y >= 0 ? 1.0f : -1.0f, 0);
+        penetration = overlap.y;
+    } else {
+        normal = Vector3f(0, 0, offset.z >= 0 ? 1.0f : -1.0f);
+        penetration = overlap.z;
+    }
+    return true;
+}
+
+Vector3f closestPointOnTriangle(const Vector3f& p, const Vector3f& a, const Vector3f& b, const Vector3f& c) {
+    // Which of the triangle's regions p projects into, from barycentric
+    // coordinates built up one feature at a time.
+    Vector3f ab = b - a;
+    Vector3f ac = c - a;
+    Vector3f ap = p - a;
+    float d1 = ab.dot(ap);
+    float d2 = ac.dot(ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) return a;
+    
+    Vector3f bp = p - b;
+    float d3 = ab.dot(bp);
+    float d4 = ac.dot(bp);
+    if (d3 >= 0.0f && d4 <= d3) return b;
+    
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + ab * (d1 / (d1 - d3));
+    
+    Vector3f cp = p - c;
+    float d5 = ab.dot(cp);
+    float d6 = ac.dot(cp);
+    if (d6 >= 0.0f && d5 <= d6) return c;
+    
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + ac * (d2 / (d2 - d6));
+    
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    
+    float denominator = 1.0f / (va + vb + vc);
+    return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+// Closest points between segments p1-q1 and p2-q2.
+void closestPointsOnSegments(const Vector3f& p1, const Vector3f& q1, const Vector3f& p2, const Vector3f& q2, Vector3f& c1, Vector3f& c2) {
+    Vector3f d1 = q1 - p1;
+    Vector3f d2 = q2 - p2;
+    Vector3f r = p1 - p2;
+    float a = d1.dot(d1);
+    float e = d2.dot(d2);
+    float f = d2.dot(r);
+    float s = 0.0f;
+    float t = 0.0f;
+    
+    if (a <= 1e-12f && e <= 1e-12f) {
+        c1 = p1;
+        c2 = p2;
+        return;
+    }
+    if (a <= 1e-12f) {
+        t = std::min(std::max(f / e, 0.0f), 1.0f);
+    } else {
+        float c = d1.dot(r);
+        if (e <= 1e-12f) {
+            s = std::min(std::max(-c / a, 0.0f), 1.0f);
+        } else {
+            float b = d1.dot(d2);
+            float denominator = a * e - b * b;
+            s = denominator > 1e-12f ? std::min(std::max((b * f - c * e) / denominator, 0.0f), 1.0f) : 0.0f;
+            t = (b * s + f) / e;
+            if (t < 0.0f) {
+                t = 0.0f;
+                s = std::min(std::max(-c / a, 0.0f), 1.0f);
+            } else if (t > 1.0f) {
+                t = 1.0f;
+                s = std::min(std::max((b - c) / a, 0.0f), 1.0f);
+            }
+        }
+    }
+    c1 = p1 + d1 * s;
+    c2 = p2 + d2 * t;
+}
+
+// Shapes against one triangle. The normal points out of the triangle, the
+// way the shape has to move to leave it; point is on the triangle.
+bool sphereTriangle(const Physics::Sphere& sphere, const Vector3f& a, const Vector3f& b, const Vector3f& c,
+                    Vector3f& normal, float& penetration, Vector3f& point) {
+    point = closestPointOnTriangle(sphere.center, a, b, c);
+    Vector3f offset = sphere.center - point;
+    float distance = offset.length();
+    penetration = sphere.radius - distance;
+    if (penetration < -ContactMargin) return false;
+    normal = distance > 1e-6f ? offset / distance : (b - a).cross(c - a).normalized();
+    return true;
+}
+
+bool capsuleTriangle(const Vector3f& p0, const Vector3f& p1, float radius, const Vector3f& a, const Vector3f& b, const Vector3f& c,
+                     Vector3f& normal, float& penetration, Vector3f& point) {
+    Vector3f face = (b - a).cross(c - a).normalized();
+    float d0 = (p0 - a).dot(face);
+    float d1 = (p1 - a).dot(face);
+    
+    // The axis pierces the triangle: out along whichever side of the face
+    // holds more of it.
+    if ((d0 < 0.0f) != (d1 < 0.0f)) {
+        Vector3f crossing = p0 + (p1 - p0) * (d0 / (d0 - d1));
+        if ((closestPointOnTriangle(crossing, a, b, c) - crossing).lengthSquared() < 1e-10f) {
+            float above = std::max(d0, d1);
+            float below = std::min(d0, d1);
+            normal = above >= -below ? face : -face;
+            penetration = radius + (above >= -below ? -below : above);
+            point = crossing;
+            return true;
+        }
+    }
+    
+    // Otherwise the nearest point of the axis is an end or lies against an
+    // edge, and the capsule collides like a sphere there.
+    Vector3f nearest = p0;
+    float best = (closestPointOnTriangle(p0, a, b, c) - p0).lengthSquared();
+    float end = (closestPointOnTriangle(p1, a, b, c) - p1).lengthSquared();
+    if (end < best) {
+        best = end;
+        nearest = p1;
+    }
+    const Vector3f* corners[3] = {&a, &b, &c};
+    for (int i = 0; i < 3; ++i) {
+        Vector3f onAxis, onEdge;
+        closestPointsOnSegments(p0, p1, *corners[i], *corners[(i + 1) % 3], onAxis, onEdge);
+        float distance = (onAxis - onEdge).lengthSquared();
+        if (distance < best) {
+            best = distance;
+            nearest = onAxis;
+        }
+    }
+    return sphereTriangle(Physics::Sphere(nearest, radius), a, b, c, normal, penetration, point);
+}
+
+// Separating axis test of a world-aligned box against a triangle, keeping
+// the axis of least overlap.
+bool boxTriangle(const AABB& box, const Vector3f& a, const Vector3f& b, const Vector3f& c,
+                 Vector3f& normal, float& penetration, Vector3f& point) {
+    Vector3f center = box.getCenter();
+    Vector3f extents = box.getExtents();
+    Vector3f v[3] = {a - center, b - center, c - center};
+    Vector3f edges[3] = {v[1] - v[0], v[2] - v[1], v[0] - v[2]};
+    
+    Vector3f axes[13];
+    int count = 0;
+    axes[count++] = Vector3f(1, 0, 0);
+    axes[count++] = Vector3f(0, 1, 0);
+    axes[count++] = Vector3f(0, 0, 1);
+    axes[count++] = edges[0].cross(edges[1]);
+    for (const Vector3f& edge : edges) {
+        axes[count++] = Vector3f(0, -edge.z, edge.y);
+        axes[count++] = Vector3f(edge.z, 0, -edge.x);
+        axes[count++] = Vector3f(-edge.y, edge.x, 0);
+    }
+    
+    penetration = std::numeric_limits<float>::max();
+    for (int i = 0; i < count; ++i) {
+        float length = axes[i].length();
+        if (length < 1e-6f) continue;
+        Vector3f axis = axes[i] / length;
         
-        Vector3f invDir = Vector3f(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z);
-        Vector3f t1 = (bounds.min - ray.origin) * invDir;
-        Vector3f t2 = (bounds.max - ray.origin) * invDir;
+        float p0 = v[0].dot(axis);
+        float p1 = v[1].dot(axis);
+        float p2 = v[2].dot(axis);
+        float low = std::min({p0, p1, p2});
+        float high = std::max({p0, p1, p2});
+        float reach = extents.x * std::abs(axis.x) + extents.y * std::abs(axis.y) + extents.z * std::abs(axis.z);
+        // Out through whichever side of the triangle is nearer.
+        float negative = reach - low;
+        float positive = high + reach;
+        float overlap = std::min(negative, positive);
+        if (overlap < -ContactMargin) return false;
         
-        Vector3f tMin = Vector3f(std::min(t1.x, t2.x), std::min(t1.y, t2.y), std::min(t1.z, t2.z));
-        Vector3f tMax = Vector3f(std::max(t1.x, t2.x), std::max(t1.y, t2.y), std::max(t1.z, t2.z));
+        if (overlap < penetration) {
+            penetration = overlap;
+            normal = negative < positive ? -axis : axis;
+        }
+    }
+    
+    point = closestPointOnTriangle(center, a, b, c);
+    return true;
+}
+
+// Time of impact, as a fraction of displacement, of a box moving into a
+// stationary one. The normal faces the moving box. Boxes that already
+// overlap are left to the contact solver.
+bool sweepBox(const AABB& moving, const Vector3f& displacement, const AABB& target, float maxFraction, float& fraction, Vector3f& normal) {
+    Vector3f extents = moving.getExtents();
+    Vector3f center = moving.getCenter();
+    const float origin[3] = {center.x, center.y, center.z};
+    const float delta[3] = {displacement.x, displacement.y, displacement.z};
+    const float low[3] = {target.min.x - extents.x, target.min.y - extents.y, target.min.z - extents.z};
+    const float high[3] = {target.max.x + extents.x, target.max.y + extents.y, target.max.z + extents.z};
+    
+    float enter = -std::numeric_limits<float>::max();
+    float exit = maxFraction;
+    int axis = -1;
+    for (int i = 0; i < 3; ++i) {
+        if (std::abs(delta[i]) < 1e-12f) {
+            if (origin[i] <= low[i] || origin[i] >= high[i]) return false;
+            continue;
+        }
         
-        float tNear = std::max({tMin.x, tMin.y, tMin.z});
-        float tFar = std::min({tMax.x, tMax.y, tMax.z});
+        float t1 = (low[i] - origin[i]) / delta[i];
+        float t2 = (high[i] - origin[i]) / delta[i];
+        if (t1 > t2) std::swap(t1, t2);
+        if (t1 > enter) {
+            enter = t1;
+            axis = i;
+        }
+        exit = std::min(exit, t2);
+    }
+    
+    if (axis < 0 || enter < 0.0f || enter > exit) return false;
+    
+    fraction = enter;
+    normal = Vector3f::zero();
+    float side = delta[axis] > 0 ? -1.0f : 1.0f;
+    if (axis == 0) normal.x = side;
+    else if (axis == 1) normal.y = side;
+    else normal.z = side;
+    return true;
+}
+
+bool sweepSphere(const Physics::Sphere& moving, const Vector3f& displacement, const Physics::Sphere& target, float maxFraction, float& fraction, Vector3f& normal) {
+    Vector3f offset = moving.center - target.center;
+    float radius = moving.radius + target.radius;
+    float c = offset.lengthSquared() - radius * radius;
+    float a = displacement.lengthSquared();
+    float b = offset.dot(displacement);
+    if (c <= 0.0f || b >= 0.0f || a < 1e-12f) return false;
+    
+    float discriminant = b * b - a * c;
+    if (discriminant < 0.0f) return false;
+    
+    float t = (-b - std::sqrt(discriminant)) / a;
+    if (t > maxFraction) return false;
+    
+    fraction = t;
+    normal = (offset + displacement * t).normalized();
+    return true;
+}
+
+// A collider as GJK sees it. Capsules stand upright and everything but
+// spheres and hulls is its world-aligned bounds, as elsewhere in the solver.
+ConvexShape convexShape(ColliderComponent::Type type, const AABB& bounds, const Physics::Sphere& sphere,
+                        const ConvexHull* hull, const Matrix4x4& hullToWorld) {
+    if (hull) return ConvexShape::convexHull(*hull, hullToWorld);
+    
+    switch (type) {
+        case ColliderComponent::Sphere:
+            return ConvexShape::point(sphere.center, sphere.radius);
+        case ColliderComponent::Capsule: {
+            Vector3f extents = bounds.getExtents();
+            float radius = std::min(extents.x, extents.z);
+            return ConvexShape::segment(bounds.getCenter(), Vector3f(0, std::max(extents.y - radius, 0.0f), 0), radius);
+        }
+        default:
+            return ConvexShape::box(bounds.getCenter(), bounds.getExtents());
+    }
+}
+
+} // namespace
+
+bool PhysicsSystem::collide(const IndexedCollider& a, const IndexedCollider& b, Vector3f& normal, float& penetration, Vector3f& point, Vector3f* axis) {
+    if (a.hasTriangles() != b.hasTriangles()) {
+        bool flip = a.hasTriangles();
+        if (!triangleContact(flip ? b : a, flip ? a : b, normal, penetration, point)) return false;
+        if (flip) normal = -normal;
+        return true;
+    }
+    
+    if (!isConvexPair(a, b)) {
+        bool spheres = a.type == ColliderComponent::Sphere && b.type == ColliderComponent::Sphere;
+        return shapeContact(spheres, a.bounds, a.sphere, b.bounds, b.sphere, normal, penetration, point);
+    }
+    
+    Vector3f cold = Vector3f::zero();
+    return convexContact(convexShape(a.type, a.bounds, a.sphere, a.hull.get(), a.meshToWorld),
+                         convexShape(b.type, b.bounds, b.sphere, b.hull.get(), b.meshToWorld),
+                         ContactMargin, axis ? *axis : cold, normal, penetration, point);
+}
+
+bool PhysicsSystem::isConvexPair(const IndexedCollider& a, const IndexedCollider& b) {
+    // Two spheres meet exactly as spheres. Two boxes (or triangle
+    // colliders) meet as their bounds, which also keeps box stacks resting
+    // face to face rather than on one point.
+    auto isBounds = [](const IndexedCollider& c) {
+        return !c.hull && c.type != ColliderComponent::Sphere && c.type != ColliderComponent::Capsule;
+    };
+    if (a.hasTriangles() != b.hasTriangles()) return false;
+    if (a.type == ColliderComponent::Sphere && b.type == ColliderComponent::Sphere) return false;
+    return !(isBounds(a) && isBounds(b));
+}
+
+bool PhysicsSystem::collidePair(const IndexedCollider& a, const IndexedCollider& b, Vector3f& normal, float& penetration, Vector3f& point) {
+    if (!isConvexPair(a, b)) return collide(a, b, normal, penetration, point);
+    
+    // Cached axes run from the lower pair id to the higher. An axis left by
+    // a pair that has since split up (or whose proxy ids were reused) only
+    // costs its first search a few iterations.
+    bool flip = b.pairId < a.pairId;
+    const IndexedCollider& first = flip ? b : a;
+    const IndexedCollider& second = flip ? a : b;
+    CachedAxis& cached = _separatingAxes[(static_cast<uint64_t>(first.pairId) << 32) | second.pairId];
+    cached.step = _step;
+    if (!collide(first, second, normal, penetration, point, &cached.axis)) return false;
+    if (flip) normal = -normal;
+    return true;
+}
+
+bool PhysicsSystem::triangleContact(const IndexedCollider& shape, const IndexedCollider& surface, Vector3f& normal, float& penetration, Vector3f& point) {
+    AABB search = shape.bounds;
+    search.expand(ContactMargin);
+    AABB local = search.transformed(surface.worldToMesh);
+    
+    // Capsules stand upright and boxes stay world-aligned, as they do
+    // everywhere else in the solver.
+    Vector3f center = shape.bounds.getCenter();
+    Vector3f extents = shape.bounds.getExtents();
+    float radius = std::min(extents.x, extents.z);
+    Vector3f axis(0, std::max(extents.y - radius, 0.0f), 0);
+    
+    ConvexShape hull = convexShape(shape.type, shape.bounds, shape.sphere, shape.hull.get(), shape.meshToWorld);
+    
+    // The deepest triangle gives the pair's one contact.
+    bool found = false;
+    penetration = -std::numeric_limits<float>::max();
+    auto test = [&](const Vector3f& a, const Vector3f& b, const Vector3f& c, unsigned int) {
+        Vector3f worldA = surface.meshToWorld.transformPointAffine(a);
+        Vector3f worldB = surface.meshToWorld.transformPointAffine(b);
+        Vector3f worldC = surface.meshToWorld.transformPointAffine(c);
+        
+        Vector3f triangleNormal, trianglePoint;
+        float depth;
+        bool hit;
+        if (shape.hull) {
+            Vector3f cold = Vector3f::zero();
+            hit = convexContact(hull, ConvexShape::triangle(worldA, worldB, worldC), ContactMargin, cold, triangleNormal, depth, trianglePoint);
+            triangleNormal = -triangleNormal;
+        } else {
+            switch (shape.type) {
+                case ColliderComponent::Sphere:
+                    hit = sphereTriangle(shape.sphere, worldA, worldB, worldC, triangleNormal, depth, trianglePoint);
+                    break;
+                case ColliderComponent::Capsule:
+                    hit = capsuleTriangle(center - axis, center + axis, radius, worldA, worldB, worldC, triangleNormal, depth, trianglePoint);
+                    break;
+                default:
+                    hit = boxTriangle(shape.bounds, worldA, worldB, worldC, triangleNormal, depth, trianglePoint);
+                    break;
+            }
+        }
+        if (hit && depth > penetration) {
+            penetration = depth;
+            normal = -triangleNormal;
+            point = trianglePoint;
+            found = true;
+        }
+    };
+    
+    if (surface.mesh) {
+        surface.mesh->query(local, test);
+    } else {
+        surface.heightfield->query(local, test);
+    }
+    return found;
+}
+
+Vector3f PhysicsSystem::sweepDisplacement(Entity* entity, const Vector3f& position, const Vector3f& scale, const Vector3f& displacement) {
+    auto* collider = entity->getComponent<ColliderComponent>();
+    float distance = displacement.length();
+    if (!collider || collider->isTrigger() || distance <= ContactMargin) return displacement;
+    
+    // Spheres sweep against spheres exactly, and every other pair except
+    // those with triangle colliders sweeps as boxes: the same shapes the
+    // contact solver uses. Targets are taken at their indexed pose, which is
+    // exact for the static geometry that fast bodies tunnel through.
+    bool isSphere = collider->getColliderType() == ColliderComponent::Sphere;
+    AABB bounds = collider->getBounds(position, scale);
+    Physics::Sphere sphere = collider->getBoundingSphere(position, scale);
+    
+    // Triangle colliders are traced along the path of the shape's center,
+    // which stops where the shape's reach along the surface normal touches.
+    Ray path;
+    path.origin = bounds.getCenter();
+    path.direction = displacement;
+    Vector3f pathInverse = path.getInverseDirection();
+    Vector3f extents = bounds.getExtents();
+    float reachFraction = (isSphere ? sphere.radius : extents.length()) / distance;
+    auto sweepTriangles = [&](const IndexedCollider& target, float maxFraction, float& hitFraction, Vector3f& hitNormal) {
+        RaycastHit surface;
+        if (!raycastCollider(target, path, pathInverse, maxFraction + reachFraction, surface)) return false;
         
-        if (tNear <= tFar && tFar > 0 && tNear < closestHit.distance) {
-            closestHit.hit = true;
-            closestHit.distance = tNear > 0 ? tNear : tFar;
-            closestHit.point = ray.getPoint(closestHit.distance);
-            closestHit.entity = entity;
+        const Vector3f& n = surface.normal;
+        float approach = -displacement.dot(n);
+        if (approach <= 1e-6f) return false;
+        float reach = isSphere ? sphere.radius : extents.x * std::abs(n.x) + extents.y * std::abs(n.y) + extents.z * std::abs(n.z);
+        hitFraction = surface.distance - reach / approach;
+        hitNormal = n;
+        return hitFraction >= 0.0f && hitFraction <= maxFraction;
+    };
+    
+    float fraction = 1.0f;
+    Vector3f normal = Vector3f::zero();
+    uint32_t layerBit = 1u << collider->getLayer();
+    uint32_t layerMask = collider->getCollisionMask() & _layerMatrix[collider->getLayer()];
+    for (const DynamicAABBTree* tree : {&_index, &_staticIndex}) {
+        // Each tree sweeps the whole displacement; keep to the nearest hit
+        // found so far.
+        tree->sweep(bounds, displacement, layerMask, [&](int proxy, float maxFraction) {
+            maxFraction = std::min(maxFraction, fraction);
+            const auto* target = static_cast<const IndexedCollider*>(tree->getUserData(proxy));
+            if (target->entity == entity || target->trigger || !(target->mask & layerBit)) return maxFraction;
+            
+            float hitFraction;
+            Vector3f hitNormal;
+            bool hit;
+            if (target->hasTriangles()) {
+                hit = sweepTriangles(*target, maxFraction, hitFraction, hitNormal);
+            } else if (isSphere && target->type == ColliderComponent::Sphere) {
+                hit = sweepSphere(sphere, displacement, target->sphere, maxFraction, hitFraction, hitNormal);
+            } else {
+                hit = sweepBox(bounds, displacement, target->bounds, maxFraction, hitFraction, hitNormal);
+            }
+            if (!hit) return maxFraction;
             
-            Vector3f center = bounds.getCenter();
-            Vector3f diff = closestHit.point - center;
-            Vector3f size = bounds.getSize();
+            fraction = hitFraction;
+            normal = hitNormal;
+            return hitFraction;
+        });
+    }
+    
+    if (fraction >= 1.0f) return displacement;
+    
+    // Stop inside the contact margin, so the solver handles the impact this
+    // step, and slide along the surface for the rest of the motion.
+    float stop = std::max(fraction - ContactMargin * 0.5f / distance, 0.0f);
+    Vector3f remaining = displacement * (1.0f - fraction);
+    remaining -= normal * std::min(remaining.dot(normal), 0.0f);
+    return displacement * stop + remaining;
+}
+
+void PhysicsSystem::updateSpatialIndex(const std::vector<std::unique_ptr<Entity>>& entities) {
+    // Nothing added, removed or switched on or off: only what moved or
+    // changed is indexed again, and static colliders cost a version check.
+    if (_colliderScan.isCurrent(entities)) {
+        for (IndexedCollider* indexed : _dynamicColliders) {
+            if (indexed->body->_sleeping) continue;
+            indexCollider(indexed->entity, indexed->collider, indexed->transform, indexed->body);
+        }
+        for (StaticWatch& watch : _staticColliders) {
+            if (watch.collider->getVersion() == watch.colliderVersion &&
+                watch.transform->getVersion() == watch.transformVersion) continue;
+            IndexedCollider* indexed = watch.indexed;
+            indexCollider(indexed->entity, indexed->collider, indexed->transform, nullptr);
+            watch.colliderVersion = indexed->colliderVersion;
+            watch.transformVersion = indexed->transformVersion;
+        }
+        return;
+    }
+    
+    _colliderScan.record(entities);
+    _dynamicColliders.clear();
+    _staticColliders.clear();
+    ++_indexStamp;
+    size_t stamped = 0;
+    
+    for (const auto& owned : entities) {
+        Entity* entity = owned.get();
+        if (!entity->isActive()) continue;
+        
+        // Static colliders that haven't changed since they were indexed cost
+        // one lookup; their components aren't even fetched.
+        auto it = _indexed.find(entity);
+        bool components = it != _indexed.end() && it->second.componentVersion == entity->getComponentVersion();
+        if (components && it->second.isStatic &&
+            it->second.colliderVersion == it->second.collider->getVersion() &&
+            it->second.transformVersion == it->second.transform->getTransform().getVersion()) {
+            it->second.stamp = _indexStamp;
+            watchStatic(it->second);
+            ++stamped;
+            continue;
+        }
+        
+        auto* collider = entity->getComponent<ColliderComponent>();
+        auto* transform = entity->getComponent<TransformComponent>();
+        if (!collider || !transform) continue;
+        auto* rigidbody = entity->getComponent<RigidbodyComponent>();
+        
+        if (it != _indexed.end()) {
+            // Asleep, so it has not moved since it was last indexed.
+            if (components && rigidbody && rigidbody->_sleeping) {
+                it->second.stamp = _indexStamp;
+                _dynamicColliders.push_back(&it->second);
+                ++stamped;
+                continue;
+            }
+            // Gained or lost its rigidbody, so it belongs in the other tree.
+            if (it->second.isStatic != (rigidbody == nullptr)) {
+                releaseCollider(it);
+            }
+        }
+        
+        IndexedCollider& indexed = indexCollider(entity, collider, transform, rigidbody);
+        if (indexed.isStatic) {
+            watchStatic(indexed);
+        } else {
+            _dynamicColliders.push_back(&indexed);
+        }
+        ++stamped;
+    }
+    
+    // Drop colliders that were removed, disabled or lost a component.
+    if (stamped == _indexed.size()) return;
+    for (auto it = _indexed.begin(); it != _indexed.end();) {
+        if (it->second.stamp != _indexStamp) {
+            releaseCollider(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void PhysicsSystem::watchStatic(IndexedCollider& indexed) {
+    StaticWatch watch;
+    watch.collider = indexed.collider;
+    watch.transform = &indexed.transform->getTransform();
+    watch.colliderVersion = indexed.colliderVersion;
+    watch.transformVersion = indexed.transformVersion;
+    watch.indexed = &indexed;
+    _staticColliders.push_back(watch);
+}
+
+void PhysicsSystem::releaseCollider(std::unordered_map<Entity*, IndexedCollider>::iterator it) {
+    const IndexedCollider* collider = &it->second;
+    _activePairs.erase(std::remove_if(_activePairs.begin(), _activePairs.end(), [collider](const TrackedPair& pair) {
+        return pair.a == collider || pair.b == collider;
+    }), _activePairs.end());
+    
+    treeOf(*collider).destroyProxy(collider->proxy);
+    _indexed.erase(it);
+}
+
+PhysicsSystem::IndexedCollider& PhysicsSystem::indexCollider(Entity* entity, ColliderComponent* collider, TransformComponent* transform, RigidbodyComponent* body) {
+    AABB bounds;
+    Physics::Sphere sphere;
+    bool isMesh = collider->getColliderType() == ColliderComponent::Mesh &&
+                  collider->getMesh() && !collider->getMesh()->isEmpty();
+    bool isHeightfield = collider->getColliderType() == ColliderComponent::Heightfield &&
+                         collider->getHeightfield() && !collider->getHeightfield()->isEmpty();
+    bool isHull = collider->getColliderType() == ColliderComponent::ConvexHull &&
+                  collider->getConvexHull() && !collider->getConvexHull()->isEmpty();
+    Matrix4x4 meshToWorld;
+    if (isMesh || isHull) {
+        // Meshes and hulls follow the full world transform, rotation
+        // included, so raycasts and GJK can trace them exactly.
+        const AABB& meshBounds = isMesh ? collider->getMesh()->getBounds() : collider->getConvexHull()->getBounds();
+        AABB local(meshBounds.min + collider->getCenter(), meshBounds.max + collider->getCenter());
+        bounds = local.transformed(transform->getWorldMatrix());
+        sphere = Physics::Sphere(bounds.getCenter(), bounds.getExtents().length());
+        meshToWorld = transform->getWorldMatrix() * Matrix4x4::translation(collider->getCenter());
+    } else if (isHeightfield) {
+        bounds = collider->getBounds(transform->getPosition(), transform->getScale());
+        sphere = collider->getBoundingSphere(transform->getPosition(), transform->getScale());
+        meshToWorld = Matrix4x4::translation(transform->getPosition() + collider->getCenter() * transform->getScale()) *
+                      Matrix4x4::scale(transform->getScale());
+    } else {
+        bounds = collider->getBounds(transform->getPosition(), transform->getScale());
+        sphere = collider->getBoundingSphere(transform->getPosition(), transform->getScale());
+    }
+    
+    // The indexed box has to cover the bounding sphere as well, which
+    // overlapSphere tests against and which can be larger than the box.
+    Vector3f extent(sphere.radius, sphere.radius, sphere.radius);
+    AABB indexBounds = bounds.merge(AABB(sphere.center - extent, sphere.center + extent));
+    
+    uint32_t layerBit = 1u << collider->getLayer();
+    bool moved = true;
+    auto it = _indexed.find(entity);
+    if (it == _indexed.end()) {
+        IndexedCollider& indexed = _indexed[entity];
+        indexed.entity = entity;
+        indexed.isStatic = body == nullptr;
+        indexed.searched = 0;
+        indexed.proxy = treeOf(indexed).createProxy(indexBounds, &indexed, layerBit);
+        indexed.pairId = (static_cast<uint32_t>(indexed.proxy) << 1) | (indexed.isStatic ? 1u : 0u);
+        it = _indexed.find(entity);
+    } else {
+        moved = !sameBounds(bounds, it->second.bounds);
+        Vector3f displacement = bounds.getCenter() - it->second.bounds.getCenter();
+        DynamicAABBTree& tree = treeOf(it->second);
+        tree.moveProxy(it->second.proxy, indexBounds, displacement);
+        tree.setProxyLayers(it->second.proxy, layerBit);
+    }
+    
+    if (body && body->_inertiaFromCollider) {
+        body->setInertia(collider->getInertiaTensor(body->_mass, transform->getScale()));
+    }
+    
+    IndexedCollider& indexed = it->second;
+    indexed.body = body;
+    indexed.collider = collider;
+    indexed.transform = transform;
+    indexed.componentVersion = entity->getComponentVersion();
+    indexed.colliderVersion = collider->getVersion();
+    indexed.transformVersion = transform->getTransform().getVersion();
+    indexed.type = collider->getColliderType();
+    indexed.bounds = bounds;
+    indexed.sphere = sphere;
+    indexed.trigger = collider->isTrigger();
+    indexed.layer = collider->getLayer();
+    indexed.mask = collider->getCollisionMask();
+    indexed.stamp = _indexStamp;
+    indexed.mesh.reset();
+    indexed.heightfield.reset();
+    indexed.hull.reset();
+    if (isMesh) {
+        indexed.mesh = collider->getMesh();
+    } else if (isHeightfield) {
+        indexed.heightfield = collider->getHeightfield();
+    } else if (isHull) {
+        indexed.hull = collider->getConvexHull();
+    }
+    if (isMesh || isHeightfield || isHull) {
+        indexed.meshToWorld = meshToWorld;
+        indexed.worldToMesh = meshToWorld.invertedAffine();
+    }
+    
+    // The step never moves static or kinematic colliders, so game code did;
+    // anything asleep against them has to react.
+    if (moved && !indexed.trigger && (!body || body->isKinematic())) {
+        wakeTouching(bounds, indexed.mask & _layerMatrix[indexed.layer]);
+    }
+    
+    return indexed;
+}
+
+void PhysicsSystem::findContacts() {
+    _contacts.clear();
+    _pairs.clear();
+    
+    for (auto it = _separatingAxes.begin(); it != _separatingAxes.end();) {
+        if (it->second.step + 1 < _step) {
+            it = _separatingAxes.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    
+    // Only awake and kinematic bodies search, so sleeping piles cost nothing
+    // here. A pair of awake bodies is taken by whichever comes first in the
+    // list. Kinematic bodies and trigger bodies only look for trigger
+    // overlaps. Static colliders never search, so static pairs cost nothing.
+    size_t sourceCount = _awakeBodies.size();
+    size_t searchCount = sourceCount + _kinematicBodies.size();
+    for (size_t i = 0; i < searchCount; ++i) {
+        RigidbodyComponent* body = i < sourceCount ? _awakeBodies[i] : _kinematicBodies[i - sourceCount];
+        auto it = _indexed.find(body->getEntity());
+        if (it == _indexed.end()) continue;
+        IndexedCollider* a = &it->second;
+        a->searched = _step;
+        bool solid = i < sourceCount && !a->trigger;
+        
+        // The tree skips everything on layers a doesn't collide with; b's
+        // own mask is checked per pair.
+        AABB search = a->bounds;
+        search.expand(ContactMargin);
+        uint32_t layerBit = 1u << a->layer;
+        auto touch = [&](IndexedCollider* b) {
+            if (b == a || !(b->mask & layerBit)) return true;
             
-            Vector3f normal = Vector3f::zero();
-            float maxComponent = 0;
+            Vector3f normal;
+            float penetration;
+            Vector3f point;
             
-            if (std::abs(diff.x / size.x) > maxComponent) {
-                maxComponent = std::abs(diff.x / size.x);
-                normal = Vector3f(diff.x > 0 ? 1 : -1, 0, 0);
+            if (a->trigger || b->trigger) {
+                if (a->trigger != b->trigger &&
+                    collidePair(*a, *b, normal, penetration, point) && penetration >= 0.0f) {
+                    addPair(a, b, Vector3f::zero(), penetration, true);
+                }
+                return true;
             }
-            if (std::abs(diff.y / size.y) > maxComponent) {
-                maxComponent = std::abs(diff.y / size.y);
-                normal = Vector3f(0, diff.y > 0 ? 1 : -1, 0);
+            if (!solid) return true;
+            
+            RigidbodyComponent* other = b->body;
+            bool simulated = other && !other->isKinematic();
+            if (simulated && other->_solverIndex >= 0 && static_cast<size_t>(other->_solverIndex) < i) return true;
+            
+            if (!collidePair(*a, *b, normal, penetration, point)) return true;
+            
+            Contact contact;
+            contact.a = a;
+            contact.b = b;
+            contact.normal = normal;
+            contact.penetration = penetration;
+            
+            // Only spheres turn on contact: other shapes still collide as
+            // their world-aligned bounds, which no torque could ever tip, so
+            // contacts would spin them up for good. Hulls do collide as
+            // rotated, but resting on a single contact point per pair they
+            // would rock on every face.
+            contact.armA = a->type == ColliderComponent::Sphere ? point - a->sphere.center : Vector3f::zero();
+            contact.armB = b->type == ColliderComponent::Sphere ? point - b->sphere.center : Vector3f::zero();
+            
+            if (simulated && other->_sleeping) {
+                wakeIsland(other->_sleepIsland);
             }
-            if (std::abs(diff.z / size.z) > maxComponent) {
-                normal = Vector3f(0, 0, diff.z > 0 ? 1 : -1);
+            if (simulated && other->_solverIndex < 0) {
+                other->_solverIndex = static_cast<int>(_awakeBodies.size());
+                _awakeBodies.push_back(other);
             }
             
-            closestHit.normal = normal;
+            _contacts.push_back(contact);
+            return true;
+        };
+        
+        uint32_t layerMask = a->mask & _layerMatrix[a->layer];
+        for (const DynamicAABBTree* tree : {&_index, &_staticIndex}) {
+            tree->query(search, layerMask, [&](int proxy) {
+                return touch(static_cast<IndexedCollider*>(tree->getUserData(proxy)));
+            });
         }
     }
+}
+
+void PhysicsSystem::addPair(IndexedCollider* a, IndexedCollider* b, const Vector3f& normal, float penetration, bool trigger) {
+    TrackedPair pair;
+    bool flip = b->pairId < a->pairId;
+    pair.a = flip ? b : a;
+    pair.b = flip ? a : b;
+    pair.key = (static_cast<uint64_t>(pair.a->pairId) << 32) | pair.b->pairId;
+    pair.normal = flip ? -normal : normal;
+    pair.penetration = penetration;
+    pair.trigger = trigger;
+    _pairs.push_back(pair);
+}
+
+void PhysicsSystem::solveContacts() {
+    for (const Contact& contact : _contacts) {
+        resolveCollision(contact, std::max(contact.penetration, 0.0f));
+    }
     
-    return closestHit;
+    // Further velocity-only passes let impulses travel through stacks;
+    // a single pass leaves every body above the bottom one sinking.
+    for (int iteration = 1; iteration < _solverIterations; ++iteration) {
+        for (const Contact& contact : _contacts) {
+            resolveCollision(contact, 0.0f);
+        }
+    }
+    
+    // Keep the index (and the bounds the next contacts read) in step with
+    // the bodies resolution pushed apart.
+    for (const Contact& contact : _contacts) {
+        if (contact.penetration <= 0.0f) continue;
+        for (IndexedCollider* indexed : {contact.a, contact.b}) {
+            if (!indexed->body || indexed->body->isKinematic()) continue;
+            Entity* entity = indexed->entity;
+            indexCollider(entity, entity->getComponent<ColliderComponent>(), entity->getComponent<TransformComponent>(), indexed->body);
+        }
+    }
 }
 
-std::vector<Entity*> PhysicsSystem::overlapSphere(const Vector3f& center, float radius, const std::vector<std::unique_ptr<Entity>>& entities) {
-    std::vector<Entity*> overlapping;
-    Sphere querySphere(center, radius);
+void PhysicsSystem::updateEvents() {
+    for (const Contact& contact : _contacts) {
+        addPair(contact.a, contact.b, contact.normal, contact.penetration, false);
+    }
     
-    auto colliders = getEntitiesWith<ColliderComponent, TransformComponent>(entities);
+    // Trigger pairs are found from both sides when both can move.
+    std::sort(_pairs.begin(), _pairs.end());
+    _pairs.erase(std::unique(_pairs.begin(), _pairs.end(), [](const TrackedPair& x, const TrackedPair& y) {
+        return x.key == y.key;
+    }), _pairs.end());
     
-    for (Entity* entity : colliders) {
-        auto* collider = entity->getComponent<ColliderComponent>();
-        auto* transform = entity->getComponent<TransformComponent>();
-        
-        Sphere entitySphere = collider->getBoundingSphere(transform->getPosition(), transform->getScale());
+    auto emit = [this](const TrackedPair& pair, CollisionEvent::Type type) {
+        CollisionEvent event;
+        event.a = pair.a->entity;
+        event.b = pair.b->entity;
+        event.normal = pair.normal;
+        event.penetration = pair.penetration;
+        event.type = type;
+        event.trigger = pair.trigger;
+        _pendingEvents.push_back(event);
+    };
+    
+    // Both lists are sorted by key, so one merge pass finds what began,
+    // stayed and ended.
+    _pendingEvents.clear();
+    _mergedPairs.clear();
+    size_t current = 0;
+    size_t previous = 0;
+    while (current < _pairs.size() || previous < _activePairs.size()) {
+        bool hasCurrent = current < _pairs.size();
+        bool hasPrevious = previous < _activePairs.size();
         
-        if (querySphere.intersects(entitySphere)) {
-            overlapping.push_back(entity);
+        if (hasCurrent && hasPrevious && _pairs[current].key == _activePairs[previous].key) {
+            emit(_pairs[current], CollisionEvent::Stay);
+            _mergedPairs.push_back(_pairs[current]);
+            ++current;
+            ++previous;
+        } else if (hasCurrent && (!hasPrevious || _pairs[current].key < _activePairs[previous].key)) {
+            emit(_pairs[current], CollisionEvent::Begin);
+            _mergedPairs.push_back(_pairs[current]);
+            ++current;
+        } else {
+            // Not found again. If neither side searched, neither moved, and
+            // the pair still touches.
+            const TrackedPair& pair = _activePairs[previous];
+            if (pair.a->searched == _step || pair.b->searched == _step) {
+                emit(pair, CollisionEvent::End);
+            } else {
+                _mergedPairs.push_back(pair);
+            }
+            ++previous;
         }
     }
     
-    return overlapping;
+    _activePairs.swap(_mergedPairs);
+    _events.swap(_pendingEvents);
 }
 
-std::vector<Entity*> PhysicsSystem::overlapBox(const Vector3f& center, const Vector3f& size, const std::vector<std::unique_ptr<Entity>>& entities) {
-    std::vector<Entity*> overlapping;
-    Vector3f halfSize = size * 0.5f;
-    AABB queryBox(center - halfSize, center + halfSize);
+int PhysicsSystem::findIsland(int body) {
+    while (_islandParent[body] != body) {
+        _islandParent[body] = _islandParent[_islandParent[body]];
+        body = _islandParent[body];
+    }
+    return body;
+}
+
+void PhysicsSystem::updateSleeping(float deltaTime) {
+    int count = static_cast<int>(_awakeBodies.size());
+    _islandParent.resize(count);
+    for (int i = 0; i < count; ++i) {
+        _islandParent[i] = i;
+    }
     
-    auto colliders = getEntitiesWith<ColliderComponent, TransformComponent>(entities);
+    // Static and kinematic colliders don't link islands, or everything on
+    // the same floor would sleep and wake together.
+    for (const Contact& contact : _contacts) {
+        RigidbodyComponent* a = contact.a->body;
+        RigidbodyComponent* b = contact.b->body;
+        if (!a || !b || a->_solverIndex < 0 || b->_solverIndex < 0) continue;
+        
+        int rootA = findIsland(a->_solverIndex);
+        int rootB = findIsland(b->_solverIndex);
+        if (rootA != rootB) {
+            _islandParent[rootA] = rootB;
+        }
+    }
     
-    for (Entity* entity : colliders) {
-        auto* collider = entity->getComponent<ColliderComponent>();
-        auto* transform = entity->getComponent<TransformComponent>();
+    // An island is as restless as its most restless body. Bodies are judged
+    // on how far they actually moved: in a stack the solver leaves some
+    // velocity behind each step that position correction then cancels.
+    float linear = _sleepLinearSpeed * deltaTime;
+    float angular = _sleepAngularSpeed * _sleepAngularSpeed;
+    _islandSleepTime.assign(count, std::numeric_limits<float>::max());
+    for (int i = 0; i < count; ++i) {
+        RigidbodyComponent* body = _awakeBodies[i];
+        const Vector3f& position = body->getEntity()->getComponent<TransformComponent>()->getPosition();
+        Vector3f moved = position - body->_stepStart;
+        if (moved.lengthSquared() > linear * linear || body->_angularVelocity.lengthSquared() > angular) {
+            body->_sleepTime = 0.0f;
+        } else {
+            body->_sleepTime += deltaTime;
+        }
         
-        AABB entityBounds = collider->getBounds(transform->getPosition(), transform->getScale());
+        float& islandTime = _islandSleepTime[findIsland(i)];
+        islandTime = std::min(islandTime, body->_canSleep ? body->_sleepTime : -1.0f);
+    }
+    
+    _islandSlot.assign(count, -1);
+    for (int i = 0; i < count; ++i) {
+        int root = findIsland(i);
+        if (_islandSleepTime[root] < _timeToSleep) continue;
         
-        if (queryBox.intersects(entityBounds)) {
-            overlapping.push_back(entity);
+        int& island = _islandSlot[root];
+        if (island < 0) {
+            if (_freeSleepingIslands.empty()) {
+                island = static_cast<int>(_sleepingIslands.size());
+                _sleepingIslands.emplace_back();
+            } else {
+                island = _freeSleepingIslands.back();
+                _freeSleepingIslands.pop_back();
+            }
         }
+        
+        RigidbodyComponent* body = _awakeBodies[i];
+        body->_sleeping = true;
+        body->_sleepIsland = island;
+        body->_velocity = Vector3f::zero();
+        body->_angularVelocity = Vector3f::zero();
+        body->clearForces();
+        _sleepingIslands[island].push_back(body);
     }
+}
+
+void PhysicsSystem::wakeIsland(int island) {
+    std::vector<RigidbodyComponent*>& bodies = _sleepingIslands[island];
+    if (bodies.empty()) return;
     
-    return overlapping;
+    for (RigidbodyComponent* body : bodies) {
+        body->wakeUp();
+        body->_sleepIsland = -1;
+    }
+    bodies.clear();
+    _freeSleepingIslands.push_back(island);
+}
+
+void PhysicsSystem::dropRemovedBodies(const std::vector<std::unique_ptr<Entity>>& entities) {
+    // Rigidbodies can be removed or replaced while their entity lives on,
+    // which onEntityRemoved never hears about. Sleeping islands and indexed
+    // colliders may still point at them, so find every body that still
+    // exists before either is touched.
+    std::unordered_set<const RigidbodyComponent*> live;
+    for (const auto& entity : entities) {
+        if (auto* rigidbody = entity->getComponent<RigidbodyComponent>()) live.insert(rigidbody);
+    }
+    
+    for (size_t i = 0; i < _sleepingIslands.size(); ++i) {
+        std::vector<RigidbodyComponent*>& bodies = _sleepingIslands[i];
+        int island = static_cast<int>(i);
+        // A new body allocated where a removed one was is live but was never
+        // put to sleep in this island.
+        auto removed = [&](const RigidbodyComponent* body) {
+            return !live.count(body) || body->_sleepIsland != island;
+        };
+        if (bodies.empty() || std::none_of(bodies.begin(), bodies.end(), removed)) continue;
+        
+        // What it held up has to be simulated again.
+        bodies.erase(std::remove_if(bodies.begin(), bodies.end(), removed), bodies.end());
+        if (bodies.empty()) {
+            _freeSleepingIslands.push_back(island);
+        } else {
+            wakeIsland(island);
+        }
+    }
+    
+    // Entries keep their old body until they are indexed again.
+    for (auto& entry : _indexed) {
+        if (entry.second.body && !live.count(entry.second.body)) entry.second.body = nullptr;
+    }
 }
 
-void PhysicsSystem::integrateVelocity(RigidbodyComponent* rigidbody, float deltaTime) {
-    Vector3f acceleration = rigidbody->getForce() * rigidbody->getInverseMass();
-    acceleration += _gravity * rigidbody->getGravityScale();
+void PhysicsSystem::wakeTouching(const AABB& bounds, uint32_t layerMask) {
+    // Only bodies sleep, and they are never in the static tree.
+    _index.query(bounds, layerMask, [&](int proxy) {
+        const auto* indexed = static_cast<const IndexedCollider*>(_index.getUserData(proxy));
+        RigidbodyComponent* body = indexed->body;
+        if (body && body->_sleepIsland >= 0 && indexed->bounds.intersects(bounds)) {
+            wakeIsland(body->_sleepIsland);
+        }
+        return true;
+    });
+}
+
+namespace {
+
+constexpr size_t RaycastPacketGrain = 64;
+constexpr size_t SphereGrain = 256;
+
+bool raycastBounds(const Ray& ray, const Vector3f& invDir, const AABB& bounds, float maxDistance, RaycastHit& hit) {
+    Vector3f t1 = (bounds.min - ray.origin) * invDir;
+    Vector3f t2 = (bounds.max - ray.origin) * invDir;
+    
+    Vector3f tMin = Vector3f(std::min(t1.x, t2.x), std::min(t1.y, t2.y), std::min(t1.z, t2.z));
+    Vector3f tMax = Vector3f(std::max(t1.x, t2.x), std::max(t1.y, t2.y), std::max(t1.z, t2.z));
+    
+    float tNear = std::max({tMin.x, tMin.y, tMin.z});
+    float tFar = std::min({tMax.x, tMax.y, tMax.z});
+    
+    if (tNear > tFar || tFar <= 0) {
+        return false;
+    }
+    
+    // Rays starting inside the box hit its far side. Comparing that distance,
+    // not tNear, keeps the closest hit independent of visiting order.
+    float distance = tNear > 0 ? tNear : tFar;
+    if (distance >= maxDistance) {
+        return false;
+    }
     
-    rigidbody->setVelocity(rigidbody->getVelocity() + acceleration * deltaTime);
+    hit.hit = true;
+    hit.distance = distance;
+    hit.point = ray.getPoint(hit.distance);
     
-    Vector3f velocity = rigidbody->getVelocity();
-    velocity = velocity * (1.0f - rigidbody->getDrag() * deltaTime);
-    rigidbody->setVelocity(velocity);
+    Vector3f center = bounds.getCenter();
+    Vector3f diff = hit.point - center;
+    Vector3f size = bounds.getSize();
     
-    Vector3f angularVelocity = rigidbody->getAngularVelocity();
-    angularVelocity = angularVelocity * (1.0f - rigidbody->getAngularDrag() * deltaTime);
-    rigidbody->setAngularVelocity(angularVelocity);
+    Vector3f normal = Vector3f::zero();
+    float maxComponent = 0;
+    
+    if (std::abs(diff.x / size.x) > maxComponent) {
+        maxComponent = std::abs(diff.x / size.x);
+        normal = Vector3f(diff.x > 0 ? 1 : -1, 0, 0);
+    }
+    if (std::abs(diff.y / size.y) > maxComponent) {
+        maxComponent = std::abs(diff.y / size.y);
+        normal = Vector3f(0, diff.y > 0 ? 1 : -1, 0);
+    }
+    if (std::abs(diff.z / size.z) > maxComponent) {
+        normal = Vector3f(0, 0, diff.z > 0 ? 1 : -1);
+    }
+    
+    hit.normal = normal;
+    return true;
 }
 
-void PhysicsSystem::integratePosition(Entity* entity, RigidbodyComponent* rigidbody, float deltaTime) {
-    auto* transform = entity->getComponent<TransformComponent>();
-    if (!transform) return;
+} // namespace
+
+bool PhysicsSystem::raycastCollider(const IndexedCollider& collider, const Ray& ray, const Vector3f& invDir, float maxDistance, RaycastHit& hit) {
+    if (!collider.hasTriangles() && !collider.hull) {
+        if (!raycastBounds(ray, invDir, collider.bounds, maxDistance, hit)) return false;
+        hit.entity = collider.entity;
+        return true;
+    }
+    
+    // The direction is deliberately left unnormalised: an affine map keeps
+    // the ray parameter, so mesh-space distances are world distances.
+    Ray local;
+    local.origin = collider.worldToMesh.transformPointAffine(ray.origin);
+    local.direction = collider.worldToMesh.transformDirection(ray.direction);
     
-    Vector3f position = transform->getPosition();
-    position += rigidbody->getVelocity() * deltaTime;
-    transform->setPosition(position);
+    MeshBVH::Hit meshHit;
+    bool traced = collider.mesh ? collider.mesh->raycast(local, maxDistance, meshHit)
+                : collider.heightfield ? collider.heightfield->raycast(local, maxDistance, meshHit)
+                : collider.hull->raycast(local, maxDistance, meshHit);
+    if (!traced) return false;
     
-    Vector3f rotation = transform->getRotation();
-    rotation += rigidbody->getAngularVelocity() * deltaTime;
-    transform->setRotation(rotation);
+    // Normals go back through the inverse transpose.
+    const Matrix4x4& m = collider.worldToMesh;
+    const Vector3f& n = meshHit.normal;
+    Vector3f normal = Vector3f(
+        m(0, 0) * n.x + m(1, 0) * n.y + m(2, 0) * n.z,
+        m(0, 1) * n.x + m(1, 1) * n.y + m(2, 1) * n.z,
+        m(0, 2) * n.x + m(1, 2) * n.y + m(2, 2) * n.z
+    ).normalized();
+    if (normal.dot(ray.direction) > 0) {
+        normal = -normal;
+    }
+    
+    hit.hit = true;
+    hit.distance = meshHit.distance;
+    hit.point = ray.getPoint(meshHit.distance);
+    hit.normal = normal;
+    hit.entity = collider.entity;
+    hit.triangleIndex = static_cast<int>(meshHit.triangle);
+    hit.barycentric = meshHit.barycentric;
+    return true;
 }
 
-void PhysicsSystem::checkCollisions(const std::vector<std::unique_ptr<Entity>>& entities) {
-    auto colliders = getEntitiesWith<ColliderComponent, TransformComponent>(entities);
+RaycastHit PhysicsSystem::raycast(const Ray& ray, float maxDistance, uint32_t layerMask) {
+    RaycastHit closestHit;
+    closestHit.distance = maxDistance;
+    Vector3f invDir = ray.getInverseDirection();
     
-    for (size_t i = 0; i < colliders.size(); ++i) {
-        for (size_t j = i + 1; j < colliders.size(); ++j) {
-            if (checkCollision(colliders[i], colliders[j])) {
+    for (const DynamicAABBTree* tree : {&_index, &_staticIndex}) {
+        tree->raycast(ray, closestHit.distance, layerMask, [&](int proxy, float currentMax) {
+            const auto* indexed = static_cast<const IndexedCollider*>(tree->getUserData(proxy));
+            if (indexed->trigger) return currentMax;
+            
+            RaycastHit hit;
+            if (raycastCollider(*indexed, ray, invDir, closestHit.distance, hit)) {
+                closestHit = hit;
             }
-        }
+            return closestHit.distance;
+        });
     }
+    
+    return closestHit;
 }
 
-bool PhysicsSystem::checkCollision(Entity* entityA, Entity* entityB) {
-    auto* colliderA = entityA->getComponent<ColliderComponent>();
-    auto* colliderB = entityB->getComponent<ColliderComponent>();
-    auto* transformA = entityA->getComponent<TransformComponent>();
-    auto* transformB = entityB->getComponent<TransformComponent>();
+void PhysicsSystem::raycastBatch(const Ray* rays, size_t count, RaycastHit* hits, float maxDistance, uint32_t layerMask) {
+    const size_t width = RayPacket::Width;
+    size_t packetCount = (count + width - 1) / width;
     
-    if (!colliderA || !colliderB || !transformA || !transformB) return false;
+    auto tracePackets = [&](size_t first, size_t last) {
+        for (size_t p = first; p < last; ++p) {
+            size_t base = p * width;
+            RayPacket packet;
+            for (size_t i = base; i < std::min(base + width, count); ++i) {
+                packet.add(rays[i], maxDistance);
+                hits[i] = RaycastHit();
+                hits[i].distance = maxDistance;
+            }
+            
+            // Hits in the first tree shorten the packet's rays for the second.
+            for (const DynamicAABBTree* tree : {&_index, &_staticIndex}) {
+                tree->raycastPacket(packet, layerMask, [&](int proxy, int laneMask) {
+                    const auto* indexed = static_cast<const IndexedCollider*>(tree->getUserData(proxy));
+                    if (indexed->trigger) return;
+                    
+                    for (int lane = 0; lane < packet.count; ++lane) {
+                        if (!(laneMask & (1 << lane))) continue;
+                        
+                        Vector3f invDir(packet.inverseX[lane], packet.inverseY[lane], packet.inverseZ[lane]);
+                        RaycastHit hit;
+                        if (raycastCollider(*indexed, rays[base + lane], invDir, packet.maxDistance[lane], hit)) {
+                            hits[base + lane] = hit;
+                            packet.maxDistance[lane] = hit.distance;
+                        }
+                    }
+                });
+            }
+        }
+    };
     
-    if (colliderA->getType() == ColliderComponent::Box && colliderB->getType() == ColliderComponent::Box) {
-        AABB boundsA = colliderA->getBounds(transformA->getPosition(), transformA->getScale());
-        AABB boundsB = colliderB->getBounds(transformB->getPosition(), transformB->getScale());
-        return checkAABBCollision(boundsA, boundsB);
+    Core::ThreadPool& pool = Core::ThreadPool::getInstance();
+    if (_parallelRaycastThreshold > 0 && count >= _parallelRaycastThreshold && pool.getThreadCount() > 1) {
+        pool.parallelFor(packetCount, RaycastPacketGrain, tracePackets);
+    } else {
+        tracePackets(0, packetCount);
     }
-    else if (colliderA->getType() == ColliderComponent::Sphere && colliderB->getType() == ColliderComponent::Sphere) {
-        Sphere sphereA = colliderA->getBoundingSphere(transformA->getPosition(), transformA->getScale());
-        Sphere sphereB = colliderB->getBoundingSphere(transformB->getPosition(), transformB->getScale());
-        return checkSphereCollision(sphereA, sphereB);
+}
+
+std::vector<Entity*> PhysicsSystem::overlapSphere(const Vector3f& center, float radius, uint32_t layerMask) {
+    std::vector<Entity*> overlapping;
+    Physics::Sphere querySphere(center, radius);
+    Vector3f extent(radius, radius, radius);
+    
+    for (const DynamicAABBTree* tree : {&_index, &_staticIndex}) {
+        tree->query(AABB(center - extent, center + extent), layerMask, [&](int proxy) {
+            const auto* indexed = static_cast<const IndexedCollider*>(tree->getUserData(proxy));
+            if (querySphere.intersects(indexed->sphere)) {
+                overlapping.push_back(indexed->entity);
+            }
+            return true;
+        });
     }
-    else {
-        AABB boundsA = colliderA->getBounds(transformA->getPosition(), transformA->getScale());
-        AABB boundsB = colliderB->getBounds(transformB->getPosition(), transformB->getScale());
-        return checkAABBCollision(boundsA, boundsB);
+    
+    return overlapping;
+}
+
+bool PhysicsSystem::sphereContact(const IndexedCollider& collider, const Physics::Sphere& sphere, Vector3f& normal, float& penetration) {
+    penetration = 0.0f;
+    if (collider.hasTriangles()) {
+        Vector3f extent(sphere.radius, sphere.radius, sphere.radius);
+        AABB local = AABB(sphere.center - extent, sphere.center + extent).transformed(collider.worldToMesh);
+        bool found = false;
+        auto test = [&](const Vector3f& a, const Vector3f& b, const Vector3f& c, unsigned int) {
+            Vector3f triangleNormal, point;
+            float depth;
+            if (sphereTriangle(sphere, collider.meshToWorld.transformPointAffine(a), collider.meshToWorld.transformPointAffine(b),
+                               collider.meshToWorld.transformPointAffine(c), triangleNormal, depth, point) && depth > penetration) {
+                penetration = depth;
+                normal = triangleNormal;
+                found = true;
+            }
+        };
+        if (collider.mesh) {
+            collider.mesh->query(local, test);
+        } else {
+            collider.heightfield->query(local, test);
+        }
+        return found;
     }
+    
+    Vector3f axis = Vector3f::zero();
+    Vector3f point;
+    if (!convexContact(ConvexShape::point(sphere.center, sphere.radius),
+                       convexShape(collider.type, collider.bounds, collider.sphere, collider.hull.get(), collider.meshToWorld),
+                       0.0f, axis, normal, penetration, point) || penetration <= 0.0f) {
+        return false;
+    }
+    normal = -normal;
+    return true;
 }
 
-bool PhysicsSystem::checkAABBCollision(const AABB& a, const AABB& b) {
-    return a.intersects(b);
+void PhysicsSystem::collideSpheres(const Vector3f* centers, size_t count, float radius, SphereContact* contacts, uint32_t layerMask) {
+    if (count == 0) return;
+    
+    AABB bounds(centers[0], centers[0]);
+    for (size_t i = 1; i < count; ++i) {
+        bounds.expand(centers[i]);
+    }
+    bounds.expand(radius);
+    
+    std::vector<const IndexedCollider*> nearby;
+    for (const DynamicAABBTree* tree : {&_index, &_staticIndex}) {
+        tree->query(bounds, layerMask, [&](int proxy) {
+            const auto* indexed = static_cast<const IndexedCollider*>(tree->getUserData(proxy));
+            if (!indexed->trigger) nearby.push_back(indexed);
+            return true;
+        });
+    }
+    
+    auto collideRange = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            contacts[i] = SphereContact();
+            if (nearby.empty()) continue;
+            
+            Physics::Sphere sphere(centers[i], radius);
+            Vector3f extent(radius, radius, radius);
+            AABB box(centers[i] - extent, centers[i] + extent);
+            for (const IndexedCollider* collider : nearby) {
+                if (!collider->bounds.intersects(box)) continue;
+                
+                Vector3f normal;
+                float penetration;
+                if (sphereContact(*collider, sphere, normal, penetration) && penetration > contacts[i].penetration) {
+                    contacts[i].hit = true;
+                    contacts[i].normal = normal;
+                    contacts[i].penetration = penetration;
+                    contacts[i].entity = collider->entity;
+                }
+            }
+        }
+    };
+    
+    Core::ThreadPool& pool = Core::ThreadPool::getInstance();
+    if (_parallelRaycastThreshold > 0 && count >= _parallelRaycastThreshold && pool.getThreadCount() > 1) {
+        pool.parallelFor(count, SphereGrain, collideRange);
+    } else {
+        collideRange(0, count);
+    }
 }
 
-bool PhysicsSystem::checkSphereCollision(const Sphere& a, const Sphere& b) {
-    return a.intersects(b);
+std::vector<Entity*> PhysicsSystem::overlapBox(const Vector3f& center, const Vector3f& size, uint32_t layerMask) {
+    std::vector<Entity*> overlapping;
+    Vector3f halfSize = size * 0.5f;
+    AABB queryBox(center - halfSize, center + halfSize);
+    
+    for (const DynamicAABBTree* tree : {&_index, &_staticIndex}) {
+        tree->query(queryBox, layerMask, [&](int proxy) {
+            const auto* indexed = static_cast<const IndexedCollider*>(tree->getUserData(proxy));
+            if (queryBox.intersects(indexed->bounds)) {
+                overlapping.push_back(indexed->entity);
+            }
+            return true;
+        });
+    }
+    
+    return overlapping;
 }
 
-bool PhysicsSystem::checkSpherAABBCollision(const Sphere& sphere, const AABB& aabb) {
-    return sphere.intersects(aabb);
+namespace {
+
+// World-space inverse inertia times v, for principal inverse moments in
+// the body's local axes.
+Vector3f applyInverseInertia(const Quaternion& orientation, const Vector3f& inverseInertia, const Vector3f& v) {
+    Vector3f local = orientation.conjugate().rotate(v);
+    return orientation.rotate(Vector3f(local.x * inverseInertia.x, local.y * inverseInertia.y, local.z * inverseInertia.z));
 }
 
-void PhysicsSystem::resolveCollision(Entity* entityA, Entity* entityB, const Vector3f& normal, float penetration) {
-    auto* rigidbodyA = entityA->getComponent<RigidbodyComponent>();
-    auto* rigidbodyB = entityB->getComponent<RigidbodyComponent>();
-    auto* transformA = entityA->getComponent<TransformComponent>();
-    auto* transformB = entityB->getComponent<TransformComponent>();
+} // namespace
+
+void PhysicsSystem::resolveCollision(const Contact& contact, float penetration) {
+    RigidbodyComponent* rigidbodyA = contact.a->body;
+    RigidbodyComponent* rigidbodyB = contact.b->body;
+    if (!rigidbodyA && !rigidbodyB) return;
     
+    auto* transformA = contact.a->entity->getComponent<TransformComponent>();
+    auto* transformB = contact.b->entity->getComponent<TransformComponent>();
     if (!transformA || !transformB) return;
     
-    if (!rigidbodyA && !rigidbodyB) return;
-    
-    float invMassA = rigidbodyA ? rigidbodyA->getInverseMass() : 0.0f;
-    float invMassB = rigidbodyB ? rigidbodyB->getInverseMass() : 0.0f;
+    bool dynamicA = rigidbodyA && !rigidbodyA->isKinematic();
+    bool dynamicB = rigidbodyB && !rigidbodyB->isKinematic();
+    float invMassA = dynamicA ? rigidbodyA->getInverseMass() : 0.0f;
+    float invMassB = dynamicB ? rigidbodyB->getInverseMass() : 0.0f;
     float totalInvMass = invMassA + invMassB;
     
     if (totalInvMass == 0) return;
     
+    const Vector3f& normal = contact.normal;
     Vector3f separation = normal * (penetration / totalInvMass);
     
-    if (rigidbodyA && !rigidbodyA->isKinematic()) {
+    if (dynamicA) {
         Vector3f posA = transformA->getPosition();
         posA -= separation * invMassA;
         transformA->setPosition(posA);
     }
     
-    if (rigidbodyB && !rigidbodyB->isKinematic()) {
+    if (dynamicB) {
         Vector3f posB = transformB->getPosition();
         posB += separation * invMassB;
         transformB->setPosition(posB);
     }
     
-    Vector3f relativeVelocity = Vector3f::zero();
-    if (rigidbodyA) relativeVelocity -= rigidbodyA->getVelocity();
-    if (rigidbodyB) relativeVelocity += rigidbodyB->getVelocity();
+    const Vector3f& armA = contact.armA;
+    const Vector3f& armB = contact.armB;
+    bool turning = contact.a->type == ColliderComponent::Sphere || contact.b->type == ColliderComponent::Sphere;
+    Vector3f invInertiaA = dynamicA ? rigidbodyA->getInverseInertiaTensor() : Vector3f::zero();
+    Vector3f invInertiaB = dynamicB ? rigidbodyB->getInverseInertiaTensor() : Vector3f::zero();
+    const Quaternion& orientationA = transformA->getOrientation();
+    const Quaternion& orientationB = transformB->getOrientation();
+    
+    auto relativeVelocity = [&]() {
+        Vector3f velocity = Vector3f::zero();
+        if (rigidbodyA) velocity -= rigidbodyA->getVelocity() + rigidbodyA->getAngularVelocity().cross(armA);
+        if (rigidbodyB) velocity += rigidbodyB->getVelocity() + rigidbodyB->getAngularVelocity().cross(armB);
+        return velocity;
+    };
+    
+    // Inverse of the pair's effective mass for an impulse along direction.
+    auto inverseMassAlong = [&](const Vector3f& direction) {
+        if (!turning) return totalInvMass;
+        Vector3f turnA = applyInverseInertia(orientationA, invInertiaA, armA.cross(direction)).cross(armA);
+        Vector3f turnB = applyInverseInertia(orientationB, invInertiaB, armB.cross(direction)).cross(armB);
+        return totalInvMass + (turnA + turnB).dot(direction);
+    };
     
-    float velAlongNormal = relativeVelocity.dot(normal);
+    auto applyImpulse = [&](const Vector3f& impulse) {
+        if (dynamicA) {
+            rigidbodyA->addImpulse(-impulse);
+            if (turning) rigidbodyA->_angularVelocity -= applyInverseInertia(orientationA, invInertiaA, armA.cross(impulse));
+        }
+        if (dynamicB) {
+            rigidbodyB->addImpulse(impulse);
+            if (turning) rigidbodyB->_angularVelocity += applyInverseInertia(orientationB, invInertiaB, armB.cross(impulse));
+        }
+    };
+    
+    float velAlongNormal = relativeVelocity().dot(normal);
     
     if (velAlongNormal > 0) return;
     
-    float restitution = 0.5f;
-    float impulseScalar = -(1 + restitution) * velAlongNormal / totalInvMass;
-    Vector3f impulse = normal * impulseScalar;
+    float restitution = velAlongNormal < -RestitutionThreshold ? 0.5f : 0.0f;
+    float impulseScalar = -(1 + restitution) * velAlongNormal / inverseMassAlong(normal);
+    applyImpulse(normal * impulseScalar);
     
-    if (rigidbodyA && !rigidbodyA->isKinematic()) {
-        rigidbodyA->addImpulse(-impulse);
-    }
+    // Friction opposes what sliding is left, up to its share of the
+    // normal impulse.
+    Vector3f velocity = relativeVelocity();
+    Vector3f sliding = velocity - normal * velocity.dot(normal);
+    float speed = sliding.length();
+    if (speed < 1e-6f) return;
     
-    if (rigidbodyB && !rigidbodyB->isKinematic()) {
-        rigidbodyB->addImpulse(impulse);
-    }
+    Vector3f tangent = sliding / speed;
+    float frictionScalar = std::min(speed / inverseMassAlong(tangent), Friction * impulseScalar);
+    applyImpulse(tangent * -frictionScalar);
 }
 
 } // namespace Physics
@@ -0,0 +1,181 @@
+#include "physics/rigidbody_world.hpp"
+#include "physics/physics.hpp"
+#include "core/thread_pool.hpp"
+#include "math/simd.hpp"
+#include <algorithm>
+
+namespace SFSim {
+namespace Physics {
+
+namespace {
+
+// Multiple of Float4::Width, so every chunk starts on a whole group.
+constexpr size_t IntegrateGrain = 16384;
+
+struct Float4x3 {
+    Float4 x, y, z;
+};
+
+Float4x3 cross(const Float4x3& a, const Float4x3& b) {
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+// Quaternion::rotate, four bodies at a time; pass the negated vector part
+// to rotate by the conjugate.
+Float4x3 rotate(const Float4x3& u, const Float4& w, const Float4x3& v) {
+    const Float4 two(2.0f);
+    Float4x3 t = cross(u, v);
+    t = {t.x * two, t.y * two, t.z * two};
+    Float4x3 ut = cross(u, t);
+    return {v.x + t.x * w + ut.x, v.y + t.y * w + ut.y, v.z + t.z * w + ut.z};
+}
+
+} // namespace
+
+RigidbodyWorld::RigidbodyWorld()
+    : _count(0)
+    , _parallelThreshold(65536)
+{
+}
+
+size_t RigidbodyWorld::add(const RigidbodyComponent& body, const Vector3f& position, const Quaternion& orientation) {
+    // Arrays only ever grow, by whole groups, so the lanes past the last
+    // body always exist; whatever they hold is integrated and ignored.
+    if (_count == _inverseMass.size()) {
+        size_t capacity = std::max<size_t>(Float4::Width, _count * 2);
+        _position.resize(capacity);
+        _orientation.resize(capacity);
+        _velocity.resize(capacity);
+        _angularVelocity.resize(capacity);
+        _force.resize(capacity);
+        _torque.resize(capacity);
+        _inverseInertia.resize(capacity);
+        _inverseMass.resize(capacity, 0.0f);
+        _drag.resize(capacity, 0.0f);
+        _angularDrag.resize(capacity, 0.0f);
+        _gravityScale.resize(capacity, 0.0f);
+    }
+
+    size_t index = _count++;
+    _position.set(index, position);
+    _orientation.set(index, orientation);
+    _velocity.set(index, body._velocity);
+    _angularVelocity.set(index, body._angularVelocity);
+    _force.set(index, body._force);
+    _torque.set(index, body._torque);
+    _inverseInertia.set(index, body._invInertia);
+    _inverseMass[index] = body._invMass;
+    _drag[index] = body._drag;
+    _angularDrag[index] = body._angularDrag;
+    _gravityScale[index] = body._gravityScale;
+    return index;
+}
+
+void RigidbodyWorld::clear() {
+    _count = 0;
+}
+
+void RigidbodyWorld::store(size_t body, RigidbodyComponent& component) const {
+    component._velocity = _velocity.get(body);
+    component._angularVelocity = _angularVelocity.get(body);
+}
+
+void RigidbodyWorld::integrate(float deltaTime, const Vector3f& gravity) {
+    size_t padded = (_count + Float4::Width - 1) / Float4::Width * Float4::Width;
+    if (padded == 0) return;
+
+    if (!Core::ThreadPool::exceedsThreshold(_count, _parallelThreshold)) {
+        integrate(0, padded, deltaTime, gravity);
+        return;
+    }
+
+    Core::ThreadPool::getInstance().parallelFor(padded, IntegrateGrain, [&](size_t begin, size_t end) {
+        integrate(begin, end, deltaTime, gravity);
+    });
+}
+
+void RigidbodyWorld::integrate(size_t begin, size_t end, float deltaTime, const Vector3f& gravity) {
+    end = std::min(end, _inverseMass.size());
+
+    // Linear motion takes the same operations, in the same order, as
+    // integrating one component at a time, so both give identical results.
+    const Float4 dt(deltaTime);
+    const Float4 halfDt(deltaTime * 0.5f);
+    const Float4 one(1.0f);
+    const Float4 gravityX(gravity.x);
+    const Float4 gravityY(gravity.y);
+    const Float4 gravityZ(gravity.z);
+    const Float4 zero(0.0f);
+
+    for (size_t i = begin; i < end; i += Float4::Width) {
+        Float4 inverseMass = Float4::load(&_inverseMass[i]);
+        Float4 gravityScale = Float4::load(&_gravityScale[i]);
+        Float4 damping = one - Float4::load(&_drag[i]) * dt;
+        Float4 angularDamping = one - Float4::load(&_angularDrag[i]) * dt;
+
+        Float4 ax = Float4::load(&_force.x[i]) * inverseMass + gravityX * gravityScale;
+        Float4 ay = Float4::load(&_force.y[i]) * inverseMass + gravityY * gravityScale;
+        Float4 az = Float4::load(&_force.z[i]) * inverseMass + gravityZ * gravityScale;
+
+        Float4 vx = (Float4::load(&_velocity.x[i]) + ax * dt) * damping;
+        Float4 vy = (Float4::load(&_velocity.y[i]) + ay * dt) * damping;
+        Float4 vz = (Float4::load(&_velocity.z[i]) + az * dt) * damping;
+        vx.store(&_velocity.x[i]);
+        vy.store(&_velocity.y[i]);
+        vz.store(&_velocity.z[i]);
+
+        (Float4::load(&_position.x[i]) + vx * dt).store(&_position.x[i]);
+        (Float4::load(&_position.y[i]) + vy * dt).store(&_position.y[i]);
+        (Float4::load(&_position.z[i]) + vz * dt).store(&_position.z[i]);
+
+        Float4x3 axis = {Float4::load(&_orientation.x[i]), Float4::load(&_orientation.y[i]), Float4::load(&_orientation.z[i])};
+        Float4 qw = Float4::load(&_orientation.w[i]);
+        Float4 wx = Float4::load(&_angularVelocity.x[i]);
+        Float4 wy = Float4::load(&_angularVelocity.y[i]);
+        Float4 wz = Float4::load(&_angularVelocity.z[i]);
+
+        // Torque is rare, so groups without any skip the trip into body
+        // space and back.
+        Float4x3 torque = {Float4::load(&_torque.x[i]), Float4::load(&_torque.y[i]), Float4::load(&_torque.z[i])};
+        if ((torque.x * torque.x + torque.y * torque.y + torque.z * torque.z > zero).movemask()) {
+            Float4x3 conjugate = {-axis.x, -axis.y, -axis.z};
+            Float4x3 local = rotate(conjugate, qw, torque);
+            local = {local.x * Float4::load(&_inverseInertia.x[i]),
+                     local.y * Float4::load(&_inverseInertia.y[i]),
+                     local.z * Float4::load(&_inverseInertia.z[i])};
+            Float4x3 alpha = rotate(axis, qw, local);
+            wx = wx + alpha.x * dt;
+            wy = wy + alpha.y * dt;
+            wz = wz + alpha.z * dt;
+            zero.store(&_torque.x[i]);
+            zero.store(&_torque.y[i]);
+            zero.store(&_torque.z[i]);
+        }
+
+        wx = wx * angularDamping;
+        wy = wy * angularDamping;
+        wz = wz * angularDamping;
+        wx.store(&_angularVelocity.x[i]);
+        wy.store(&_angularVelocity.y[i]);
+        wz.store(&_angularVelocity.z[i]);
+
+        // q += dt/2 * (w, 0) * q, renormalized; the estimate is plenty when
+        // it runs every step.
+        Float4 x = axis.x + (wx * qw + wy * axis.z - wz * axis.y) * halfDt;
+        Float4 y = axis.y + (wy * qw + wz * axis.x - wx * axis.z) * halfDt;
+        Float4 z = axis.z + (wz * qw + wx * axis.y - wy * axis.x) * halfDt;
+        Float4 w = qw - (wx * axis.x + wy * axis.y + wz * axis.z) * halfDt;
+        Float4 invLength = Float4::rsqrt(x * x + y * y + z * z + w * w);
+        (x * invLength).store(&_orientation.x[i]);
+        (y * invLength).store(&_orientation.y[i]);
+        (z * invLength).store(&_orientation.z[i]);
+        (w * invLength).store(&_orientation.w[i]);
+
+        zero.store(&_force.x[i]);
+        zero.store(&_force.y[i]);
+        zero.store(&_force.z[i]);
+    }
+}
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
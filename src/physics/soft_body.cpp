@@ -0,0 +1,349 @@
+#include "physics/soft_body.hpp"
+#include "geometry/mesh.hpp"
+#include "core/thread_pool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace SFSim {
+namespace Physics {
+
+namespace {
+
+constexpr size_t ParticleGrain = 1024;
+constexpr size_t ConstraintGrain = 512;
+// Colors a particle can take part in, one bit each.
+constexpr int MaxColors = 64;
+
+// Particles flagged in writeMesh(): moved since the last write, and on a
+// triangle with one that did.
+constexpr uint8_t Moved = 1;
+constexpr uint8_t Touched = 2;
+
+bool samePosition(const Vector3f& a, const Vector3f& b) {
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+} // namespace
+
+SoftBody::SoftBody()
+    : _mesh(nullptr)
+    , _stretchCompliance(0.0f)
+    , _bendCompliance(0.001f)
+    , _volumeConstrained(false)
+    , _volumeCompliance(0.0f)
+    , _pressure(1.0f)
+    , _substeps(10)
+    , _gravity(0.0f, -9.81f, 0.0f)
+    , _damping(0.1f)
+    , _thickness(0.02f)
+    , _friction(0.5f)
+    , _collisionMask(AllLayers)
+    , _parallelThreshold(4096)
+    , _restVolume(0.0f)
+{
+}
+
+void SoftBody::build(MeshGeometry& mesh, float mass) {
+    _mesh = &mesh;
+    const std::vector<Vertex>& vertices = mesh.getMeshVertices();
+    const std::vector<unsigned int>& indices = mesh.getIndices();
+    size_t vertexCount = vertices.size();
+
+    // Vertices sorted by position (then index) sit in runs of equal ones;
+    // each run's first vertex stands for the rest, and particles are
+    // numbered in the order their first vertex comes in the mesh.
+    std::vector<uint32_t> byPosition(vertexCount);
+    std::iota(byPosition.begin(), byPosition.end(), 0u);
+    std::sort(byPosition.begin(), byPosition.end(), [&](uint32_t a, uint32_t b) {
+        const Vector3f& pa = vertices[a].position;
+        const Vector3f& pb = vertices[b].position;
+        if (pa.x != pb.x) return pa.x < pb.x;
+        if (pa.y != pb.y) return pa.y < pb.y;
+        if (pa.z != pb.z) return pa.z < pb.z;
+        return a < b;
+    });
+    std::vector<uint32_t> first(vertexCount);
+    for (size_t k = 0; k < vertexCount; ++k) {
+        bool starts = k == 0 || !samePosition(vertices[byPosition[k]].position, vertices[byPosition[k - 1]].position);
+        first[byPosition[k]] = starts ? byPosition[k] : first[byPosition[k - 1]];
+    }
+
+    _positions.clear();
+    _vertexParticle.resize(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        if (first[v] == v) {
+            _vertexParticle[v] = static_cast<uint32_t>(_positions.size());
+            _positions.push_back(vertices[v].position);
+        } else {
+            _vertexParticle[v] = _vertexParticle[first[v]];
+        }
+    }
+    size_t count = _positions.size();
+    _previous = _positions;
+    _written = _positions;
+    _velocities.assign(count, Vector3f::zero());
+    _inverseMass.assign(count, mass > 0.0f && count > 0 ? static_cast<float>(count) / mass : 1.0f);
+    _moved.assign(count, 0);
+    _contacts.resize(count);
+
+    // Triangles that welding collapsed have nothing to hold together.
+    _triangles.clear();
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        if (indices[i] >= vertexCount || indices[i + 1] >= vertexCount || indices[i + 2] >= vertexCount) continue;
+        uint32_t a = _vertexParticle[indices[i]];
+        uint32_t b = _vertexParticle[indices[i + 1]];
+        uint32_t c = _vertexParticle[indices[i + 2]];
+        if (a == b || b == c || a == c) continue;
+        _triangles.push_back(a);
+        _triangles.push_back(b);
+        _triangles.push_back(c);
+    }
+
+    _cornerStart.assign(count + 1, 0);
+    for (uint32_t particle : _triangles) ++_cornerStart[particle + 1];
+    for (size_t p = 0; p < count; ++p) _cornerStart[p + 1] += _cornerStart[p];
+    _corners.resize(_triangles.size());
+    std::vector<uint32_t> next(_cornerStart.begin(), _cornerStart.end() - 1);
+    for (size_t corner = 0; corner < _triangles.size(); ++corner) {
+        _corners[next[_triangles[corner]]++] = static_cast<uint32_t>(corner);
+    }
+    _volumeGradient.resize(count);
+
+    // Every edge once, with the corner across from it in each triangle
+    // that has it: one stretch constraint per edge, and a bending one
+    // across each edge two triangles share.
+    struct Edge {
+        uint32_t low;
+        uint32_t high;
+        uint32_t opposite;
+    };
+    std::vector<Edge> edges;
+    edges.reserve(_triangles.size());
+    for (size_t t = 0; t < _triangles.size(); t += 3) {
+        for (size_t corner = 0; corner < 3; ++corner) {
+            uint32_t a = _triangles[t + corner];
+            uint32_t b = _triangles[t + (corner + 1) % 3];
+            edges.push_back({std::min(a, b), std::max(a, b), _triangles[t + (corner + 2) % 3]});
+        }
+    }
+    std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) {
+        return a.low != b.low ? a.low < b.low : a.high < b.high;
+    });
+
+    _constraints.clear();
+    for (size_t i = 0; i < edges.size();) {
+        size_t end = i + 1;
+        while (end < edges.size() && edges[end].low == edges[i].low && edges[end].high == edges[i].high) ++end;
+
+        const Edge& edge = edges[i];
+        _constraints.push_back({edge.low, edge.high, (_positions[edge.low] - _positions[edge.high]).length(), false});
+        if (end - i >= 2 && edges[i].opposite != edges[i + 1].opposite) {
+            uint32_t a = edges[i].opposite;
+            uint32_t b = edges[i + 1].opposite;
+            _constraints.push_back({a, b, (_positions[a] - _positions[b]).length(), true});
+        }
+        i = end;
+    }
+    color();
+
+    _restVolume = getVolume();
+}
+
+void SoftBody::color() {
+    // Greedily, each constraint takes the lowest color neither of its
+    // particles has yet. Every color below one in use is in use too.
+    std::vector<uint64_t> used(_positions.size(), 0);
+    std::vector<uint8_t> colors(_constraints.size());
+    std::vector<uint32_t> counts(MaxColors + 2, 0);
+    int colorCount = 0;
+    for (size_t i = 0; i < _constraints.size(); ++i) {
+        uint64_t taken = used[_constraints[i].a] | used[_constraints[i].b];
+        int color = 0;
+        while (color < MaxColors && (taken >> color & 1u)) ++color;
+        if (color < MaxColors) {
+            used[_constraints[i].a] |= uint64_t(1) << color;
+            used[_constraints[i].b] |= uint64_t(1) << color;
+            colorCount = std::max(colorCount, color + 1);
+        }
+        colors[i] = static_cast<uint8_t>(color);
+        ++counts[color + 1];
+    }
+
+    // A counting sort keeps each batch in edge order.
+    for (int color = 0; color <= MaxColors; ++color) counts[color + 1] += counts[color];
+    std::vector<DistanceConstraint> sorted(_constraints.size());
+    std::vector<uint32_t> next(counts.begin(), counts.end() - 1);
+    for (size_t i = 0; i < _constraints.size(); ++i) {
+        sorted[next[colors[i]]++] = _constraints[i];
+    }
+    _constraints.swap(sorted);
+    _batches.assign(counts.begin(), counts.begin() + colorCount + 1);
+}
+
+float SoftBody::getVolume() const {
+    float volume = 0.0f;
+    for (size_t t = 0; t < _triangles.size(); t += 3) {
+        const Vector3f& a = _positions[_triangles[t]];
+        const Vector3f& b = _positions[_triangles[t + 1]];
+        const Vector3f& c = _positions[_triangles[t + 2]];
+        volume += a.dot(b.cross(c));
+    }
+    return volume / 6.0f;
+}
+
+void SoftBody::update(float deltaTime, PhysicsSystem* physics) {
+    if (!_mesh || _positions.empty() || deltaTime <= 0.0f) return;
+
+    float dt = std::min(deltaTime, MaxDeltaTime) / static_cast<float>(_substeps);
+    for (int i = 0; i < _substeps; ++i) {
+        substep(dt, physics);
+    }
+    writeMesh();
+}
+
+void SoftBody::substep(float dt, PhysicsSystem* physics) {
+    size_t count = _positions.size();
+    bool parallel = Core::ThreadPool::exceedsThreshold(count, _parallelThreshold);
+
+    Core::ThreadPool::parallelForIf(parallel, count, ParticleGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            _previous[i] = _positions[i];
+            if (_inverseMass[i] == 0.0f) continue;
+            _velocities[i] += _gravity * dt;
+            _positions[i] += _velocities[i] * dt;
+        }
+    });
+
+    // One pass per substep, so every constraint's multiplier starts from
+    // zero and none need keeping between them.
+    float stretchAlpha = _stretchCompliance / (dt * dt);
+    float bendAlpha = _bendCompliance / (dt * dt);
+    for (size_t b = 0; b + 1 < _batches.size(); ++b) {
+        size_t begin = _batches[b];
+        size_t size = _batches[b + 1] - begin;
+        bool parallelBatch = Core::ThreadPool::exceedsThreshold(size, _parallelThreshold);
+        Core::ThreadPool::parallelForIf(parallelBatch, size, ConstraintGrain, [&](size_t first, size_t last) {
+            solveConstraints(begin + first, begin + last, stretchAlpha, bendAlpha);
+        });
+    }
+    solveConstraints(_batches.empty() ? 0 : _batches.back(), _constraints.size(), stretchAlpha, bendAlpha);
+
+    if (_volumeConstrained) solveVolume(dt);
+    if (physics) collide(*physics);
+
+    float keep = std::max(0.0f, 1.0f - _damping * dt);
+    float inverseDt = 1.0f / dt;
+    Core::ThreadPool::parallelForIf(parallel, count, ParticleGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (_inverseMass[i] == 0.0f) continue;
+            _velocities[i] = (_positions[i] - _previous[i]) * (inverseDt * keep);
+        }
+    });
+}
+
+void SoftBody::solveConstraints(size_t begin, size_t end, float stretchAlpha, float bendAlpha) {
+    for (size_t i = begin; i < end; ++i) {
+        const DistanceConstraint& constraint = _constraints[i];
+        float wa = _inverseMass[constraint.a];
+        float wb = _inverseMass[constraint.b];
+        float alpha = constraint.bending ? bendAlpha : stretchAlpha;
+        float denominator = wa + wb + alpha;
+        if (wa + wb == 0.0f) continue;
+
+        Vector3f offset = _positions[constraint.a] - _positions[constraint.b];
+        float length = offset.length();
+        if (length < 1e-9f) continue;
+
+        float lambda = (constraint.restLength - length) / denominator;
+        Vector3f correction = offset * (lambda / length);
+        _positions[constraint.a] += correction * wa;
+        _positions[constraint.b] -= correction * wb;
+    }
+}
+
+void SoftBody::solveVolume(float dt) {
+    size_t count = _positions.size();
+    bool parallel = Core::ThreadPool::exceedsThreshold(count, _parallelThreshold);
+
+    // The volume's gradient at a particle is a sixth of the cross product
+    // of the two corners after it, summed over its triangles.
+    Core::ThreadPool::parallelForIf(parallel, count, ParticleGrain, [&](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; ++p) {
+            Vector3f gradient = Vector3f::zero();
+            for (uint32_t k = _cornerStart[p]; k < _cornerStart[p + 1]; ++k) {
+                uint32_t corner = _corners[k];
+                uint32_t t = corner - corner % 3;
+                const Vector3f& b = _positions[_triangles[t + (corner + 1) % 3]];
+                const Vector3f& c = _positions[_triangles[t + (corner + 2) % 3]];
+                gradient += b.cross(c);
+            }
+            _volumeGradient[p] = gradient * (1.0f / 6.0f);
+        }
+    });
+
+    float denominator = _volumeCompliance / (dt * dt);
+    for (size_t p = 0; p < count; ++p) {
+        denominator += _inverseMass[p] * _volumeGradient[p].dot(_volumeGradient[p]);
+    }
+    if (denominator < 1e-12f) return;
+
+    float lambda = (_pressure * _restVolume - getVolume()) / denominator;
+    Core::ThreadPool::parallelForIf(parallel, count, ParticleGrain, [&](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; ++p) {
+            _positions[p] += _volumeGradient[p] * (lambda * _inverseMass[p]);
+        }
+    });
+}
+
+void SoftBody::collide(PhysicsSystem& physics) {
+    size_t count = _positions.size();
+    physics.collideSpheres(_positions.data(), count, _thickness, _contacts.data(), _collisionMask);
+
+    // Friction takes back the substep's sliding along the surface, up to
+    // friction times how far the particle was pushed out.
+    bool parallel = Core::ThreadPool::exceedsThreshold(count, _parallelThreshold);
+    Core::ThreadPool::parallelForIf(parallel, count, ParticleGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const SphereContact& contact = _contacts[i];
+            if (!contact.hit || _inverseMass[i] == 0.0f) continue;
+
+            _positions[i] += contact.normal * contact.penetration;
+            Vector3f moved = _positions[i] - _previous[i];
+            Vector3f sliding = moved - contact.normal * moved.dot(contact.normal);
+            float distance = sliding.length();
+            float limit = _friction * contact.penetration;
+            _positions[i] -= distance <= limit ? sliding : sliding * (limit / distance);
+        }
+    });
+}
+
+void SoftBody::writeMesh() {
+    size_t count = _positions.size();
+    bool any = false;
+    for (size_t p = 0; p < count; ++p) {
+        _moved[p] = samePosition(_positions[p], _written[p]) ? 0 : Moved;
+        any = any || _moved[p];
+    }
+    if (!any) return;
+
+    // A vertex's normal depends on every corner of the triangles around it.
+    for (size_t t = 0; t < _triangles.size(); t += 3) {
+        if ((_moved[_triangles[t]] | _moved[_triangles[t + 1]] | _moved[_triangles[t + 2]]) & Moved) {
+            _moved[_triangles[t]] |= Touched;
+            _moved[_triangles[t + 1]] |= Touched;
+            _moved[_triangles[t + 2]] |= Touched;
+        }
+    }
+    _movedVertices.clear();
+    for (size_t v = 0; v < _vertexParticle.size(); ++v) {
+        if (_moved[_vertexParticle[v]] & Touched) _movedVertices.push_back(static_cast<unsigned int>(v));
+    }
+
+    _mesh->updatePositions([&](size_t vertex) { return _positions[_vertexParticle[vertex]]; });
+    _mesh->calculateNormals(_movedVertices);
+    std::copy(_positions.begin(), _positions.end(), _written.begin());
+}
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
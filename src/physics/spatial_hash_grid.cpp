@@ -0,0 +1,152 @@
+#include "physics/spatial_hash_grid.hpp"
+#include "core/thread_pool.hpp"
+#include <algorithm>
+
+namespace SFSim {
+namespace Physics {
+
+namespace {
+
+constexpr size_t BuildGrain = 16384;
+
+} // namespace
+
+SpatialHashGrid::SpatialHashGrid()
+    : _cellSize(1.0f)
+    , _inverseCellSize(1.0f)
+    , _parallelThreshold(65536)
+    , _bucketMask(1)
+{
+}
+
+void SpatialHashGrid::build(const std::vector<Vector3f>& points) {
+    std::vector<float> x(points.size());
+    std::vector<float> y(points.size());
+    std::vector<float> z(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        x[i] = points[i].x;
+        y[i] = points[i].y;
+        z[i] = points[i].z;
+    }
+    build(x.data(), y.data(), z.data(), points.size());
+}
+
+void SpatialHashGrid::clear() {
+    _sortedIndices.clear();
+    _sortedX.clear();
+    _sortedY.clear();
+    _sortedZ.clear();
+    _sortedCells.clear();
+}
+
+void SpatialHashGrid::build(const float* x, const float* y, const float* z, size_t count) {
+    _inverseCellSize = 1.0f / _cellSize;
+
+    int bits = 1;
+    while ((size_t(1) << bits) < count * 2) ++bits;
+    size_t buckets = size_t(1) << bits;
+    _bucketMask = static_cast<uint32_t>(buckets - 1);
+
+    // Atomics can't be moved, so the table is replaced rather than resized;
+    // it only ever grows, and only the first buckets entries are used.
+    if (_counts.size() < buckets) {
+        _counts = std::vector<std::atomic<uint32_t>>(buckets);
+    }
+    _bucketStart.resize(buckets + 1);
+    _cells.resize(count);
+    _buckets.resize(count);
+    _ranks.resize(count);
+    _sortedIndices.resize(count);
+    _sortedX.resize(count);
+    _sortedY.resize(count);
+    _sortedZ.resize(count);
+    _sortedCells.resize(count);
+
+    bool parallel = Core::ThreadPool::exceedsThreshold(count, _parallelThreshold);
+
+    Core::ThreadPool::parallelForIf(parallel, buckets, BuildGrain, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; ++b) _counts[b].store(0, std::memory_order_relaxed);
+    });
+
+    // Count the points per bucket, each point taking the next rank in its
+    // bucket. On one thread ranks follow point order, and plain loads and
+    // stores do; in parallel they need the atomic increment, and the
+    // buckets are put back in point order below.
+    Core::ThreadPool::parallelForIf(parallel, count, BuildGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            int cellX = cellCoordinate(x[i]);
+            int cellY = cellCoordinate(y[i]);
+            int cellZ = cellCoordinate(z[i]);
+            uint32_t bucket = bucketOf(cellX, cellY, cellZ);
+            _cells[i] = packCell(cellX, cellY, cellZ);
+            _buckets[i] = bucket;
+            if (parallel) {
+                _ranks[i] = _counts[bucket].fetch_add(1, std::memory_order_relaxed);
+            } else {
+                uint32_t rank = _counts[bucket].load(std::memory_order_relaxed);
+                _counts[bucket].store(rank + 1, std::memory_order_relaxed);
+                _ranks[i] = rank;
+            }
+        }
+    });
+
+    // Prefix sum of the counts, in blocks: each block's total, a scan over
+    // the totals, then each block's starts from its offset.
+    size_t blocks = (buckets + BuildGrain - 1) / BuildGrain;
+    _blockSums.resize(blocks);
+    Core::ThreadPool::parallelForIf(parallel, blocks, 1, [&](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; ++block) {
+            uint32_t sum = 0;
+            size_t last = std::min(buckets, (block + 1) * BuildGrain);
+            for (size_t b = block * BuildGrain; b < last; ++b) sum += _counts[b].load(std::memory_order_relaxed);
+            _blockSums[block] = sum;
+        }
+    });
+    uint32_t offset = 0;
+    for (uint32_t& sum : _blockSums) {
+        uint32_t blockSum = sum;
+        sum = offset;
+        offset += blockSum;
+    }
+    Core::ThreadPool::parallelForIf(parallel, blocks, 1, [&](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; ++block) {
+            uint32_t start = _blockSums[block];
+            size_t last = std::min(buckets, (block + 1) * BuildGrain);
+            for (size_t b = block * BuildGrain; b < last; ++b) {
+                _bucketStart[b] = start;
+                start += _counts[b].load(std::memory_order_relaxed);
+            }
+        }
+    });
+    _bucketStart[buckets] = static_cast<uint32_t>(count);
+
+    Core::ThreadPool::parallelForIf(parallel, count, BuildGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            _sortedIndices[_bucketStart[_buckets[i]] + _ranks[i]] = static_cast<uint32_t>(i);
+        }
+    });
+
+    // Buckets hold a handful of points, so sorting each is cheap.
+    if (parallel) {
+        Core::ThreadPool::parallelForIf(parallel, buckets, BuildGrain, [&](size_t begin, size_t end) {
+            for (size_t b = begin; b < end; ++b) {
+                uint32_t* first = _sortedIndices.data() + _bucketStart[b];
+                uint32_t* last = _sortedIndices.data() + _bucketStart[b + 1];
+                if (last - first > 1) std::sort(first, last);
+            }
+        });
+    }
+
+    Core::ThreadPool::parallelForIf(parallel, count, BuildGrain, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; ++s) {
+            uint32_t i = _sortedIndices[s];
+            _sortedX[s] = x[i];
+            _sortedY[s] = y[i];
+            _sortedZ[s] = z[i];
+            _sortedCells[s] = _cells[i];
+        }
+    });
+}
+
+} // namespace Physics
+} // namespace SFSim
\ No newline at end of file
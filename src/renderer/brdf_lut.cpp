@@ -0,0 +1,96 @@
+#include "renderer/brdf_lut.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace SFSim {
+
+namespace {
+
+float radicalInverse(std::uint32_t bits) {
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return static_cast<float>(bits) * 2.3283064365386963e-10f;
+}
+
+float geometrySchlickGGX(float NdotX, float k) {
+    return NdotX / (NdotX * (1.0f - k) + k);
+}
+
+} // namespace
+
+const BRDFLookupTable& BRDFLookupTable::getInstance() {
+    static BRDFLookupTable instance;
+    return instance;
+}
+
+BRDFLookupTable::BRDFLookupTable()
+    : _table(Size * Size)
+{
+    for (int row = 0; row < Size; ++row) {
+        float roughness = static_cast<float>(row) / (Size - 1);
+        for (int column = 0; column < Size; ++column) {
+            // Avoid NdotV = 0 exactly, where the lobe degenerates.
+            float NdotV = std::max(static_cast<float>(column) / (Size - 1), 1e-3f);
+            _table[row * Size + column] = integrate(NdotV, roughness);
+        }
+    }
+}
+
+Vector2f BRDFLookupTable::sample(float NdotV, float roughness) const {
+    float u = std::clamp(NdotV, 0.0f, 1.0f) * (Size - 1);
+    float v = std::clamp(roughness, 0.0f, 1.0f) * (Size - 1);
+    
+    int x0 = std::min(static_cast<int>(u), Size - 2);
+    int y0 = std::min(static_cast<int>(v), Size - 2);
+    float fx = u - x0;
+    float fy = v - y0;
+    
+    const Vector2f* row0 = &_table[y0 * Size + x0];
+    const Vector2f* row1 = row0 + Size;
+    Vector2f top = Vector2f::lerp(row0[0], row0[1], fx);
+    Vector2f bottom = Vector2f::lerp(row1[0], row1[1], fx);
+    return Vector2f::lerp(top, bottom, fy);
+}
+
+Vector2f BRDFLookupTable::integrate(float NdotV, float roughness) const {
+    // Importance-sample the GGX lobe around N = +Z (Karis, "Real Shading in
+    // Unreal Engine 4"), using the IBL remapping k = roughness^2 / 2.
+    Vector3f V(std::sqrt(std::max(0.0f, 1.0f - NdotV * NdotV)), 0.0f, NdotV);
+    float a = roughness * roughness;
+    float k = a / 2.0f;
+    
+    float scale = 0.0f;
+    float bias = 0.0f;
+    
+    for (int i = 0; i < SampleCount; ++i) {
+        float u1 = static_cast<float>(i) / SampleCount;
+        float u2 = radicalInverse(static_cast<std::uint32_t>(i));
+        
+        float phi = 2.0f * static_cast<float>(M_PI) * u1;
+        float cosTheta = std::sqrt((1.0f - u2) / (1.0f + (a * a - 1.0f) * u2));
+        float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+        Vector3f H(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
+        
+        float VdotH = V.dot(H);
+        Vector3f L = H * (2.0f * VdotH) - V;
+        
+        float NdotL = L.z;
+        float NdotH = H.z;
+        if (NdotL <= 0.0f || VdotH <= 0.0f) continue;
+        
+        float G = geometrySchlickGGX(NdotV, k) * geometrySchlickGGX(NdotL, k);
+        float visibility = G * VdotH / (NdotH * NdotV);
+        float fresnel = std::pow(1.0f - VdotH, 5.0f);
+        
+        scale += (1.0f - fresnel) * visibility;
+        bias += fresnel * visibility;
+    }
+    
+    return Vector2f(scale / SampleCount, bias / SampleCount);
+}
+
+} // namespace SFSim
\ No newline at end of file
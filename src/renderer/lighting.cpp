@@ -0,0 +1,287 @@
+#include "renderer/lighting.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace SFSim {
+
+bool Light::operator==(const Light& other) const {
+    return type == other.type &&
+           position.x == other.position.x && position.y == other.position.y && position.z == other.position.z &&
+           direction.x == other.direction.x && direction.y == other.direction.y && direction.z == other.direction.z &&
+           color == other.color &&
+           intensity == other.intensity &&
+           range == other.range &&
+           innerConeAngle == other.innerConeAngle &&
+           outerConeAngle == other.outerConeAngle;
+}
+
+LightEnvironment::LightEnvironment()
+    : _ambient(Vector3f::zero())
+    , _hasView(false)
+    , _eye(Vector3f::zero())
+    , _perspective(true)
+    , _near(0.1f)
+    , _far(1000.0f)
+    , _sliceScale(1.0f)
+    , _tilesX(16)
+    , _tilesY(9)
+    , _slices(24)
+    , _version(0)
+    , _viewChanged(true)
+{
+}
+
+void LightEnvironment::setView(const Matrix4x4& view, const Matrix4x4& projection, const Vector3f& eye) {
+    if (_hasView &&
+        std::memcmp(view.m, _view.m, sizeof(view.m)) == 0 &&
+        std::memcmp(projection.m, _projection.m, sizeof(projection.m)) == 0 &&
+        eye.x == _eye.x && eye.y == _eye.y && eye.z == _eye.z) {
+        return;
+    }
+
+    _hasView = true;
+    _view = view;
+    _projection = projection;
+    _eye = eye;
+
+    // Recover the clip planes from the projection matrix (see Matrix4x4::perspective/orthographic).
+    _perspective = projection(3, 2) != 0.0f;
+    if (_perspective) {
+        _near = projection(2, 3) / (projection(2, 2) - 1.0f);
+        _far = projection(2, 3) / (projection(2, 2) + 1.0f);
+    } else {
+        _near = (projection(2, 3) + 1.0f) / projection(2, 2);
+        _far = (projection(2, 3) - 1.0f) / projection(2, 2);
+    }
+    _near = std::max(_near, 1e-4f);
+    _far = std::max(_far, _near * 1.001f);
+    _sliceScale = _perspective ? _slices / std::log(_far / _near) : _slices / (_far - _near);
+
+    _viewChanged = true;
+}
+
+void LightEnvironment::clearView() {
+    if (_hasView) {
+        _hasView = false;
+        _viewChanged = true;
+    }
+}
+
+void LightEnvironment::setAmbientLight(const sf::Color& color, float intensity) {
+    float scale = intensity / 255.0f;
+    Vector3f ambient(color.r * scale, color.g * scale, color.b * scale);
+    if (ambient.x != _ambient.x || ambient.y != _ambient.y || ambient.z != _ambient.z) {
+        _ambient = ambient;
+        ++_version;
+    }
+}
+
+void LightEnvironment::setClusterDimensions(int tilesX, int tilesY, int slices) {
+    _tilesX = std::max(1, tilesX);
+    _tilesY = std::max(1, tilesY);
+    _slices = std::max(1, slices);
+    _sliceScale = _perspective ? _slices / std::log(_far / _near) : _slices / (_far - _near);
+    _viewChanged = true;
+}
+
+void LightEnvironment::build() {
+    if (!_viewChanged && _lights == _builtLights) {
+        return;
+    }
+
+    _builtLights = _lights;
+    _viewChanged = false;
+    ++_version;
+
+    _directional.clear();
+
+    int tilesX = _hasView ? _tilesX : 1;
+    int tilesY = _hasView ? _tilesY : 1;
+    int slices = _hasView ? _slices : 1;
+    size_t clusterCount = static_cast<size_t>(tilesX) * tilesY * slices;
+
+    std::vector<ClusterRange> ranges(_builtLights.size());
+    std::vector<unsigned int> counts(clusterCount + 1, 0);
+
+    for (unsigned int i = 0; i < _builtLights.size(); ++i) {
+        const Light& light = _builtLights[i];
+        ClusterRange& range = ranges[i];
+
+        if (light.type == LightType::Directional) {
+            _directional.push_back(i);
+            range = {0, -1, 0, -1, 0, -1};
+            continue;
+        }
+
+        if (!_hasView) {
+            range = {0, 0, 0, 0, 0, 0};
+        } else if (!computeClusterRange(light, range)) {
+            range = {0, -1, 0, -1, 0, -1};
+            continue;
+        }
+
+        for (int z = range.z0; z <= range.z1; ++z) {
+            for (int y = range.y0; y <= range.y1; ++y) {
+                for (int x = range.x0; x <= range.x1; ++x) {
+                    counts[(z * tilesY + y) * tilesX + x]++;
+                }
+            }
+        }
+    }
+
+    _clusterOffsets.assign(clusterCount + 1, 0);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        _clusterOffsets[c + 1] = _clusterOffsets[c] + counts[c];
+    }
+
+    _clusterLights.resize(_clusterOffsets[clusterCount]);
+    std::vector<unsigned int> cursor(_clusterOffsets.begin(), _clusterOffsets.end() - 1);
+
+    for (unsigned int i = 0; i < _builtLights.size(); ++i) {
+        const ClusterRange& range = ranges[i];
+        for (int z = range.z0; z <= range.z1; ++z) {
+            for (int y = range.y0; y <= range.y1; ++y) {
+                for (int x = range.x0; x <= range.x1; ++x) {
+                    _clusterLights[cursor[(z * tilesY + y) * tilesX + x]++] = i;
+                }
+            }
+        }
+    }
+}
+
+size_t LightEnvironment::getLightsAt(const Vector3f& worldPosition, const unsigned int*& lights) const {
+    if (_clusterOffsets.empty()) {
+        lights = nullptr;
+        return 0;
+    }
+
+    int cluster = 0;
+
+    if (_hasView) {
+        Vector3f viewPos = _view.transformPoint(worldPosition);
+        Vector4f clip = _projection * Vector4f(viewPos, 1.0f);
+
+        int x = _tilesX / 2;
+        int y = _tilesY / 2;
+        if (clip.w > 1e-6f) {
+            float ndcX = clip.x / clip.w;
+            float ndcY = clip.y / clip.w;
+            x = std::clamp(static_cast<int>((ndcX + 1.0f) * 0.5f * _tilesX), 0, _tilesX - 1);
+            y = std::clamp(static_cast<int>((ndcY + 1.0f) * 0.5f * _tilesY), 0, _tilesY - 1);
+        }
+
+        cluster = clusterIndex(x, y, depthSlice(-viewPos.z));
+    }
+
+    lights = _clusterLights.data() + _clusterOffsets[cluster];
+    return _clusterOffsets[cluster + 1] - _clusterOffsets[cluster];
+}
+
+bool LightEnvironment::evaluateLight(unsigned int index, const Vector3f& worldPosition, Vector3f& toLight, Vector3f& radiance) const {
+    const Light& light = _builtLights[index];
+    float scale = light.intensity / 255.0f;
+
+    if (light.type == LightType::Directional) {
+        toLight = -1.0f * light.direction.normalized();
+        radiance = Vector3f(light.color.r * scale, light.color.g * scale, light.color.b * scale);
+        return true;
+    }
+
+    Vector3f delta = light.position - worldPosition;
+    float distanceSquared = delta.lengthSquared();
+    if (distanceSquared >= light.range * light.range) {
+        return false;
+    }
+
+    float distance = std::sqrt(distanceSquared);
+    toLight = distance > 0.0f ? delta / distance : Vector3f::up();
+
+    float falloff = 1.0f - distance / light.range;
+    float attenuation = falloff * falloff;
+
+    if (light.type == LightType::Spot) {
+        float cosAngle = -toLight.dot(light.direction.normalized());
+        float cosOuter = std::cos(light.outerConeAngle);
+        float cosInner = std::cos(light.innerConeAngle);
+        if (cosAngle <= cosOuter) {
+            return false;
+        }
+        float t = std::min(1.0f, (cosAngle - cosOuter) / std::max(1e-4f, cosInner - cosOuter));
+        attenuation *= t * t * (3.0f - 2.0f * t);
+    }
+
+    scale *= attenuation;
+    radiance = Vector3f(light.color.r * scale, light.color.g * scale, light.color.b * scale);
+    return true;
+}
+
+Vector3f LightEnvironment::getPrimaryLightDirection() const {
+    if (!_directional.empty()) {
+        return -1.0f * _builtLights[_directional.front()].direction.normalized();
+    }
+    return Vector3f(0.5f, 0.5f, 1.0f).normalized();
+}
+
+const LightEnvironment& LightEnvironment::getDefault() {
+    static LightEnvironment environment = [] {
+        LightEnvironment env;
+        Light light;
+        light.direction = -1.0f * Vector3f(0.5f, 0.5f, 1.0f).normalized();
+        env.addLight(light);
+        env.build();
+        return env;
+    }();
+    return environment;
+}
+
+int LightEnvironment::depthSlice(float depth) const {
+    if (depth <= _near) return 0;
+    float slice = _perspective ? std::log(depth / _near) * _sliceScale : (depth - _near) * _sliceScale;
+    return std::clamp(static_cast<int>(slice), 0, _slices - 1);
+}
+
+bool LightEnvironment::computeClusterRange(const Light& light, ClusterRange& range) const {
+    Vector3f center = _view.transformPoint(light.position);
+    float radius = light.range;
+
+    float nearDepth = -center.z - radius;
+    float farDepth = -center.z + radius;
+    if (farDepth < _near || nearDepth > _far) {
+        return false;
+    }
+
+    range.z0 = depthSlice(nearDepth);
+    range.z1 = depthSlice(farDepth);
+
+    // Project the corners of the light's view-space bounding box, with depth
+    // clamped to the visible range, to get a conservative screen rectangle.
+    float minX = 1.0f, maxX = -1.0f, minY = 1.0f, maxY = -1.0f;
+    float zFront = -std::max(nearDepth, _near);
+    float zBack = -std::min(farDepth, _far);
+
+    for (int corner = 0; corner < 8; ++corner) {
+        Vector3f p(center.x + ((corner & 1) ? radius : -radius),
+                   center.y + ((corner & 2) ? radius : -radius),
+                   (corner & 4) ? zBack : zFront);
+        Vector4f clip = _projection * Vector4f(p, 1.0f);
+        float ndcX = clip.x / clip.w;
+        float ndcY = clip.y / clip.w;
+        minX = std::min(minX, ndcX);
+        maxX = std::max(maxX, ndcX);
+        minY = std::min(minY, ndcY);
+        maxY = std::max(maxY, ndcY);
+    }
+
+    if (maxX < -1.0f || minX > 1.0f || maxY < -1.0f || minY > 1.0f) {
+        return false;
+    }
+
+    range.x0 = std::clamp(static_cast<int>((minX + 1.0f) * 0.5f * _tilesX), 0, _tilesX - 1);
+    range.x1 = std::clamp(static_cast<int>((maxX + 1.0f) * 0.5f * _tilesX), 0, _tilesX - 1);
+    range.y0 = std::clamp(static_cast<int>((minY + 1.0f) * 0.5f * _tilesY), 0, _tilesY - 1);
+    range.y1 = std::clamp(static_cast<int>((maxY + 1.0f) * 0.5f * _tilesY), 0, _tilesY - 1);
+    return true;
+}
+
+} // namespace SFSim
\ No newline at end of file
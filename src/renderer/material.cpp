@@ -1,21 +1,194 @@
 #include "renderer/material.hpp"
+#include "renderer/lighting.hpp"
+#include "renderer/brdf_lut.hpp"
 #include <cmath>
 #include <algorithm>
 #include <cstdint>
+#include <cassert>
+#include <typeinfo>
+#include <atomic>
+#include <functional>
+#include <vector>
 
 namespace SFSim {
 
+namespace {
+
+struct Vector3x4 {
+    Float4 x, y, z;
+};
+
+Vector3x4 gatherVectors(const Vector3f* v, size_t base, size_t lanes) {
+    float x[4], y[4], z[4];
+    for (size_t lane = 0; lane < 4; ++lane) {
+        const Vector3f& p = v[base + std::min(lane, lanes - 1)];
+        x[lane] = p.x;
+        y[lane] = p.y;
+        z[lane] = p.z;
+    }
+    return {Float4::load(x), Float4::load(y), Float4::load(z)};
+}
+
+void normalize(Float4& x, Float4& y, Float4& z) {
+    Float4 length = Float4::sqrt(x * x + y * y + z * z);
+    Float4 invLength = Float4(1.0f) / Float4::max(length, Float4(1e-8f));
+    x = x * invLength;
+    y = y * invLength;
+    z = z * invLength;
+}
+
+struct ShadingScratch {
+    std::vector<Vector3f> viewDirs;
+    std::vector<float> r, g, b;
+};
+
+void hashCombine(size_t& seed, size_t value) {
+    seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+void hashFloat(size_t& seed, float value) {
+    // Adding zero folds -0 into +0 so equal values hash equally.
+    hashCombine(seed, std::hash<float>()(value + 0.0f));
+}
+
+void hashColor(size_t& seed, const sf::Color& color) {
+    hashCombine(seed, (static_cast<std::uint32_t>(color.r) << 24) | (static_cast<std::uint32_t>(color.g) << 16) |
+                      (static_cast<std::uint32_t>(color.b) << 8) | color.a);
+}
+
+ShadingScratch& getShadingScratch() {
+    thread_local ShadingScratch scratch;
+    return scratch;
+}
+
+// Collects (vertex, light) pairs four at a time so point and spot lights,
+// which differ per vertex, still go through the SIMD lighting kernels.
+class PairBatcher {
+public:
+    PairBatcher(const Vector3f* normals, const Vector3f* viewDirs, float* r, float* g, float* b)
+        : _normals(normals), _viewDirs(viewDirs), _r(r), _g(g), _b(b), _count(0)
+    {
+    }
+
+    void add(size_t vertex, const Vector3f& toLight, const Vector3f& radiance) {
+        _vertex[_count] = vertex;
+        _toLight[_count] = toLight;
+        _radiance[_count] = radiance;
+        ++_count;
+    }
+
+    bool full() const { return _count == 4; }
+
+    template<typename Evaluate>
+    void flush(Evaluate evaluate) {
+        if (_count == 0) return;
+
+        float n[3][4], v[3][4], l[3][4];
+        for (size_t lane = 0; lane < 4; ++lane) {
+            size_t src = std::min(lane, _count - 1);
+            const Vector3f& normal = _normals[_vertex[src]];
+            const Vector3f& view = _viewDirs[_vertex[src]];
+            const Vector3f& light = _toLight[src];
+            n[0][lane] = normal.x; n[1][lane] = normal.y; n[2][lane] = normal.z;
+            v[0][lane] = view.x;   v[1][lane] = view.y;   v[2][lane] = view.z;
+            l[0][lane] = light.x;  l[1][lane] = light.y;  l[2][lane] = light.z;
+        }
+
+        LightingBatch batch;
+        batch.nx = Float4::load(n[0]); batch.ny = Float4::load(n[1]); batch.nz = Float4::load(n[2]);
+        batch.vx = Float4::load(v[0]); batch.vy = Float4::load(v[1]); batch.vz = Float4::load(v[2]);
+        batch.lx = Float4::load(l[0]); batch.ly = Float4::load(l[1]); batch.lz = Float4::load(l[2]);
+
+        Float4 r, g, b;
+        evaluate(batch, r, g, b);
+
+        float rs[4], gs[4], bs[4];
+        r.store(rs);
+        g.store(gs);
+        b.store(bs);
+        for (size_t lane = 0; lane < _count; ++lane) {
+            size_t vertex = _vertex[lane];
+            _r[vertex] += rs[lane] * _radiance[lane].x;
+            _g[vertex] += gs[lane] * _radiance[lane].y;
+            _b[vertex] += bs[lane] * _radiance[lane].z;
+        }
+
+        _count = 0;
+    }
+
+private:
+    const Vector3f* _normals;
+    const Vector3f* _viewDirs;
+    float* _r;
+    float* _g;
+    float* _b;
+    size_t _vertex[4];
+    Vector3f _toLight[4];
+    Vector3f _radiance[4];
+    size_t _count;
+};
+
+} // namespace
+
 Material::Material(MaterialType type)
     : _type(type)
+    , _id(nextId())
     , _name("Default Material")
     , _diffuseColor(sf::Color::White)
     , _emissiveColor(sf::Color::Black)
     , _opacity(1.0f)
     , _wireframe(false)
     , _doubleSided(false)
+    , _shadingQuality(ShadingQuality::Accurate)
+    , _version(0)
 {
 }
 
+unsigned int Material::nextId() {
+    static std::atomic<unsigned int> counter(0);
+    return ++counter;
+}
+
+void Material::markChanged() {
+    ++_version;
+    updateShadingConstants();
+}
+
+bool Material::supportsBatchedShading() const {
+    return typeid(*this) == typeid(Material);
+}
+
+std::shared_ptr<Material> Material::clone() const {
+    // Copying a subclass as a plain Material would silently change how it
+    // shades; every subclass has to override clone().
+    assert(typeid(*this) == typeid(Material) && "Material subclasses must override clone()");
+    auto copy = std::make_shared<Material>(*this);
+    copy->_id = nextId();
+    return copy;
+}
+
+bool Material::isEquivalent(const Material& other) const {
+    return typeid(*this) == typeid(other) &&
+           _type == other._type &&
+           _diffuseColor == other._diffuseColor &&
+           _emissiveColor == other._emissiveColor &&
+           _opacity == other._opacity &&
+           _wireframe == other._wireframe &&
+           _doubleSided == other._doubleSided &&
+           _shadingQuality == other._shadingQuality;
+}
+
+size_t Material::hashProperties() const {
+    size_t seed = typeid(*this).hash_code();
+    hashCombine(seed, static_cast<size_t>(_type));
+    hashColor(seed, _diffuseColor);
+    hashColor(seed, _emissiveColor);
+    hashFloat(seed, _opacity);
+    hashCombine(seed, (_wireframe ? 1u : 0u) | (_doubleSided ? 2u : 0u));
+    hashCombine(seed, static_cast<size_t>(_shadingQuality));
+    return seed;
+}
+
 sf::Color Material::calculateColor(const Vector3f& position, const Vector3f& normal, const Vector3f& lightDir) const {
     float NdotL = std::max(0.0f, normal.dot(lightDir));
     
@@ -27,12 +200,162 @@ sf::Color Material::calculateColor(const Vector3f& position, const Vector3f& nor
     return sf::Color(r, g, b, a);
 }
 
+void Material::shade(const Vector3f* normals, const Vector3f* positions, sf::Color* out, size_t n, const LightEnvironment& lighting) const {
+    if (!supportsBatchedShading()) {
+        Vector3f lightDir = lighting.getPrimaryLightDirection();
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = calculateColor(positions[i], normals[i], lightDir);
+        }
+        return;
+    }
+    
+    ShadingScratch& scratch = getShadingScratch();
+    scratch.viewDirs.resize(n);
+    scratch.r.resize(n);
+    scratch.g.resize(n);
+    scratch.b.resize(n);
+    
+    Vector3f ambient = getAmbientTerm();
+    for (size_t i = 0; i < n; ++i) {
+        scratch.viewDirs[i] = lighting.hasView() ? (lighting.getEyePosition() - positions[i]).normalized() : Vector3f(0, 0, 1);
+        scratch.r[i] = ambient.x;
+        scratch.g[i] = ambient.y;
+        scratch.b[i] = ambient.z;
+    }
+    
+    const Vector3f& environment = lighting.getAmbientRadiance();
+    if (environment.x > 0.0f || environment.y > 0.0f || environment.z > 0.0f) {
+        evaluateAmbient(normals, scratch.viewDirs.data(), n, environment, scratch.r.data(), scratch.g.data(), scratch.b.data());
+    }
+    
+    auto evaluate = [this](const LightingBatch& batch, Float4& r, Float4& g, Float4& b) {
+        evaluateLighting(batch, r, g, b);
+    };
+    
+    for (unsigned int lightIndex : lighting.getDirectionalLights()) {
+        Vector3f toLight, radiance;
+        lighting.evaluateLight(lightIndex, Vector3f::zero(), toLight, radiance);
+        
+        const Float4 lx(toLight.x), ly(toLight.y), lz(toLight.z);
+        const Float4 radianceR(radiance.x), radianceG(radiance.y), radianceB(radiance.z);
+        
+        for (size_t base = 0; base < n; base += Float4::Width) {
+            size_t lanes = std::min(n - base, static_cast<size_t>(Float4::Width));
+            Vector3x4 normal = gatherVectors(normals, base, lanes);
+            Vector3x4 view = gatherVectors(scratch.viewDirs.data(), base, lanes);
+            
+            LightingBatch batch{normal.x, normal.y, normal.z, view.x, view.y, view.z, lx, ly, lz};
+            Float4 r, g, b;
+            evaluateLighting(batch, r, g, b);
+            
+            float rs[4], gs[4], bs[4];
+            (r * radianceR).store(rs);
+            (g * radianceG).store(gs);
+            (b * radianceB).store(bs);
+            for (size_t lane = 0; lane < lanes; ++lane) {
+                scratch.r[base + lane] += rs[lane];
+                scratch.g[base + lane] += gs[lane];
+                scratch.b[base + lane] += bs[lane];
+            }
+        }
+    }
+    
+    PairBatcher batcher(normals, scratch.viewDirs.data(), scratch.r.data(), scratch.g.data(), scratch.b.data());
+    
+    for (size_t i = 0; i < n; ++i) {
+        const unsigned int* lights = nullptr;
+        size_t lightCount = lighting.getLightsAt(positions[i], lights);
+        
+        for (size_t j = 0; j < lightCount; ++j) {
+            Vector3f toLight, radiance;
+            if (!lighting.evaluateLight(lights[j], positions[i], toLight, radiance)) continue;
+            
+            batcher.add(i, toLight, radiance);
+            if (batcher.full()) {
+                batcher.flush(evaluate);
+            }
+        }
+    }
+    batcher.flush(evaluate);
+    
+    std::uint8_t alpha = static_cast<std::uint8_t>(_diffuseColor.a * _opacity);
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = sf::Color(static_cast<std::uint8_t>(std::clamp(scratch.r[i], 0.0f, 255.0f)),
+                           static_cast<std::uint8_t>(std::clamp(scratch.g[i], 0.0f, 255.0f)),
+                           static_cast<std::uint8_t>(std::clamp(scratch.b[i], 0.0f, 255.0f)),
+                           alpha);
+    }
+}
+
+Vector3f Material::getAmbientTerm() const {
+    return Vector3f(_emissiveColor.r, _emissiveColor.g, _emissiveColor.b);
+}
+
+void Material::evaluateAmbient(const Vector3f* normals, const Vector3f* viewDirs, size_t n, const Vector3f& radiance, float* r, float* g, float* b) const {
+    float ambientR = _diffuseColor.r * radiance.x;
+    float ambientG = _diffuseColor.g * radiance.y;
+    float ambientB = _diffuseColor.b * radiance.z;
+    for (size_t i = 0; i < n; ++i) {
+        r[i] += ambientR;
+        g[i] += ambientG;
+        b[i] += ambientB;
+    }
+}
+
+void Material::evaluateLighting(const LightingBatch& batch, Float4& r, Float4& g, Float4& b) const {
+    Float4 NdotL = Float4::max(Float4(0.0f), batch.nx * batch.lx + batch.ny * batch.ly + batch.nz * batch.lz);
+    r = Float4(_diffuseColor.r) * NdotL;
+    g = Float4(_diffuseColor.g) * NdotL;
+    b = Float4(_diffuseColor.b) * NdotL;
+}
+
 PhongMaterial::PhongMaterial()
     : Material(MaterialType::Phong)
     , _specularColor(sf::Color::White)
     , _ambientColor(sf::Color(32, 32, 32))
     , _shininess(32.0f)
 {
+    setShininess(_shininess);
+}
+
+void PhongMaterial::setShininess(float shininess) {
+    _shininess = std::max(1.0f, shininess);
+    markChanged();
+    
+    // x^shininess sampled over [0, 1] with one extra entry so interpolation
+    // never reads past the end.
+    _specularTable.resize(SpecularTableSize + 1);
+    for (int i = 0; i < SpecularTableSize; ++i) {
+        _specularTable[i] = std::pow(static_cast<float>(i) / (SpecularTableSize - 1), _shininess);
+    }
+    _specularTable[SpecularTableSize] = 1.0f;
+}
+
+bool PhongMaterial::supportsBatchedShading() const {
+    return typeid(*this) == typeid(PhongMaterial);
+}
+
+std::shared_ptr<Material> PhongMaterial::clone() const {
+    assert(typeid(*this) == typeid(PhongMaterial) && "Material subclasses must override clone()");
+    auto copy = std::make_shared<PhongMaterial>(*this);
+    copy->_id = nextId();
+    return copy;
+}
+
+bool PhongMaterial::isEquivalent(const Material& other) const {
+    if (!Material::isEquivalent(other)) return false;
+    const auto& phong = static_cast<const PhongMaterial&>(other);
+    return _specularColor == phong._specularColor &&
+           _ambientColor == phong._ambientColor &&
+           _shininess == phong._shininess;
+}
+
+size_t PhongMaterial::hashProperties() const {
+    size_t seed = Material::hashProperties();
+    hashColor(seed, _specularColor);
+    hashColor(seed, _ambientColor);
+    hashFloat(seed, _shininess);
+    return seed;
 }
 
 sf::Color PhongMaterial::calculateColor(const Vector3f& position, const Vector3f& normal, const Vector3f& lightDir) const {
@@ -70,12 +393,96 @@ sf::Color PhongMaterial::calculateColor(const Vector3f& position, const Vector3f
     return sf::Color(r, g, b, a);
 }
 
+Vector3f PhongMaterial::getAmbientTerm() const {
+    const float ambientStrength = 0.1f;
+    return Vector3f(_ambientColor.r * ambientStrength + _emissiveColor.r,
+                    _ambientColor.g * ambientStrength + _emissiveColor.g,
+                    _ambientColor.b * ambientStrength + _emissiveColor.b);
+}
+
+void PhongMaterial::evaluateLighting(const LightingBatch& batch, Float4& r, Float4& g, Float4& b) const {
+    const Float4 zero(0.0f);
+    
+    Float4 NdotLRaw = batch.nx * batch.lx + batch.ny * batch.ly + batch.nz * batch.lz;
+    Float4 NdotL = Float4::max(zero, NdotLRaw);
+    
+    Float4 twoNdotL = Float4(2.0f) * NdotLRaw;
+    Float4 rx = batch.nx * twoNdotL - batch.lx;
+    Float4 ry = batch.ny * twoNdotL - batch.ly;
+    Float4 rz = batch.nz * twoNdotL - batch.lz;
+    Float4 RdotV = Float4::select(NdotLRaw > zero, Float4::max(zero, rx * batch.vx + ry * batch.vy + rz * batch.vz), zero);
+    
+    Float4 specular;
+    if (_shadingQuality == ShadingQuality::Fast) {
+        float position[4], spec[4];
+        (Float4::min(RdotV, Float4(1.0f)) * Float4(SpecularTableSize - 1.0f)).store(position);
+        for (int lane = 0; lane < 4; ++lane) {
+            int index = static_cast<int>(position[lane]);
+            float t = position[lane] - index;
+            spec[lane] = _specularTable[index] + (_specularTable[index + 1] - _specularTable[index]) * t;
+        }
+        specular = Float4::load(spec);
+    } else {
+        float rdotv[4], spec[4];
+        RdotV.store(rdotv);
+        for (int lane = 0; lane < 4; ++lane) {
+            spec[lane] = rdotv[lane] > 0.0f ? std::pow(rdotv[lane], _shininess) : 0.0f;
+        }
+        specular = Float4::load(spec);
+    }
+    
+    r = Float4(_diffuseColor.r) * NdotL + Float4(_specularColor.r) * specular;
+    g = Float4(_diffuseColor.g) * NdotL + Float4(_specularColor.g) * specular;
+    b = Float4(_diffuseColor.b) * NdotL + Float4(_specularColor.b) * specular;
+}
+
 PBRMaterial::PBRMaterial()
     : Material(MaterialType::PBR)
     , _metallic(0.0f)
     , _roughness(0.5f)
     , _specularF0(0.04f, 0.04f, 0.04f)
 {
+    updateShadingConstants();
+}
+
+bool PBRMaterial::supportsBatchedShading() const {
+    return typeid(*this) == typeid(PBRMaterial);
+}
+
+std::shared_ptr<Material> PBRMaterial::clone() const {
+    assert(typeid(*this) == typeid(PBRMaterial) && "Material subclasses must override clone()");
+    auto copy = std::make_shared<PBRMaterial>(*this);
+    copy->_id = nextId();
+    return copy;
+}
+
+bool PBRMaterial::isEquivalent(const Material& other) const {
+    if (!Material::isEquivalent(other)) return false;
+    const auto& pbr = static_cast<const PBRMaterial&>(other);
+    return _metallic == pbr._metallic &&
+           _roughness == pbr._roughness &&
+           _specularF0.x == pbr._specularF0.x &&
+           _specularF0.y == pbr._specularF0.y &&
+           _specularF0.z == pbr._specularF0.z;
+}
+
+size_t PBRMaterial::hashProperties() const {
+    size_t seed = Material::hashProperties();
+    hashFloat(seed, _metallic);
+    hashFloat(seed, _roughness);
+    hashFloat(seed, _specularF0.x);
+    hashFloat(seed, _specularF0.y);
+    hashFloat(seed, _specularF0.z);
+    return seed;
+}
+
+void PBRMaterial::updateShadingConstants() {
+    _albedo = Vector3f(_diffuseColor.r / 255.0f, _diffuseColor.g / 255.0f, _diffuseColor.b / 255.0f);
+    _F0 = Vector3f::lerp(_specularF0, _albedo, _metallic);
+    
+    float a = _roughness * _roughness;
+    _alpha2 = a * a;
+    _k = (_roughness + 1.0f) * (_roughness + 1.0f) / 8.0f;
 }
 
 sf::Color PBRMaterial::calculateColor(const Vector3f& position, const Vector3f& normal, const Vector3f& lightDir) const {
@@ -84,7 +491,6 @@ sf::Color PBRMaterial::calculateColor(const Vector3f& position, const Vector3f&
     
     float NdotL = std::max(0.0f, normal.dot(lightDir));
     float NdotV = std::max(0.0f, normal.dot(viewDir));
-    float NdotH = std::max(0.0f, normal.dot(halfVector));
     float VdotH = std::max(0.0f, viewDir.dot(halfVector));
     
     Vector3f albedo = Vector3f(_diffuseColor.r / 255.0f, _diffuseColor.g / 255.0f, _diffuseColor.b / 255.0f);
@@ -114,6 +520,56 @@ sf::Color PBRMaterial::calculateColor(const Vector3f& position, const Vector3f&
     return sf::Color(r, g, b, a);
 }
 
+void PBRMaterial::evaluateAmbient(const Vector3f* normals, const Vector3f* viewDirs, size_t n, const Vector3f& radiance, float* r, float* g, float* b) const {
+    const BRDFLookupTable& lut = BRDFLookupTable::getInstance();
+    float diffuseScale = 1.0f - _metallic;
+    
+    for (size_t i = 0; i < n; ++i) {
+        Vector2f split = lut.sample(std::max(0.0f, normals[i].dot(viewDirs[i])), _roughness);
+        Vector3f specular = _F0 * split.x + Vector3f(split.y, split.y, split.y);
+        r[i] += ((1.0f - specular.x) * diffuseScale * _albedo.x + specular.x) * radiance.x * 255.0f;
+        g[i] += ((1.0f - specular.y) * diffuseScale * _albedo.y + specular.y) * radiance.y * 255.0f;
+        b[i] += ((1.0f - specular.z) * diffuseScale * _albedo.z + specular.z) * radiance.z * 255.0f;
+    }
+}
+
+void PBRMaterial::evaluateLighting(const LightingBatch& batch, Float4& r, Float4& g, Float4& b) const {
+    const Vector3f& F0 = _F0;
+    const float a2 = _alpha2;
+    
+    const Float4 zero(0.0f);
+    const Float4 one(1.0f);
+    const Float4 oneMinusK(1.0f - _k), kG(_k);
+    
+    Float4 hx = batch.lx + batch.vx;
+    Float4 hy = batch.ly + batch.vy;
+    Float4 hz = batch.lz + batch.vz;
+    normalize(hx, hy, hz);
+    
+    Float4 NdotL = Float4::max(zero, batch.nx * batch.lx + batch.ny * batch.ly + batch.nz * batch.lz);
+    Float4 NdotV = Float4::max(zero, batch.nx * batch.vx + batch.ny * batch.vy + batch.nz * batch.vz);
+    Float4 NdotH = Float4::max(zero, batch.nx * hx + batch.ny * hy + batch.nz * hz);
+    Float4 VdotH = Float4::max(zero, batch.vx * hx + batch.vy * hy + batch.vz * hz);
+    
+    Float4 oneMinusCos = one - VdotH;
+    Float4 oneMinusCos2 = oneMinusCos * oneMinusCos;
+    Float4 fresnel = oneMinusCos2 * oneMinusCos2 * oneMinusCos;
+    Float4 Fr = Float4(F0.x) + Float4(1.0f - F0.x) * fresnel;
+    Float4 Fg = Float4(F0.y) + Float4(1.0f - F0.y) * fresnel;
+    Float4 Fb = Float4(F0.z) + Float4(1.0f - F0.z) * fresnel;
+    
+    Float4 d = NdotH * NdotH * Float4(a2 - 1.0f) + one;
+    Float4 D = Float4(a2) / (Float4(static_cast<float>(M_PI)) * d * d);
+    Float4 G = (NdotV / (NdotV * oneMinusK + kG)) * (NdotL / (NdotL * oneMinusK + kG));
+    Float4 specular = D * G / (Float4(4.0f) * NdotV * NdotL + Float4(0.001f));
+    
+    const Float4 diffuseScale((1.0f - _metallic) / static_cast<float>(M_PI));
+    const Float4 scale(255.0f);
+    r = ((one - Fr) * diffuseScale * Float4(_albedo.x) + Fr * specular) * NdotL * scale;
+    g = ((one - Fg) * diffuseScale * Float4(_albedo.y) + Fg * specular) * NdotL * scale;
+    b = ((one - Fb) * diffuseScale * Float4(_albedo.z) + Fb * specular) * NdotL * scale;
+}
+
 Vector3f PBRMaterial::fresnelSchlick(float cosTheta, const Vector3f& F0) const {
     float oneMinusCos = 1.0f - cosTheta;
     float oneMinusCos5 = oneMinusCos * oneMinusCos * oneMinusCos * oneMinusCos * oneMinusCos;
@@ -0,0 +1,61 @@
+#include "renderer/material_registry.hpp"
+#include <algorithm>
+
+namespace SFSim {
+
+MaterialRegistry& MaterialRegistry::getInstance() {
+    static MaterialRegistry instance;
+    return instance;
+}
+
+std::shared_ptr<Material> MaterialRegistry::intern(const std::shared_ptr<Material>& material) {
+    if (!material) return getDefault();
+    
+    // Buckets are keyed by the hash at insertion time; a material modified
+    // after interning only costs a stale entry, since matches compare the
+    // current properties.
+    auto& bucket = _buckets[material->hashProperties()];
+    
+    for (auto it = bucket.begin(); it != bucket.end();) {
+        std::shared_ptr<Material> existing = it->lock();
+        if (!existing) {
+            it = bucket.erase(it);
+            continue;
+        }
+        if (existing == material || existing->isEquivalent(*material)) {
+            return existing;
+        }
+        ++it;
+    }
+    
+    bucket.push_back(material);
+    return material;
+}
+
+std::shared_ptr<Material> MaterialRegistry::getDefault() {
+    if (!_default) {
+        _default = intern(std::make_shared<Material>());
+    }
+    return _default;
+}
+
+size_t MaterialRegistry::getMaterialCount() const {
+    size_t count = 0;
+    for (const auto& entry : _buckets) {
+        count += std::count_if(entry.second.begin(), entry.second.end(),
+                               [](const std::weak_ptr<Material>& material) { return !material.expired(); });
+    }
+    return count;
+}
+
+void MaterialRegistry::collectGarbage() {
+    for (auto it = _buckets.begin(); it != _buckets.end();) {
+        auto& bucket = it->second;
+        bucket.erase(std::remove_if(bucket.begin(), bucket.end(),
+                                    [](const std::weak_ptr<Material>& material) { return material.expired(); }),
+                     bucket.end());
+        it = bucket.empty() ? _buckets.erase(it) : std::next(it);
+    }
+}
+
+} // namespace SFSim
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "renderer/particle_renderer.hpp"
+#include "core/thread_pool.hpp"
+#include "math/simd.hpp"
+#include <algorithm>
+
+namespace SFSim {
+
+namespace {
+
+// Multiple of Float4::Width, so every chunk starts on a whole group.
+constexpr size_t DrawGrain = 16384;
+
+} // namespace
+
+ParticleRenderer::ParticleRenderer()
+    : _style(Style::Points)
+    , _size(3.0f)
+    , _fadeOut(false)
+    , _drawn(0)
+{
+}
+
+void ParticleRenderer::draw(sf::RenderTarget& target, const Physics::ParticleWorld& world, const Matrix4x4& viewProjection) {
+    size_t count = world.size();
+    size_t perParticle = _style == Style::Points ? 1 : 6;
+    float width = static_cast<float>(target.getSize().x);
+    float height = static_cast<float>(target.getSize().y);
+
+    // Every chunk writes into its own slice of the buffer, sized for the
+    // worst case; the slices are closed up afterwards. The buffer only
+    // grows, so steady frames don't allocate.
+    if (_vertices.size() < count * perParticle) {
+        _vertices.resize(count * perParticle);
+    }
+    _chunkCounts.assign((count + DrawGrain - 1) / DrawGrain, 0);
+
+    Core::ThreadPool::getInstance().parallelFor(count, DrawGrain, [&](size_t begin, size_t end) {
+        _chunkCounts[begin / DrawGrain] = project(world, begin, end, viewProjection, width, height,
+                                                  _vertices.data() + begin * perParticle);
+    });
+
+    size_t written = 0;
+    for (size_t chunk = 0; chunk < _chunkCounts.size(); ++chunk) {
+        sf::Vertex* from = _vertices.data() + chunk * DrawGrain * perParticle;
+        if (from != _vertices.data() + written) {
+            std::copy(from, from + _chunkCounts[chunk], _vertices.data() + written);
+        }
+        written += _chunkCounts[chunk];
+    }
+
+    _drawn = written / perParticle;
+    if (written == 0) return;
+
+    target.draw(_vertices.data(), written,
+                _style == Style::Points ? sf::PrimitiveType::Points : sf::PrimitiveType::Triangles);
+}
+
+size_t ParticleRenderer::project(const Physics::ParticleWorld& world, size_t begin, size_t end, const Matrix4x4& viewProjection,
+                                 float width, float height, sf::Vertex* out) const {
+    const float* positionX = world.getPositionX();
+    const float* positionY = world.getPositionY();
+    const float* positionZ = world.getPositionZ();
+    const float* ages = world.getAges();
+    const float* lifetimes = world.getLifetimes();
+    const std::uint32_t* colors = world.getColors();
+    const Matrix4x4& m = viewProjection;
+
+    const Float4 zero(0.0f);
+    const Float4 halfWidth(width * 0.5f);
+    const Float4 halfHeight(height * 0.5f);
+    // Squares reaching onto the screen from just outside it still show.
+    const Float4 marginX(_style == Style::Points ? 1.0f : 1.0f + _size / width);
+    const Float4 marginY(_style == Style::Points ? 1.0f : 1.0f + _size / height);
+    float half = _size * 0.5f;
+
+    sf::Vertex* cursor = out;
+    float screenX[4];
+    float screenY[4];
+    for (size_t i = begin; i < end; i += Float4::Width) {
+        Float4 x = Float4::load(positionX + i);
+        Float4 y = Float4::load(positionY + i);
+        Float4 z = Float4::load(positionZ + i);
+        Float4 cx = Float4(m[0]) * x + Float4(m[1]) * y + Float4(m[2]) * z + Float4(m[3]);
+        Float4 cy = Float4(m[4]) * x + Float4(m[5]) * y + Float4(m[6]) * z + Float4(m[7]);
+        Float4 cw = Float4(m[12]) * x + Float4(m[13]) * y + Float4(m[14]) * z + Float4(m[15]);
+
+        Float4 visible = (cw > zero) & (Float4::abs(cx) <= cw * marginX) & (Float4::abs(cy) <= cw * marginY);
+        int mask = visible.movemask();
+        if (end - i < Float4::Width) {
+            mask &= (1 << (end - i)) - 1;
+        }
+        if (!mask) continue;
+
+        Float4 inverseW = Float4(1.0f) / cw;
+        ((cx * inverseW + Float4(1.0f)) * halfWidth).store(screenX);
+        ((Float4(1.0f) - cy * inverseW) * halfHeight).store(screenY);
+
+        for (; mask; mask &= mask - 1) {
+            int lane = 0;
+            while (!(mask & (1 << lane))) ++lane;
+            size_t particle = i + lane;
+
+            sf::Color color(colors[particle]);
+            if (_fadeOut) {
+                float remaining = 1.0f - ages[particle] / lifetimes[particle];
+                color.a = static_cast<std::uint8_t>(color.a * std::clamp(remaining, 0.0f, 1.0f));
+            }
+
+            sf::Vector2f center(screenX[lane], screenY[lane]);
+            if (_style == Style::Points) {
+                *cursor++ = sf::Vertex{center, color};
+                continue;
+            }
+
+            sf::Vector2f topLeft(center.x - half, center.y - half);
+            sf::Vector2f topRight(center.x + half, center.y - half);
+            sf::Vector2f bottomLeft(center.x - half, center.y + half);
+            sf::Vector2f bottomRight(center.x + half, center.y + half);
+            *cursor++ = sf::Vertex{topLeft, color};
+            *cursor++ = sf::Vertex{topRight, color};
+            *cursor++ = sf::Vertex{bottomRight, color};
+            *cursor++ = sf::Vertex{topLeft, color};
+            *cursor++ = sf::Vertex{bottomRight, color};
+            *cursor++ = sf::Vertex{bottomLeft, color};
+        }
+    }
+    return static_cast<size_t>(cursor - out);
+}
+
+} // namespace SFSim
\ No newline at end of file
@@ -9,6 +9,7 @@ namespace SFSim {
 Renderer::Renderer()
     : _window(nullptr)
     , _camera(nullptr)
+    , _lighting(nullptr)
     , _wireframeMode(false)
     , _backfaceCulling(true)
     , _depthTesting(true)
@@ -60,6 +61,7 @@ void Renderer::submit(Geometry* geometry, const Matrix4x4& transform, int priori
     command.transform = transform;
     command.priority = priority;
     command.depth = calculateDepth(geometry, transform);
+    command.materialId = geometry->getMaterialId();
     
     _renderQueue.push_back(command);
 }
@@ -68,23 +70,11 @@ void Renderer::submitImmediate(Geometry* geometry, const Matrix4x4& transform) {
     if (!geometry || !_window || !_camera) return;
     
     Matrix4x4 viewProjection = getViewProjectionMatrix();
+    geometry->setLightEnvironment(_lighting);
     geometry->draw(*_window, transform, viewProjection);
     
     _stats.drawCalls++;
-    
-    switch (geometry->getType()) {
-        case GeometryType::Triangle:
-            _stats.triangles++;
-            break;
-        case GeometryType::Line:
-            _stats.lines++;
-            break;
-        case GeometryType::Point:
-            _stats.points++;
-            break;
-        default:
-            break;
-    }
+    recordGeometry(geometry);
 }
 
 void Renderer::clear(const sf::Color& color) {
@@ -183,30 +173,82 @@ void Renderer::drawDebugGrid(const Vector3f& center, float spacing, int lines, c
 }
 
 void Renderer::sortRenderQueue() {
-    std::sort(_renderQueue.begin(), _renderQueue.end());
+    if (_depthTesting) {
+        std::sort(_renderQueue.begin(), _renderQueue.end());
+        return;
+    }
+    
+    std::sort(_renderQueue.begin(), _renderQueue.end(), [](const RenderCommand& a, const RenderCommand& b) {
+        if (a.priority != b.priority) {
+            return a.priority > b.priority;
+        }
+        if (a.materialId != b.materialId) {
+            return a.materialId < b.materialId;
+        }
+        return a.depth > b.depth;
+    });
 }
 
 void Renderer::executeRenderQueue() {
     Matrix4x4 viewProjection = getViewProjectionMatrix();
     
-    for (const auto& command : _renderQueue) {
-        command.geometry->draw(*_window, command.transform, viewProjection);
+    size_t begin = 0;
+    while (begin < _renderQueue.size()) {
+        size_t end = begin + 1;
+        unsigned int materialId = _renderQueue[begin].materialId;
+        if (materialId != 0) {
+            while (end < _renderQueue.size() && _renderQueue[end].materialId == materialId) {
+                ++end;
+            }
+        }
         
-        _stats.drawCalls++;
+        executeBatch(begin, end, viewProjection);
+        begin = end;
+    }
+}
+
+void Renderer::executeBatch(size_t begin, size_t end, const Matrix4x4& viewProjection) {
+    _stats.batches++;
+    _batchVertices.clear();
+    
+    for (size_t i = begin; i < end; ++i) {
+        const RenderCommand& command = _renderQueue[i];
+        command.geometry->setLightEnvironment(_lighting);
         
-        switch (command.geometry->getType()) {
-            case GeometryType::Triangle:
-                _stats.triangles++;
-                break;
-            case GeometryType::Line:
-                _stats.lines++;
-                break;
-            case GeometryType::Point:
-                _stats.points++;
-                break;
-            default:
-                break;
+        if (!command.geometry->appendTriangles(_batchVertices, *_window, command.transform, viewProjection)) {
+            // Keep submission order: whatever was batched so far goes first.
+            flushBatch();
+            command.geometry->draw(*_window, command.transform, viewProjection);
+            _stats.drawCalls++;
         }
+        
+        recordGeometry(command.geometry);
+    }
+    
+    flushBatch();
+}
+
+void Renderer::flushBatch() {
+    if (_batchVertices.empty()) return;
+    
+    _window->draw(_batchVertices.data(), _batchVertices.size(), sf::PrimitiveType::Triangles);
+    _stats.drawCalls++;
+    _batchVertices.clear();
+}
+
+void Renderer::recordGeometry(Geometry* geometry) {
+    switch (geometry->getType()) {
+        case GeometryType::Triangle:
+            _stats.triangles++;
+            break;
+        case GeometryType::Line:
+            _stats.lines++;
+            break;
+        case GeometryType::Point:
+            _stats.points++;
+            break;
+        default:
+            break;
     }
 }
 
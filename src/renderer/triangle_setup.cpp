@@ -0,0 +1,221 @@
+#include "renderer/triangle_setup.hpp"
+#include "geometry/mesh.hpp"
+#include "math/simd.hpp"
+#include <algorithm>
+
+namespace SFSim {
+
+TriangleSetup::TriangleSetup()
+    : _backfaceCulling(true)
+    , _screenWidth(0.0f)
+    , _screenHeight(0.0f)
+{
+    _stats.reset();
+}
+
+void TriangleSetup::transformVertices(const Vertex* vertices, size_t count, const Matrix4x4& mvp, float screenWidth, float screenHeight) {
+    _screenWidth = screenWidth;
+    _screenHeight = screenHeight;
+
+    _clipX.resize(count);
+    _clipY.resize(count);
+    _clipW.resize(count);
+    _screenX.resize(count);
+    _screenY.resize(count);
+    _nearDistance.resize(count);
+
+    const Float4 halfWidth(screenWidth * 0.5f);
+    const Float4 halfHeight(screenHeight * 0.5f);
+    const Float4 one(1.0f);
+    const Float4 minW(1e-6f);
+
+    for (size_t base = 0; base < count; base += Float4::Width) {
+        size_t lanes = std::min(count - base, static_cast<size_t>(Float4::Width));
+
+        float px[4], py[4], pz[4];
+        for (size_t lane = 0; lane < 4; ++lane) {
+            const Vector3f& p = vertices[base + std::min(lane, lanes - 1)].position;
+            px[lane] = p.x;
+            py[lane] = p.y;
+            pz[lane] = p.z;
+        }
+
+        Float4 x = Float4::load(px);
+        Float4 y = Float4::load(py);
+        Float4 z = Float4::load(pz);
+
+        Float4 cx = Float4(mvp[0]) * x + Float4(mvp[1]) * y + Float4(mvp[2]) * z + Float4(mvp[3]);
+        Float4 cy = Float4(mvp[4]) * x + Float4(mvp[5]) * y + Float4(mvp[6]) * z + Float4(mvp[7]);
+        Float4 cz = Float4(mvp[8]) * x + Float4(mvp[9]) * y + Float4(mvp[10]) * z + Float4(mvp[11]);
+        Float4 cw = Float4(mvp[12]) * x + Float4(mvp[13]) * y + Float4(mvp[14]) * z + Float4(mvp[15]);
+
+        Float4 nearDist = cz + cw;
+        Float4 safeW = Float4::select(cw > minW, cw, one);
+        Float4 sx = (cx / safeW + one) * halfWidth;
+        Float4 sy = (one - cy / safeW) * halfHeight;
+
+        float out[6][4];
+        cx.store(out[0]);
+        cy.store(out[1]);
+        cw.store(out[2]);
+        sx.store(out[3]);
+        sy.store(out[4]);
+        nearDist.store(out[5]);
+
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            size_t i = base + lane;
+            _clipX[i] = out[0][lane];
+            _clipY[i] = out[1][lane];
+            _clipW[i] = out[2][lane];
+            _screenX[i] = out[3][lane];
+            _screenY[i] = out[4][lane];
+            _nearDistance[i] = out[5][lane];
+        }
+    }
+}
+
+void TriangleSetup::assemble(const unsigned int* indices, size_t indexCount) {
+    _stats.reset();
+    _output.clear();
+    _sourceTriangles.clear();
+
+    size_t vertexCount = _nearDistance.size();
+    size_t triangleCount = indexCount / 3;
+    _stats.triangles = triangleCount;
+
+    const Float4 zero(0.0f);
+
+    for (size_t base = 0; base < triangleCount; base += Float4::Width) {
+        size_t lanes = std::min(triangleCount - base, static_cast<size_t>(Float4::Width));
+
+        float ax[4], ay[4], bx[4], by[4], cx[4], cy[4], da[4], db[4], dc[4];
+        int validMask = 0;
+
+        for (size_t lane = 0; lane < 4; ++lane) {
+            const unsigned int* tri = indices + (base + std::min(lane, lanes - 1)) * 3;
+            bool valid = lane < lanes && tri[0] < vertexCount && tri[1] < vertexCount && tri[2] < vertexCount;
+            unsigned int i0 = valid ? tri[0] : 0;
+            unsigned int i1 = valid ? tri[1] : 0;
+            unsigned int i2 = valid ? tri[2] : 0;
+
+            if (valid) validMask |= 1 << lane;
+
+            if (vertexCount == 0) {
+                ax[lane] = ay[lane] = bx[lane] = by[lane] = cx[lane] = cy[lane] = 0.0f;
+                da[lane] = db[lane] = dc[lane] = -1.0f;
+                continue;
+            }
+
+            ax[lane] = _screenX[i0]; ay[lane] = _screenY[i0];
+            bx[lane] = _screenX[i1]; by[lane] = _screenY[i1];
+            cx[lane] = _screenX[i2]; cy[lane] = _screenY[i2];
+            da[lane] = _nearDistance[i0];
+            db[lane] = _nearDistance[i1];
+            dc[lane] = _nearDistance[i2];
+        }
+
+        Float4 pax = Float4::load(ax), pay = Float4::load(ay);
+        Float4 pbx = Float4::load(bx), pby = Float4::load(by);
+        Float4 pcx = Float4::load(cx), pcy = Float4::load(cy);
+
+        // Screen space has y pointing down, so counter-clockwise (front-facing)
+        // triangles in NDC come out with a negative signed area here.
+        Float4 area = (pbx - pax) * (pcy - pay) - (pcx - pax) * (pby - pay);
+
+        Float4 insideA = Float4::load(da) >= zero;
+        Float4 insideB = Float4::load(db) >= zero;
+        Float4 insideC = Float4::load(dc) >= zero;
+
+        int allInside = (insideA & insideB & insideC).movemask() & validMask;
+        int anyInside = (insideA | insideB | insideC).movemask() & validMask;
+        int frontFacing = (area < zero).movemask();
+        int keep = _backfaceCulling ? (allInside & frontFacing) : allInside;
+
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            int bit = 1 << lane;
+            if (!(validMask & bit)) continue;
+
+            unsigned int source = static_cast<unsigned int>(base + lane);
+            const unsigned int* tri = indices + source * 3;
+
+            if (keep & bit) {
+                emitTriangle(tri[0], tri[1], tri[2], source);
+            } else if (allInside & bit) {
+                _stats.backfaceCulled++;
+            } else if (!(anyInside & bit)) {
+                _stats.nearCulled++;
+            } else {
+                clipTriangle(tri[0], tri[1], tri[2], source);
+            }
+        }
+    }
+
+    _stats.emitted = _sourceTriangles.size();
+}
+
+void TriangleSetup::emitTriangle(unsigned int i0, unsigned int i1, unsigned int i2, unsigned int source) {
+    _output.push_back({Vector2f(_screenX[i0], _screenY[i0]), i0, i0, 0.0f});
+    _output.push_back({Vector2f(_screenX[i1], _screenY[i1]), i1, i1, 0.0f});
+    _output.push_back({Vector2f(_screenX[i2], _screenY[i2]), i2, i2, 0.0f});
+    _sourceTriangles.push_back(source);
+}
+
+void TriangleSetup::clipTriangle(unsigned int i0, unsigned int i1, unsigned int i2, unsigned int source) {
+    const unsigned int corners[3] = {i0, i1, i2};
+
+    SetupVertex polygon[4];
+    int count = 0;
+
+    for (int e = 0; e < 3; ++e) {
+        unsigned int cur = corners[e];
+        unsigned int next = corners[(e + 1) % 3];
+        float dCur = _nearDistance[cur];
+        float dNext = _nearDistance[next];
+
+        if (dCur >= 0.0f) {
+            polygon[count++] = {Vector2f(_screenX[cur], _screenY[cur]), cur, cur, 0.0f};
+        }
+
+        if ((dCur >= 0.0f) != (dNext >= 0.0f)) {
+            float t = dCur / (dCur - dNext);
+            float x = _clipX[cur] + (_clipX[next] - _clipX[cur]) * t;
+            float y = _clipY[cur] + (_clipY[next] - _clipY[cur]) * t;
+            float w = _clipW[cur] + (_clipW[next] - _clipW[cur]) * t;
+            polygon[count++] = {toScreen(x, y, w), cur, next, t};
+        }
+    }
+
+    if (count < 3) {
+        _stats.nearCulled++;
+        return;
+    }
+
+    float area = 0.0f;
+    for (int i = 0; i < count; ++i) {
+        const Vector2f& p = polygon[i].screen;
+        const Vector2f& q = polygon[(i + 1) % count].screen;
+        area += p.x * q.y - q.x * p.y;
+    }
+
+    if (_backfaceCulling && area >= 0.0f) {
+        _stats.backfaceCulled++;
+        return;
+    }
+
+    _stats.clipped++;
+    for (int i = 1; i + 1 < count; ++i) {
+        _output.push_back(polygon[0]);
+        _output.push_back(polygon[i]);
+        _output.push_back(polygon[i + 1]);
+        _sourceTriangles.push_back(source);
+    }
+}
+
+Vector2f TriangleSetup::toScreen(float x, float y, float w) const {
+    if (w <= 0.0f) return Vector2f(0, 0);
+    float invW = 1.0f / w;
+    return Vector2f((x * invW + 1.0f) * 0.5f * _screenWidth,
+                    (1.0f - y * invW) * 0.5f * _screenHeight);
+}
+
+} // namespace SFSim
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "scene/scene.hpp"
 #include "ecs/transform_component.hpp"
 #include "ecs/render_component.hpp"
+#include "ecs/light_component.hpp"
 #include <algorithm>
 
 namespace SFSim {
@@ -134,6 +135,8 @@ void Scene::update(float deltaTime) {
     for (const auto& system : _systems) {
         system->update(deltaTime, _entities);
     }
+    
+    _transformHierarchy.update();
 }
 
 void Scene::render(sf::RenderWindow& window) {
@@ -141,6 +144,10 @@ void Scene::render(sf::RenderWindow& window) {
     
     Matrix4x4 viewProjection = _activeCamera->getViewProjectionMatrix();
     
+    // Picks up anything moved since update(); free when nothing changed.
+    _transformHierarchy.update();
+    updateLighting();
+    
     auto renderableEntities = getEntitiesWith<TransformComponent, RenderComponent>();
     
     for (Entity* entity : renderableEntities) {
@@ -148,11 +155,26 @@ void Scene::render(sf::RenderWindow& window) {
         auto* render = entity->getComponent<RenderComponent>();
         
         if (render->isVisible() && render->getGeometry()) {
+            render->getGeometry()->setLightEnvironment(&_lighting);
             render->getGeometry()->draw(window, transform->getWorldMatrix(), viewProjection);
         }
     }
 }
 
+void Scene::updateLighting() {
+    _lighting.setView(_activeCamera->getViewMatrix(), _activeCamera->getProjectionMatrix(), _activeCamera->getPosition());
+    _lighting.clearLights();
+    
+    for (Entity* entity : getEntitiesWith<LightComponent>()) {
+        auto* light = entity->getComponent<LightComponent>();
+        if (light->isEnabled()) {
+            _lighting.addLight(light->getWorldLight());
+        }
+    }
+    
+    _lighting.build();
+}
+
 void Scene::clear() {
     for (const auto& system : _systems) {
         for (const auto& entity : _entities) {
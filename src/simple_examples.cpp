@@ -8,6 +8,8 @@
 #include "camera.hpp"
 #include "math/matrix.hpp"
 #include "math/vector.hpp"
+#include "physics/particle_world.hpp"
+#include "renderer/particle_renderer.hpp"
 
 namespace SimpleExamples {
 
@@ -84,6 +86,14 @@ public:
     virtual void update(float deltaTime) = 0;
     virtual void setup() = 0;
 
+    // Draws the points; simulations that keep their own geometry override
+    // this to draw it their own way.
+    virtual void draw() {
+        for (const auto& point : points) {
+            point.draw(window, camera);
+        }
+    }
+
     void run() {
         setup();
         sf::Clock clock;
@@ -143,9 +153,7 @@ public:
             update(deltaTime);
 
             window.clear(sf::Color::Black);
-            for (const auto& point : points) {
-                point.draw(window, camera);
-            }
+            draw();
             window.display();
         }
     }
@@ -195,16 +203,8 @@ public:
 
 class ParticleSystem : public Simulation {
 private:
-    struct Particle {
-        Vector3f position;
-        Vector3f velocity;
-        sf::Color color;
-
-        Particle(Vector3f pos, Vector3f vel, sf::Color col)
-            : position(pos), velocity(vel), color(col) {}
-    };
-
-    std::vector<Particle> particles;
+    Physics::ParticleWorld particles;
+    ParticleRenderer renderer;
 
 public:
     ParticleSystem() : Simulation("Particle System Simulation") {
@@ -212,58 +212,44 @@ public:
     }
 
     void setup() override {
-        particles.clear();
-
-        // Create initial particles
-        for (int i = 0; i < 150; ++i) {
-            float theta = static_cast<float>(rand()) / RAND_MAX * 2.0f * M_PI;
-            float phi = static_cast<float>(rand()) / RAND_MAX * M_PI;
-            float speed = 2.0f + static_cast<float>(rand()) / RAND_MAX * 3.0f;
-
-            Vector3f pos((static_cast<float>(rand()) / RAND_MAX - 0.5f) * 2.0f,
-                         (static_cast<float>(rand()) / RAND_MAX - 0.5f) * 2.0f,
-                         (static_cast<float>(rand()) / RAND_MAX - 0.5f) * 2.0f);
-
-            Vector3f vel(speed * sin(phi) * cos(theta),
-                         speed * sin(phi) * sin(theta) - 1.0f,  // Gravity effect
-                         speed * cos(phi));
-
-            sf::Color color(100 + rand() % 156, 100 + rand() % 156, 100 + rand() % 156);
+        const float boundary = 5.0f;
 
-            particles.emplace_back(pos, vel, color);
+        particles.clear();
+        particles.clearEmitters();
+        particles.clearForceFields();
+        particles.setContainer(Physics::AABB(Vector3f(-boundary, -boundary, -boundary),
+                                             Vector3f(boundary, boundary, boundary)), 0.8f);
+        particles.addForceField(Physics::ForceField::gravity(Vector3f(0, -9.8f, 0)));
+        particles.addForceField(Physics::ForceField::vortex(Vector3f::zero(), Vector3f::up(), 12.0f, 1.5f));
+        particles.addForceField(Physics::ForceField::drag(0.1f));
+
+        // A fountain from the floor, in a few colors.
+        const sf::Color colors[] = {sf::Color(255, 180, 80), sf::Color(120, 200, 255), sf::Color(200, 140, 255)};
+        for (int i = 0; i < 3; ++i) {
+            Physics::ParticleEmitter emitter;
+            emitter.position = Vector3f(-2.0f + 2.0f * i, -boundary, 0);
+            emitter.direction = Vector3f::up();
+            emitter.spread = 0.3f;
+            emitter.jitter = 0.2f;
+            emitter.minSpeed = 8.0f;
+            emitter.maxSpeed = 12.0f;
+            emitter.rate = 20000.0f;
+            emitter.minLifetime = 3.0f;
+            emitter.maxLifetime = 5.0f;
+            emitter.color = colors[i].toInteger();
+            particles.addEmitter(emitter);
         }
+
+        renderer.setStyle(ParticleRenderer::Style::Points);
+        renderer.setFadeOut(true);
     }
 
     void update(float deltaTime) override {
-        clearPoints();
-
-        const float bounce = 0.8f;
-        const float gravity = 9.8f;
-        const float boundary = 5.0f;
-
-        for (auto& particle : particles) {
-            // Apply gravity
-            particle.velocity.y -= gravity * deltaTime;
-
-            // Update position
-            particle.position += particle.velocity * deltaTime;
-
-            // Boundary collisions
-            if (particle.position.x > boundary || particle.position.x < -boundary) {
-                particle.velocity.x *= -bounce;
-                particle.position.x = std::clamp(particle.position.x, -boundary, boundary);
-            }
-            if (particle.position.y > boundary || particle.position.y < -boundary) {
-                particle.velocity.y *= -bounce;
-                particle.position.y = std::clamp(particle.position.y, -boundary, boundary);
-            }
-            if (particle.position.z > boundary || particle.position.z < -boundary) {
-                particle.velocity.z *= -bounce;
-                particle.position.z = std::clamp(particle.position.z, -boundary, boundary);
-            }
+        particles.update(deltaTime);
+    }
 
-            addPoint(particle.position, particle.color, 2.5f);
-        }
+    void draw() override {
+        renderer.draw(window, particles, camera.getViewProjectionMatrix());
     }
 };
 
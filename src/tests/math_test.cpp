@@ -3,6 +3,7 @@
 #include <cmath>
 #include "math/vector.hpp"
 #include "math/matrix.hpp"
+#include "math/quaternion.hpp"
 
 using namespace SFSim::Math;
 
@@ -49,7 +50,7 @@ void testVector3f() {
 void testMatrix4x4() {
     std::cout << "Testing Matrix4x4..." << std::endl;
     
-    Matrix4x4 identity = Matrix4x4::identity();
+    Matrix4x4 identity;
     Vector3f point(1, 2, 3);
     Vector3f transformed = identity.transformPoint(point);
     assert(vector3fEqual(transformed, point));
@@ -74,12 +75,50 @@ void testMatrix4x4() {
     std::cout << "Matrix4x4 tests passed!" << std::endl;
 }
 
+bool matrixEqual(const Matrix4x4& a, const Matrix4x4& b, float epsilon) {
+    for (int i = 0; i < 16; ++i) {
+        if (std::abs(a.m[i] - b.m[i]) > epsilon) return false;
+    }
+    return true;
+}
+
+void testQuaternion() {
+    std::cout << "Testing Quaternion..." << std::endl;
+    
+    Vector3f euler(0.3f, -1.1f, 2.0f);
+    Quaternion q = Quaternion::fromEuler(euler);
+    Matrix4x4 expected = Matrix4x4::rotationX(euler.x) * Matrix4x4::rotationY(euler.y) * Matrix4x4::rotationZ(euler.z);
+    assert(matrixEqual(Matrix4x4::rotation(q), expected, 1e-5f));
+    
+    Vector3f v(1, 2, 3);
+    Vector3f rotated = q.rotate(v);
+    Vector3f viaMatrix = expected.transformDirection(v);
+    assert(std::abs(rotated.x - viaMatrix.x) < 1e-5f && std::abs(rotated.y - viaMatrix.y) < 1e-5f && std::abs(rotated.z - viaMatrix.z) < 1e-5f);
+    
+    Vector3f back = q.toEuler();
+    assert(std::abs(back.x - euler.x) < 1e-5f && std::abs(back.y - euler.y) < 1e-5f && std::abs(back.z - euler.z) < 1e-5f);
+    
+    Vector3f t(5, -2, 1), s(2, 3, 0.5f);
+    Matrix4x4 trs = Matrix4x4::compose(t, q, s);
+    assert(matrixEqual(trs, Matrix4x4::translation(t) * expected * Matrix4x4::scale(s), 1e-5f));
+    assert(matrixEqual(trs.invertedAffine(), trs.inverted(), 1e-5f));
+    assert(matrixEqual(trs.multipliedAffine(trs), trs * trs, 1e-4f));
+    
+    Quaternion half = Quaternion::slerp(Quaternion(), Quaternion::fromAxisAngle(Vector3f::up(), 1.0f), 0.5f);
+    assert(matrixEqual(Matrix4x4::rotation(half), Matrix4x4::rotationY(0.5f), 1e-5f));
+    
+    std::cout << "Quaternion tests passed!" << std::endl;
+}
+
 void testProjection() {
     std::cout << "Testing projection matrices..." << std::endl;
     
     Matrix4x4 persp = Matrix4x4::perspective(M_PI / 4, 16.0f / 9.0f, 0.1f, 100.0f);
+    assert(floatEqual(persp.transformPoint(Vector3f(0, 0, -0.1f)).z, -1.0f));
     
     Matrix4x4 ortho = Matrix4x4::orthographic(-10, 10, -10, 10, 0.1f, 100.0f);
+    Vector3f corner = ortho.transformPoint(Vector3f(10, -10, -50));
+    assert(floatEqual(corner.x, 1.0f) && floatEqual(corner.y, -1.0f));
     
     Vector3f eye(0, 0, 5);
     Vector3f target(0, 0, 0);
@@ -88,6 +127,7 @@ void testProjection() {
     
     Vector3f worldPoint(1, 1, 0);
     Vector3f viewPoint = view.transformPoint(worldPoint);
+    assert(vector3fEqual(viewPoint, Vector3f(1, 1, -5)));
     
     std::cout << "Projection matrix tests passed!" << std::endl;
 }
@@ -97,6 +137,7 @@ int main() {
     
     testVector3f();
     testMatrix4x4();
+    testQuaternion();
     testProjection();
     
     std::cout << "All math tests passed!" << std::endl;
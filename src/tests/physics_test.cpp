@@ -0,0 +1,145 @@
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+#include "ecs/entity.hpp"
+#include "ecs/transform_component.hpp"
+#include "physics/physics.hpp"
+#include "physics/convex_hull.hpp"
+
+using namespace SFSim;
+using namespace SFSim::ECS;
+using namespace SFSim::Physics;
+
+constexpr float TimeStep = 1.0f / 60.0f;
+
+// A floor with one column of boxes resting on it, stepped until the
+// column falls asleep as a single island.
+std::vector<std::unique_ptr<Entity>> buildSleepingStack(PhysicsSystem& physics, int height) {
+    std::vector<std::unique_ptr<Entity>> entities;
+    
+    auto floor = std::make_unique<Entity>(1);
+    floor->addComponent<TransformComponent>()->setPosition(Vector3f(0, -0.5f, 0));
+    floor->addComponent<ColliderComponent>(ColliderComponent::Box)->setSize(Vector3f(10.0f, 1.0f, 10.0f));
+    entities.push_back(std::move(floor));
+    
+    for (int y = 0; y < height; ++y) {
+        auto box = std::make_unique<Entity>(entities.size() + 1);
+        box->addComponent<TransformComponent>()->setPosition(Vector3f(0, 0.5f + y * 1.01f, 0));
+        box->addComponent<ColliderComponent>(ColliderComponent::Box);
+        box->addComponent<RigidbodyComponent>();
+        entities.push_back(std::move(box));
+    }
+    
+    for (int step = 0; step < 600 && physics.getSleepingIslandCount() == 0; ++step) {
+        physics.update(TimeStep, entities);
+    }
+    assert(physics.getSleepingIslandCount() == 1);
+    physics.update(TimeStep, entities);
+    assert(physics.getAwakeBodyCount() == 0);
+    return entities;
+}
+
+void testRemovedBodyWakesItsIsland() {
+    std::cout << "Testing rigidbody removal from a sleeping island..." << std::endl;
+    
+    PhysicsSystem physics;
+    auto entities = buildSleepingStack(physics, 3);
+    
+    // The middle box stops being a body, so the one above it has to fall
+    // onto it again.
+    entities[2]->removeComponent<RigidbodyComponent>();
+    physics.update(TimeStep, entities);
+    assert(physics.getSleepingIslandCount() == 0);
+    assert(!entities[1]->getComponent<RigidbodyComponent>()->isSleeping());
+    assert(!entities[3]->getComponent<RigidbodyComponent>()->isSleeping());
+    
+    entities[3]->getComponent<RigidbodyComponent>()->addImpulse(Vector3f(0.1f, 0, 0));
+    for (int step = 0; step < 10; ++step) {
+        physics.update(TimeStep, entities);
+    }
+    
+    std::cout << "Rigidbody removal tests passed!" << std::endl;
+}
+
+void testReplacedBodyWakesItsIsland() {
+    std::cout << "Testing rigidbody replacement in a sleeping island..." << std::endl;
+    
+    PhysicsSystem physics;
+    auto entities = buildSleepingStack(physics, 3);
+    
+    // Adding a component replaces the old one through removeComponent.
+    entities[1]->addComponent<RigidbodyComponent>();
+    physics.update(TimeStep, entities);
+    assert(physics.getSleepingIslandCount() == 0);
+    assert(!entities[3]->getComponent<RigidbodyComponent>()->isSleeping());
+    
+    for (int step = 0; step < 600 && physics.getSleepingIslandCount() == 0; ++step) {
+        physics.update(TimeStep, entities);
+    }
+    assert(physics.getSleepingIslandCount() == 1);
+    
+    std::cout << "Rigidbody replacement tests passed!" << std::endl;
+}
+
+// Every side of a cube hull is two coplanar triangles, so the hit triangle
+// has to be chosen by the hit point, not just the plane the ray crossed.
+void checkHullHit(const ConvexHull& hull, const Ray& ray, const ConvexHull::Hit& hit) {
+    const auto& vertices = hull.getVertices();
+    const auto& indices = hull.getIndices();
+    const Vector3f& a = vertices[indices[hit.triangle * 3]];
+    const Vector3f& b = vertices[indices[hit.triangle * 3 + 1]];
+    const Vector3f& c = vertices[indices[hit.triangle * 3 + 2]];
+    const float eps = 1e-4f;
+    assert(hit.barycentric.x >= -eps && hit.barycentric.x <= 1.0f + eps);
+    assert(hit.barycentric.y >= -eps && hit.barycentric.y <= 1.0f + eps);
+    assert(hit.barycentric.z >= -eps && hit.barycentric.z <= 1.0f + eps);
+    Vector3f point = a * hit.barycentric.x + b * hit.barycentric.y + c * hit.barycentric.z;
+    assert((point - ray.getPoint(hit.distance)).length() < eps);
+}
+
+void testHullRaycastPicksContainingTriangle() {
+    std::cout << "Testing convex hull raycasts against coplanar faces..." << std::endl;
+    
+    ConvexHull hull;
+    std::vector<Vector3f> corners;
+    for (int i = 0; i < 8; ++i) {
+        corners.emplace_back((i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f, (i & 4) ? 0.5f : -0.5f);
+    }
+    hull.build(corners);
+    assert(hull.getFaceCount() == 12);
+    
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> across(-0.49f, 0.49f);
+    for (int i = 0; i < 1000; ++i) {
+        float x = across(rng);
+        float z = across(rng);
+        ConvexHull::Hit hit;
+        
+        Ray down(Vector3f(x, 2.0f, z), Vector3f(0, -1, 0));
+        assert(hull.raycast(down, 10.0f, hit));
+        assert(std::abs(hit.distance - 1.5f) < 1e-4f);
+        checkHullHit(hull, down, hit);
+        
+        // Starting inside, the ray hits the face it leaves through.
+        Ray up(Vector3f(x, 0.0f, z), Vector3f(0, 1, 0));
+        assert(hull.raycast(up, 10.0f, hit));
+        assert(std::abs(hit.distance - 0.5f) < 1e-4f);
+        checkHullHit(hull, up, hit);
+    }
+    
+    std::cout << "Convex hull raycast tests passed!" << std::endl;
+}
+
+int main() {
+    std::cout << "Running physics tests..." << std::endl;
+    
+    testRemovedBodyWakesItsIsland();
+    testReplacedBodyWakesItsIsland();
+    testHullRaycastPicksContainingTriangle();
+    
+    std::cout << "All physics tests passed!" << std::endl;
+    return 0;
+}
\ No newline at end of file
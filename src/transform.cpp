@@ -7,9 +7,12 @@ namespace SFSim {
 Transform::Transform()
     : _position(Vector3f::zero())
     , _rotation(Vector3f::zero())
+    , _orientation()
     , _scale(Vector3f::one())
     , _localMatrixDirty(true)
     , _worldMatrixDirty(true)
+    , _inverseWorldMatrixDirty(true)
+    , _version(0)
     , _parent(nullptr)
 {
 }
@@ -17,9 +20,12 @@ Transform::Transform()
 Transform::Transform(const Vector3f& position, const Vector3f& rotation, const Vector3f& scale)
     : _position(position)
     , _rotation(rotation)
+    , _orientation(Quaternion::fromEuler(rotation))
     , _scale(scale)
     , _localMatrixDirty(true)
     , _worldMatrixDirty(true)
+    , _inverseWorldMatrixDirty(true)
+    , _version(0)
     , _parent(nullptr)
 {
 }
@@ -31,6 +37,13 @@ void Transform::setPosition(const Vector3f& position) {
 
 void Transform::setRotation(const Vector3f& rotation) {
     _rotation = rotation;
+    _orientation = Quaternion::fromEuler(rotation);
+    markDirty();
+}
+
+void Transform::setOrientation(const Quaternion& orientation) {
+    _orientation = orientation.normalized();
+    _rotation = _orientation.toEuler();
     markDirty();
 }
 
@@ -51,9 +64,14 @@ void Transform::translate(const Vector3f& translation) {
 
 void Transform::rotate(const Vector3f& rotation) {
     _rotation += rotation;
+    _orientation = Quaternion::fromEuler(_rotation);
     markDirty();
 }
 
+void Transform::rotate(const Quaternion& rotation) {
+    setOrientation(rotation * _orientation);
+}
+
 void Transform::scaleBy(const Vector3f& scale) {
     _scale.x *= scale.x;
     _scale.y *= scale.y;
@@ -67,24 +85,15 @@ void Transform::scaleBy(float scale) {
 }
 
 Vector3f Transform::getForward() const {
-    Matrix4x4 rotMatrix = Matrix4x4::rotationX(_rotation.x) * 
-                          Matrix4x4::rotationY(_rotation.y) * 
-                          Matrix4x4::rotationZ(_rotation.z);
-    return rotMatrix.transformDirection(Vector3f::forward());
+    return _orientation.rotate(Vector3f::forward());
 }
 
 Vector3f Transform::getRight() const {
-    Matrix4x4 rotMatrix = Matrix4x4::rotationX(_rotation.x) * 
-                          Matrix4x4::rotationY(_rotation.y) * 
-                          Matrix4x4::rotationZ(_rotation.z);
-    return rotMatrix.transformDirection(Vector3f::right());
+    return _orientation.rotate(Vector3f::right());
 }
 
 Vector3f Transform::getUp() const {
-    Matrix4x4 rotMatrix = Matrix4x4::rotationX(_rotation.x) * 
-                          Matrix4x4::rotationY(_rotation.y) * 
-                          Matrix4x4::rotationZ(_rotation.z);
-    return rotMatrix.transformDirection(Vector3f::up());
+    return _orientation.rotate(Vector3f::up());
 }
 
 const Matrix4x4& Transform::getLocalMatrix() const {
@@ -101,6 +110,14 @@ const Matrix4x4& Transform::getWorldMatrix() const {
     return _worldMatrix;
 }
 
+const Matrix4x4& Transform::getInverseWorldMatrix() const {
+    if (_inverseWorldMatrixDirty) {
+        _inverseWorldMatrix = getWorldMatrix().invertedAffine();
+        _inverseWorldMatrixDirty = false;
+    }
+    return _inverseWorldMatrix;
+}
+
 void Transform::setParent(Transform* parent) {
     if (_parent) {
         _parent->removeChild(this);
@@ -137,18 +154,25 @@ void Transform::removeChild(Transform* child) {
 
 Vector3f Transform::getWorldPosition() const {
     if (_parent) {
-        return _parent->getWorldMatrix().transformPoint(_position);
+        return _parent->getWorldMatrix().transformPointAffine(_position);
     }
     return _position;
 }
 
 Vector3f Transform::getWorldRotation() const {
     if (_parent) {
-        return _parent->getWorldRotation() + _rotation;
+        return getWorldOrientation().toEuler();
     }
     return _rotation;
 }
 
+Quaternion Transform::getWorldOrientation() const {
+    if (_parent) {
+        return _parent->getWorldOrientation() * _orientation;
+    }
+    return _orientation;
+}
+
 Vector3f Transform::getWorldScale() const {
     if (_parent) {
         Vector3f parentScale = _parent->getWorldScale();
@@ -158,7 +182,7 @@ Vector3f Transform::getWorldScale() const {
 }
 
 Vector3f Transform::transformPoint(const Vector3f& point) const {
-    return getWorldMatrix().transformPoint(point);
+    return getWorldMatrix().transformPointAffine(point);
 }
 
 Vector3f Transform::transformDirection(const Vector3f& direction) const {
@@ -166,27 +190,39 @@ Vector3f Transform::transformDirection(const Vector3f& direction) const {
 }
 
 Vector3f Transform::inverseTransformPoint(const Vector3f& point) const {
-    return getWorldMatrix().inverted().transformPoint(point);
+    return getInverseWorldMatrix().transformPointAffine(point);
 }
 
 Vector3f Transform::inverseTransformDirection(const Vector3f& direction) const {
-    return getWorldMatrix().inverted().transformDirection(direction);
+    return getInverseWorldMatrix().transformDirection(direction);
+}
+
+void Transform::transformPoints(const Vector3f* points, Vector3f* out, size_t count) const {
+    getWorldMatrix().transformPointsAffine(points, out, count);
+}
+
+void Transform::transformDirections(const Vector3f* directions, Vector3f* out, size_t count) const {
+    getWorldMatrix().transformDirections(directions, out, count);
+}
+
+void Transform::inverseTransformPoints(const Vector3f* points, Vector3f* out, size_t count) const {
+    getInverseWorldMatrix().transformPointsAffine(points, out, count);
+}
+
+void Transform::inverseTransformDirections(const Vector3f* directions, Vector3f* out, size_t count) const {
+    getInverseWorldMatrix().transformDirections(directions, out, count);
 }
 
 void Transform::markDirty() {
     _localMatrixDirty = true;
     _worldMatrixDirty = true;
+    _inverseWorldMatrixDirty = true;
+    ++_version;
     markChildrenWorldMatrixDirty();
 }
 
 void Transform::updateLocalMatrix() const {
-    Matrix4x4 translationMatrix = Matrix4x4::translation(_position);
-    Matrix4x4 rotationMatrix = Matrix4x4::rotationX(_rotation.x) * 
-                              Matrix4x4::rotationY(_rotation.y) * 
-                              Matrix4x4::rotationZ(_rotation.z);
-    Matrix4x4 scaleMatrix = Matrix4x4::scale(_scale);
-    
-    _localMatrix = translationMatrix * rotationMatrix * scaleMatrix;
+    _localMatrix = Matrix4x4::compose(_position, _orientation, _scale);
     _localMatrixDirty = false;
 }
 
@@ -196,7 +232,7 @@ void Transform::updateWorldMatrix() const {
     }
     
     if (_parent) {
-        _worldMatrix = _parent->getWorldMatrix() * _localMatrix;
+        _worldMatrix = _parent->getWorldMatrix().multipliedAffine(_localMatrix);
     } else {
         _worldMatrix = _localMatrix;
     }
@@ -207,6 +243,8 @@ void Transform::updateWorldMatrix() const {
 void Transform::markChildrenWorldMatrixDirty() {
     for (Transform* child : _children) {
         child->_worldMatrixDirty = true;
+        child->_inverseWorldMatrixDirty = true;
+        ++child->_version;
         child->markChildrenWorldMatrixDirty();
     }
 }
@@ -0,0 +1,393 @@
+#include "transform_hierarchy.hpp"
+#include "core/thread_pool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace SFSim {
+
+namespace {
+
+int countTrailingZeros(std::uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+bool testBit(const std::vector<std::uint64_t>& bits, size_t index) {
+    return (bits[index >> 6] >> (index & 63)) & 1u;
+}
+
+void setBits(std::vector<std::uint64_t>& bits, size_t begin, size_t end) {
+    while (begin < end) {
+        size_t word = begin >> 6;
+        size_t wordEnd = std::min(end, (word + 1) << 6);
+        size_t width = wordEnd - begin;
+        std::uint64_t mask = width == 64 ? ~std::uint64_t(0) : ((std::uint64_t(1) << width) - 1);
+        bits[word] |= mask << (begin & 63);
+        begin = wordEnd;
+    }
+}
+
+// Visits set bits in [begin, end) in increasing order. The current word is
+// re-read after each visit, so bits set ahead of the cursor by fn are seen.
+template<typename Fn>
+void forEachSetBit(const std::vector<std::uint64_t>& bits, size_t begin, size_t end, Fn fn) {
+    size_t i = begin;
+    while (i < end) {
+        size_t word = i >> 6;
+        std::uint64_t pending = bits[word] & (~std::uint64_t(0) << (i & 63));
+        if (!pending) {
+            i = (word + 1) << 6;
+            continue;
+        }
+        size_t index = (word << 6) + countTrailingZeros(pending);
+        if (index >= end) break;
+        fn(index);
+        i = index + 1;
+    }
+}
+
+constexpr std::uint32_t NoParent = TransformHierarchy::InvalidNode;
+constexpr size_t ParallelGrain = 1024;
+
+} // namespace
+
+TransformHierarchy::TransformHierarchy()
+    : _parallelThreshold(8192)
+    , _structureDirty(false)
+    , _anyDirty(false)
+    , _anyUpdated(false)
+{
+}
+
+TransformHierarchy::NodeId TransformHierarchy::create(NodeId parent) {
+    NodeId node;
+    if (!_freeNodes.empty()) {
+        node = _freeNodes.back();
+        _freeNodes.pop_back();
+    } else {
+        node = static_cast<NodeId>(_indexOfNode.size());
+        _indexOfNode.push_back(InvalidNode);
+    }
+    
+    std::uint32_t index = static_cast<std::uint32_t>(_nodeOfIndex.size());
+    _indexOfNode[node] = index;
+    
+    _nodeOfIndex.push_back(node);
+    _parentNode.push_back(isValid(parent) ? parent : InvalidNode);
+    _parentIndex.push_back(NoParent);
+    _firstChild.push_back(0);
+    _childCount.push_back(0);
+    _position.push_back(Vector3f::zero());
+    _orientation.push_back(Quaternion());
+    _scale.push_back(Vector3f::one());
+    _localMatrix.emplace_back();
+    _worldMatrix.emplace_back();
+    _localDirty.resize((_nodeOfIndex.size() + 63) / 64, 0);
+    _worldUpdated.resize(_localDirty.size(), 0);
+    
+    markDirty(index);
+    _structureDirty = true;
+    return node;
+}
+
+void TransformHierarchy::destroy(NodeId node) {
+    if (!isValid(node)) return;
+    
+    std::uint32_t index = _indexOfNode[node];
+    NodeId parent = _parentNode[index];
+    for (NodeId& p : _parentNode) {
+        if (p == node) p = parent;
+    }
+    
+    // Swap-remove; the order is restored by the next rebuild.
+    std::uint32_t last = static_cast<std::uint32_t>(_nodeOfIndex.size() - 1);
+    if (index != last) {
+        _nodeOfIndex[index] = _nodeOfIndex[last];
+        _parentNode[index] = _parentNode[last];
+        _position[index] = _position[last];
+        _orientation[index] = _orientation[last];
+        _scale[index] = _scale[last];
+        _localMatrix[index] = _localMatrix[last];
+        _worldMatrix[index] = _worldMatrix[last];
+        _indexOfNode[_nodeOfIndex[index]] = index;
+    }
+    
+    _nodeOfIndex.pop_back();
+    _parentNode.pop_back();
+    _parentIndex.pop_back();
+    _firstChild.pop_back();
+    _childCount.pop_back();
+    _position.pop_back();
+    _orientation.pop_back();
+    _scale.pop_back();
+    _localMatrix.pop_back();
+    _worldMatrix.pop_back();
+    
+    _indexOfNode[node] = InvalidNode;
+    _freeNodes.push_back(node);
+    _structureDirty = true;
+}
+
+void TransformHierarchy::clear() {
+    _nodeOfIndex.clear();
+    _parentNode.clear();
+    _parentIndex.clear();
+    _firstChild.clear();
+    _childCount.clear();
+    _position.clear();
+    _orientation.clear();
+    _scale.clear();
+    _localMatrix.clear();
+    _worldMatrix.clear();
+    _localDirty.clear();
+    _worldUpdated.clear();
+    _levelOffsets.clear();
+    _indexOfNode.clear();
+    _freeNodes.clear();
+    _structureDirty = false;
+    _anyDirty = false;
+    _anyUpdated = false;
+}
+
+bool TransformHierarchy::setParent(NodeId node, NodeId parent) {
+    if (!isValid(node)) return false;
+    if (parent != InvalidNode && !isValid(parent)) return false;
+    
+    // Refuse to create a cycle.
+    for (NodeId ancestor = parent; ancestor != InvalidNode; ancestor = _parentNode[_indexOfNode[ancestor]]) {
+        if (ancestor == node) return false;
+    }
+    
+    std::uint32_t index = _indexOfNode[node];
+    if (_parentNode[index] != parent) {
+        _parentNode[index] = parent;
+        _structureDirty = true;
+    }
+    return true;
+}
+
+void TransformHierarchy::setLocalTransform(NodeId node, const Vector3f& position, const Quaternion& orientation, const Vector3f& scale) {
+    std::uint32_t index = _indexOfNode[node];
+    _position[index] = position;
+    _orientation[index] = orientation;
+    _scale[index] = scale;
+    markDirty(index);
+}
+
+void TransformHierarchy::setLocalTransform(NodeId node, const Vector3f& position, const Vector3f& rotation, const Vector3f& scale) {
+    setLocalTransform(node, position, Quaternion::fromEuler(rotation), scale);
+}
+
+void TransformHierarchy::setPosition(NodeId node, const Vector3f& position) {
+    std::uint32_t index = _indexOfNode[node];
+    _position[index] = position;
+    markDirty(index);
+}
+
+void TransformHierarchy::setRotation(NodeId node, const Vector3f& rotation) {
+    setOrientation(node, Quaternion::fromEuler(rotation));
+}
+
+void TransformHierarchy::setOrientation(NodeId node, const Quaternion& orientation) {
+    std::uint32_t index = _indexOfNode[node];
+    _orientation[index] = orientation;
+    markDirty(index);
+}
+
+void TransformHierarchy::setScale(NodeId node, const Vector3f& scale) {
+    std::uint32_t index = _indexOfNode[node];
+    _scale[index] = scale;
+    markDirty(index);
+}
+
+bool TransformHierarchy::wasUpdated(NodeId node) const {
+    return testBit(_worldUpdated, _indexOfNode[node]);
+}
+
+void TransformHierarchy::update() {
+    if (_structureDirty) {
+        rebuildOrder();
+    }
+    
+    if (!_anyDirty) {
+        if (_anyUpdated) {
+            std::fill(_worldUpdated.begin(), _worldUpdated.end(), 0);
+            _anyUpdated = false;
+        }
+        return;
+    }
+    
+    Core::ThreadPool& pool = Core::ThreadPool::getInstance();
+    bool parallel = _parallelThreshold > 0 && pool.getThreadCount() > 1;
+    
+    if (parallel && _nodeOfIndex.size() >= _parallelThreshold) {
+        pool.parallelFor(_localDirty.size(), ParallelGrain / 64, [this](size_t first, size_t last) {
+            updateLocalMatrices(first << 6, std::min(last << 6, _nodeOfIndex.size()));
+        });
+    } else {
+        updateLocalMatrices(0, _nodeOfIndex.size());
+    }
+    
+    // Nodes whose world matrix changes: locally dirty ones plus, as the sweep
+    // reaches each of them, their child ranges.
+    _worldUpdated = _localDirty;
+    
+    // Consecutive narrow levels are swept serially in one go; a level is
+    // only split across threads when it is wide enough to pay for it.
+    size_t serialBegin = 0;
+    for (size_t level = 0; parallel && level + 1 < _levelOffsets.size(); ++level) {
+        size_t begin = _levelOffsets[level];
+        size_t end = _levelOffsets[level + 1];
+        
+        if (end - begin >= _parallelThreshold) {
+            propagate(serialBegin, begin);
+            pool.parallelFor(end - begin, ParallelGrain, [this, begin](size_t first, size_t last) {
+                forEachSetBit(_worldUpdated, begin + first, begin + last, [this](size_t i) {
+                    updateWorldMatrices(static_cast<std::uint32_t>(i));
+                });
+            });
+            // Flag children only after the level is done, so threads never
+            // write bitset words another thread is reading.
+            forEachSetBit(_worldUpdated, begin, end, [this](size_t i) {
+                setBits(_worldUpdated, _firstChild[i], _firstChild[i] + _childCount[i]);
+            });
+            serialBegin = end;
+        }
+    }
+    propagate(serialBegin, _nodeOfIndex.size());
+    
+    std::fill(_localDirty.begin(), _localDirty.end(), 0);
+    _anyDirty = false;
+    _anyUpdated = true;
+}
+
+void TransformHierarchy::markDirty(std::uint32_t index) {
+    _localDirty[index >> 6] |= std::uint64_t(1) << (index & 63);
+    _anyDirty = true;
+}
+
+void TransformHierarchy::rebuildOrder() {
+    size_t count = _nodeOfIndex.size();
+    
+    // Children lists in CSR form, keyed by the parent's current index.
+    std::vector<std::uint32_t> childOffsets(count + 1, 0);
+    std::vector<std::uint32_t> currentParent(count, NoParent);
+    for (size_t i = 0; i < count; ++i) {
+        if (_parentNode[i] != InvalidNode) {
+            currentParent[i] = _indexOfNode[_parentNode[i]];
+            childOffsets[currentParent[i] + 1]++;
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        childOffsets[i + 1] += childOffsets[i];
+    }
+    std::vector<std::uint32_t> children(childOffsets[count]);
+    std::vector<std::uint32_t> cursor(childOffsets.begin(), childOffsets.end() - 1);
+    for (size_t i = 0; i < count; ++i) {
+        if (currentParent[i] != NoParent) {
+            children[cursor[currentParent[i]]++] = static_cast<std::uint32_t>(i);
+        }
+    }
+    
+    // Breadth-first order: roots, then each level in turn.
+    std::vector<std::uint32_t> order;
+    order.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (currentParent[i] == NoParent) {
+            order.push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+    
+    _levelOffsets.clear();
+    _levelOffsets.push_back(0);
+    size_t levelBegin = 0;
+    while (levelBegin < order.size()) {
+        size_t levelEnd = order.size();
+        _levelOffsets.push_back(levelEnd);
+        for (size_t i = levelBegin; i < levelEnd; ++i) {
+            std::uint32_t node = order[i];
+            for (std::uint32_t c = childOffsets[node]; c < childOffsets[node + 1]; ++c) {
+                order.push_back(children[c]);
+            }
+        }
+        levelBegin = levelEnd;
+    }
+    
+    auto permute = [&order](auto& values) {
+        std::remove_reference_t<decltype(values)> sorted;
+        sorted.reserve(values.size());
+        for (std::uint32_t source : order) {
+            sorted.push_back(values[source]);
+        }
+        values.swap(sorted);
+    };
+    
+    permute(_nodeOfIndex);
+    permute(_parentNode);
+    permute(_position);
+    permute(_orientation);
+    permute(_scale);
+    permute(_localMatrix);
+    permute(_worldMatrix);
+    
+    for (size_t i = 0; i < count; ++i) {
+        _indexOfNode[_nodeOfIndex[i]] = static_cast<std::uint32_t>(i);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        _parentIndex[i] = _parentNode[i] == InvalidNode ? NoParent : _indexOfNode[_parentNode[i]];
+    }
+    
+    // Breadth-first order keeps each node's children contiguous.
+    std::fill(_childCount.begin(), _childCount.end(), 0);
+    for (size_t i = count; i-- > 0;) {
+        if (_parentIndex[i] != NoParent) {
+            _firstChild[_parentIndex[i]] = static_cast<std::uint32_t>(i);
+            _childCount[_parentIndex[i]]++;
+        }
+    }
+    
+    // Parents may have changed, so every world matrix is recomputed.
+    _localDirty.assign((count + 63) / 64, 0);
+    setBits(_localDirty, 0, count);
+    _worldUpdated.assign(_localDirty.size(), 0);
+    _anyDirty = count > 0;
+    _structureDirty = false;
+}
+
+void TransformHierarchy::updateLocalMatrices(size_t begin, size_t end) {
+    forEachSetBit(_localDirty, begin, end, [this](size_t i) {
+        _localMatrix[i] = Matrix3x4::compose(_position[i], _orientation[i], _scale[i]);
+    });
+}
+
+void TransformHierarchy::updateWorldMatrices(std::uint32_t index) {
+    std::uint32_t parent = _parentIndex[index];
+    if (parent == NoParent) {
+        _worldMatrix[index] = _localMatrix[index];
+    } else if (!testBit(_worldUpdated, parent)) {
+        // Only the node itself changed; an updated parent would already
+        // have written this matrix while doing its children.
+        Matrix3x4::multiply(_worldMatrix[parent], &_localMatrix[index], &_worldMatrix[index], 1);
+    }
+    
+    std::uint32_t first = _firstChild[index];
+    Matrix3x4::multiply(_worldMatrix[index], &_localMatrix[first], &_worldMatrix[first], _childCount[index]);
+}
+
+void TransformHierarchy::propagate(size_t begin, size_t end) {
+    forEachSetBit(_worldUpdated, begin, end, [this](size_t i) {
+        updateWorldMatrices(static_cast<std::uint32_t>(i));
+        setBits(_worldUpdated, _firstChild[i], _firstChild[i] + _childCount[i]);
+    });
+}
+
+} // namespace SFSim
\ No newline at end of file